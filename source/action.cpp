@@ -243,6 +243,7 @@ void Action::commit(DirtyList* dirty_list)
 						old_tile->decreaseWaypointCount();
 
 					new_tile->increaseWaypointCount();
+					map.invalidateSummary(data->position);
 
 					Position old_pos = waypoint->pos;
 					waypoint->pos = data->position;
@@ -359,6 +360,7 @@ void Action::undo(DirtyList* dirty_list)
 						old_tile->decreaseWaypointCount();
 
 					new_tile->increaseWaypointCount();
+					map.invalidateSummary(data->position);
 
 					Position old_pos = waypoint->pos;
 					waypoint->pos = data->position;
@@ -464,18 +466,20 @@ void BatchAction::commit()
 	}
 }
 
-void BatchAction::undo()
+bool BatchAction::undo()
 {
 	for(Action* action : std::views::reverse(batch)) {
 		action->undo(nullptr);
 	}
+	return true;
 }
 
-void BatchAction::redo()
+bool BatchAction::redo()
 {
 	for(Action* action : batch) {
 		action->redo(nullptr);
 	}
+	return true;
 }
 
 void BatchAction::merge(BatchAction* other)
@@ -567,7 +571,7 @@ void ActionQueue::addBatch(BatchAction* batch, int stacking_delay)
 	do {
 		if(!actions.empty()) {
 			BatchAction* lastAction = actions.back();
-			if(lastAction->type == batch->type && g_settings.getInteger(Config::GROUP_ACTIONS) && time(nullptr) - stacking_delay < lastAction->timestamp) {
+			if(lastAction->type == batch->type && lastAction->canMerge() && batch->canMerge() && g_settings.getInteger(Config::GROUP_ACTIONS) && time(nullptr) - stacking_delay < lastAction->timestamp) {
 				lastAction->merge(batch);
 				lastAction->timestamp = time(nullptr);
 				memory_size -= lastAction->memsize();
@@ -615,11 +619,11 @@ void ActionQueue::generateLabels()
 bool ActionQueue::undo()
 {
 	if(current > 0) {
-		current--;
-		BatchAction* batch = actions.at(current);
-		if(batch) {
-			batch->undo();
+		BatchAction* batch = actions.at(current - 1);
+		if(batch && !batch->undo()) {
+			return false;
 		}
+		current--;
 
 		// Update title
 		if(batch->isNoSelection() && editor.getMap().doChange()) {
@@ -634,8 +638,8 @@ bool ActionQueue::redo()
 {
 	if(current < actions.size()) {
 		BatchAction* batch = actions.at(current);
-		if(batch) {
-			batch->redo();
+		if(batch && !batch->redo()) {
+			return false;
 		}
 		current++;
 
@@ -684,6 +688,7 @@ wxString ActionQueue::createLabel(ActionIdentifier type)
 		case ACTION_ROTATE_ITEM: return "Rotate Item";
 		case ACTION_REPLACE_ITEMS: return "Replace";
 		case ACTION_CHANGE_PROPERTIES: return "Change Properties";
+		case ACTION_REMOVE_ITEMS: return "Remove Items";
 		default: return wxEmptyString;
 	}
 }
@@ -47,6 +47,7 @@ enum ActionIdentifier {
 	ACTION_ROTATE_ITEM,
 	ACTION_REPLACE_ITEMS,
 	ACTION_CHANGE_PROPERTIES,
+	ACTION_REMOVE_ITEMS,
 };
 
 enum ChangeType {
@@ -156,6 +157,7 @@ protected:
 	ActionIdentifier type;
 
 	friend class ActionQueue;
+	friend class BulkAction;
 };
 
 typedef std::vector<Action*> ActionVector;
@@ -182,10 +184,14 @@ protected:
 	BatchAction(Editor& editor, ActionIdentifier ident);
 
 	virtual void commit();
-	virtual void undo();
-	virtual void redo();
+	// False if the batch couldn't be undone or redone, the map is left as
+	// it was then
+	virtual bool undo();
+	virtual bool redo();
 
 	void merge(BatchAction* other);
+	// False for batches that must stay on their own in the undo queue
+	virtual bool canMerge() const noexcept { return true; }
 
 	Editor& editor;
 	int timestamp;
@@ -195,6 +201,7 @@ protected:
 	wxString label;
 
 	friend class ActionQueue;
+	friend class BulkOperation;
 };
 
 class ActionQueue
@@ -90,6 +90,7 @@ const wxBitmap& HistoryListBox::getIconBitmap(ActionIdentifier identifier) const
 		case ACTION_UNSELECT:
 			return unselect_bitmap;
 		case ACTION_DELETE_TILES:
+		case ACTION_REMOVE_ITEMS:
 			return delete_bitmap;
 		case ACTION_CUT_TILES:
 			return cut_bitmap;
@@ -29,6 +29,9 @@
 #include "main_menubar.h"
 #include "updater.h"
 #include "artprovider.h"
+#include "map_tile_exporter.h"
+#include "render_benchmark.h"
+#include "map_tab.h"
 
 #include "materials.h"
 #include "map.h"
@@ -125,16 +128,19 @@ bool Application::OnInit()
 	g_gui.LoadHotkeys();
 	ClientVersion::loadVersions();
 
+	m_file_to_open = wxEmptyString;
+	const bool has_map = ParseCommandLineMap(m_file_to_open);
+
 #ifdef _USE_PROCESS_COM
 	m_single_instance_checker = newd wxSingleInstanceChecker; //Instance checker has to stay alive throughout the applications lifetime
-	if(g_settings.getInteger(Config::ONLY_ONE_INSTANCE) && m_single_instance_checker->IsAnotherRunning()) {
+	// Command line modes always run in this process, not in the running editor
+	if(!IsCommandLineMode() && g_settings.getInteger(Config::ONLY_ONE_INSTANCE) && m_single_instance_checker->IsAnotherRunning()) {
 		RMEProcessClient client;
 		wxConnectionBase* connection = client.MakeConnection("localhost", "rme_host", "rme_talk");
 		if(connection) {
-			wxString fileName;
-			if(ParseCommandLineMap(fileName)) {
+			if(has_map) {
 				wxLogNull nolog; //We might get a timeout message if the file fails to open on the running instance. Let's not show that message.
-				connection->Execute(fileName);
+				connection->Execute(m_file_to_open);
 			}
 			connection->Disconnect();
 			wxDELETE(connection);
@@ -142,10 +148,13 @@ bool Application::OnInit()
 		wxDELETE(m_single_instance_checker);
 		return false; //Since we return false - OnExit is never called
 	}
-	// We act as server then
-	m_proc_server = newd RMEProcessServer();
-	if(!m_proc_server->Create("rme_host")) {
-		wxLogWarning("Could not register IPC service!");
+	// We act as server then, unless another editor already does
+	m_proc_server = nullptr;
+	if(!IsCommandLineMode() || !m_single_instance_checker->IsAnotherRunning()) {
+		m_proc_server = newd RMEProcessServer();
+		if(!m_proc_server->Create("rme_host")) {
+			wxLogWarning("Could not register IPC service!");
+		}
 	}
 #endif
 
@@ -164,9 +173,6 @@ bool Application::OnInit()
     std::string error;
     StringVector warnings;
 
-    m_file_to_open = wxEmptyString;
-    ParseCommandLineMap(m_file_to_open);
-
     g_gui.root = newd MainFrame(__W_RME_APPLICATION_NAME__, wxDefaultPosition, wxSize(700,500));
 	SetTopWindow(g_gui.root);
 	g_gui.SetTitle("");
@@ -274,12 +280,21 @@ void Application::OnEventLoopEnter(wxEventLoopBase* loop) {
     m_startup = false;
 
     //Don't try to create a map if we didn't load the client map.
-    if(ClientVersion::getLatestVersion() == nullptr)
+    if(ClientVersion::getLatestVersion() == nullptr) {
+        if(IsCommandLineMode())
+            FailCommandLine("No client version could be loaded, check clients.xml.");
         return;
+    }
 
     //Open a map.
     if(m_file_to_open != wxEmptyString) {
         g_gui.LoadMap(FileName(m_file_to_open));
+        if(!m_export_directory.empty())
+            ExportTiles();
+        else if(m_benchmark)
+            RunBenchmark();
+    } else if(IsCommandLineMode()) {
+        FailCommandLine("No map file was given.");
     } else if(!g_gui.IsWelcomeDialogShown() && g_gui.NewMap()) { //Open a new empty map
         // You generally don't want to save this map...
         g_gui.GetCurrentEditor()->clearChanges();
@@ -339,6 +354,12 @@ int Application::OnExit()
 	return 1;
 }
 
+int Application::OnRun()
+{
+	const int exit_code = wxApp::OnRun();
+	return m_exit_code != 0 ? m_exit_code : exit_code;
+}
+
 void Application::OnFatalException()
 {
 	////
@@ -346,11 +367,97 @@ void Application::OnFatalException()
 
 bool Application::ParseCommandLineMap(wxString& fileName)
 {
-	if(argc == 2) {
-		fileName = wxString(argv[1]);
-		return true;
+	// rme [map] [--export-tiles=<directory>] [--floor=<floor>]
+	//     [--benchmark[=<path.xml>]] [--benchmark-output=<report.json>]
+	// Both modes still open the main frame, so they need a display (xvfb
+	// on headless machines), see README.md
+	bool found = false;
+	for(int i = 1; i < argc; ++i) {
+		wxString argument = argv[i];
+		wxString value;
+		if(argument.StartsWith("--export-tiles=", &value)) {
+			m_export_directory = value;
+		} else if(argument.StartsWith("--benchmark-output=", &value)) {
+			m_benchmark_output = value;
+		} else if(argument == "--benchmark") {
+			m_benchmark = true;
+		} else if(argument.StartsWith("--benchmark=", &value)) {
+			m_benchmark = true;
+			m_benchmark_path = value;
+		} else if(argument.StartsWith("--floor=", &value)) {
+			long floor;
+			if(value.ToLong(&floor))
+				m_export_floor = floor;
+		} else if(!found) {
+			fileName = argument;
+			found = true;
+		}
 	}
-	return false;
+	return found;
+}
+
+void Application::FailCommandLine(const wxString& message)
+{
+	std::cerr << nstr(message) << std::endl;
+	m_exit_code = 1;
+	g_gui.root->Close(true);
+}
+
+void Application::ExportTiles()
+{
+	if(!g_gui.IsEditorOpen()) {
+		std::cerr << "Couldn't open " << nstr(m_file_to_open) << ", no tiles exported." << std::endl;
+		m_exit_code = 1;
+	} else {
+		MapTileExporter exporter(g_gui.GetCurrentMap(), m_export_floor);
+		exporter.setProgressCallback([](int done) {
+			std::cout << "Exporting tiles... " << done << "%" << std::endl;
+		});
+
+		if(exporter.exportTiles(nstr(m_export_directory))) {
+			std::cout << "Exported floor " << m_export_floor << " to " << nstr(m_export_directory)
+				<< ", zoom levels 0 to " << exporter.getMaxZoom() << "." << std::endl;
+		} else {
+			std::cerr << exporter.getError() << std::endl;
+			m_exit_code = 1;
+		}
+	}
+
+	// Nothing was changed, so this closes without asking to save
+	g_gui.root->Close(true);
+}
+
+void Application::RunBenchmark()
+{
+	MapTab* tab = g_gui.GetCurrentMapTab();
+	if(!g_gui.IsEditorOpen() || !tab) {
+		std::cerr << "Couldn't open " << nstr(m_file_to_open) << ", nothing was benchmarked." << std::endl;
+		m_exit_code = 1;
+	} else {
+		RenderBenchmark benchmark(g_gui.GetCurrentMap(), *tab->GetCanvas());
+		bool loaded = true;
+		if(m_benchmark_path.empty())
+			benchmark.createDefaultPath();
+		else
+			loaded = benchmark.load(nstr(m_benchmark_path));
+
+		if(!loaded || !benchmark.run()) {
+			std::cerr << benchmark.getError() << std::endl;
+			m_exit_code = 1;
+		} else if(m_benchmark_output.empty()) {
+			benchmark.writeReport(std::cout);
+		} else {
+			std::ofstream file(nstr(m_benchmark_output), std::ios::trunc | std::ios::out);
+			benchmark.writeReport(file);
+			if(!file.good()) {
+				std::cerr << "Could not write " << nstr(m_benchmark_output) << std::endl;
+				m_exit_code = 1;
+			}
+		}
+	}
+
+	// Nothing was changed, so this closes without asking to save
+	g_gui.root->Close(true);
 }
 
 MainFrame::MainFrame(const wxString& title, const wxPoint& pos, const wxSize& size) :
@@ -43,13 +43,30 @@ public:
     virtual void OnEventLoopEnter(wxEventLoopBase* loop);
 	virtual void MacOpenFiles(const wxArrayString& fileNames);
 	virtual int OnExit();
+	// The exit code of the process, wxWidgets ignores what OnExit returns
+	virtual int OnRun();
 	void Unload();
 
 private:
     bool m_startup;
     wxString m_file_to_open;
+	// Set by --export-tiles, the map is exported and the editor closes again
+	wxString m_export_directory;
+	int m_export_floor = rme::MapGroundLayer;
+	// Non-zero once a command line mode failed
+	int m_exit_code = 0;
+	// Set by --benchmark, a camera path is replayed and the editor closes again
+	bool m_benchmark = false;
+	wxString m_benchmark_path;
+	wxString m_benchmark_output;
 	void FixVersionDiscrapencies();
 	bool ParseCommandLineMap(wxString& fileName);
+	// Set when the editor only runs a command line mode and closes again
+	bool IsCommandLineMode() const { return !m_export_directory.empty() || m_benchmark; }
+	// Prints the error and closes the editor with a non-zero exit code
+	void FailCommandLine(const wxString& message);
+	void ExportTiles();
+	void RunBenchmark();
 
 	virtual void OnFatalException();
 
@@ -23,6 +23,9 @@
 BaseMap::BaseMap() :
 	allocator(),
 	tilecount(0),
+	render_generation(0),
+	tile_revision(0),
+	summary_generation(1),
 	root(*this)
 {
 	////
@@ -33,6 +36,19 @@ BaseMap::~BaseMap()
 	////
 }
 
+bool BaseMap::getChangesSince(uint32_t revision, PositionVector& positions) const
+{
+	uint32_t count = tile_revision - revision;
+	if(count > ChangeLogSize)
+		return false;
+
+	positions.reserve(positions.size() + count);
+	for(uint32_t i = revision; i != tile_revision; ++i) {
+		positions.push_back(change_log[i % ChangeLogSize]);
+	}
+	return true;
+}
+
 void BaseMap::clear(bool del)
 {
 	PositionVector pos_vec;
@@ -45,6 +61,50 @@ void BaseMap::clear(bool del)
 	}
 }
 
+void BaseMap::getLeaves(std::vector<QTreeNode*>& leaves)
+{
+	std::vector<QTreeNode*> nodes { &root };
+	while(!nodes.empty()) {
+		QTreeNode* node = nodes.back();
+		nodes.pop_back();
+		if(node->isLeaf) {
+			leaves.push_back(node);
+			continue;
+		}
+
+		// Reversed, so the first child comes off the stack first
+		for(int i = rme::MapLayers - 1; i >= 0; --i) {
+			if(QTreeNode* child = node->child[i])
+				nodes.push_back(child);
+		}
+	}
+}
+
+const LeafSummary& BaseMap::getSummary(QTreeNode* leaf)
+{
+	ASSERT(leaf->isLeaf);
+	LeafSummary& summary = leaf->summary;
+	if(summary.generation != summary_generation) {
+		summary.clear();
+		for(Floor* floor : leaf->array) {
+			if(!floor)
+				continue;
+
+			for(const TileLocation& location : floor->locs) {
+				summary.add(location);
+			}
+		}
+		summary.generation = summary_generation;
+	}
+	return summary;
+}
+
+void BaseMap::invalidateSummary(const Position& position)
+{
+	if(QTreeNode* leaf = root.getLeaf(position.x, position.y))
+		leaf->summary.generation = 0;
+}
+
 void BaseMap::clearVisible(uint32_t mask)
 {
 	root.clearVisible(mask);
@@ -119,6 +179,10 @@ void BaseMap::setTile(int x, int y, int z, Tile* new_tile, bool remove)
 
 	if ((remove && old_tile) || new_tile)
 		updateUniqueIds(remove ? old_tile : nullptr, new_tile);
+	if (old_tile || new_tile) {
+		updateItemIndex(old_tile, new_tile);
+		updateStatistics(old_tile, new_tile);
+	}
 
 	if (remove) {
 		delete old_tile;
@@ -148,8 +212,11 @@ Tile* BaseMap::swapTile(int x, int y, int z, Tile* new_tile)
 	QTreeNode* leaf = root.getLeafForce(x, y);
 	Tile* old_tile = leaf->setTile(x, y, z, new_tile);
 
-	if (old_tile || new_tile)
+	if (old_tile || new_tile) {
 		updateUniqueIds(old_tile, new_tile);
+		updateItemIndex(old_tile, new_tile);
+		updateStatistics(old_tile, new_tile);
+	}
 
 	return old_tile;
 }
@@ -24,6 +24,8 @@
 #include "map_allocator.h"
 #include "tile.h"
 
+#include <array>
+
 // Class declarations
 class QTreeNode;
 class BaseMap;
@@ -101,6 +103,8 @@ public:
 	// Get a Quad Tree Leaf from the map
 	QTreeNode* getLeaf(int x, int y) { return root.getLeaf(x, y); }
 	QTreeNode* createLeaf(int x, int y) { return root.getLeafForce(x, y); }
+	// All leaves, in the order MapIterator visits them
+	void getLeaves(std::vector<QTreeNode*>& leaves);
 
 	// Assigns a tile, it might seem pointless to provide position, but it is not, as the passed tile may be nullptr
 	void setTile(int x, int y, int z, Tile* new_tile, bool remove = false);
@@ -115,13 +119,51 @@ public:
 
 	uint64_t getTileCount() const noexcept { return tilecount; }
 
+	// Replacing a tile marks its floor as changed. Code that edits tiles in
+	// place instead (bulk removals, house and spawn bookkeeping) calls this
+	// so cached renderings of the whole map are dropped.
+	void invalidateRender() noexcept { ++render_generation; }
+	uint32_t getRenderGeneration() const noexcept { return render_generation; }
+	// Increases whenever any tile of the map is replaced
+	uint32_t getTileRevision() const noexcept { return tile_revision; }
+	// Positions of the tiles replaced after the given tile revision, false if
+	// more tiles were replaced since than the change log keeps
+	bool getChangesSince(uint32_t revision, PositionVector& positions) const;
+
+	// Summary of the tiles of a leaf, rebuilt first if it went stale. Leaves
+	// only hold their own summary, so worker threads may ask for different
+	// leaves at the same time.
+	const LeafSummary& getSummary(QTreeNode* leaf);
+	// New tiles are added to the summary of their leaf, replacing or
+	// removing one makes it stale. Code that adds to tiles in place calls
+	// these, for one leaf or for all of them.
+	void invalidateSummary(const Position& position);
+	void invalidateSummaries() noexcept {
+		if(++summary_generation == 0)
+			++summary_generation;
+	}
+
+	static constexpr uint32_t ChangeLogSize = 4096;
+
 public:
 	MapAllocator allocator;
 
 protected:
 	virtual void updateUniqueIds(Tile* old_tile, Tile* new_tile) { }
+	// Called with the tile that actually left the map, even when it is kept
+	virtual void updateItemIndex(Tile* old_tile, Tile* new_tile) { }
+	virtual void updateStatistics(Tile* old_tile, Tile* new_tile) { }
+	void logChange(int x, int y, int z) noexcept {
+		change_log[tile_revision % ChangeLogSize] = Position(x, y, z);
+		++tile_revision;
+	}
 
 	uint64_t tilecount;
+	uint32_t render_generation;
+	uint32_t tile_revision;
+	uint32_t summary_generation;
+	// Ring of the last replaced tiles, indexed by tile revision
+	std::array<Position, ChangeLogSize> change_log;
 
 	QTreeNode root; // The Quad Tree root
 
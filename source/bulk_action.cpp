@@ -0,0 +1,343 @@
+//////////////////////////////////////////////////////////////////////
+// This file is part of Remere's Map Editor
+//////////////////////////////////////////////////////////////////////
+// Remere's Map Editor is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// Remere's Map Editor is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <http://www.gnu.org/licenses/>.
+//////////////////////////////////////////////////////////////////////
+
+#include "main.h"
+
+#include "bulk_action.h"
+#include "gui.h"
+#include "iomap_otbm.h"
+#include "settings.h"
+
+#include <wx/filename.h>
+
+namespace {
+	// The tiles are written as OTBM nodes, all items as nodes so the ground
+	// and the order of the items come back as they were
+	void writeTile(const IOMap& version, NodeFileWriteHandle& writer, const Tile* tile)
+	{
+		const Position& position = tile->getPosition();
+		writer.addNode(OTBM_TILE);
+		writer.addU16(position.x);
+		writer.addU16(position.y);
+		writer.addU8(position.z);
+		writer.addU32(tile->getHouseID());
+		writer.addU16(tile->getMapFlags());
+		writer.addU8(tile->ground ? 1 : 0);
+		if(tile->ground)
+			tile->ground->serializeItemNode_OTBM(version, writer);
+		for(const Item* item : tile->items) {
+			item->serializeItemNode_OTBM(version, writer);
+		}
+		writer.endNode();
+	}
+
+	Tile* readTile(const IOMap& version, Map& map, BinaryNode* node)
+	{
+		uint8_t type;
+		uint16_t x, y;
+		uint8_t z;
+		uint32_t house_id;
+		uint16_t flags;
+		uint8_t has_ground;
+		if(!node->getByte(type) || type != OTBM_TILE || !node->getU16(x) || !node->getU16(y) || !node->getU8(z) ||
+				!node->getU32(house_id) || !node->getU16(flags) || !node->getU8(has_ground))
+			return nullptr;
+
+		Tile* tile = map.allocator(map.createTileL(x, y, z));
+		if(house_id != 0)
+			tile->setHouse(map.houses.getHouse(house_id));
+		tile->setMapFlags(flags);
+
+		BinaryNode* child = node->getChild();
+		if(child) do {
+			uint8_t item_type;
+			if(!child->getByte(item_type) || item_type != OTBM_ITEM)
+				continue;
+
+			// The first item node is the ground even if it can't be read
+			const bool ground = (has_ground != 0);
+			has_ground = 0;
+
+			Item* item = Item::Create_OTBM(version, child);
+			if(!item)
+				continue;
+
+			item->unserializeItemNode_OTBM(version, child);
+			if(ground) {
+				delete tile->ground;
+				tile->ground = item;
+			} else {
+				tile->items.push_back(item);
+			}
+		} while(child->advance());
+
+		tile->update();
+		return tile;
+	}
+}
+
+BulkAction::BulkAction(Editor& editor, ActionIdentifier ident) :
+	BatchAction(editor, ident),
+	file_end(0)
+{
+	////
+}
+
+BulkAction::~BulkAction()
+{
+	if(file.IsOpened())
+		file.Close();
+	if(!filename.IsEmpty())
+		wxRemoveFile(filename);
+}
+
+bool BulkAction::useSwapFile()
+{
+	if(file.IsOpened())
+		return true;
+
+	filename = wxFileName::CreateTempFileName("rme-undo", &file);
+	return !filename.IsEmpty() && file.IsOpened();
+}
+
+void BulkAction::addAndCommitAction(Action* action)
+{
+	const size_t index = batch.size();
+	BatchAction::addAndCommitAction(action);
+	if(batch.size() > index)
+		swapOut(index);
+}
+
+bool BulkAction::swapOut(size_t index)
+{
+	if(!file.IsOpened() || index >= batch.size())
+		return false;
+
+	Action* action = batch[index];
+	ChangeList kept;
+	ChangeList moved;
+	for(Change* change : action->changes) {
+		const Tile* tile = (change->getType() == CHANGE_TILE ? reinterpret_cast<Tile*>(change->getData()) : nullptr);
+		if(tile && !tile->creature && !tile->spawn && !tile->isSelected())
+			moved.push_back(change);
+		else
+			kept.push_back(change);
+	}
+	if(moved.empty())
+		return false;
+
+	const VirtualIOMap version(MapVersion(MAP_OTBM_4, CLIENT_VERSION_NONE));
+	MemoryNodeFileWriteHandle writer;
+	writer.addNode(0);
+	for(const Change* change : moved) {
+		writeTile(version, writer, reinterpret_cast<Tile*>(change->getData()));
+	}
+	writer.endNode();
+
+	// Chunks are written where they were before if they still fit there
+	if(swapped.size() <= index)
+		swapped.resize(index + 1);
+	Swapped& slot = swapped[index];
+	const uint64_t size = writer.getSize();
+	if(size > slot.capacity) {
+		slot.offset = file_end;
+		slot.capacity = size;
+		file_end += size;
+	}
+
+	if(file.Seek(wxFileOffset(slot.offset)) == wxInvalidOffset || file.Write(writer.getMemory(), size) != size)
+		return false;
+
+	slot.size = size;
+	slot.tiles = moved.size();
+	for(Change* change : moved) {
+		delete change;
+	}
+	action->changes.swap(kept);
+	return true;
+}
+
+bool BulkAction::swapIn(size_t index)
+{
+	if(index >= swapped.size() || swapped[index].size == 0)
+		return true;
+
+	Swapped& slot = swapped[index];
+	std::vector<uint8_t> buffer(slot.size);
+	if(file.Seek(wxFileOffset(slot.offset)) == wxInvalidOffset || file.Read(buffer.data(), buffer.size()) != ssize_t(buffer.size()))
+		return false;
+
+	const VirtualIOMap version(MapVersion(MAP_OTBM_4, CLIENT_VERSION_NONE));
+	MemoryNodeFileReadHandle reader(buffer.data(), buffer.size());
+	BinaryNode* root = reader.getRootNode();
+	BinaryNode* node = (root ? root->getChild() : nullptr);
+	TileVector tiles;
+	bool read = true;
+	if(node) do {
+		Tile* tile = readTile(version, editor.getMap(), node);
+		if(!tile) {
+			read = false;
+			break;
+		}
+		tiles.push_back(tile);
+	} while(node->advance());
+
+	if(!read || tiles.size() != slot.tiles) {
+		for(Tile* tile : tiles) {
+			delete tile;
+		}
+		return false;
+	}
+
+	Action* action = batch[index];
+	for(Tile* tile : tiles) {
+		action->addChange(newd Change(tile));
+	}
+	slot.size = 0;
+	return true;
+}
+
+bool BulkAction::apply(size_t index, bool undo)
+{
+	if(!swapIn(index))
+		return false;
+
+	if(undo)
+		batch[index]->undo(nullptr);
+	else
+		batch[index]->redo(nullptr);
+	swapOut(index);
+	return true;
+}
+
+void BulkAction::reportSwapError(bool undo) const
+{
+	g_gui.PopupDialog("Error", wxString::Format("The tiles of a bulk action could not be read back from %s, it was not %s.",
+		filename, undo ? "undone" : "redone"), wxOK);
+}
+
+bool BulkAction::undo()
+{
+	for(size_t index = batch.size(); index-- > 0; ) {
+		if(apply(index, true))
+			continue;
+
+		// The chunks undone until then are redone, so the map stays as it was
+		for(size_t done = index + 1; done < batch.size(); ++done) {
+			apply(done, false);
+		}
+		reportSwapError(true);
+		return false;
+	}
+	return true;
+}
+
+bool BulkAction::redo()
+{
+	for(size_t index = 0; index < batch.size(); ++index) {
+		if(apply(index, false))
+			continue;
+
+		for(size_t done = index; done-- > 0; ) {
+			apply(done, true);
+		}
+		reportSwapError(false);
+		return false;
+	}
+	return true;
+}
+
+BulkOperation::BulkOperation(Editor& editor, ActionIdentifier type) :
+	editor(editor),
+	traversal(editor.getMap()),
+	batch(nullptr),
+	chunk(nullptr),
+	chunk_memory(0),
+	change_count(0),
+	tile_count(0)
+{
+	if(editor.IsLive()) {
+		batch = editor.createBatch(type);
+	} else {
+		BulkAction* bulk = newd BulkAction(editor, type);
+		if(g_settings.getBoolean(Config::BULK_UNDO_ON_DISK))
+			bulk->useSwapFile();
+		batch = bulk;
+	}
+}
+
+BulkOperation::~BulkOperation()
+{
+	commit();
+}
+
+bool BulkOperation::addTile(Tile* new_tile, size_t memory, int64_t changed, size_t done, size_t total)
+{
+	if(!chunk)
+		chunk = editor.createAction(batch);
+	chunk_memory += memory;
+	chunk->addChange(newd Change(new_tile));
+	change_count += changed;
+	++tile_count;
+
+	if(chunk->size() < TilesPerChunk && chunk_memory < ChunkMemory)
+		return true;
+
+	commitChunk();
+	return !progress || progress(50 + int(done * 50 / total));
+}
+
+void BulkOperation::commitChunk()
+{
+	if(!chunk)
+		return;
+
+	batch->addAndCommitAction(chunk);
+	chunk = nullptr;
+	chunk_memory = 0;
+}
+
+void BulkOperation::commit()
+{
+	if(!batch)
+		return;
+
+	commitChunk();
+	editor.addBatch(batch);
+	editor.updateActions();
+	batch = nullptr;
+}
+
+void BulkOperation::rollback()
+{
+	if(!batch)
+		return;
+
+	delete chunk;
+	chunk = nullptr;
+	chunk_memory = 0;
+
+	// What can't be undone stays in the undo queue
+	if(batch->undo()) {
+		delete batch;
+	} else {
+		editor.addBatch(batch);
+		editor.updateActions();
+	}
+	batch = nullptr;
+	editor.getMap().invalidateRender();
+}
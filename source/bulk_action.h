@@ -0,0 +1,238 @@
+//////////////////////////////////////////////////////////////////////
+// This file is part of Remere's Map Editor
+//////////////////////////////////////////////////////////////////////
+// Remere's Map Editor is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// Remere's Map Editor is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <http://www.gnu.org/licenses/>.
+//////////////////////////////////////////////////////////////////////
+
+#ifndef RME_BULK_ACTION_H_
+#define RME_BULK_ACTION_H_
+
+#include "action.h"
+#include "editor.h"
+#include "map_traversal.h"
+
+#include <wx/file.h>
+
+// A batch made of many committed chunks of tiles. The tiles a chunk needs
+// to be undone or redone can be kept in a temporary file instead of memory,
+// they are read back a chunk at a time. Tiles with creatures or spawns and
+// selected tiles always stay in memory.
+class BulkAction : public BatchAction
+{
+public:
+	BulkAction(Editor& editor, ActionIdentifier ident);
+	virtual ~BulkAction();
+
+	// False if the file couldn't be created, the tiles stay in memory then
+	bool useSwapFile();
+	bool isUsingSwapFile() const noexcept { return file.IsOpened(); }
+	uint64_t getSwapFileSize() const noexcept { return file_end; }
+
+	void addAndCommitAction(Action* action) override;
+
+protected:
+	bool undo() override;
+	bool redo() override;
+	// The chunks and the swap file belong to this batch only
+	bool canMerge() const noexcept override { return false; }
+
+private:
+	// Where the tiles of a chunk are in the file
+	struct Swapped {
+		uint64_t offset = 0;
+		uint64_t capacity = 0;
+		uint64_t size = 0;
+		size_t tiles = 0;
+	};
+
+	// Moves the tiles of the chunk to the file, false if they stay in memory
+	bool swapOut(size_t index);
+	// Reads all tiles of the chunk back or none of them, the file keeps them
+	// if it fails
+	bool swapIn(size_t index);
+	// Undoes or redoes one chunk, false if its tiles couldn't be read back
+	bool apply(size_t index, bool undo);
+	void reportSwapError(bool undo) const;
+
+	wxFile file;
+	wxString filename;
+	uint64_t file_end;
+	// By index of the chunk, chunks merged later on stay in memory
+	std::vector<Swapped> swapped;
+};
+
+// Runs a tool over the whole map without building one huge action: the
+// tiles to change are found on all cores, then copied, changed and
+// committed a chunk at a time. The chunks form one batch, so the tool is
+// undone and redone as a whole. In live sessions the chunks are sent like
+// any other batch and kept in memory.
+class BulkOperation
+{
+public:
+	BulkOperation(Editor& editor, ActionIdentifier type);
+	// Adds what was committed to the undo queue, if it wasn't rolled back
+	~BulkOperation();
+
+	BulkOperation(const BulkOperation&) = delete;
+	BulkOperation& operator=(const BulkOperation&) = delete;
+
+	// To narrow down the tiles that are looked at
+	MapTraversal& getTraversal() noexcept { return traversal; }
+	// Called with 0 to 100, finding the tiles is the first half. Returning
+	// false stops the operation, the chunks committed until then stay.
+	void setProgress(std::function<bool(int)> callback) { progress = std::move(callback); }
+
+	// find(tile) is called on the worker threads and is true for the tiles
+	// to change, edit(tile) then gets a copy of each of them and returns how
+	// many things it changed. False if it was stopped.
+	template <typename Find, typename Edit>
+	bool run(Find find, Edit edit);
+	// Deletes grounds and items lying on tiles for which predicate(item) is
+	// true, the contents of containers are not checked
+	template <typename Predicate>
+	bool removeItems(Predicate predicate);
+	// Replaces the tiles for which predicate(tile) is true by empty ones
+	template <typename Predicate>
+	bool removeTiles(Predicate predicate);
+
+	int64_t getChangeCount() const noexcept { return change_count; }
+	uint64_t getTileCount() const noexcept { return tile_count; }
+
+	// Adds the committed chunks to the undo queue as one batch
+	void commit();
+	// Undoes the committed chunks, nothing is added to the undo queue unless
+	// they couldn't be read back from the swap file
+	void rollback();
+
+	static constexpr size_t TilesPerChunk = 4096;
+	static constexpr size_t ChunkMemory = 16 * 1024 * 1024;
+
+private:
+	// The tiles for which find(tile) is true, in map order
+	template <typename Find>
+	bool findTiles(Find find, TileVector& tiles);
+	// Adds the change to the chunk, memory is what it keeps to be undone.
+	// False if the progress callback stopped the operation after the chunk
+	// was committed.
+	bool addTile(Tile* new_tile, size_t memory, int64_t changed, size_t done, size_t total);
+	void commitChunk();
+
+	Editor& editor;
+	MapTraversal traversal;
+	BatchAction* batch;
+	Action* chunk;
+	size_t chunk_memory;
+	std::function<bool(int)> progress;
+	int64_t change_count;
+	uint64_t tile_count;
+};
+
+template <typename Find>
+inline bool BulkOperation::findTiles(Find find, TileVector& tiles)
+{
+	if(!batch)
+		return false;
+
+	if(progress) {
+		traversal.setProgress([this](int done) {
+			if(!progress(done / 2))
+				traversal.cancel();
+		});
+	}
+
+	return traversal.forEachTile(tiles,
+		[&find](TileVector& found, Tile* tile) {
+			if(find(tile))
+				found.push_back(tile);
+		},
+		[](TileVector& all, TileVector& found) {
+			all.insert(all.end(), found.begin(), found.end());
+		});
+}
+
+template <typename Find, typename Edit>
+inline bool BulkOperation::run(Find find, Edit edit)
+{
+	TileVector tiles;
+	if(!findTiles(find, tiles))
+		return false;
+
+	// The tiles of earlier chunks may be on disk by now, but every tile is
+	// only looked at once
+	Map& map = editor.getMap();
+	for(size_t i = 0; i < tiles.size(); ++i) {
+		Tile* new_tile = tiles[i]->deepCopy(map);
+		const int64_t changed = edit(new_tile);
+		if(changed == 0) {
+			delete new_tile;
+			continue;
+		}
+		if(!addTile(new_tile, new_tile->memsize(), changed, i + 1, tiles.size()))
+			return false;
+	}
+	commitChunk();
+	return true;
+}
+
+template <typename Predicate>
+inline bool BulkOperation::removeItems(Predicate predicate)
+{
+	return run(
+		[&predicate](Tile* tile) {
+			if(tile->ground && predicate(tile->ground))
+				return true;
+			for(Item* item : tile->items) {
+				if(predicate(item))
+					return true;
+			}
+			return false;
+		},
+		[&predicate](Tile* tile) {
+			int64_t removed = 0;
+			if(tile->ground && predicate(tile->ground)) {
+				delete tile->ground;
+				tile->ground = nullptr;
+				++removed;
+			}
+			for(auto it = tile->items.begin(); it != tile->items.end(); ) {
+				if(predicate(*it)) {
+					delete *it;
+					it = tile->items.erase(it);
+					++removed;
+				} else {
+					++it;
+				}
+			}
+			return removed;
+		});
+}
+
+template <typename Predicate>
+inline bool BulkOperation::removeTiles(Predicate predicate)
+{
+	TileVector tiles;
+	if(!findTiles(predicate, tiles))
+		return false;
+
+	Map& map = editor.getMap();
+	for(size_t i = 0; i < tiles.size(); ++i) {
+		Tile* new_tile = map.allocator(tiles[i]->getLocation());
+		if(!addTile(new_tile, tiles[i]->memsize(), 1, i + 1, tiles.size()))
+			return false;
+	}
+	commitChunk();
+	return true;
+}
+
+#endif
@@ -160,6 +160,22 @@ std::string as_upper_str(const std::string& other)
 	return ret;
 }
 
+void writeJsonString(std::ostream& stream, const std::string& str)
+{
+	static const char hex[] = "0123456789abcdef";
+	stream << '"';
+	for(char c : str) {
+		if(c == '"' || c == '\\') {
+			stream << '\\' << c;
+		} else if(uint8_t(c) < 0x20) {
+			stream << "\\u00" << hex[uint8_t(c) >> 4] << hex[uint8_t(c) & 0xF];
+		} else {
+			stream << c;
+		}
+	}
+	stream << '"';
+}
+
 bool isFalseString(std::string& str)
 {
 	if(str == "false" || str == "0" || str == "" || str == "no" || str == "not") {
@@ -56,6 +56,8 @@ void to_lower_str(std::string& source);
 void to_upper_str(std::string& source);
 std::string as_lower_str(const std::string& other);
 std::string as_upper_str(const std::string& other);
+// Writes str as a quoted JSON string, for reports that are streamed by hand
+void writeJsonString(std::ostream& stream, const std::string& str);
 
 // isFalseString returns true if the string is either "0", "false", "no", "not" or blank
 // isTrueString returns the opposite value of isFalseString
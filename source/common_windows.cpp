@@ -23,6 +23,7 @@
 
 #include "items.h"
 #include "map.h"
+#include "map_traversal.h"
 #include "item.h"
 #include "complexitem.h"
 #include "raw_brush.h"
@@ -197,20 +198,27 @@ struct MapConversionContext
 	typedef std::map<std::string, CreatureInfo> CreatureMap;
 	CreatureMap creature_types;
 
-	void operator()(Map& map, Tile* tile, long long done)
+	// Called from the worker threads with a map per chunk
+	static void add(CreatureMap& creatures, Tile* tile)
 	{
 		if(tile->creature) {
-			CreatureMap::iterator f = creature_types.find(tile->creature->getName());
-			if(f == creature_types.end()) {
+			CreatureMap::iterator f = creatures.find(tile->creature->getName());
+			if(f == creatures.end()) {
 				CreatureInfo info = {
 					tile->creature->getName(),
 					tile->creature->isNpc(),
 					tile->creature->getLookType()
 				};
-				creature_types[tile->creature->getName()] = info;
+				creatures[tile->creature->getName()] = info;
 			}
 		}
 	}
+
+	// Keeps the first creature of every name in map order
+	static void merge(CreatureMap& creatures, CreatureMap& chunk)
+	{
+		creatures.insert(chunk.begin(), chunk.end());
+	}
 };
 
 void MapPropertiesWindow::OnClickOK(wxCommandEvent& WXUNUSED(event))
@@ -255,7 +263,8 @@ void MapPropertiesWindow::OnClickOK(wxCommandEvent& WXUNUSED(event))
 
 			// Remember all creatures types on the map
 			MapConversionContext conversion_context;
-			foreach_TileOnMap(map, conversion_context);
+			MapTraversal traversal(map);
+			traversal.forEachTile(conversion_context.creature_types, MapConversionContext::add, MapConversionContext::merge);
 
 			// Perform the conversion
 			map.convert(new_ver, true);
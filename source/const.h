@@ -58,6 +58,12 @@ constexpr int MaxActionId = 65535;
 // Position indicator when using the position control
 constexpr int PositionIndicatorDuration = 3000;
 
+// Leaves the map drawer keeps cached before dropping the ones off screen
+constexpr size_t RenderCacheMinLeaves = 4096;
+
+// Colorized outfit images kept in memory, 4 KB each
+constexpr size_t OutfitCacheSize = 2048;
+
 } // namespace rme
 
 #endif // RME_CONST_H_
@@ -22,6 +22,10 @@
 #include "brush.h"
 #include "creatures.h"
 #include "creature_brush.h"
+#include "worker_pool.h"
+
+#include <atomic>
+#include <thread>
 
 CreatureDatabase g_creatures;
 
@@ -293,8 +297,36 @@ bool CreatureDatabase::loadFromXML(const FileName& filename, bool standard, wxSt
 	return true;
 }
 
+void CreatureDatabase::addImportedCreatureType(CreatureType* creatureType)
+{
+	CreatureType* current = (*this)[creatureType->name];
+	if(current) {
+		*current = *creatureType;
+		delete creatureType;
+		return;
+	}
+
+	creature_map[as_lower_str(creatureType->name)] = creatureType;
+
+	Tileset* tileSet = nullptr;
+	if(creatureType->isNpc) {
+		tileSet = g_materials.tilesets["NPCs"];
+	} else {
+		tileSet = g_materials.tilesets["Others"];
+	}
+	ASSERT(tileSet != nullptr);
+
+	Brush* brush = newd CreatureBrush(creatureType);
+	g_brushes.addBrush(brush);
+
+	TilesetCategory* tileSetCategory = tileSet->getCategory(TILESET_CREATURE);
+	tileSetCategory->brushlist.push_back(brush);
+}
+
 bool CreatureDatabase::importXMLFromOT(const FileName& filename, wxString& error, wxArrayString& warnings)
 {
+	wxStopWatch watch;
+
 	pugi::xml_document doc;
 	pugi::xml_parse_result result = doc.load_file(filename.GetFullPath().mb_str());
 	if(!result) {
@@ -304,6 +336,16 @@ bool CreatureDatabase::importXMLFromOT(const FileName& filename, wxString& error
 
 	pugi::xml_node node;
 	if((node = doc.child("monsters"))) {
+		// Parsing is independent per file, only merging touches the database
+		// and the brushes, so parse on a pool and merge here in file order.
+		struct ImportRecord {
+			FileName file;
+			std::string path;
+			CreatureType* creatureType = nullptr;
+			wxArrayString warnings;
+		};
+
+		std::vector<ImportRecord> records;
 		for(pugi::xml_node monsterNode = node.first_child(); monsterNode; monsterNode = monsterNode.next_sibling()) {
 			if(as_lower_str(monsterNode.name()) != "monster") {
 				continue;
@@ -314,66 +356,69 @@ bool CreatureDatabase::importXMLFromOT(const FileName& filename, wxString& error
 				continue;
 			}
 
-			FileName monsterFile(filename);
-			monsterFile.SetFullName(wxString(attribute.as_string(), wxConvUTF8));
+			ImportRecord& record = records.emplace_back();
+			record.file = filename;
+			record.file.SetFullName(wxString(attribute.as_string(), wxConvUTF8));
+			record.path = std::string(record.file.GetFullPath().mb_str());
+		}
 
-			pugi::xml_document monsterDoc;
-			pugi::xml_parse_result monsterResult = monsterDoc.load_file(monsterFile.GetFullPath().mb_str());
-			if(!monsterResult) {
-				continue;
-			}
+		std::atomic<size_t> next(0);
+		auto worker = [&records, &next]() {
+			for(size_t index = next++; index < records.size(); index = next++) {
+				ImportRecord& record = records[index];
 
-			CreatureType* creatureType = CreatureType::loadFromOTXML(monsterFile, monsterDoc, warnings);
-			if(creatureType) {
-				CreatureType* current = (*this)[creatureType->name];
-				if(current) {
-					*current = *creatureType;
-					delete creatureType;
-				} else {
-					creature_map[as_lower_str(creatureType->name)] = creatureType;
-
-					Tileset* tileSet = nullptr;
-					if(creatureType->isNpc) {
-						tileSet = g_materials.tilesets["NPCs"];
-					} else {
-						tileSet = g_materials.tilesets["Others"];
-					}
-					ASSERT(tileSet != nullptr);
-
-					Brush* brush = newd CreatureBrush(creatureType);
-					g_brushes.addBrush(brush);
-
-					TilesetCategory* tileSetCategory = tileSet->getCategory(TILESET_CREATURE);
-					tileSetCategory->brushlist.push_back(brush);
+				pugi::xml_document monsterDoc;
+				if(!monsterDoc.load_file(record.path.c_str())) {
+					record.warnings.push_back("Couldn't load monster file \"" + record.file.GetFullName() + "\"");
+					continue;
 				}
+				record.creatureType = CreatureType::loadFromOTXML(record.file, monsterDoc, record.warnings);
 			}
-		}
-	} else if((node = doc.child("monster")) || (node = doc.child("npc"))) {
-		CreatureType* creatureType = CreatureType::loadFromOTXML(filename, doc, warnings);
-		if(creatureType) {
-			CreatureType* current = (*this)[creatureType->name];
+		};
 
-			if(current) {
-				*current = *creatureType;
-				delete creatureType;
-			} else {
-				creature_map[as_lower_str(creatureType->name)] = creatureType;
+		size_t threadCount = WorkerPool::getThreadSetting();
+		threadCount = std::min(threadCount, records.size());
 
-				Tileset* tileSet = nullptr;
-				if(creatureType->isNpc) {
-					tileSet = g_materials.tilesets["NPCs"];
-				} else {
-					tileSet = g_materials.tilesets["Others"];
-				}
-				ASSERT(tileSet != nullptr);
+		std::vector<std::thread> threads;
+		for(size_t i = 1; i < threadCount; ++i) {
+			threads.emplace_back(worker);
+		}
+		worker();
+		for(std::thread& thread : threads) {
+			thread.join();
+		}
 
-				Brush* brush = newd CreatureBrush(creatureType);
-				g_brushes.addBrush(brush);
+		// Thousands of files tend to repeat the same handful of problems
+		std::map<wxString, size_t> warningCount;
+		std::vector<wxString> warningOrder;
+		size_t imported = 0;
+		for(ImportRecord& record : records) {
+			for(const wxString& warning : record.warnings) {
+				if(warningCount[warning]++ == 0) {
+					warningOrder.push_back(warning);
+				}
+			}
+			if(record.creatureType) {
+				addImportedCreatureType(record.creatureType);
+				++imported;
+			}
+		}
 
-				TilesetCategory* tileSetCategory = tileSet->getCategory(TILESET_CREATURE);
-				tileSetCategory->brushlist.push_back(brush);
+		for(const wxString& warning : warningOrder) {
+			size_t count = warningCount[warning];
+			if(count > 1) {
+				warnings.push_back(warning + wxString::Format(" (%zu times)", count));
+			} else {
+				warnings.push_back(warning);
 			}
 		}
+
+		g_gui.SetStatusText(wxString::Format("Imported %zu of %zu creature files in %ld ms.", imported, records.size(), watch.Time()));
+	} else if((node = doc.child("monster")) || (node = doc.child("npc"))) {
+		CreatureType* creatureType = CreatureType::loadFromOTXML(filename, doc, warnings);
+		if(creatureType) {
+			addImportedCreatureType(creatureType);
+		}
 	} else {
 		error = "This is not valid OT npc/monster data file.";
 		return false;
@@ -54,6 +54,12 @@ public:
 	bool importXMLFromOT(const FileName& filename, wxString& error, wxArrayString& warnings);
 
 	bool saveToXML(const FileName& filename);
+
+protected:
+	// Adds or overwrites a creature imported from OT data, creating its brush
+	void addImportedCreatureType(CreatureType* creatureType);
+
+	friend class DataCache;
 };
 
 class CreatureType
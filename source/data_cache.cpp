@@ -0,0 +1,390 @@
+//////////////////////////////////////////////////////////////////////
+// This file is part of Remere's Map Editor
+//////////////////////////////////////////////////////////////////////
+// Remere's Map Editor is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// Remere's Map Editor is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <http://www.gnu.org/licenses/>.
+//////////////////////////////////////////////////////////////////////
+
+#include "main.h"
+
+#include "data_cache.h"
+#include "filehandle.h"
+#include "items.h"
+#include "creatures.h"
+#include "graphics.h"
+#include "gui.h"
+
+namespace {
+	constexpr char CacheSignature[4] = {'R', 'M', 'E', 'C'};
+	// Bump whenever the layout of the snapshot or of ItemType/CreatureType changes
+	constexpr uint32_t CacheFormatVersion = 1;
+
+	class CacheWriter
+	{
+	public:
+		template<typename T>
+		void write(T value) {
+			static_assert(std::is_trivially_copyable_v<T>);
+			const uint8_t* ptr = reinterpret_cast<const uint8_t*>(&value);
+			buffer.insert(buffer.end(), ptr, ptr + sizeof(T));
+		}
+		void writeString(const std::string& str) {
+			write<uint32_t>(str.size());
+			buffer.insert(buffer.end(), str.begin(), str.end());
+		}
+
+		std::string buffer;
+	};
+
+	class CacheReader
+	{
+	public:
+		explicit CacheReader(const std::string& buffer) : buffer(buffer), position(0), error(false) {}
+
+		template<typename T>
+		T read() {
+			static_assert(std::is_trivially_copyable_v<T>);
+			T value = T();
+			if(!canRead(sizeof(T))) {
+				return value;
+			}
+			memcpy(&value, buffer.data() + position, sizeof(T));
+			position += sizeof(T);
+			return value;
+		}
+		std::string readString() {
+			uint32_t length = read<uint32_t>();
+			if(!canRead(length)) {
+				return std::string();
+			}
+			std::string str = buffer.substr(position, length);
+			position += length;
+			return str;
+		}
+
+		bool hasError() const noexcept { return error; }
+		bool isEnd() const noexcept { return position == buffer.size(); }
+
+	private:
+		bool canRead(size_t length) {
+			if(error || length > buffer.size() - position) {
+				error = true;
+				return false;
+			}
+			return true;
+		}
+
+		const std::string& buffer;
+		size_t position;
+		bool error;
+	};
+
+	void writeItemType(CacheWriter& writer, const ItemType& it)
+	{
+		writer.write<uint16_t>(it.id);
+		writer.write<uint16_t>(it.clientID);
+		writer.write<uint8_t>(it.group);
+		writer.write<uint8_t>(it.type);
+		writer.write<uint16_t>(it.volume);
+		writer.write<uint16_t>(it.maxTextLen);
+		writer.writeString(it.name);
+		writer.writeString(it.editorsuffix);
+		writer.writeString(it.description);
+		writer.write<float>(it.weight);
+		writer.write<int32_t>(it.attack);
+		writer.write<int32_t>(it.defense);
+		writer.write<int32_t>(it.armor);
+		writer.write<uint32_t>(it.charges);
+		writer.write<int32_t>(it.alwaysOnTopOrder);
+		writer.write<uint16_t>(it.rotateTo);
+
+		const bool flags[] = {
+			it.client_chargeable, it.extra_chargeable, it.ignoreLook,
+			it.isHangable, it.hookEast, it.hookSouth, it.canReadText, it.canWriteText,
+			it.allowDistRead, it.replaceable, it.decays,
+			it.stackable, it.moveable, it.alwaysOnBottom, it.pickupable, it.rotable,
+			it.floorChangeDown, it.floorChangeNorth, it.floorChangeSouth, it.floorChangeEast, it.floorChangeWest, it.floorChange,
+			it.unpassable, it.blockPickupable, it.blockMissiles, it.blockPathfinder, it.hasElevation,
+		};
+		uint32_t bits = 0;
+		for(size_t i = 0; i < std::size(flags); ++i) {
+			if(flags[i]) {
+				bits |= 1u << i;
+			}
+		}
+		writer.write<uint32_t>(bits);
+	}
+
+	void readItemType(CacheReader& reader, ItemType& it)
+	{
+		it.id = reader.read<uint16_t>();
+		it.clientID = reader.read<uint16_t>();
+		it.group = static_cast<ItemGroup_t>(reader.read<uint8_t>());
+		it.type = static_cast<ItemTypes_t>(reader.read<uint8_t>());
+		it.volume = reader.read<uint16_t>();
+		it.maxTextLen = reader.read<uint16_t>();
+		it.name = reader.readString();
+		it.editorsuffix = reader.readString();
+		it.description = reader.readString();
+		it.weight = reader.read<float>();
+		it.attack = reader.read<int32_t>();
+		it.defense = reader.read<int32_t>();
+		it.armor = reader.read<int32_t>();
+		it.charges = reader.read<uint32_t>();
+		it.alwaysOnTopOrder = reader.read<int32_t>();
+		it.rotateTo = reader.read<uint16_t>();
+
+		bool* flags[] = {
+			&it.client_chargeable, &it.extra_chargeable, &it.ignoreLook,
+			&it.isHangable, &it.hookEast, &it.hookSouth, &it.canReadText, &it.canWriteText,
+			&it.allowDistRead, &it.replaceable, &it.decays,
+			&it.stackable, &it.moveable, &it.alwaysOnBottom, &it.pickupable, &it.rotable,
+			&it.floorChangeDown, &it.floorChangeNorth, &it.floorChangeSouth, &it.floorChangeEast, &it.floorChangeWest, &it.floorChange,
+			&it.unpassable, &it.blockPickupable, &it.blockMissiles, &it.blockPathfinder, &it.hasElevation,
+		};
+		uint32_t bits = reader.read<uint32_t>();
+		for(size_t i = 0; i < std::size(flags); ++i) {
+			*flags[i] = (bits & (1u << i)) != 0;
+		}
+
+		it.sprite = static_cast<GameSprite*>(g_gui.gfx.getSprite(it.clientID));
+	}
+}
+
+DataCache::DataCache(const FileName& filename, ClientVersionID version) :
+	filename(filename),
+	version(version)
+{
+	////
+}
+
+void DataCache::addSource(const FileName& source)
+{
+	sources.push_back(source);
+}
+
+uint64_t DataCache::hashFile(const FileName& file)
+{
+	// FNV-1a, we only need to notice changes, not resist tampering
+	uint64_t hash = 0xcbf29ce484222325ULL;
+
+	FILE* f = fopen(nstr(file.GetFullPath()).c_str(), "rb");
+	if(!f) {
+		return 0;
+	}
+
+	uint8_t chunk[64 * 1024];
+	size_t read;
+	while((read = fread(chunk, 1, sizeof(chunk), f)) > 0) {
+		for(size_t i = 0; i < read; ++i) {
+			hash ^= chunk[i];
+			hash *= 0x100000001b3ULL;
+		}
+	}
+	fclose(f);
+	return hash;
+}
+
+bool DataCache::readSource(const FileName& file, Source& source, bool hash) const
+{
+	if(!file.FileExists()) {
+		return false;
+	}
+
+	source.path = nstr(file.GetFullPath());
+	source.size = file.GetSize().GetValue();
+	source.mtime = file.GetModificationTime().GetValue().GetValue();
+	source.hash = hash ? hashFile(file) : 0;
+	return true;
+}
+
+bool DataCache::load(ItemDatabase& items, CreatureDatabase& creatures)
+{
+	std::string buffer;
+	{
+		FileReadHandle f(nstr(filename.GetFullPath()));
+		if(!f.isOk() || f.size() < sizeof(CacheSignature)) {
+			return false;
+		}
+		if(!f.getRAW(buffer, f.size())) {
+			return false;
+		}
+	}
+
+	CacheReader reader(buffer);
+	for(char c : CacheSignature) {
+		if(reader.read<char>() != c) {
+			return false;
+		}
+	}
+
+	if(reader.read<uint32_t>() != CacheFormatVersion || reader.read<uint32_t>() != __RME_VERSION_ID__ || reader.read<int32_t>() != version) {
+		return false;
+	}
+
+	uint32_t sourceCount = reader.read<uint32_t>();
+	if(reader.hasError() || sourceCount != sources.size()) {
+		return false;
+	}
+
+	for(const FileName& file : sources) {
+		Source cached;
+		cached.path = reader.readString();
+		cached.size = reader.read<uint64_t>();
+		cached.mtime = reader.read<int64_t>();
+		cached.hash = reader.read<uint64_t>();
+
+		Source current;
+		if(reader.hasError() || !readSource(file, current, false)) {
+			return false;
+		}
+		if(cached.path != current.path || cached.size != current.size) {
+			return false;
+		}
+		// A touched but unchanged file (eg. a fresh checkout) is still valid
+		if(cached.mtime != current.mtime && cached.hash != hashFile(file)) {
+			return false;
+		}
+	}
+
+	items.MajorVersion = reader.read<uint32_t>();
+	items.MinorVersion = reader.read<uint32_t>();
+	items.BuildNumber = reader.read<uint32_t>();
+	if(g_settings.getInteger(Config::CHECK_SIGNATURES)) {
+		if(g_gui.GetCurrentVersion().getOTBVersion().format_version != items.MajorVersion) {
+			return false;
+		}
+	}
+
+	items.maxItemId = reader.read<uint16_t>();
+	uint32_t itemCount = reader.read<uint32_t>();
+	for(uint32_t i = 0; i < itemCount && !reader.hasError(); ++i) {
+		ItemType* it = newd ItemType();
+		readItemType(reader, *it);
+		if(reader.hasError() || it->id == 0 || it->id > items.maxItemId || items.items[it->id]) {
+			delete it;
+			break;
+		}
+		items.items.set(it->id, it);
+	}
+
+	uint32_t creatureCount = reader.read<uint32_t>();
+	for(uint32_t i = 0; i < creatureCount && !reader.hasError(); ++i) {
+		std::string name = reader.readString();
+		bool isNpc = reader.read<uint8_t>() != 0;
+
+		Outfit outfit;
+		outfit.lookType = reader.read<int32_t>();
+		outfit.lookItem = reader.read<int32_t>();
+		outfit.lookMount = reader.read<int32_t>();
+		outfit.lookAddon = reader.read<int32_t>();
+		outfit.lookHead = reader.read<int32_t>();
+		outfit.lookBody = reader.read<int32_t>();
+		outfit.lookLegs = reader.read<int32_t>();
+		outfit.lookFeet = reader.read<int32_t>();
+
+		if(reader.hasError() || creatures[name]) {
+			break;
+		}
+		creatures.addCreatureType(name, isNpc, outfit)->standard = true;
+	}
+
+	if(reader.hasError() || !reader.isEnd()) {
+		items.clear();
+		items.maxItemId = 0;
+		creatures.clear();
+		return false;
+	}
+	return true;
+}
+
+bool DataCache::save(ItemDatabase& items, CreatureDatabase& creatures)
+{
+	CacheWriter writer;
+	for(char c : CacheSignature) {
+		writer.write<char>(c);
+	}
+	writer.write<uint32_t>(CacheFormatVersion);
+	writer.write<uint32_t>(__RME_VERSION_ID__);
+	writer.write<int32_t>(version);
+
+	writer.write<uint32_t>(sources.size());
+	for(const FileName& file : sources) {
+		Source source;
+		if(!readSource(file, source, true)) {
+			return false;
+		}
+		writer.writeString(source.path);
+		writer.write<uint64_t>(source.size);
+		writer.write<int64_t>(source.mtime);
+		writer.write<uint64_t>(source.hash);
+	}
+
+	writer.write<uint32_t>(items.MajorVersion);
+	writer.write<uint32_t>(items.MinorVersion);
+	writer.write<uint32_t>(items.BuildNumber);
+	writer.write<uint16_t>(items.maxItemId);
+
+	uint32_t itemCount = 0;
+	for(uint32_t id = 0; id <= items.maxItemId; ++id) {
+		const ItemType* it = items.items.at(id);
+		if(it && !it->isMetaItem()) {
+			++itemCount;
+		}
+	}
+	writer.write<uint32_t>(itemCount);
+	for(uint32_t id = 0; id <= items.maxItemId; ++id) {
+		const ItemType* it = items.items.at(id);
+		if(it && !it->isMetaItem()) {
+			writeItemType(writer, *it);
+		}
+	}
+
+	// Only the data pack creatures, the user creatures.xml is loaded on top
+	uint32_t creatureCount = 0;
+	for(const auto& entry : creatures.creature_map) {
+		if(entry.second->standard && !entry.second->missing) {
+			++creatureCount;
+		}
+	}
+	writer.write<uint32_t>(creatureCount);
+	for(const auto& entry : creatures.creature_map) {
+		const CreatureType* type = entry.second;
+		if(!type->standard || type->missing) {
+			continue;
+		}
+		writer.writeString(type->name);
+		writer.write<uint8_t>(type->isNpc);
+		writer.write<int32_t>(type->outfit.lookType);
+		writer.write<int32_t>(type->outfit.lookItem);
+		writer.write<int32_t>(type->outfit.lookMount);
+		writer.write<int32_t>(type->outfit.lookAddon);
+		writer.write<int32_t>(type->outfit.lookHead);
+		writer.write<int32_t>(type->outfit.lookBody);
+		writer.write<int32_t>(type->outfit.lookLegs);
+		writer.write<int32_t>(type->outfit.lookFeet);
+	}
+
+	// Write to a temporary file first so an interrupted save never leaves
+	// a truncated snapshot behind
+	wxString temporary = filename.GetFullPath() + ".tmp";
+	{
+		FileWriteHandle f(nstr(temporary));
+		if(!f.isOk() || !f.addRAW(reinterpret_cast<const uint8_t*>(writer.buffer.data()), writer.buffer.size())) {
+			f.close();
+			wxRemoveFile(temporary);
+			return false;
+		}
+	}
+	return wxRenameFile(temporary, filename.GetFullPath(), true);
+}
@@ -0,0 +1,64 @@
+//////////////////////////////////////////////////////////////////////
+// This file is part of Remere's Map Editor
+//////////////////////////////////////////////////////////////////////
+// Remere's Map Editor is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// Remere's Map Editor is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <http://www.gnu.org/licenses/>.
+//////////////////////////////////////////////////////////////////////
+
+#ifndef RME_DATA_CACHE_H_
+#define RME_DATA_CACHE_H_
+
+#include "client_version.h"
+
+class ItemDatabase;
+class CreatureDatabase;
+
+// Binary snapshot of the parsed items.otb, items.xml and creatures.xml.
+// The snapshot is keyed on the size, modification time and content hash
+// of every source file, so editing any of them (or upgrading the editor)
+// silently falls back to parsing the XML/OTB files again.
+// Brushes and materials reference items and each other through pointers
+// and are still built from materials.xml on every load.
+class DataCache
+{
+public:
+	DataCache(const FileName& filename, ClientVersionID version);
+
+	void addSource(const FileName& source);
+
+	// Restores the databases from the snapshot, returns false if there is no
+	// usable snapshot. The databases are left empty on failure.
+	bool load(ItemDatabase& items, CreatureDatabase& creatures);
+	// Writes the current (standard) database contents
+	bool save(ItemDatabase& items, CreatureDatabase& creatures);
+
+	const FileName& getFilename() const noexcept { return filename; }
+
+	static uint64_t hashFile(const FileName& file);
+
+private:
+	struct Source {
+		std::string path;
+		uint64_t size;
+		int64_t mtime;
+		uint64_t hash;
+	};
+
+	bool readSource(const FileName& file, Source& source, bool hash) const;
+
+	FileName filename;
+	ClientVersionID version;
+	std::vector<FileName> sources;
+};
+
+#endif
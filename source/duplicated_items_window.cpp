@@ -18,12 +18,63 @@
 #include "main.h"
 
 #include "duplicated_items_window.h"
+#include "bulk_action.h"
 #include "gui.h"
 #include "map.h"
+#include "map_traversal.h"
 #include "tile.h"
 #include "item.h"
 #include "editor.h"
 
+MapIssuesListBox::MapIssuesListBox(wxWindow* parent, const MapIssues& issues) :
+	wxVListBox(parent, wxID_ANY, wxDefaultPosition, wxSize(200, 330), wxLB_SINGLE),
+	issues(issues)
+{
+	////
+}
+
+void MapIssuesListBox::OnDrawItem(wxDC& dc, const wxRect& rect, size_t index) const
+{
+	if(index >= issues.size()) {
+		return;
+	}
+
+	if(IsSelected(index)) {
+		dc.SetTextForeground(wxSystemSettings::GetColour(wxSYS_COLOUR_HIGHLIGHTTEXT));
+	} else {
+		dc.SetTextForeground(wxSystemSettings::GetColour(wxSYS_COLOUR_LISTBOXTEXT));
+	}
+
+	const MapIssues::Issue& issue = issues[index];
+	wxString label;
+	switch(issue.kind) {
+		case MapIssues::STACKED_ITEMS:
+			label = wxString::Format("item: %d, count: %d", issue.value, issue.count);
+			break;
+		case MapIssues::DUPLICATE_UNIQUE_ID:
+			label = wxString::Format("unique id: %d, used: %d", issue.value, issue.count);
+			break;
+		case MapIssues::OVERLAPPING_SPAWN:
+			label = wxString::Format("spawn radius: %d, overlaps: %d", issue.value, issue.count);
+			break;
+		case MapIssues::HOUSE_TILE_NO_HOUSE:
+			label = wxString::Format("no house: %d", issue.value);
+			break;
+		case MapIssues::CLIENT_TILE_LIMIT:
+			label = wxString::Format("things: %d, hidden: %d", issue.count, issue.value);
+			break;
+		default:
+			break;
+	}
+	label += wxString::Format(", pos: (%d,%d,%d)", issue.position.x, issue.position.y, issue.position.z);
+	dc.DrawText(label, rect.GetX() + 2, rect.GetY() + 2);
+}
+
+wxCoord MapIssuesListBox::OnMeasureItem(size_t index) const
+{
+	return GetCharHeight() + 4;
+}
+
 DuplicatedItemsWindow::DuplicatedItemsWindow(wxWindow* parent) :
 	wxPanel(parent, wxID_ANY),
 	map_tab(nullptr)
@@ -32,9 +83,22 @@ DuplicatedItemsWindow::DuplicatedItemsWindow(wxWindow* parent) :
 	wxBitmap save_bitmap = wxArtProvider::GetBitmap(wxART_FILE_SAVE, wxART_TOOLBAR, icon_size);
 
 	wxSizer* sizer = new wxBoxSizer(wxVERTICAL);
-	items_list = new wxListBox(this, wxID_ANY, wxDefaultPosition, wxSize(200, 330), 0, nullptr, wxLB_SINGLE | wxLB_ALWAYS_SB);
+
+	wxArrayString sort_choices;
+	sort_choices.Add("Sort by kind");
+	sort_choices.Add("Sort by position");
+	sort_choices.Add("Sort by id");
+	sort_choices.Add("Sort by count");
+	sort_choice = new wxChoice(this, wxID_ANY, wxDefaultPosition, wxDefaultSize, sort_choices);
+	sort_choice->SetSelection(MapIssues::SORT_BY_KIND);
+	sizer->Add(sort_choice, wxSizerFlags(0).Expand().Border(wxALL, 2));
+
+	items_list = new MapIssuesListBox(this, issues);
 	sizer->Add(items_list, wxSizerFlags(1).Expand());
 
+	summary_text = new wxStaticText(this, wxID_ANY, wxEmptyString);
+	sizer->Add(summary_text, wxSizerFlags(0).Expand().Border(wxALL, 2));
+
 	wxSizer* buttonsSizer = new wxBoxSizer(wxHORIZONTAL);
 
 	remove_button = new wxButton(this, wxID_DELETE, "Remove");
@@ -42,7 +106,7 @@ DuplicatedItemsWindow::DuplicatedItemsWindow(wxWindow* parent) :
 	remove_all_button = new wxButton(this, wxID_DELETE, "Remove All");
 	remove_all_button->Enable(false);
 	export_button = new wxBitmapButton(this, wxID_ANY, save_bitmap, wxDefaultPosition, wxDefaultSize, wxBU_AUTODRAW);
-	export_button->SetToolTip("Export");
+	export_button->SetToolTip("Export CSV");
 	export_button->Enable(false);
 
 	buttonsSizer->Add(remove_button, wxSizerFlags(0).Center());
@@ -55,6 +119,7 @@ DuplicatedItemsWindow::DuplicatedItemsWindow(wxWindow* parent) :
 	SetSizerAndFit(sizer);
 
 	items_list->Bind(wxEVT_LISTBOX, &DuplicatedItemsWindow::OnClickResult, this);
+	sort_choice->Bind(wxEVT_CHOICE, &DuplicatedItemsWindow::OnChangeSort, this);
 	remove_button->Bind(wxEVT_BUTTON, &DuplicatedItemsWindow::OnClickRemove, this);
 	remove_all_button->Bind(wxEVT_BUTTON, &DuplicatedItemsWindow::OnClickRemoveAll, this);
 	export_button->Bind(wxEVT_BUTTON, &DuplicatedItemsWindow::OnClickExport, this);
@@ -62,9 +127,8 @@ DuplicatedItemsWindow::DuplicatedItemsWindow(wxWindow* parent) :
 
 DuplicatedItemsWindow::~DuplicatedItemsWindow()
 {
-	Clear();
-
 	items_list->Unbind(wxEVT_LISTBOX, &DuplicatedItemsWindow::OnClickResult, this);
+	sort_choice->Unbind(wxEVT_CHOICE, &DuplicatedItemsWindow::OnChangeSort, this);
 	remove_button->Unbind(wxEVT_BUTTON, &DuplicatedItemsWindow::OnClickRemove, this);
 	remove_all_button->Unbind(wxEVT_BUTTON, &DuplicatedItemsWindow::OnClickRemoveAll, this);
 	export_button->Unbind(wxEVT_BUTTON, &DuplicatedItemsWindow::OnClickExport, this);
@@ -80,74 +144,61 @@ void DuplicatedItemsWindow::StartSearch(MapTab* tab, bool selection)
 	}
 
 	auto message = wxString::Format("Searching on %s...", selection ? "selected area" : "map");
-	g_gui.CreateLoadBar(message);
-
-	Map* map = map_tab->GetMap();
-	auto ibegin = map->begin();
-	auto iend = map->end();
-	long progress = 0;
-	std::vector<DuplicatedItem*> result;
-
-	while(ibegin != iend) {
-		++progress;
-		Tile* tile = (*ibegin)->get();
-		if(selection && !tile->isSelected()) {
-			++ibegin;
-			continue;
-		}
-
-		if(progress % 0x8000 == 0) {
-			g_gui.SetLoadDone((int)(100 * progress / map->getTileCount()));
-		}
-
-		auto& position = tile->getPosition();
-		uint16_t prevId = 0;
-		uint16_t count = 0;
-
-		for(Item* item : tile->items) {
-			uint16_t id = item->getID();
-			if(id == prevId) {
-				count++;
-			} else if(count > 0) {
-				result.push_back(new DuplicatedItem(position, prevId, count));
-				count = 0;
-			}
-			prevId = id;
-		}
-		// Check for the last item
-		if(count > 0) {
-			result.push_back(new DuplicatedItem(position, prevId, count));
-		}
+	g_gui.CreateLoadBar(message, true);
 
-		++ibegin;
+	MapTraversal traversal(*map_tab->GetMap());
+	if(selection) {
+		traversal.setSelection(map_tab->GetEditor()->getSelection());
 	}
+	traversal.setProgress([&traversal](int done) {
+		if(!g_gui.SetLoadDone(done))
+			traversal.cancel();
+	});
+	issues.find(traversal);
 
 	g_gui.DestroyLoadBar();
 
-	for(auto item : result) {
-		auto label = wxString::Format("item: %d, count: %d, pos: (%d,%d,%d)",
-			item->itemId, item->count, item->position.x, item->position.y, item->position.z);
-		items_list->Append(label, item);
-	}
-
-	UpdateButtons();
+	// What was found before the search was cancelled is shown as well
+	issues.sort(MapIssues::SortKey(sort_choice->GetSelection()), sort_choice->GetSelection() == MapIssues::SORT_BY_COUNT);
+	RefreshList();
 }
 
 void DuplicatedItemsWindow::Clear()
 {
-	uint32_t count = items_list->GetCount();
-	if(count == 0) {
-		return;
-	}
+	issues = MapIssues();
+	RefreshList();
+
+	map_tab = nullptr;
+}
 
-	for(uint32_t i = 0; i < count; ++i) {
-		delete reinterpret_cast<DuplicatedItem*>(items_list->GetClientData(i));
+void DuplicatedItemsWindow::RefreshList()
+{
+	items_list->SetSelection(wxNOT_FOUND);
+	items_list->SetItemCount(issues.size());
+	items_list->RefreshAll();
+
+	wxString summary;
+	for(int kind = 0; kind < MapIssues::KIND_COUNT; ++kind) {
+		const size_t count = issues.getCount(MapIssues::Kind(kind));
+		if(count != 0) {
+			summary << (summary.IsEmpty() ? "" : "\n") << count << " " << MapIssues::getKindName(MapIssues::Kind(kind));
+		}
 	}
+	summary_text->SetLabel(summary.IsEmpty() ? wxString("Nothing found") : summary);
+	Layout();
 
-	items_list->Clear();
 	UpdateButtons();
+}
 
-	map_tab = nullptr;
+const MapIssues::Issue* DuplicatedItemsWindow::GetRemovableIssue() const
+{
+	const int index = items_list->GetSelection();
+	if(index == wxNOT_FOUND || size_t(index) >= issues.size()) {
+		return nullptr;
+	}
+
+	const MapIssues::Issue& issue = issues[index];
+	return issue.kind == MapIssues::STACKED_ITEMS ? &issue : nullptr;
 }
 
 void DuplicatedItemsWindow::OnClickResult(wxCommandEvent& event)
@@ -156,13 +207,19 @@ void DuplicatedItemsWindow::OnClickResult(wxCommandEvent& event)
 		return;
 	}
 
-	DuplicatedItem* data = reinterpret_cast<DuplicatedItem*>(event.GetClientData());
-	if(data) {
-		g_gui.SetScreenCenterPosition(data->position);
-		remove_button->Enable(true);
-	} else {
-		remove_button->Enable(false);
+	const int index = event.GetSelection();
+	if(index != wxNOT_FOUND && size_t(index) < issues.size()) {
+		g_gui.SetScreenCenterPosition(issues[index].position);
 	}
+	remove_button->Enable(GetRemovableIssue() != nullptr);
+}
+
+void DuplicatedItemsWindow::OnChangeSort(wxCommandEvent& WXUNUSED(event))
+{
+	// The most counted first, everything else ascending
+	const int key = sort_choice->GetSelection();
+	issues.sort(MapIssues::SortKey(key), key == MapIssues::SORT_BY_COUNT);
+	RefreshList();
 }
 
 void DuplicatedItemsWindow::OnClickRemove(wxCommandEvent& WXUNUSED(event))
@@ -171,27 +228,33 @@ void DuplicatedItemsWindow::OnClickRemove(wxCommandEvent& WXUNUSED(event))
 		return;
 	}
 
-	int32_t index = items_list->GetSelection();
-	if (index == wxNOT_FOUND) {
+	const MapIssues::Issue* issue = GetRemovableIssue();
+	if(!issue) {
 		return;
 	}
 
-	Editor* editor = map_tab->GetEditor();
-	ActionQueue* history = editor->getHistoryActions();
-	BatchAction* batch = history->createBatch(ACTION_DELETE_TILES);
-	Action* action = history->createAction(batch);
-
-	DuplicatedItem* data = reinterpret_cast<DuplicatedItem*>(items_list->GetClientData(index));
-	removeItem(data, action);
-
-	batch->addAndCommitAction(action);
-	editor->addBatch(batch);
-	editor->updateActions();
-
-	items_list->Delete(index);
-	delete data;
+	const Position position = issue->position;
+	Map* map = map_tab->GetMap();
+	Tile* tile = map->getTile(position);
+	if(tile) {
+		Tile* new_tile = tile->deepCopy(*map);
+		if(MapIssues::removeStackedItems(new_tile) != 0) {
+			Editor* editor = map_tab->GetEditor();
+			BatchAction* batch = editor->createBatch(ACTION_REMOVE_ITEMS);
+			Action* action = editor->createAction(batch);
+			action->addChange(new Change(new_tile));
+			batch->addAndCommitAction(action);
+			editor->addBatch(batch);
+			editor->updateActions();
+		} else {
+			delete new_tile;
+		}
+	}
 
-	UpdateButtons();
+	issues.remove([&position](const MapIssues::Issue& other) {
+		return other.kind == MapIssues::STACKED_ITEMS && other.position == position;
+	});
+	RefreshList();
 }
 
 void DuplicatedItemsWindow::OnClickRemoveAll(wxCommandEvent& WXUNUSED(event))
@@ -200,52 +263,54 @@ void DuplicatedItemsWindow::OnClickRemoveAll(wxCommandEvent& WXUNUSED(event))
 		return;
 	}
 
-	uint32_t count = items_list->GetCount();
-	if (count == 0) {
+	PositionVector positions;
+	for(const MapIssues::Issue& issue : issues.getIssues()) {
+		if(issue.kind == MapIssues::STACKED_ITEMS) {
+			positions.push_back(issue.position);
+		}
+	}
+	if(positions.empty()) {
 		return;
 	}
 
-	g_gui.CreateLoadBar("Removing items...");
-
-	Map* map = map_tab->GetMap();
-	Editor* editor = map_tab->GetEditor();
-	ActionQueue* history = editor->getHistoryActions();
-	BatchAction* batch = history->createBatch(ACTION_DELETE_TILES);
-	Action* action = history->createAction(batch);
-
-	for(uint32_t i = 0; i < count; ++i) {
-		DuplicatedItem* data = reinterpret_cast<DuplicatedItem*>(items_list->GetClientData(i));
-		removeItem(data, action);
-		g_gui.SetLoadScale((int32_t)i, (int32_t)count);
+	std::sort(positions.begin(), positions.end());
+	positions.erase(std::unique(positions.begin(), positions.end()), positions.end());
+
+	g_gui.CreateLoadBar("Removing items...", true);
+
+	bool finished;
+	{
+		BulkOperation operation(*map_tab->GetEditor(), ACTION_REMOVE_ITEMS);
+		operation.getTraversal().setPositions(std::move(positions));
+		operation.setProgress([](int done) { return g_gui.SetLoadDone(done); });
+		finished = operation.run(
+			[](Tile*) { return true; },
+			[](Tile* tile) { return MapIssues::removeStackedItems(tile); });
+		if(!finished) {
+			operation.rollback();
+		}
 	}
 
-	batch->addAndCommitAction(action);
-	editor->addBatch(batch);
-	editor->updateActions();
-
 	g_gui.DestroyLoadBar();
-	Clear();
+
+	if(finished) {
+		issues.remove([](const MapIssues::Issue& issue) { return issue.kind == MapIssues::STACKED_ITEMS; });
+		RefreshList();
+	}
 }
 
 void DuplicatedItemsWindow::OnClickExport(wxCommandEvent& WXUNUSED(event))
 {
-	wxFileDialog dialog(this, "Save file...", "", "", "Text Documents (*.txt) | *.txt", wxFD_SAVE);
+	wxFileDialog dialog(this, "Save file...", "", "", "CSV Files (*.csv)|*.csv", wxFD_SAVE | wxFD_OVERWRITE_PROMPT);
 	if(dialog.ShowModal() == wxID_OK) {
 		wxFile file(dialog.GetPath(), wxFile::write);
 		if(file.IsOpened()) {
-			g_gui.CreateLoadBar("Exporting result...");
-
-			file.Write("Generated by Remere's Map Editor " + __RME_VERSION__);
-			file.Write("\n=============================================\n\n");
-			wxArrayString lines = items_list->GetStrings();
-			size_t count = lines.Count();
-			for(size_t i = 0; i < count; ++i) {
-				file.Write(lines[i] + "\n");
-				g_gui.SetLoadScale((int32_t)i, (int32_t)count);
-			}
+			std::ostringstream stream;
+			issues.writeCsv(stream);
+			file.Write(stream.str());
 			file.Close();
-
-			g_gui.DestroyLoadBar();
+		} else {
+			g_gui.PopupDialog("Error", "Could not open " + dialog.GetPath() + " for writing.", wxOK);
 		}
 	}
 }
@@ -256,32 +321,8 @@ void DuplicatedItemsWindow::UpdateButtons()
 		return;
 	}
 
-	bool enable = items_list->GetCount() != 0 && map_tab && map_tab->IsCurrent();
-	remove_button->Enable(enable);
-	remove_all_button->Enable(enable);
+	bool enable = !issues.empty() && map_tab && map_tab->IsCurrent();
+	remove_button->Enable(enable && GetRemovableIssue() != nullptr);
+	remove_all_button->Enable(enable && issues.getCount(MapIssues::STACKED_ITEMS) != 0);
 	export_button->Enable(enable);
 }
-
-bool DuplicatedItemsWindow::removeItem(DuplicatedItem* data, Action* action)
-{
-	Map* map = map_tab->GetMap();
-	Tile* tile = map->getTile(data->position);
-	if(!tile) {
-		return false;
-	}
-
-	uint16_t count = 0;
-	Tile* new_tile = tile->deepCopy(*map);
-	for(auto it = new_tile->items.begin(); it != new_tile->items.end();) {
-		Item* item = *it;
-		if (item->getID() != data->itemId || ++count == 1) {
-			++it;
-			continue;
-		}
-		delete item;
-		it = new_tile->items.erase(it);
-	}
-
-	action->addChange(new Change(new_tile));
-	return true;
-}
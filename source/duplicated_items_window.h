@@ -20,21 +20,25 @@
 
 #include "main.h"
 
-#include "position.h"
+#include "map_issues.h"
 
 class MapTab;
 
-class DuplicatedItemsWindow : public wxPanel
+// Draws the issues straight from the array, nothing is stored per line
+class MapIssuesListBox : public wxVListBox
 {
-	struct DuplicatedItem {
-		DuplicatedItem(const Position& position, uint16_t itemId, uint16_t count) :
-			position(position), itemId(itemId), count(count) {}
+public:
+	MapIssuesListBox(wxWindow* parent, const MapIssues& issues);
+
+	void OnDrawItem(wxDC& dc, const wxRect& rect, size_t index) const override;
+	wxCoord OnMeasureItem(size_t index) const override;
 
-		Position position;
-		uint16_t itemId;
-		uint16_t count;
-	};
+private:
+	const MapIssues& issues;
+};
 
+class DuplicatedItemsWindow : public wxPanel
+{
 public:
 	DuplicatedItemsWindow(wxWindow* parent);
 	virtual ~DuplicatedItemsWindow();
@@ -46,15 +50,21 @@ public:
 	void UpdateButtons();
 
 	void OnClickResult(wxCommandEvent&);
+	void OnChangeSort(wxCommandEvent&);
 	void OnClickRemove(wxCommandEvent&);
 	void OnClickRemoveAll(wxCommandEvent&);
 	void OnClickExport(wxCommandEvent&);
 
 protected:
-	bool removeItem(DuplicatedItem* data, Action* action);
+	void RefreshList();
+	// Only stacked items can be removed from here
+	const MapIssues::Issue* GetRemovableIssue() const;
 
 	MapTab* map_tab;
-	wxListBox* items_list;
+	MapIssues issues;
+	MapIssuesListBox* items_list;
+	wxStaticText* summary_text;
+	wxChoice* sort_choice;
 	wxButton* remove_button;
 	wxButton* remove_all_button;
 	wxBitmapButton* export_button;
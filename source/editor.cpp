@@ -20,6 +20,7 @@
 #include "editor.h"
 #include "materials.h"
 #include "map.h"
+#include "map_traversal.h"
 #include "complexitem.h"
 #include "settings.h"
 #include "gui.h"
@@ -755,6 +756,7 @@ bool Editor::importMap(FileName filename, int import_x_offset, int import_y_offs
 
 		map.addSpawn(tile);
 	}
+	map.invalidateStatistics();
 
 	g_gui.DestroyLoadBar();
 
@@ -805,6 +807,11 @@ void Editor::borderizeMap(bool showdialog)
 		++tiles_done;
 	}
 
+	map.invalidateRender();
+	map.invalidateItemIndex();
+	map.invalidateSummaries();
+	map.invalidateStatistics();
+
 	if(showdialog) {
 		g_gui.DestroyLoadBar();
 	}
@@ -878,6 +885,11 @@ void Editor::randomizeMap(bool showdialog)
 		++tiles_done;
 	}
 
+	map.invalidateRender();
+	map.invalidateItemIndex();
+	map.invalidateSummaries();
+	map.invalidateStatistics();
+
 	if(showdialog) {
 		g_gui.DestroyLoadBar();
 	}
@@ -916,22 +928,28 @@ void Editor::clearInvalidHouseTiles(bool showdialog)
 		}
 	}
 
-	uint64_t tiles_done = 0;
-	for(MapIterator map_iter = map.begin(); map_iter != map.end(); ++map_iter) {
-		if(showdialog && tiles_done % 4096 == 0) {
-			g_gui.SetLoadDone(int(tiles_done / double(map.tilecount) * 100.0));
-		}
-
-		Tile* tile = (*map_iter)->get();
-		ASSERT(tile);
-		if(tile->isHouseTile()) {
-			if(houses.getHouse(tile->getHouseID()) == nullptr) {
-				tile->setHouse(nullptr);
+	TileVector tiles;
+	MapTraversal traversal(map);
+	if(showdialog) {
+		traversal.setProgress([](int done) { g_gui.SetLoadDone(done); });
+	}
+	traversal.forEachTile(tiles,
+		[&houses](TileVector& chunk, Tile* tile) {
+			if(tile->isHouseTile() && houses.getHouse(tile->getHouseID()) == nullptr) {
+				chunk.push_back(tile);
 			}
-		}
-		++tiles_done;
+		},
+		[](TileVector& all, TileVector& chunk) {
+			all.insert(all.end(), chunk.begin(), chunk.end());
+		});
+
+	for(Tile* tile : tiles) {
+		tile->setHouse(nullptr);
 	}
 
+	map.invalidateRender();
+	map.invalidateStatistics();
+
 	if(showdialog) {
 		g_gui.DestroyLoadBar();
 	}
@@ -955,6 +973,8 @@ void Editor::clearModifiedTileState(bool showdialog)
 		++tiles_done;
 	}
 
+	map.invalidateRender();
+
 	if(showdialog) {
 		g_gui.DestroyLoadBar();
 	}
@@ -1880,6 +1900,13 @@ void Editor::QueryNode(int ndx, int ndy, bool underground)
 	live_client->queryNode(ndx, ndy, underground);
 }
 
+void Editor::PrefetchNodes(int start_x, int start_y, int end_x, int end_y, int floor)
+{
+	if(live_client) {
+		live_client->prefetchNodes(start_x, start_y, end_x, end_y, floor);
+	}
+}
+
 void Editor::SendNodeRequests()
 {
 	if(live_client) {
@@ -68,6 +68,7 @@ public: // Functions
 
 	// Client side
 	void QueryNode(int ndx, int ndy, bool underground);
+	void PrefetchNodes(int start_x, int start_y, int end_x, int end_y, int floor);
 	void SendNodeRequests();
 
 	bool hasChanges() const;
@@ -0,0 +1,250 @@
+//////////////////////////////////////////////////////////////////////
+// This file is part of Remere's Map Editor
+//////////////////////////////////////////////////////////////////////
+// Remere's Map Editor is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// Remere's Map Editor is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <http://www.gnu.org/licenses/>.
+//////////////////////////////////////////////////////////////////////
+
+#include "main.h"
+
+#include "frame_profiler.h"
+
+#include <fstream>
+
+FrameProfiler g_profiler;
+
+FrameProfiler::FrameProfiler() :
+	enabled(false),
+	epoch(std::chrono::steady_clock::now()),
+	in_frame(false)
+{
+	for(auto& counter : counters) {
+		counter.store(0, std::memory_order_relaxed);
+	}
+}
+
+void FrameProfiler::setEnabled(bool enable)
+{
+	if(enable == isEnabled())
+		return;
+
+	if(enable) {
+		frames.clear();
+		epoch = std::chrono::steady_clock::now();
+		for(auto& counter : counters) {
+			counter.store(0, std::memory_order_relaxed);
+		}
+	}
+	in_frame = false;
+	open_phases.clear();
+	enabled.store(enable, std::memory_order_relaxed);
+}
+
+int64_t FrameProfiler::now() const
+{
+	return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - epoch).count();
+}
+
+void FrameProfiler::beginFrame()
+{
+	if(!isEnabled())
+		return;
+
+	in_frame = true;
+	open_phases.clear();
+	current.phases.clear();
+	current.start = now();
+	current.duration = 0;
+	for(auto& counter : counters) {
+		counter.store(0, std::memory_order_relaxed);
+	}
+}
+
+void FrameProfiler::endFrame()
+{
+	if(!isEnabled() || !in_frame)
+		return;
+
+	while(!open_phases.empty()) {
+		endPhase();
+	}
+
+	current.duration = now() - current.start;
+	for(int i = 0; i < COUNTER_COUNT; ++i) {
+		current.counters[i] = counters[i].load(std::memory_order_relaxed);
+	}
+
+	if(frames.size() >= HistorySize)
+		frames.pop_front();
+	frames.push_back(current);
+	in_frame = false;
+}
+
+void FrameProfiler::beginPhase(const char* name)
+{
+	if(!isEnabled() || !in_frame)
+		return;
+
+	open_phases.push_back(current.phases.size());
+	current.phases.push_back(Phase { name, int(open_phases.size()) - 1, now() - current.start, 0 });
+}
+
+void FrameProfiler::endPhase()
+{
+	if(!isEnabled() || open_phases.empty())
+		return;
+
+	Phase& phase = current.phases[open_phases.back()];
+	phase.duration = now() - current.start - phase.start;
+	open_phases.pop_back();
+}
+
+std::vector<std::string> FrameProfiler::getSummary() const
+{
+	std::vector<std::string> lines;
+	if(frames.empty())
+		return lines;
+
+	size_t count = std::min(frames.size(), SummaryFrames);
+	auto first = frames.end() - count;
+
+	// Phases are listed in the order of the latest frame, a phase that runs
+	// several times in a frame (like one per floor) is added up
+	struct Total {
+		const char* name;
+		int depth;
+		int64_t duration;
+	};
+	std::vector<Total> totals;
+	for(const Phase& phase : frames.back().phases) {
+		auto it = std::find_if(totals.begin(), totals.end(), [&phase](const Total& total) {
+			return strcmp(total.name, phase.name) == 0;
+		});
+		if(it == totals.end())
+			totals.push_back(Total { phase.name, phase.depth, 0 });
+	}
+
+	int64_t frame_total = 0;
+	int64_t frame_max = 0;
+	for(auto it = first; it != frames.end(); ++it) {
+		frame_total += it->duration;
+		frame_max = std::max(frame_max, it->duration);
+		for(const Phase& phase : it->phases) {
+			for(Total& total : totals) {
+				if(strcmp(total.name, phase.name) == 0) {
+					total.duration += phase.duration;
+					break;
+				}
+			}
+		}
+	}
+
+	// Frames are painted on demand, so the rate is measured between their starts
+	double average = frame_total / 1000.0 / count;
+	double span = (frames.back().start - first->start) / 1000.0;
+	double fps = count > 1 && span > 0 ? (count - 1) * 1000.0 / span : 0.0;
+
+	char buffer[128];
+	snprintf(buffer, sizeof(buffer), "frame %.2f ms avg, %.2f ms max, %.1f fps", average, frame_max / 1000.0, fps);
+	lines.emplace_back(buffer);
+
+	for(const Total& total : totals) {
+		snprintf(buffer, sizeof(buffer), "%*s%s %.2f ms", total.depth * 2 + 2, "", total.name, total.duration / 1000.0 / count);
+		lines.emplace_back(buffer);
+
+		// The driver is still busy with our commands after the CPU is done
+		if(strcmp(total.name, GpuWaitPhase) == 0 && frame_total > 0) {
+			double share = 100.0 * total.duration / frame_total;
+			snprintf(buffer, sizeof(buffer), "  %s bound (%.0f%% waiting on the GPU)", share >= 50.0 ? "GPU" : "CPU", share);
+			lines.emplace_back(buffer);
+		}
+	}
+
+	const Frame& last = frames.back();
+	for(int i = 0; i < COUNTER_COUNT; ++i) {
+		snprintf(buffer, sizeof(buffer), "%s %llu", getCounterName(Counter(i)), static_cast<unsigned long long>(last.counters[i]));
+		lines.emplace_back(buffer);
+	}
+	return lines;
+}
+
+bool FrameProfiler::exportCSV(const std::string& path) const
+{
+	std::ofstream file(path, std::ios::trunc | std::ios::out);
+	if(!file.is_open())
+		return false;
+
+	// One row for the whole frame with its counters, then one row per phase
+	file << "frame,phase,depth,start_us,duration_us";
+	for(int i = 0; i < COUNTER_COUNT; ++i) {
+		file << "," << getCounterName(Counter(i));
+	}
+	file << "\n";
+
+	size_t number = 0;
+	for(const Frame& frame : frames) {
+		file << number << ",frame,0," << frame.start << "," << frame.duration;
+		for(uint64_t value : frame.counters) {
+			file << "," << value;
+		}
+		file << "\n";
+
+		for(const Phase& phase : frame.phases) {
+			file << number << "," << phase.name << "," << (phase.depth + 1) << "," << (frame.start + phase.start) << "," << phase.duration;
+			file << std::string(COUNTER_COUNT, ',') << "\n";
+		}
+		++number;
+	}
+	return file.good();
+}
+
+bool FrameProfiler::exportTrace(const std::string& path) const
+{
+	std::ofstream file(path, std::ios::trunc | std::ios::out);
+	if(!file.is_open())
+		return false;
+
+	// Complete events nest by time on a single thread, counters are drawn as graphs
+	file << "{\"traceEvents\":[";
+	bool first = true;
+	for(const Frame& frame : frames) {
+		file << (first ? "\n" : ",\n");
+		first = false;
+		file << "{\"name\":\"frame\",\"ph\":\"X\",\"pid\":1,\"tid\":1,\"ts\":" << frame.start << ",\"dur\":" << frame.duration << "}";
+
+		for(const Phase& phase : frame.phases) {
+			file << ",\n{\"name\":\"" << phase.name << "\",\"ph\":\"X\",\"pid\":1,\"tid\":1,\"ts\":" << (frame.start + phase.start) << ",\"dur\":" << phase.duration << "}";
+		}
+
+		file << ",\n{\"name\":\"counters\",\"ph\":\"C\",\"pid\":1,\"ts\":" << frame.start << ",\"args\":{";
+		for(int i = 0; i < COUNTER_COUNT; ++i) {
+			file << (i ? "," : "") << "\"" << getCounterName(Counter(i)) << "\":" << frame.counters[i];
+		}
+		file << "}}";
+	}
+	file << "\n],\"displayTimeUnit\":\"ms\"}\n";
+	return file.good();
+}
+
+const char* FrameProfiler::getCounterName(Counter counter)
+{
+	switch(counter) {
+		case DRAW_CALLS: return "draw_calls";
+		case TEXTURE_BINDS: return "texture_binds";
+		case TILES_VISITED: return "tiles_visited";
+		case SPRITES_DECODED: return "sprites_decoded";
+		case TEXTURES_CREATED: return "textures_created";
+		case TEXTURES_EVICTED: return "textures_evicted";
+		default: return "unknown";
+	}
+}
@@ -0,0 +1,115 @@
+//////////////////////////////////////////////////////////////////////
+// This file is part of Remere's Map Editor
+//////////////////////////////////////////////////////////////////////
+// Remere's Map Editor is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// Remere's Map Editor is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <http://www.gnu.org/licenses/>.
+//////////////////////////////////////////////////////////////////////
+
+#ifndef RME_FRAME_PROFILER_H_
+#define RME_FRAME_PROFILER_H_
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <deque>
+
+// Times the phases of every painted frame of the map canvas and counts what
+// the renderer did meanwhile. Frames and phases are only opened on the GUI
+// thread, counters can be bumped from any thread. Everything is a no-op
+// while the profiler is disabled.
+class FrameProfiler
+{
+public:
+	enum Counter {
+		DRAW_CALLS,
+		TEXTURE_BINDS,
+		TILES_VISITED,
+		SPRITES_DECODED,
+		TEXTURES_CREATED,
+		TEXTURES_EVICTED,
+		COUNTER_COUNT
+	};
+
+	struct Phase {
+		const char* name;
+		int depth;
+		int64_t start; // Microseconds since the start of the frame
+		int64_t duration;
+	};
+
+	struct Frame {
+		int64_t start; // Microseconds since the profiler was enabled
+		int64_t duration;
+		std::vector<Phase> phases;
+		std::array<uint64_t, COUNTER_COUNT> counters;
+	};
+
+	// Phase timing glFinish after drawing, see MapCanvas::OnPaint
+	static constexpr const char* GpuWaitPhase = "gpu wait";
+	static constexpr size_t HistorySize = 600;
+	// Frames averaged for the overlay
+	static constexpr size_t SummaryFrames = 60;
+
+	FrameProfiler();
+
+	bool isEnabled() const noexcept { return enabled.load(std::memory_order_relaxed); }
+	// Enabling starts a new recording, disabling keeps the frames for exporting
+	void setEnabled(bool enabled);
+
+	void count(Counter counter, uint64_t amount = 1) noexcept {
+		if(isEnabled())
+			counters[counter].fetch_add(amount, std::memory_order_relaxed);
+	}
+
+	void beginFrame();
+	void endFrame();
+	void beginPhase(const char* name);
+	void endPhase();
+
+	const std::deque<Frame>& getFrames() const noexcept { return frames; }
+	// Lines of text for the canvas overlay
+	std::vector<std::string> getSummary() const;
+
+	bool exportCSV(const std::string& path) const;
+	// Chrome trace event format, opens in chrome://tracing and Perfetto
+	bool exportTrace(const std::string& path) const;
+
+	static const char* getCounterName(Counter counter);
+
+private:
+	int64_t now() const;
+
+	std::atomic<bool> enabled;
+	std::array<std::atomic<uint64_t>, COUNTER_COUNT> counters;
+	std::chrono::steady_clock::time_point epoch;
+
+	bool in_frame;
+	Frame current;
+	std::vector<size_t> open_phases;
+	std::deque<Frame> frames;
+};
+
+extern FrameProfiler g_profiler;
+
+// Times the enclosing block as a phase of the current frame
+class ProfileScope
+{
+public:
+	explicit ProfileScope(const char* name) { g_profiler.beginPhase(name); }
+	~ProfileScope() { g_profiler.endPhase(); }
+
+	ProfileScope(const ProfileScope&) = delete;
+	ProfileScope& operator=(const ProfileScope&) = delete;
+};
+
+#endif
@@ -24,6 +24,9 @@
 #include "settings.h"
 #include "gui.h"
 #include "otml.h"
+#include "frame_profiler.h"
+#include "items.h"
+#include "tile.h"
 
 #include <wx/mstream.h>
 #include <wx/stopwatch.h>
@@ -61,6 +64,8 @@ static uint32_t TemplateOutfitLookupTable[] = {
 GraphicManager::GraphicManager() :
 	client_version(nullptr),
 	unloaded(true),
+	generation(0),
+	outfit_cache(rme::OutfitCacheSize),
 	dat_format(DAT_FORMAT_UNKNOWN),
 	otfi_found(false),
 	is_extended(false),
@@ -76,15 +81,20 @@ GraphicManager::GraphicManager() :
 
 GraphicManager::~GraphicManager()
 {
-	for(SpriteMap::iterator iter = sprite_space.begin(); iter != sprite_space.end(); ++iter) {
-		delete iter->second;
+	for(GameSprite* sprite : game_sprites) {
+		delete sprite;
 	}
 
-	for(ImageMap::iterator iter = image_space.begin(); iter != image_space.end(); ++iter) {
-		delete iter->second;
+	for(Sprite* sprite : editor_sprites) {
+		delete sprite;
 	}
 
-	sprite_space.clear();
+	for(GameSprite::NormalImage* image : image_space) {
+		delete image;
+	}
+
+	game_sprites.clear();
+	editor_sprites.clear();
 	image_space.clear();
 
 	delete animation_timer;
@@ -108,61 +118,57 @@ GLuint GraphicManager::getFreeTextureID()
 
 void GraphicManager::clear()
 {
-	SpriteMap new_sprite_space;
-	for(SpriteMap::iterator iter = sprite_space.begin(); iter != sprite_space.end(); ++iter) {
-		if(iter->first >= 0) { // Don't clean internal sprites
-			delete iter->second;
-		} else {
-			new_sprite_space.insert(std::make_pair(iter->first, iter->second));
-		}
+	// Internal (editor) sprites are kept
+	for(GameSprite* sprite : game_sprites) {
+		delete sprite;
 	}
 
-	for(ImageMap::iterator iter = image_space.begin(); iter != image_space.end(); ++iter) {
-		delete iter->second;
+	for(GameSprite::NormalImage* image : image_space) {
+		delete image;
 	}
 
-	sprite_space.swap(new_sprite_space);
+	game_sprites.clear();
 	image_space.clear();
 	cleanup_list.clear();
+	outfit_cache.clear();
 
 	item_count = 0;
 	creature_count = 0;
 	loaded_textures = 0;
 	lastclean = time(nullptr);
-	spritefile = "";
+	sprite_archive.close();
 
 	unloaded = true;
+	++generation;
 }
 
 void GraphicManager::cleanSoftwareSprites()
 {
-	for(SpriteMap::iterator iter = sprite_space.begin(); iter != sprite_space.end(); ++iter) {
-		if(iter->first >= 0) { // Don't clean internal sprites
-			iter->second->unloadDC();
+	// Don't clean internal sprites
+	for(GameSprite* sprite : game_sprites) {
+		if(sprite) {
+			sprite->unloadDC();
 		}
 	}
 }
 
-Sprite* GraphicManager::getSprite(int id)
+Sprite* GraphicManager::getInternalSprite(int id)
 {
-	SpriteMap::iterator it = sprite_space.find(id);
-	if(it != sprite_space.end()) {
-		return it->second;
+	size_t index = static_cast<size_t>(id - EDITOR_SPRITE_SELECTION_MARKER);
+	if(id < EDITOR_SPRITE_SELECTION_MARKER || index >= editor_sprites.size()) {
+		return nullptr;
 	}
-	return nullptr;
+	return editor_sprites[index];
 }
 
-GameSprite* GraphicManager::getCreatureSprite(int id)
+Sprite*& GraphicManager::internalSprite(int id)
 {
-	if(id < 0) {
-		return nullptr;
-	}
-
-	SpriteMap::iterator it = sprite_space.find(id+item_count);
-	if(it != sprite_space.end()) {
-		return static_cast<GameSprite*>(it->second);
+	ASSERT(id >= EDITOR_SPRITE_SELECTION_MARKER && id < 0);
+	size_t index = static_cast<size_t>(id - EDITOR_SPRITE_SELECTION_MARKER);
+	if(index >= editor_sprites.size()) {
+		editor_sprites.resize(index + 1, nullptr);
 	}
-	return nullptr;
+	return editor_sprites[index];
 }
 
 GameSprite* GraphicManager::getEditorSprite(int id)
@@ -170,12 +176,7 @@ GameSprite* GraphicManager::getEditorSprite(int id)
 	if(id >= 0) {
 		return nullptr;
 	}
-
-	SpriteMap::iterator it = sprite_space.find(id);
-	if(it != sprite_space.end()) {
-		return dynamic_cast<GameSprite*>(it->second);
-	}
-	return nullptr;
+	return dynamic_cast<GameSprite*>(getInternalSprite(id));
 }
 
 #define loadPNGFile(name) _wxGetBitmapFromMemory(name, sizeof(name))
@@ -190,160 +191,160 @@ inline wxBitmap* _wxGetBitmapFromMemory(const unsigned char* data, int length)
 bool GraphicManager::loadEditorSprites()
 {
 	// Unused graphics MIGHT be loaded here, but it's a neglectable loss
-	sprite_space[EDITOR_SPRITE_SELECTION_MARKER] =
+	internalSprite(EDITOR_SPRITE_SELECTION_MARKER) =
 		newd EditorSprite(
 			newd wxBitmap(selection_marker_xpm16x16),
 			newd wxBitmap(selection_marker_xpm32x32)
 		);
-	sprite_space[EDITOR_SPRITE_BRUSH_CD_1x1] =
+	internalSprite(EDITOR_SPRITE_BRUSH_CD_1x1) =
 		newd EditorSprite(
 			loadPNGFile(circular_1_small_png),
 			loadPNGFile(circular_1_png)
 		);
-	sprite_space[EDITOR_SPRITE_BRUSH_CD_3x3] =
+	internalSprite(EDITOR_SPRITE_BRUSH_CD_3x3) =
 		newd EditorSprite(
 			loadPNGFile(circular_2_small_png),
 			loadPNGFile(circular_2_png)
 		);
-	sprite_space[EDITOR_SPRITE_BRUSH_CD_5x5] =
+	internalSprite(EDITOR_SPRITE_BRUSH_CD_5x5) =
 		newd EditorSprite(
 			loadPNGFile(circular_3_small_png),
 			loadPNGFile(circular_3_png)
 		);
-	sprite_space[EDITOR_SPRITE_BRUSH_CD_7x7] =
+	internalSprite(EDITOR_SPRITE_BRUSH_CD_7x7) =
 		newd EditorSprite(
 			loadPNGFile(circular_4_small_png),
 			loadPNGFile(circular_4_png)
 		);
-	sprite_space[EDITOR_SPRITE_BRUSH_CD_9x9] =
+	internalSprite(EDITOR_SPRITE_BRUSH_CD_9x9) =
 		newd EditorSprite(
 			loadPNGFile(circular_5_small_png),
 			loadPNGFile(circular_5_png)
 		);
-	sprite_space[EDITOR_SPRITE_BRUSH_CD_15x15] =
+	internalSprite(EDITOR_SPRITE_BRUSH_CD_15x15) =
 		newd EditorSprite(
 			loadPNGFile(circular_6_small_png),
 			loadPNGFile(circular_6_png)
 		);
-	sprite_space[EDITOR_SPRITE_BRUSH_CD_19x19] =
+	internalSprite(EDITOR_SPRITE_BRUSH_CD_19x19) =
 		newd EditorSprite(
 			loadPNGFile(circular_7_small_png),
 			loadPNGFile(circular_7_png)
 		);
-	sprite_space[EDITOR_SPRITE_BRUSH_SD_1x1] =
+	internalSprite(EDITOR_SPRITE_BRUSH_SD_1x1) =
 		newd EditorSprite(
 			loadPNGFile(rectangular_1_small_png),
 			loadPNGFile(rectangular_1_png)
 		);
-	sprite_space[EDITOR_SPRITE_BRUSH_SD_3x3] =
+	internalSprite(EDITOR_SPRITE_BRUSH_SD_3x3) =
 		newd EditorSprite(
 			loadPNGFile(rectangular_2_small_png),
 			loadPNGFile(rectangular_2_png)
 		);
-	sprite_space[EDITOR_SPRITE_BRUSH_SD_5x5] =
+	internalSprite(EDITOR_SPRITE_BRUSH_SD_5x5) =
 		newd EditorSprite(
 			loadPNGFile(rectangular_3_small_png),
 			loadPNGFile(rectangular_3_png)
 		);
-	sprite_space[EDITOR_SPRITE_BRUSH_SD_7x7] =
+	internalSprite(EDITOR_SPRITE_BRUSH_SD_7x7) =
 		newd EditorSprite(
 			loadPNGFile(rectangular_4_small_png),
 			loadPNGFile(rectangular_4_png)
 		);
-	sprite_space[EDITOR_SPRITE_BRUSH_SD_9x9] =
+	internalSprite(EDITOR_SPRITE_BRUSH_SD_9x9) =
 		newd EditorSprite(
 			loadPNGFile(rectangular_5_small_png),
 			loadPNGFile(rectangular_5_png)
 		);
-	sprite_space[EDITOR_SPRITE_BRUSH_SD_15x15] =
+	internalSprite(EDITOR_SPRITE_BRUSH_SD_15x15) =
 		newd EditorSprite(
 			loadPNGFile(rectangular_6_small_png),
 			loadPNGFile(rectangular_6_png)
 		);
-	sprite_space[EDITOR_SPRITE_BRUSH_SD_19x19] =
+	internalSprite(EDITOR_SPRITE_BRUSH_SD_19x19) =
 		newd EditorSprite(
 			loadPNGFile(rectangular_7_small_png),
 			loadPNGFile(rectangular_7_png)
 		);
 
-	sprite_space[EDITOR_SPRITE_OPTIONAL_BORDER_TOOL] =
+	internalSprite(EDITOR_SPRITE_OPTIONAL_BORDER_TOOL) =
 		newd EditorSprite(
 			loadPNGFile(optional_border_small_png),
 			loadPNGFile(optional_border_png)
 		);
-	sprite_space[EDITOR_SPRITE_ERASER] =
+	internalSprite(EDITOR_SPRITE_ERASER) =
 		newd EditorSprite(
 			loadPNGFile(eraser_small_png),
 			loadPNGFile(eraser_png)
 		);
-	sprite_space[EDITOR_SPRITE_PZ_TOOL] =
+	internalSprite(EDITOR_SPRITE_PZ_TOOL) =
 		newd EditorSprite(
 			loadPNGFile(protection_zone_small_png),
 			loadPNGFile(protection_zone_png)
 		);
-	sprite_space[EDITOR_SPRITE_PVPZ_TOOL] =
+	internalSprite(EDITOR_SPRITE_PVPZ_TOOL) =
 		newd EditorSprite(
 			loadPNGFile(pvp_zone_small_png),
 			loadPNGFile(pvp_zone_png)
 		);
-	sprite_space[EDITOR_SPRITE_NOLOG_TOOL] =
+	internalSprite(EDITOR_SPRITE_NOLOG_TOOL) =
 		newd EditorSprite(
 			loadPNGFile(no_logout_small_png),
 			loadPNGFile(no_logout_png)
 		);
-	sprite_space[EDITOR_SPRITE_NOPVP_TOOL] =
+	internalSprite(EDITOR_SPRITE_NOPVP_TOOL) =
 		newd EditorSprite(
 			loadPNGFile(no_pvp_small_png),
 			loadPNGFile(no_pvp_png)
 		);
 
-	sprite_space[EDITOR_SPRITE_DOOR_NORMAL] =
+	internalSprite(EDITOR_SPRITE_DOOR_NORMAL) =
 		newd EditorSprite(
 			loadPNGFile(door_normal_small_png),
 			loadPNGFile(door_normal_png)
 		);
-	sprite_space[EDITOR_SPRITE_DOOR_LOCKED] =
+	internalSprite(EDITOR_SPRITE_DOOR_LOCKED) =
 		newd EditorSprite(
 			loadPNGFile(door_locked_small_png),
 			loadPNGFile(door_locked_png)
 		);
-	sprite_space[EDITOR_SPRITE_DOOR_MAGIC] =
+	internalSprite(EDITOR_SPRITE_DOOR_MAGIC) =
 		newd EditorSprite(
 			loadPNGFile(door_magic_small_png),
 			loadPNGFile(door_magic_png)
 		);
-	sprite_space[EDITOR_SPRITE_DOOR_QUEST] =
+	internalSprite(EDITOR_SPRITE_DOOR_QUEST) =
 		newd EditorSprite(
 			loadPNGFile(door_quest_small_png),
 			loadPNGFile(door_quest_png)
 		);
-	sprite_space[EDITOR_SPRITE_WINDOW_NORMAL] =
+	internalSprite(EDITOR_SPRITE_WINDOW_NORMAL) =
 		newd EditorSprite(
 			loadPNGFile(window_normal_small_png),
 			loadPNGFile(window_normal_png)
 		);
-	sprite_space[EDITOR_SPRITE_WINDOW_HATCH] =
+	internalSprite(EDITOR_SPRITE_WINDOW_HATCH) =
 		newd EditorSprite(
 			loadPNGFile(window_hatch_small_png),
 			loadPNGFile(window_hatch_png)
 		);
 
-	sprite_space[EDITOR_SPRITE_SELECTION_GEM] =
+	internalSprite(EDITOR_SPRITE_SELECTION_GEM) =
 		newd EditorSprite(
 			loadPNGFile(gem_edit_png),
 			nullptr
 		);
-	sprite_space[EDITOR_SPRITE_DRAWING_GEM] =
+	internalSprite(EDITOR_SPRITE_DRAWING_GEM) =
 		newd EditorSprite(
 			loadPNGFile(gem_move_png),
 			nullptr
 		);
 
-	sprite_space[EDITOR_SPRITE_SPAWNS] = GameSprite::createFromBitmap(ART_SPAWNS);
-	sprite_space[EDITOR_SPRITE_HOUSE_EXIT] = GameSprite::createFromBitmap(ART_HOUSE_EXIT);
-	sprite_space[EDITOR_SPRITE_PICKUPABLE_ITEM] = GameSprite::createFromBitmap(ART_PICKUPABLE);
-	sprite_space[EDITOR_SPRITE_MOVEABLE_ITEM] = GameSprite::createFromBitmap(ART_MOVEABLE);
-	sprite_space[EDITOR_SPRITE_PICKUPABLE_MOVEABLE_ITEM] = GameSprite::createFromBitmap(ART_PICKUPABLE_MOVEABLE);
+	internalSprite(EDITOR_SPRITE_SPAWNS) = GameSprite::createFromBitmap(ART_SPAWNS);
+	internalSprite(EDITOR_SPRITE_HOUSE_EXIT) = GameSprite::createFromBitmap(ART_HOUSE_EXIT);
+	internalSprite(EDITOR_SPRITE_PICKUPABLE_ITEM) = GameSprite::createFromBitmap(ART_PICKUPABLE);
+	internalSprite(EDITOR_SPRITE_MOVEABLE_ITEM) = GameSprite::createFromBitmap(ART_MOVEABLE);
+	internalSprite(EDITOR_SPRITE_PICKUPABLE_MOVEABLE_ITEM) = GameSprite::createFromBitmap(ART_PICKUPABLE_MOVEABLE);
 
 	return true;
 }
@@ -424,11 +425,13 @@ bool GraphicManager::loadSpriteMetadata(const FileName& datafile, wxString& erro
 		has_frame_groups = dat_format >= DAT_FORMAT_1057;
 	}
 
+	game_sprites.assign(maxID + 1, nullptr);
+
 	uint16_t id = minID;
 	// loop through all ItemDatabase until we reach the end of file
 	while(id <= maxID) {
 		GameSprite* sType = newd GameSprite();
-		sprite_space[id] = sType;
+		game_sprites[id] = sType;
 
 		sType->id = id;
 
@@ -509,12 +512,15 @@ bool GraphicManager::loadSpriteMetadata(const FileName& datafile, wxString& erro
 					sprite_id = u16;
 				}
 
+				if(sprite_id >= image_space.size()) {
+					image_space.resize(std::max<size_t>(sprite_id + 1, image_space.size() * 2), nullptr);
+				}
 				if(image_space[sprite_id] == nullptr) {
 					GameSprite::NormalImage* img = newd GameSprite::NormalImage();
 					img->id = sprite_id;
 					image_space[sprite_id] = img;
 				}
-				sType->spriteList.push_back(static_cast<GameSprite::NormalImage*>(image_space[sprite_id]));
+				sType->spriteList.push_back(image_space[sprite_id]);
 			}
 		}
 		++id;
@@ -708,117 +714,21 @@ bool GraphicManager::loadSpriteMetadataFlags(FileReadHandle& file, GameSprite* s
 
 bool GraphicManager::loadSpriteData(const FileName& datafile, wxString& error, wxArrayString& warnings)
 {
-	FileReadHandle fh(nstr(datafile.GetFullPath()));
-
-	if(!fh.isOk()) {
-		error = "Failed to open file for reading";
+	// Memcached sprites read the whole file up front, otherwise the OS pages it in on demand
+	bool preload = g_settings.getInteger(Config::USE_MEMCACHED_SPRITES);
+	if(!sprite_archive.open(nstr(datafile.GetFullPath()), is_extended, preload, error)) {
 		return false;
 	}
 
-#define safe_get(func, ...) do {\
-		if(!fh.get##func(__VA_ARGS__)) {\
-			error = wxstr(fh.getErrorMessage()); \
-			return false; \
-		} \
-	} while(false)
-
-
-	uint32_t sprSignature;
-	safe_get(U32, sprSignature);
-
-	uint32_t total_pics = 0;
-	if(is_extended) {
-		safe_get(U32, total_pics);
-	} else {
-		uint16_t u16 = 0;
-		safe_get(U16, u16);
-		total_pics = u16;
-	}
-
-	if(!g_settings.getInteger(Config::USE_MEMCACHED_SPRITES)) {
-		spritefile = nstr(datafile.GetFullPath());
-		unloaded = false;
-		return true;
-	}
-
-	std::vector<uint32_t> sprite_indexes;
-	for(uint32_t i = 0; i < total_pics; ++i) {
-		uint32_t index;
-		safe_get(U32, index);
-		sprite_indexes.push_back(index);
-	}
-
-	// Now read individual sprites
-	int id = 1;
-	for(std::vector<uint32_t>::iterator sprite_iter = sprite_indexes.begin(); sprite_iter != sprite_indexes.end(); ++sprite_iter, ++id) {
-		uint32_t index = *sprite_iter + 3;
-		fh.seek(index);
-		uint16_t size;
-		safe_get(U16, size);
-
-		ImageMap::iterator it = image_space.find(id);
-		if(it != image_space.end()) {
-			GameSprite::NormalImage* spr = dynamic_cast<GameSprite::NormalImage*>(it->second);
-			if(spr && size > 0) {
-				if(spr->size > 0) {
-					wxString ss;
-					ss << "items.spr: Duplicate GameSprite id " << id;
-					warnings.push_back(ss);
-					fh.skip(size);
-				} else {
-					spr->id = id;
-					spr->size = size;
-					spr->dump = newd uint8_t[size];
-					if(!fh.getRAW(spr->dump, size)) {
-						error = wxstr(fh.getErrorMessage()); \
-						return false;
-					}
-				}
-			}
-		} else {
-			fh.skip(size);
+	for(uint32_t id = 0; id < image_space.size(); ++id) {
+		GameSprite::NormalImage* spr = image_space[id];
+		if(spr) {
+			spr->dump = sprite_archive.getSprite(id, spr->size);
 		}
 	}
-#undef safe_get
-	unloaded = false;
-	return true;
-}
-
-bool GraphicManager::loadSpriteDump(uint8_t*& target, uint16_t& size, int sprite_id)
-{
-	if(g_settings.getInteger(Config::USE_MEMCACHED_SPRITES))
-		return false;
 
-	if(sprite_id == 0) {
-		// Empty GameSprite
-		size = 0;
-		target = nullptr;
-		return true;
-	}
-
-	FileReadHandle fh(spritefile);
-	if(!fh.isOk())
-		return false;
 	unloaded = false;
-
-	if(!fh.seek((is_extended ? 4 : 2) + sprite_id * sizeof(uint32_t)))
-		return false;
-
-	uint32_t to_seek = 0;
-	if(fh.getU32(to_seek)) {
-		fh.seek(to_seek+3);
-		uint16_t sprite_size;
-		if(fh.getU16(sprite_size)) {
-			target = newd uint8_t[sprite_size];
-			if(fh.getRAW(target, sprite_size)) {
-				size = sprite_size;
-				return true;
-			}
-			delete[] target;
-			target = nullptr;
-		}
-	}
-	return false;
+	return true;
 }
 
 void GraphicManager::addSpriteToCleanup(GameSprite* spr)
@@ -839,16 +749,11 @@ void GraphicManager::garbageCollection()
 		int t = time(nullptr);
 		if(loaded_textures > g_settings.getInteger(Config::TEXTURE_CLEAN_THRESHOLD) &&
 			t - lastclean > g_settings.getInteger(Config::TEXTURE_CLEAN_PULSE)) {
-			ImageMap::iterator iit = image_space.begin();
-			while(iit != image_space.end()) {
-				iit->second->clean(t);
-				++iit;
+			for(GameSprite::NormalImage* image : image_space) {
+				if(image) image->clean(t);
 			}
-			SpriteMap::iterator sit = sprite_space.begin();
-			while(sit != sprite_space.end()) {
-				GameSprite* gs = dynamic_cast<GameSprite*>(sit->second);
-				if(gs) gs->clean(t);
-				++sit;
+			for(GameSprite* sprite : game_sprites) {
+				if(sprite) sprite->clean(t);
 			}
 			lastclean = t;
 		}
@@ -882,7 +787,6 @@ void EditorSprite::unloadDC()
 }
 
 GameSprite::GameSprite() :
-	id(0),
 	height(0),
 	width(0),
 	layers(0),
@@ -890,11 +794,12 @@ GameSprite::GameSprite() :
 	pattern_y(0),
 	pattern_z(0),
 	frames(0),
+	draw_height(0),
 	numsprites(0),
 	animator(nullptr),
 	ground_speed(0),
-	draw_height(0),
-	minimap_color(0)
+	minimap_color(0),
+	id(0)
 {
 	dc[SPRITE_SIZE_16x16] = nullptr;
 	dc[SPRITE_SIZE_32x32] = nullptr;
@@ -903,19 +808,16 @@ GameSprite::GameSprite() :
 GameSprite::~GameSprite()
 {
 	unloadDC();
-	for(std::list<TemplateImage*>::iterator iter = instanced_templates.begin(); iter != instanced_templates.end(); ++iter) {
-		delete *iter;
+	for(auto& entry : instanced_templates) {
+		delete entry.second;
 	}
 
 	delete animator;
 }
 
 void GameSprite::clean(int time) {
-	for(std::list<TemplateImage*>::iterator iter = instanced_templates.begin();
-			iter != instanced_templates.end();
-			++iter)
-	{
-		(*iter)->clean(time);
+	for(auto& entry : instanced_templates) {
+		entry.second->clean(time);
 	}
 }
 
@@ -938,43 +840,109 @@ int GameSprite::getIndex(int width, int height, int layer, int pattern_x, int pa
 		this->width + width;
 }
 
-GLuint GameSprite::getHardwareID(int _x, int _y, int _layer, int _count, int _pattern_x, int _pattern_y, int _pattern_z, int _frame)
+uint32_t GameSprite::getSpriteIndex(int _x, int _y, int _layer, int _count, int _pattern_x, int _pattern_y, int _frame) const
 {
-	uint32_t v;
 	if(_count >= 0 && height <= 1 && width <= 1) {
-		v = _count;
+		return _count;
+	}
+	return ((((((_frame)*pattern_y+_pattern_y)*pattern_x+_pattern_x)*layers+_layer)*height+_y)*width+_x);
+}
+
+GameSprite::ItemPattern GameSprite::getItemPattern(const Tile* tile, const Item* item, int& draw_x, int& draw_y) const
+{
+	const ItemType& type = g_items.getItemType(item->getID());
+	const Position& pos = tile->getPosition();
+
+	ItemPattern pattern;
+	pattern.screenx = draw_x - draw_offset.x;
+	pattern.screeny = draw_y - draw_offset.y;
+	pattern.subtype = -1;
+	pattern.pattern_x = 0;
+	pattern.pattern_y = 0;
+
+	// Set the newd drawing height accordingly
+	draw_x -= draw_height;
+	draw_y -= draw_height;
+
+	if(type.isSplash() || type.isFluidContainer()) {
+		pattern.subtype = item->getSubtype();
+	} else if(type.isHangable) {
+		if(tile->hasProperty(HOOK_SOUTH)) {
+			pattern.pattern_x = 1;
+		} else if(tile->hasProperty(HOOK_EAST)) {
+			pattern.pattern_x = 2;
+		}
+	} else if(type.stackable && pattern_x == 4 && pattern_y == 2) {
+		int count = item->getSubtype();
+		if(count <= 0) {
+			pattern.pattern_x = 0;
+			pattern.pattern_y = 0;
+		} else if(count < 5) {
+			pattern.pattern_x = count - 1;
+			pattern.pattern_y = 0;
+		} else if(count < 10) {
+			pattern.pattern_x = 0;
+			pattern.pattern_y = 1;
+		} else if(count < 25) {
+			pattern.pattern_x = 1;
+			pattern.pattern_y = 1;
+		} else if(count < 50) {
+			pattern.pattern_x = 2;
+			pattern.pattern_y = 1;
+		} else {
+			pattern.pattern_x = 3;
+			pattern.pattern_y = 1;
+		}
 	} else {
-		v = ((((((_frame)*pattern_y+_pattern_y)*pattern_x+_pattern_x)*layers+_layer)*height+_y)*width+_x);
+		pattern.pattern_x = pos.x % pattern_x;
+		pattern.pattern_y = pos.y % pattern_y;
 	}
-	if(v >= numsprites) {
+
+	pattern.animated = animator && frames > 1 && (pattern.subtype < 0 || width > 1 || height > 1);
+	pattern.frame = pattern.animated ? 0 : item->getFrame();
+	return pattern;
+}
+
+uint32_t GameSprite::wrapIndex(uint32_t index) const noexcept
+{
+	if(index >= numsprites) {
 		if(numsprites == 1) {
-			v = 0;
+			index = 0;
 		} else {
-			v %= numsprites;
+			index %= numsprites;
 		}
 	}
-	return spriteList[v]->getHardwareID();
+	return index;
+}
+
+GLuint GameSprite::getHardwareID(uint32_t index)
+{
+	return spriteList[wrapIndex(index)]->getHardwareID();
+}
+
+uint8_t* GameSprite::getRGBAData(uint32_t index)
+{
+	return spriteList[wrapIndex(index)]->getRGBAData();
+}
+
+uint32_t GameSprite::getImageID(uint32_t index) const
+{
+	return spriteList[wrapIndex(index)]->id;
+}
+
+GLuint GameSprite::getHardwareID(int _x, int _y, int _layer, int _count, int _pattern_x, int _pattern_y, int _pattern_z, int _frame)
+{
+	return getHardwareID(getSpriteIndex(_x, _y, _layer, _count, _pattern_x, _pattern_y, _frame));
 }
 
 GameSprite::TemplateImage* GameSprite::getTemplateImage(int sprite_index, const Outfit& outfit)
 {
-	if(instanced_templates.empty()) {
-		TemplateImage* img = newd TemplateImage(this, sprite_index, outfit);
-		instanced_templates.push_back(img);
-		return img;
+	// Spawns easily have dozens of color combinations of the same outfit
+	uint64_t key = uint64_t(uint32_t(sprite_index)) << 32 | outfit.getColorHash();
+	TemplateImage*& img = instanced_templates[key];
+	if(!img) {
+		img = newd TemplateImage(this, sprite_index, outfit);
 	}
-	// While this is linear lookup, it is very rare for the list to contain more than 4-8 entries, so it's faster than a hashmap anyways.
-	for(std::list<TemplateImage*>::iterator iter = instanced_templates.begin(); iter != instanced_templates.end(); ++iter) {
-		TemplateImage* img = *iter;
-		if(img->sprite_index == sprite_index) {
-			uint32_t lookHash = img->lookHead << 24 | img->lookBody << 16 | img->lookLegs << 8 | img->lookFeet;
-			if(outfit.getColorHash() == lookHash) {
-				return img;
-			}
-		}
-	}
-	TemplateImage* img = newd TemplateImage(this, sprite_index, outfit);
-	instanced_templates.push_back(img);
 	return img;
 }
 
@@ -1134,6 +1102,7 @@ void GameSprite::Image::createGLTexture(GLuint textureId)
 
 	isGLLoaded = true;
 	g_gui.gfx.loaded_textures += 1;
+	g_profiler.count(FrameProfiler::TEXTURES_CREATED);
 
 	glBindTexture(GL_TEXTURE_2D, textureId);
 	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR); // Linear Filtering
@@ -1149,6 +1118,7 @@ void GameSprite::Image::unloadGLTexture(GLuint textureId)
 {
 	isGLLoaded = false;
 	g_gui.gfx.loaded_textures -= 1;
+	g_profiler.count(FrameProfiler::TEXTURES_EVICTED);
 	glDeleteTextures(1, &textureId);
 }
 
@@ -1174,30 +1144,16 @@ GameSprite::NormalImage::NormalImage() :
 
 GameSprite::NormalImage::~NormalImage()
 {
-	delete[] dump;
+	////
 }
 
 void GameSprite::NormalImage::clean(int time)
 {
 	Image::clean(time);
-	if(time - lastaccess > 5 && !g_settings.getInteger(Config::USE_MEMCACHED_SPRITES)) { // We keep dumps around for 5 seconds.
-		delete[] dump;
-		dump = nullptr;
-	}
 }
 
 uint8_t* GameSprite::NormalImage::getRGBData()
 {
-	if(!dump) {
-		if(g_settings.getInteger(Config::USE_MEMCACHED_SPRITES)) {
-			return nullptr;
-		}
-
-		if(!g_gui.gfx.loadSpriteDump(dump, size, id)) {
-			return nullptr;
-		}
-	}
-
 	const int pixels_data_size = rme::SpritePixels * rme::SpritePixels * 3;
 	uint8_t* data = newd uint8_t[pixels_data_size];
 	uint8_t bpp = g_gui.gfx.hasTransparency() ? 4 : 3;
@@ -1205,7 +1161,7 @@ uint8_t* GameSprite::NormalImage::getRGBData()
 	int read = 0;
 
 	// decompress pixels
-	while(read < size && write < pixels_data_size) {
+	while(read + 4 <= size && write < pixels_data_size) {
 		int transparent = dump[read] | dump[read + 1] << 8;
 		read += 2;
 		for(int i = 0; i < transparent && write < pixels_data_size; i++) {
@@ -1217,7 +1173,7 @@ uint8_t* GameSprite::NormalImage::getRGBData()
 
 		int colored = dump[read] | dump[read + 1] << 8;
 		read += 2;
-		for(int i = 0; i < colored && write < pixels_data_size; i++) {
+		for(int i = 0; i < colored && write < pixels_data_size && read + bpp <= size; i++) {
 			data[write + 0] = dump[read + 0]; // red
 			data[write + 1] = dump[read + 1]; // green
 			data[write + 2] = dump[read + 2]; // blue
@@ -1238,57 +1194,9 @@ uint8_t* GameSprite::NormalImage::getRGBData()
 
 uint8_t* GameSprite::NormalImage::getRGBAData()
 {
-	if(!dump) {
-		if(g_settings.getInteger(Config::USE_MEMCACHED_SPRITES)) {
-			return nullptr;
-		}
-
-		if(!g_gui.gfx.loadSpriteDump(dump, size, id)) {
-			return nullptr;
-		}
-	}
-
-	const int pixels_data_size = rme::SpritePixelsSize * 4;
-	uint8_t* data = newd uint8_t[pixels_data_size];
-	bool use_alpha = g_gui.gfx.hasTransparency();
-	uint8_t bpp = use_alpha ? 4 : 3;
-	int write = 0;
-	int read = 0;
-
-	// decompress pixels
-	while(read < size && write < pixels_data_size) {
-		int transparent = dump[read] | dump[read + 1] << 8;
-		if(use_alpha && transparent >= rme::SpritePixelsSize) // Corrupted sprite?
-			break;
-		read += 2;
-		for(int i = 0; i < transparent && write < pixels_data_size; i++) {
-			data[write + 0] = 0x00; // red
-			data[write + 1] = 0x00; // green
-			data[write + 2] = 0x00; // blue
-			data[write + 3] = 0x00; // alpha
-			write += 4;
-		}
-
-		int colored = dump[read] | dump[read + 1] << 8;
-		read += 2;
-		for(int i = 0; i < colored && write < pixels_data_size; i++) {
-			data[write + 0] = dump[read + 0]; // red
-			data[write + 1] = dump[read + 1]; // green
-			data[write + 2] = dump[read + 2]; // blue
-			data[write + 3] = use_alpha ? dump[read + 3] : 0xFF; // alpha
-			write += 4;
-			read += bpp;
-		}
-	}
-
-	// fill remaining pixels
-	while(write < pixels_data_size) {
-		data[write + 0] = 0x00; // red
-		data[write + 1] = 0x00; // green
-		data[write + 2] = 0x00; // blue
-		data[write + 3] = 0x00; // alpha
-		write += 4;
-	}
+	uint8_t* data = newd uint8_t[rme::SpritePixelsSize * rme::PixelFormatRGBA];
+	decodeSpritePixels(dump, dump ? size : 0, g_gui.gfx.hasTransparency(), data);
+	g_profiler.count(FrameProfiler::SPRITES_DECODED);
 	return data;
 }
 
@@ -1391,118 +1299,68 @@ GameSprite::TemplateImage::~TemplateImage()
 	////
 }
 
-void GameSprite::TemplateImage::colorizePixel(uint8_t color, uint8_t& red, uint8_t& green, uint8_t& blue)
-{
-	// Thanks! Khaos, or was it mips? Hmmm... =)
-	uint8_t ro = (TemplateOutfitLookupTable[color] & 0xFF0000) >> 16; // rgb outfit
-	uint8_t go = (TemplateOutfitLookupTable[color] & 0xFF00) >> 8;
-	uint8_t bo = (TemplateOutfitLookupTable[color] & 0xFF);
-	red = (uint8_t)(red * (ro / 255.f));
-	green = (uint8_t)(green * (go / 255.f));
-	blue = (uint8_t)(blue * (bo / 255.f));
-}
-
 uint8_t* GameSprite::TemplateImage::getRGBData()
 {
-	uint8_t* rgbdata = parent->spriteList[sprite_index]->getRGBData();
-	uint8_t* template_rgbdata = parent->spriteList[sprite_index + parent->height * parent->width]->getRGBData();
-
-	if(!rgbdata) {
-		delete[] template_rgbdata;
-		return nullptr;
-	}
-	if(!template_rgbdata) {
-		delete[] rgbdata;
+	uint8_t* rgbadata = getRGBAData();
+	if(!rgbadata) {
 		return nullptr;
 	}
 
-	if(lookHead > (sizeof(TemplateOutfitLookupTable) / sizeof(TemplateOutfitLookupTable[0]))) {
-		lookHead = 0;
-	}
-	if(lookBody > (sizeof(TemplateOutfitLookupTable) / sizeof(TemplateOutfitLookupTable[0]))) {
-		lookBody = 0;
-	}
-	if(lookLegs > (sizeof(TemplateOutfitLookupTable) / sizeof(TemplateOutfitLookupTable[0]))) {
-		lookLegs = 0;
-	}
-	if(lookFeet > (sizeof(TemplateOutfitLookupTable) / sizeof(TemplateOutfitLookupTable[0]))) {
-		lookFeet = 0;
-	}
-
-	for(int y = 0; y < rme::SpritePixels; ++y) {
-		for(int x = 0; x < rme::SpritePixels; ++x) {
-			uint8_t& red   = rgbdata[y*rme::SpritePixels*3 + x*3 + 0];
-			uint8_t& green = rgbdata[y*rme::SpritePixels*3 + x*3 + 1];
-			uint8_t& blue  = rgbdata[y*rme::SpritePixels*3 + x*3 + 2];
-
-			uint8_t& tred   = template_rgbdata[y*rme::SpritePixels*3 + x*3 + 0];
-			uint8_t& tgreen = template_rgbdata[y*rme::SpritePixels*3 + x*3 + 1];
-			uint8_t& tblue  = template_rgbdata[y*rme::SpritePixels*3 + x*3 + 2];
-
-			if(tred && tgreen && !tblue) { // yellow => head
-				colorizePixel(lookHead, red, green, blue);
-			} else if(tred && !tgreen && !tblue) { // red => body
-				colorizePixel(lookBody, red, green, blue);
-			} else if(!tred && tgreen && !tblue) { // green => legs
-				colorizePixel(lookLegs, red, green, blue);
-			} else if(!tred && !tgreen && tblue) { // blue => feet
-				colorizePixel(lookFeet, red, green, blue);
-			}
+	uint8_t* rgbdata = newd uint8_t[rme::SpritePixelsSize * rme::PixelFormatRGB];
+	for(int i = 0; i < rme::SpritePixelsSize; ++i) {
+		const uint8_t* source = rgbadata + i * rme::PixelFormatRGBA;
+		uint8_t* target = rgbdata + i * rme::PixelFormatRGB;
+		if(source[3] == 0) {
+			// Magenta is the transparent color of the software sprites
+			target[0] = 0xFF;
+			target[1] = 0x00;
+			target[2] = 0xFF;
+		} else {
+			target[0] = source[0];
+			target[1] = source[1];
+			target[2] = source[2];
 		}
 	}
-	delete[] template_rgbdata;
+	delete[] rgbadata;
 	return rgbdata;
 }
 
 uint8_t* GameSprite::TemplateImage::getRGBAData()
 {
-	uint8_t* rgbadata = parent->spriteList[sprite_index]->getRGBAData();
-	uint8_t* template_rgbdata = parent->spriteList[sprite_index + parent->height * parent->width]->getRGBData();
-
-	if(!rgbadata) {
-		delete[] template_rgbdata;
-		return nullptr;
-	}
-	if(!template_rgbdata) {
-		delete[] rgbadata;
-		return nullptr;
-	}
+	const NormalImage* image = parent->spriteList[sprite_index];
+	const NormalImage* template_image = parent->spriteList[sprite_index + parent->height * parent->width];
 
-	if(lookHead > (sizeof(TemplateOutfitLookupTable) / sizeof(TemplateOutfitLookupTable[0]))) {
+	constexpr size_t table_size = sizeof(TemplateOutfitLookupTable) / sizeof(TemplateOutfitLookupTable[0]);
+	if(lookHead >= table_size) {
 		lookHead = 0;
 	}
-	if(lookBody > (sizeof(TemplateOutfitLookupTable) / sizeof(TemplateOutfitLookupTable[0]))) {
+	if(lookBody >= table_size) {
 		lookBody = 0;
 	}
-	if(lookLegs > (sizeof(TemplateOutfitLookupTable) / sizeof(TemplateOutfitLookupTable[0]))) {
+	if(lookLegs >= table_size) {
 		lookLegs = 0;
 	}
-	if(lookFeet > (sizeof(TemplateOutfitLookupTable) / sizeof(TemplateOutfitLookupTable[0]))) {
+	if(lookFeet >= table_size) {
 		lookFeet = 0;
 	}
 
-	for(int y = 0; y < rme::SpritePixels; ++y) {
-		for(int x = 0; x < rme::SpritePixels; ++x) {
-			uint8_t& red   = rgbadata[y*rme::SpritePixels*4 + x*4 + 0];
-			uint8_t& green = rgbadata[y*rme::SpritePixels*4 + x*4 + 1];
-			uint8_t& blue  = rgbadata[y*rme::SpritePixels*4 + x*4 + 2];
-
-			uint8_t& tred   = template_rgbdata[y*rme::SpritePixels*3 + x*3 + 0];
-			uint8_t& tgreen = template_rgbdata[y*rme::SpritePixels*3 + x*3 + 1];
-			uint8_t& tblue  = template_rgbdata[y*rme::SpritePixels*3 + x*3 + 2];
-
-			if(tred && tgreen && !tblue) { // yellow => head
-				colorizePixel(lookHead, red, green, blue);
-			} else if(tred && !tgreen && !tblue) { // red => body
-				colorizePixel(lookBody, red, green, blue);
-			} else if(!tred && tgreen && !tblue) { // green => legs
-				colorizePixel(lookLegs, red, green, blue);
-			} else if(!tred && !tgreen && tblue) { // blue => feet
-				colorizePixel(lookFeet, red, green, blue);
-			}
-		}
+	uint8_t* rgbadata = newd uint8_t[rme::SpritePixelsSize * rme::PixelFormatRGBA];
+	uint32_t color_hash = lookHead << 24 | lookBody << 16 | lookLegs << 8 | lookFeet;
+	if(g_gui.gfx.outfit_cache.get(image->id, template_image->id, color_hash, rgbadata)) {
+		return rgbadata;
 	}
-	delete[] template_rgbdata;
+
+	bool has_alpha = g_gui.gfx.hasTransparency();
+	uint8_t template_rgbadata[rme::SpritePixelsSize * rme::PixelFormatRGBA];
+	decodeSpritePixels(image->dump, image->dump ? image->size : 0, has_alpha, rgbadata);
+	decodeSpritePixels(template_image->dump, template_image->dump ? template_image->size : 0, has_alpha, template_rgbadata);
+	g_profiler.count(FrameProfiler::SPRITES_DECODED, 2);
+
+	colorizeOutfitPixels(rgbadata, template_rgbadata,
+		TemplateOutfitLookupTable[lookHead], TemplateOutfitLookupTable[lookBody],
+		TemplateOutfitLookupTable[lookLegs], TemplateOutfitLookupTable[lookFeet]);
+
+	g_gui.gfx.outfit_cache.put(image->id, template_image->id, color_hash, rgbadata);
 	return rgbadata;
 }
 
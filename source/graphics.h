@@ -23,6 +23,8 @@
 #include <deque>
 
 #include "client_version.h"
+#include "sprite_archive.h"
+#include "sprite_pixels.h"
 
 #include <wx/artprov.h>
 
@@ -86,6 +88,34 @@ public:
 	int getIndex(int width, int height, int layer, int pattern_x, int pattern_y, int pattern_z, int frame) const;
 	GLuint getHardwareID(int _x, int _y, int _layer, int _subtype, int _pattern_x, int _pattern_y, int _pattern_z, int _frame);
 	GLuint getHardwareID(int _x, int _y, int _dir, int _addon, int _pattern_z, const Outfit& _outfit, int _frame); // CreatureDatabase
+	// Unwrapped index into the sprite list, frames are frameStride() apart
+	uint32_t getSpriteIndex(int _x, int _y, int _layer, int _subtype, int _pattern_x, int _pattern_y, int _frame) const;
+	uint32_t frameStride() const noexcept { return uint32_t(pattern_y) * pattern_x * layers * height * width; }
+	GLuint getHardwareID(uint32_t index);
+	// Pixels of one image without touching GL, for drawing off the GL thread.
+	// The index wraps like getHardwareID, the caller deletes the buffer.
+	uint8_t* getRGBAData(uint32_t index);
+	// Images shared between sprites have the same id
+	uint32_t getImageID(uint32_t index) const;
+
+	// Which images of the sprite an item on a tile uses and where they go,
+	// shared by everything that draws map tiles
+	struct ItemPattern {
+		int screenx;
+		int screeny;
+		int subtype;
+		int pattern_x;
+		int pattern_y;
+		int frame;
+		// Only the frame 0 index is worked out, the frame is picked when drawing
+		bool animated;
+
+		uint32_t getSpriteIndex(const GameSprite* sprite, int x, int y, int layer) const {
+			return sprite->getSpriteIndex(x, y, layer, subtype, pattern_x, pattern_y, frame);
+		}
+	};
+	// Moves draw_x and draw_y up by the draw height, for the next item on the tile
+	ItemPattern getItemPattern(const Tile* tile, const Item* item, int& draw_x, int& draw_y) const;
 	virtual void DrawTo(wxDC* dc, SpriteSize sz, int start_x, int start_y, int width = -1, int height = -1);
 	void DrawTo(wxDC* context, const wxRect& rect, const Outfit& outfit);
 
@@ -107,6 +137,8 @@ protected:
 	class NormalImage;
 	class TemplateImage;
 
+	uint32_t wrapIndex(uint32_t index) const noexcept;
+
 	wxMemoryDC* getDC(SpriteSize size);
 	wxMemoryDC* getDC(const Outfit& outfit);
 	TemplateImage* getTemplateImage(int sprite_index, const Outfit& outfit);
@@ -139,9 +171,9 @@ protected:
 		// We use the sprite id as GL texture id
 		uint32_t id;
 
-		// This contains the pixel data
+		// This contains the pixel data, owned by the sprite archive
 		uint16_t size;
-		uint8_t* dump;
+		const uint8_t* dump;
 
 		virtual void clean(int time);
 
@@ -181,17 +213,14 @@ protected:
 		uint8_t lookLegs;
 		uint8_t lookFeet;
 	protected:
-		void colorizePixel(uint8_t color, uint8_t &r, uint8_t &b, uint8_t &g);
-
 		virtual void createGLTexture(GLuint ignored = 0);
 		virtual void unloadGLTexture(GLuint ignored = 0);
 	};
 
-	uint32_t id;
-	wxMemoryDC* dc[SPRITE_SIZE_COUNT];
-
 public:
 	// GameSprite info
+	// Everything BlitItem reads is kept together at the start of the object,
+	// so drawing an item touches a single cache line of its sprite.
 	uint8_t height;
 	uint8_t width;
 	uint8_t layers;
@@ -199,20 +228,26 @@ public:
 	uint8_t pattern_y;
 	uint8_t pattern_z;
 	uint8_t frames;
+	uint16_t draw_height;
 	uint32_t numsprites;
+	wxPoint draw_offset;
+	std::vector<NormalImage*> spriteList;
 
 	Animator* animator;
 
 	uint16_t ground_speed;
-	uint16_t draw_height;
-	wxPoint draw_offset;
 	uint16_t minimap_color;
 
+protected:
+	uint32_t id;
+	wxMemoryDC* dc[SPRITE_SIZE_COUNT];
+
+public:
 	bool has_light = false;
 	SpriteLight light;
 
-	std::vector<NormalImage*> spriteList;
-	std::list<TemplateImage*> instanced_templates; // Templates that use this sprite
+	// Templates that use this sprite, keyed on sprite index << 32 | outfit color hash
+	std::unordered_map<uint64_t, TemplateImage*> instanced_templates;
 
 	friend class GraphicManager;
 };
@@ -286,8 +321,20 @@ public:
 	void clear();
 	void cleanSoftwareSprites();
 
-	Sprite* getSprite(int id);
-	GameSprite* getCreatureSprite(int id);
+	// Dense lookups, these run for every creature drawn each frame
+	Sprite* getSprite(int id) {
+		if(id < 0) {
+			return getInternalSprite(id);
+		}
+		return static_cast<size_t>(id) < game_sprites.size() ? game_sprites[id] : nullptr;
+	}
+	GameSprite* getCreatureSprite(int id) {
+		if(id < 0) {
+			return nullptr;
+		}
+		size_t index = static_cast<size_t>(id) + item_count;
+		return index < game_sprites.size() ? game_sprites[index] : nullptr;
+	}
 	GameSprite* getEditorSprite(int id);
 
 	long getElapsedTime() const { return (animation_timer->TimeInMicro() / 1000).ToLong(); }
@@ -317,19 +364,26 @@ public:
 
 	bool hasTransparency() const;
 	bool isUnloaded() const;
+	// Changes every time the loaded sprites are released
+	uint32_t getGeneration() const noexcept { return generation; }
 
 	ClientVersion *client_version;
 
 private:
 	bool unloaded;
-	// This is used if memcaching is NOT on
-	std::string spritefile;
-	bool loadSpriteDump(uint8_t*& target, uint16_t& size, int sprite_id);
-
-	typedef std::map<int, Sprite*> SpriteMap;
-	SpriteMap sprite_space;
-	typedef std::map<int, GameSprite::Image*> ImageMap;
-	ImageMap image_space;
+	uint32_t generation;
+	SpriteArchive sprite_archive;
+
+	Sprite* getInternalSprite(int id);
+	Sprite*& internalSprite(int id);
+
+	// Indexed by client id
+	std::vector<GameSprite*> game_sprites;
+	// Indexed by id - EDITOR_SPRITE_SELECTION_MARKER
+	std::vector<Sprite*> editor_sprites;
+	// Indexed by sprite id
+	std::vector<GameSprite::NormalImage*> image_space;
+	OutfitCache outfit_cache;
 	std::deque<GameSprite*> cleanup_list;
 
 	DatFormat dat_format;
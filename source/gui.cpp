@@ -27,6 +27,7 @@
 #include "map.h"
 #include "sprites.h"
 #include "materials.h"
+#include "data_cache.h"
 #include "doodad_brush.h"
 #include "spawn_brush.h"
 
@@ -378,22 +379,48 @@ bool GUI::LoadDataFiles(wxString& error, wxArrayString& warnings)
 		return false;
 	}
 
-	g_gui.SetLoadDone(20, "Loading items.otb file...");
-	if(!g_items.loadFromOtb(wxString(data_path.GetPath(wxPATH_GET_VOLUME | wxPATH_GET_SEPARATOR) + "items.otb"), error, warnings)) {
-		error = "Couldn't load items.otb: " + error;
-		g_gui.DestroyLoadBar();
-		UnloadVersion();
-		return false;
-	}
+	wxString items_otb = data_path.GetPath(wxPATH_GET_VOLUME | wxPATH_GET_SEPARATOR) + "items.otb";
+	wxString items_xml = data_path.GetPath(wxPATH_GET_VOLUME | wxPATH_GET_SEPARATOR) + "items.xml";
+	wxString creatures_xml = data_path.GetPath(wxPATH_GET_VOLUME | wxPATH_GET_SEPARATOR) + "creatures.xml";
 
-	g_gui.SetLoadDone(30, "Loading items.xml ...");
-	if(!g_items.loadFromGameXml(wxString(data_path.GetPath(wxPATH_GET_VOLUME | wxPATH_GET_SEPARATOR) + "items.xml"), error, warnings)) {
-		warnings.push_back("Couldn't load items.xml: " + error);
-	}
+	FileName cache_file = getLoadedVersion()->getLocalDataPath();
+	cache_file.SetFullName("data.cache");
+	DataCache cache(cache_file, GetCurrentVersionID());
+	cache.addSource(items_otb);
+	cache.addSource(items_xml);
+	cache.addSource(creatures_xml);
+
+	bool use_cache = g_settings.getInteger(Config::USE_DATA_CACHE);
+	if(use_cache && cache.load(g_items, g_creatures)) {
+		g_gui.SetLoadDone(45, "Loaded items and creatures from cache...");
+	} else {
+		// Only snapshot a clean parse, so problems keep being reported
+		size_t warning_count = warnings.size();
+		bool clean = true;
+
+		g_gui.SetLoadDone(20, "Loading items.otb file...");
+		if(!g_items.loadFromOtb(items_otb, error, warnings)) {
+			error = "Couldn't load items.otb: " + error;
+			g_gui.DestroyLoadBar();
+			UnloadVersion();
+			return false;
+		}
+
+		g_gui.SetLoadDone(30, "Loading items.xml ...");
+		if(!g_items.loadFromGameXml(items_xml, error, warnings)) {
+			warnings.push_back("Couldn't load items.xml: " + error);
+			clean = false;
+		}
 
-	g_gui.SetLoadDone(45, "Loading creatures.xml ...");
-	if(!g_creatures.loadFromXML(wxString(data_path.GetPath(wxPATH_GET_VOLUME | wxPATH_GET_SEPARATOR) + "creatures.xml"), true, error, warnings)) {
-		warnings.push_back("Couldn't load creatures.xml: " + error);
+		g_gui.SetLoadDone(45, "Loading creatures.xml ...");
+		if(!g_creatures.loadFromXML(creatures_xml, true, error, warnings)) {
+			warnings.push_back("Couldn't load creatures.xml: " + error);
+			clean = false;
+		}
+
+		if(use_cache && clean && warnings.size() == warning_count) {
+			cache.save(g_items, g_creatures);
+		}
 	}
 
 	g_gui.SetLoadDone(45, "Loading user creatures.xml ...");
@@ -1232,12 +1259,11 @@ bool GUI::SetLoadDone(int32_t done, const wxString& newMessage)
 	int32_t newProgress = progressFrom + static_cast<int32_t>((done / 100.f) * (progressTo - progressFrom));
 	newProgress = std::max<int32_t>(0, std::min<int32_t>(100, newProgress));
 
-	bool skip = false;
+	bool running = true;
 	if(progressBar) {
-		progressBar->Update(
+		running = progressBar->Update(
 			newProgress,
-			wxString::Format("%s (%d%%)", progressText, newProgress),
-			&skip
+			wxString::Format("%s (%d%%)", progressText, newProgress)
 		);
 		currentProgress = newProgress;
 	}
@@ -1252,7 +1278,7 @@ bool GUI::SetLoadDone(int32_t done, const wxString& newMessage)
 		}
 	}
 
-	return skip;
+	return running;
 }
 
 void GUI::DestroyLoadBar()
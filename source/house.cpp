@@ -102,6 +102,9 @@ void House::clean()
 	Tile* tile = map->getTile(exit);
 	if(tile)
 		tile->removeHouseExit(this);
+
+	map->invalidateRender();
+	map->invalidateStatistics();
 }
 
 size_t House::size() const
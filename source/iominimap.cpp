@@ -366,9 +366,24 @@ void IOMinimap::readBlocks()
 		return;
 	}
 
-	auto& map = m_editor->getMap();
-
 	int tiles_iterated = 0;
+
+	// The selected tiles are read directly instead of looked for in the map
+	if (m_mode == MinimapExportMode::SelectedArea) {
+		const auto& tiles = m_editor->getSelection().getTiles();
+		for (Tile* tile : tiles) {
+			if (m_updateLoadbar) {
+				++tiles_iterated;
+				if (tiles_iterated % 8192 == 0) {
+					g_gui.SetLoadDone(int(tiles_iterated / double(tiles.size()) * 90.0));
+				}
+			}
+			readTile(tile);
+		}
+		return;
+	}
+
+	auto& map = m_editor->getMap();
 	for(auto it = map.begin(); it != map.end(); ++it) {
 		auto tile = (*it)->get();
 
@@ -379,40 +394,39 @@ void IOMinimap::readBlocks()
 			}
 		}
 
-		if(!tile || (!tile->ground && tile->items.empty())) {
-			continue;
+		if (tile && (m_floor == -1 || tile->getPosition().z == m_floor)) {
+			readTile(tile);
 		}
+	}
+}
 
-		const auto& position = tile->getPosition();
-
-		if (m_mode == MinimapExportMode::SelectedArea) {
-			if (!tile->isSelected()) {
-				continue;
-			}
-		} else if (m_floor != -1 && position.z != m_floor) {
-			continue;
-		}
+void IOMinimap::readTile(Tile* tile)
+{
+	if(!tile->ground && tile->items.empty()) {
+		return;
+	}
 
-		MinimapTile minimapTile;
-		minimapTile.color = tile->getMiniMapColor();
-		minimapTile.flags |= MinimapTileWasSeen;
-		if (tile->isBlocking()) {
-			minimapTile.flags |= MinimapTileNotWalkable;
-		}
-		//if (!tile->isPathable()) {
-			//minimapTile.flags |= MinimapTileNotPathable;
-		//}
-		minimapTile.speed = std::min<int>((int)std::ceil(tile->getGroundSpeed() / 10.f), 0xFF);
-
-		auto& blocks = m_blocks[position.z];
-		uint32_t index = getBlockIndex(position);
-		if (blocks.find(index) == blocks.end()) {
-			blocks.insert({ index, MinimapBlock() });
-		}
+	const auto& position = tile->getPosition();
 
-		auto& block = blocks.at(index);
-		int offset_x = position.x - (position.x % MMBLOCK_SIZE);
-		int offset_y = position.y - (position.y % MMBLOCK_SIZE);
-		block.updateTile(position.x - offset_x, position.y - offset_y, minimapTile);
+	MinimapTile minimapTile;
+	minimapTile.color = tile->getMiniMapColor();
+	minimapTile.flags |= MinimapTileWasSeen;
+	if (tile->isBlocking()) {
+		minimapTile.flags |= MinimapTileNotWalkable;
+	}
+	//if (!tile->isPathable()) {
+		//minimapTile.flags |= MinimapTileNotPathable;
+	//}
+	minimapTile.speed = std::min<int>((int)std::ceil(tile->getGroundSpeed() / 10.f), 0xFF);
+
+	auto& blocks = m_blocks[position.z];
+	uint32_t index = getBlockIndex(position);
+	if (blocks.find(index) == blocks.end()) {
+		blocks.insert({ index, MinimapBlock() });
 	}
+
+	auto& block = blocks.at(index);
+	int offset_x = position.x - (position.x % MMBLOCK_SIZE);
+	int offset_y = position.y - (position.y % MMBLOCK_SIZE);
+	block.updateTile(position.x - offset_x, position.y - offset_y, minimapTile);
 }
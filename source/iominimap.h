@@ -81,6 +81,7 @@ private:
 	bool exportMinimap(const std::string& directory);
 	bool exportSelection(const std::string& directory, const std::string& name);
 	void readBlocks();
+	void readTile(Tile* tile);
 	inline uint32_t getBlockIndex(const Position& pos) {
 		return ((pos.y / MMBLOCK_SIZE) * (65536 / MMBLOCK_SIZE)) + (pos.x / MMBLOCK_SIZE);
 	}
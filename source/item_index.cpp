@@ -0,0 +1,303 @@
+//////////////////////////////////////////////////////////////////////
+// This file is part of Remere's Map Editor
+//////////////////////////////////////////////////////////////////////
+// Remere's Map Editor is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// Remere's Map Editor is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <http://www.gnu.org/licenses/>.
+//////////////////////////////////////////////////////////////////////
+
+#include "main.h"
+
+#include "item_index.h"
+#include "basemap.h"
+#include "complexitem.h"
+
+namespace {
+	// Pending changes of a list are merged in once there are more than this,
+	// or more than half the list
+	constexpr size_t MinPending = 256;
+
+	void writeVarint(std::vector<uint8_t>& data, uint64_t value)
+	{
+		while(value >= 0x80) {
+			data.push_back(uint8_t(value) | 0x80);
+			value >>= 7;
+		}
+		data.push_back(uint8_t(value));
+	}
+}
+
+ItemIndex::ItemIndex() :
+	entries(0),
+	valid(true)
+{
+	////
+}
+
+void ItemIndex::invalidate()
+{
+	std::unordered_map<uint32_t, List>().swap(lists);
+	entries = 0;
+	valid = false;
+}
+
+void ItemIndex::build(BaseMap& map)
+{
+	invalidate();
+	valid = true;
+	for(MapIterator it = map.begin(); it != map.end(); ++it) {
+		update(nullptr, (*it)->get());
+	}
+	compact();
+}
+
+void ItemIndex::compact()
+{
+	for(auto it = lists.begin(); it != lists.end();) {
+		List& list = it->second;
+		if(!list.added.empty() || !list.removed.empty())
+			compact(list);
+
+		if(list.size == 0)
+			it = lists.erase(it);
+		else
+			++it;
+	}
+}
+
+void ItemIndex::update(const Tile* old_tile, const Tile* new_tile)
+{
+	if(!valid || (!old_tile && !new_tile))
+		return;
+
+	old_keys.clear();
+	new_keys.clear();
+	if(old_tile) {
+		if(old_tile->ground)
+			collectKeys(old_tile->ground, old_keys);
+		for(Item* item : old_tile->items) {
+			collectKeys(item, old_keys);
+		}
+	}
+	if(new_tile) {
+		if(new_tile->ground)
+			collectKeys(new_tile->ground, new_keys);
+		for(Item* item : new_tile->items) {
+			collectKeys(item, new_keys);
+		}
+	}
+
+	// Actions replace tiles with edited copies, only what differs is changed
+	std::sort(old_keys.begin(), old_keys.end());
+	std::sort(new_keys.begin(), new_keys.end());
+
+	ASSERT(!old_tile || !new_tile || old_tile->getPosition() == new_tile->getPosition());
+	const uint64_t position = pack(new_tile ? new_tile->getPosition() : old_tile->getPosition());
+	auto old_it = old_keys.begin();
+	auto new_it = new_keys.begin();
+	while(old_it != old_keys.end() || new_it != new_keys.end()) {
+		if(new_it == new_keys.end() || (old_it != old_keys.end() && *old_it < *new_it)) {
+			remove(*old_it++, position);
+		} else if(old_it == old_keys.end() || *new_it < *old_it) {
+			add(*new_it++, position);
+		} else {
+			++old_it;
+			++new_it;
+		}
+	}
+}
+
+void ItemIndex::addItem(const Position& position, Item* item)
+{
+	if(!valid || !item)
+		return;
+
+	new_keys.clear();
+	collectKeys(item, new_keys);
+	for(uint32_t key : new_keys) {
+		add(key, pack(position));
+	}
+}
+
+void ItemIndex::removeItem(const Position& position, Item* item)
+{
+	if(!valid || !item)
+		return;
+
+	new_keys.clear();
+	collectKeys(item, new_keys);
+	for(uint32_t key : new_keys) {
+		remove(key, pack(position));
+	}
+}
+
+void ItemIndex::find(Key key, uint16_t id, PositionVector& positions)
+{
+	auto it = lists.find(makeKey(key, id));
+	if(it == lists.end())
+		return;
+
+	List& list = it->second;
+	if(!list.added.empty() || !list.removed.empty())
+		compact(list);
+
+	std::vector<uint64_t> values;
+	decode(list, values);
+	values.erase(std::unique(values.begin(), values.end()), values.end());
+
+	positions.reserve(positions.size() + values.size());
+	for(uint64_t value : values) {
+		positions.push_back(unpack(value));
+	}
+}
+
+void ItemIndex::findAny(Key key, PositionVector& positions)
+{
+	std::vector<uint64_t> values;
+	for(auto& entry : lists) {
+		if((entry.first >> 16) != key)
+			continue;
+
+		List& list = entry.second;
+		if(!list.added.empty() || !list.removed.empty())
+			compact(list);
+		decode(list, values);
+	}
+
+	std::sort(values.begin(), values.end());
+	values.erase(std::unique(values.begin(), values.end()), values.end());
+
+	positions.reserve(positions.size() + values.size());
+	for(uint64_t value : values) {
+		positions.push_back(unpack(value));
+	}
+}
+
+uint64_t ItemIndex::count(Key key, uint16_t id) const
+{
+	auto it = lists.find(makeKey(key, id));
+	if(it == lists.end())
+		return 0;
+
+	const List& list = it->second;
+	return list.size + list.added.size() - list.removed.size();
+}
+
+size_t ItemIndex::getMemoryUsage() const
+{
+	// Hash nodes hold the key, the list and a link
+	size_t usage = lists.bucket_count() * sizeof(void*);
+	for(const auto& entry : lists) {
+		const List& list = entry.second;
+		usage += sizeof(entry) + sizeof(void*);
+		usage += list.data.capacity();
+		usage += (list.added.capacity() + list.removed.capacity()) * sizeof(uint64_t);
+	}
+	return usage;
+}
+
+void ItemIndex::collectKeys(Item* item, std::vector<uint32_t>& keys)
+{
+	keys.push_back(makeKey(ITEM_ID, item->getID()));
+
+	uint16_t action_id = item->getActionID();
+	if(action_id != 0)
+		keys.push_back(makeKey(ACTION_ID, action_id));
+
+	uint16_t unique_id = item->getUniqueID();
+	if(unique_id != 0)
+		keys.push_back(makeKey(UNIQUE_ID, unique_id));
+
+	if(Container* container = item->getContainer()) {
+		for(Item* content : container->getVector()) {
+			collectKeys(content, keys);
+		}
+	}
+}
+
+void ItemIndex::decode(const List& list, std::vector<uint64_t>& values)
+{
+	values.reserve(values.size() + list.size);
+
+	uint64_t value = 0;
+	uint64_t delta = 0;
+	int shift = 0;
+	for(uint8_t byte : list.data) {
+		delta |= uint64_t(byte & 0x7F) << shift;
+		if(byte & 0x80) {
+			shift += 7;
+			continue;
+		}
+		value += delta;
+		values.push_back(value);
+		delta = 0;
+		shift = 0;
+	}
+}
+
+void ItemIndex::compact(List& list)
+{
+	std::vector<uint64_t> values;
+	decode(list, values);
+
+	// Positions repeat once per item, so these are multiset operations
+	std::sort(list.added.begin(), list.added.end());
+	std::sort(list.removed.begin(), list.removed.end());
+
+	std::vector<uint64_t> merged;
+	merged.reserve(values.size() + list.added.size());
+	std::merge(values.begin(), values.end(), list.added.begin(), list.added.end(), std::back_inserter(merged));
+
+	values.clear();
+	std::set_difference(merged.begin(), merged.end(), list.removed.begin(), list.removed.end(), std::back_inserter(values));
+
+	std::vector<uint8_t> data;
+	data.reserve(values.size() + values.size() / 4 + 8);
+	uint64_t previous = 0;
+	for(uint64_t value : values) {
+		writeVarint(data, value - previous);
+		previous = value;
+	}
+	data.shrink_to_fit();
+
+	list.data.swap(data);
+	list.size = uint32_t(values.size());
+	std::vector<uint64_t>().swap(list.added);
+	std::vector<uint64_t>().swap(list.removed);
+}
+
+void ItemIndex::add(uint32_t key, uint64_t position)
+{
+	List& list = lists[key];
+	list.added.push_back(position);
+	++entries;
+
+	if(list.added.size() + list.removed.size() > std::max<size_t>(MinPending, list.size / 2))
+		compact(list);
+}
+
+void ItemIndex::remove(uint32_t key, uint64_t position)
+{
+	auto it = lists.find(key);
+	if(it == lists.end())
+		return;
+
+	List& list = it->second;
+	list.removed.push_back(position);
+	--entries;
+
+	if(list.added.size() + list.removed.size() > std::max<size_t>(MinPending, list.size / 2)) {
+		compact(list);
+		if(list.size == 0)
+			lists.erase(it);
+	}
+}
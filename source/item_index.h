@@ -0,0 +1,100 @@
+//////////////////////////////////////////////////////////////////////
+// This file is part of Remere's Map Editor
+//////////////////////////////////////////////////////////////////////
+// Remere's Map Editor is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// Remere's Map Editor is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <http://www.gnu.org/licenses/>.
+//////////////////////////////////////////////////////////////////////
+
+#ifndef RME_ITEM_INDEX_H_
+#define RME_ITEM_INDEX_H_
+
+#include "position.h"
+
+#include <unordered_map>
+
+class BaseMap;
+class Tile;
+class Item;
+
+// Lists the positions of the tiles holding items with a given server id,
+// action id or unique id, container contents included. It is kept up to
+// date as tiles are replaced, so searches only visit the tiles they find.
+//
+// Every list keeps its positions sorted and delta encoded, changes are
+// appended to small pending lists and merged in when those grow too long
+// or the list is read.
+class ItemIndex
+{
+public:
+	enum Key : uint8_t {
+		ITEM_ID,
+		ACTION_ID,
+		UNIQUE_ID,
+	};
+
+	ItemIndex();
+
+	// Changes are ignored while the index is invalid, it has to be built
+	// again before it can answer anything
+	bool isValid() const noexcept { return valid; }
+	void invalidate();
+	void build(BaseMap& map);
+	// Merges every pending change, done after loading a map
+	void compact();
+
+	void update(const Tile* old_tile, const Tile* new_tile);
+	void addItem(const Position& position, Item* item);
+	void removeItem(const Position& position, Item* item);
+
+	// Sorted by floor, row and column, each position listed once
+	void find(Key key, uint16_t id, PositionVector& positions);
+	// Same, for items with any id of the kind
+	void findAny(Key key, PositionVector& positions);
+	// Number of matching items
+	uint64_t count(Key key, uint16_t id) const;
+
+	uint64_t getEntryCount() const noexcept { return entries; }
+	size_t getMemoryUsage() const;
+
+private:
+	struct List {
+		std::vector<uint8_t> data;
+		uint32_t size = 0;
+		std::vector<uint64_t> added;
+		std::vector<uint64_t> removed;
+	};
+
+	static uint32_t makeKey(Key key, uint16_t id) noexcept { return (uint32_t(key) << 16) | id; }
+	static uint64_t pack(const Position& position) noexcept {
+		return (uint64_t(position.z) << 32) | (uint64_t(position.y) << 16) | uint64_t(position.x);
+	}
+	static Position unpack(uint64_t value) noexcept {
+		return Position(int(value & 0xFFFF), int((value >> 16) & 0xFFFF), int(value >> 32));
+	}
+
+	static void collectKeys(Item* item, std::vector<uint32_t>& keys);
+	static void decode(const List& list, std::vector<uint64_t>& values);
+	static void compact(List& list);
+
+	void add(uint32_t key, uint64_t position);
+	void remove(uint32_t key, uint64_t position);
+
+	std::unordered_map<uint32_t, List> lists;
+	// Kept to not allocate for every tile
+	std::vector<uint32_t> old_keys;
+	std::vector<uint32_t> new_keys;
+	uint64_t entries;
+	bool valid;
+};
+
+#endif
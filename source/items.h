@@ -403,6 +403,7 @@ protected:
 
 	friend class GameSprite;
 	friend class Item;
+	friend class DataCache;
 };
 
 extern ItemDatabase g_items;
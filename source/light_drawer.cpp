@@ -17,6 +17,7 @@
 
 #include "main.h"
 #include "light_drawer.h"
+#include "frame_profiler.h"
 
 LightDrawer::LightDrawer()
 {
@@ -73,6 +74,8 @@ void LightDrawer::draw(int map_x, int map_y, int scroll_x, int scroll_y)
 	constexpr int draw_width = rme::ClientMapWidth * rme::TileSize;
 	constexpr int draw_height = rme::ClientMapHeight * rme::TileSize;
 
+	g_profiler.count(FrameProfiler::TEXTURE_BINDS);
+	g_profiler.count(FrameProfiler::DRAW_CALLS);
 	glBindTexture(GL_TEXTURE_2D, texture);
 	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
 	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
@@ -43,8 +43,8 @@ public:
 
 protected:
 	void commit();
-	void undo();
-	void redo();
+	bool undo();
+	bool redo();
 
 	friend class NetworkedActionQueue;
 };
@@ -25,8 +25,9 @@
 #include <wx/event.h>
 
 LiveClient::LiveClient() : LiveSocket(),
-	readMessage(), queryNodeList(), currentOperation(),
-	resolver(nullptr), socket(nullptr), editor(nullptr), stopped(false)
+	readMessage(), queryNodeList(), pendingNodeList(),
+	viewCenterX(0), viewCenterY(0), viewRadius(0), viewUnderground(false), hasView(false),
+	currentOperation(), resolver(nullptr), socket(nullptr), editor(nullptr), stopped(false)
 {
 	//
 }
@@ -164,9 +165,10 @@ std::string LiveClient::getHostName() const
 
 void LiveClient::receiveHeader()
 {
+	readMessage = NetworkMessage();
 	readMessage.position = 0;
 	asio::async_read(*socket,
-		asio::buffer(readMessage.buffer, 4),
+		asio::buffer(readMessage.getData(), 4),
 		[this](const std::error_code& error, size_t bytesReceived) -> void {
 			if(error) {
 				if(!handleError(error)) {
@@ -175,7 +177,13 @@ void LiveClient::receiveHeader()
 			} else if(bytesReceived < 4) {
 				logMessage(wxString() + getHostName() + ": Could not receive header[size: " + std::to_string(bytesReceived) + "], disconnecting client.");
 			} else {
-				receive(readMessage.read<uint32_t>());
+				const uint32_t packetSize = readMessage.read<uint32_t>();
+				if(packetSize == 0 || packetSize > NetworkMessage::MaxPacketSize) {
+					logMessage(wxString() + getHostName() + ": Invalid packet size " + std::to_string(packetSize) + ", disconnecting.");
+					wxTheApp->CallAfter([this]() { close(); });
+					return;
+				}
+				receive(packetSize);
 			}
 		}
 	);
@@ -183,15 +191,15 @@ void LiveClient::receiveHeader()
 
 void LiveClient::receive(uint32_t packetSize)
 {
-	readMessage.buffer.resize(readMessage.position + packetSize);
+	readMessage.expand(packetSize);
 	asio::async_read(*socket,
-		asio::buffer(&readMessage.buffer[readMessage.position], packetSize),
+		asio::buffer(readMessage.getData() + readMessage.position, packetSize),
 		[this](const std::error_code& error, size_t bytesReceived) -> void {
 			if(error) {
 				if(!handleError(error)) {
 					logMessage(wxString() + getHostName() + ": " + error.message());
 				}
-			} else if(bytesReceived < readMessage.buffer.size() - 4) {
+			} else if(bytesReceived < readMessage.size) {
 				logMessage(wxString() + getHostName() + ": Could not receive packet[size: " + std::to_string(bytesReceived) + "], disconnecting client.");
 			} else {
 				wxTheApp->CallAfter([this]() {
@@ -205,10 +213,13 @@ void LiveClient::receive(uint32_t packetSize)
 
 void LiveClient::send(NetworkMessage& message)
 {
-	memcpy(&message.buffer[0], &message.size, 4);
+	// The header is the same for every receiver, so a broadcast can share
+	// the buffer, the handler keeps it alive until the write is done.
+	const uint32_t packetSize = static_cast<uint32_t>(message.size);
+	memcpy(message.getData(), &packetSize, 4);
 	asio::async_write(*socket,
-		asio::buffer(message.buffer, message.size + 4),
-		[this](const std::error_code& error, size_t bytesTransferred) -> void {
+		asio::buffer(message.getData(), message.size + 4),
+		[this, buffer = message.buffer](const std::error_code& error, size_t bytesTransferred) -> void {
 			if(error) {
 				logMessage(wxString() + getHostName() + ": " + error.message());
 			}
@@ -276,16 +287,67 @@ void LiveClient::sendNodeRequests()
 		return;
 	}
 
+	// Requests the server never answered would hold the budget forever
+	const auto now = std::chrono::steady_clock::now();
+	for(auto it = pendingNodeList.begin(); it != pendingNodeList.end(); ) {
+		if(now - it->second > std::chrono::seconds(10)) {
+			cancelNodeRequest(it->first);
+			it = pendingNodeList.erase(it);
+		} else {
+			++it;
+		}
+	}
+
+	const int32_t maxPending = std::max<int32_t>(1, g_settings.getInteger(Config::LIVE_MAX_PENDING_NODES));
+	const int32_t budget = maxPending - static_cast<int32_t>(pendingNodeList.size());
+	if(budget <= 0) {
+		return;
+	}
+
+	// Closest to the center of the view first, nodes that have scrolled far
+	// out of the view (or are on the other side of the ground floor) are
+	// not worth asking for anymore.
+	std::vector<std::pair<int64_t, uint32_t>> nodes;
+	nodes.reserve(queryNodeList.size());
+	for(auto it = queryNodeList.begin(); it != queryNodeList.end(); ) {
+		const uint32_t node = *it;
+		if(!hasView) {
+			nodes.emplace_back(0, node);
+			++it;
+			continue;
+		}
+
+		const int32_t dx = static_cast<int32_t>(node >> 18) - viewCenterX;
+		const int32_t dy = static_cast<int32_t>((node >> 4) & 0x3FFF) - viewCenterY;
+		if(static_cast<bool>(node & 1) != viewUnderground || std::max(std::abs(dx), std::abs(dy)) > viewRadius) {
+			cancelNodeRequest(node);
+			it = queryNodeList.erase(it);
+			continue;
+		}
+
+		nodes.emplace_back(static_cast<int64_t>(dx) * dx + static_cast<int64_t>(dy) * dy, node);
+		++it;
+	}
+
+	if(nodes.empty()) {
+		return;
+	}
+
+	const size_t count = std::min<size_t>(nodes.size(), budget);
+	std::partial_sort(nodes.begin(), nodes.begin() + count, nodes.end());
+
 	NetworkMessage message;
 	message.write<uint8_t>(PACKET_REQUEST_NODES);
 
-	message.write<uint32_t>(queryNodeList.size());
-	for(uint32_t node : queryNodeList) {
+	message.write<uint32_t>(count);
+	for(size_t i = 0; i < count; ++i) {
+		const uint32_t node = nodes[i].second;
 		message.write<uint32_t>(node);
+		queryNodeList.erase(node);
+		pendingNodeList[node] = now;
 	}
 
 	send(message);
-	queryNodeList.clear();
 }
 
 void LiveClient::sendChanges(DirtyList& dirtyList)
@@ -312,8 +374,7 @@ void LiveClient::sendChanges(DirtyList& dirtyList)
 	NetworkMessage message;
 	message.write<uint8_t>(PACKET_CHANGE_LIST);
 
-	std::string data(reinterpret_cast<const char*>(mapWriter.getMemory()), mapWriter.getSize());
-	message.write<std::string>(data);
+	message.write<std::string_view>(std::string_view(reinterpret_cast<const char*>(mapWriter.getMemory()), mapWriter.getSize()));
 
 	send(message);
 }
@@ -342,10 +403,78 @@ void LiveClient::queryNode(int32_t ndx, int32_t ndy, bool underground)
 	queryNodeList.insert(nd);
 }
 
+void LiveClient::prefetchNodes(int32_t startx, int32_t starty, int32_t endx, int32_t endy, int32_t floor)
+{
+	if(!editor) {
+		return;
+	}
+
+	const int32_t ring = std::max(0, g_settings.getInteger(Config::LIVE_PREFETCH_RING));
+	const int32_t lookahead = std::max(0, g_settings.getInteger(Config::LIVE_PREFETCH_LOOKAHEAD));
+	const bool underground = floor > rme::MapGroundLayer;
+
+	// Node coordinates
+	const int32_t ndStartX = std::max(0, startx) >> 2;
+	const int32_t ndStartY = std::max(0, starty) >> 2;
+	const int32_t ndEndX = std::max(0, endx) >> 2;
+	const int32_t ndEndY = std::max(0, endy) >> 2;
+	const int32_t centerX = (ndStartX + ndEndX) / 2;
+	const int32_t centerY = (ndStartY + ndEndY) / 2;
+
+	int32_t dirX = 0;
+	int32_t dirY = 0;
+	if(hasView && viewUnderground == underground) {
+		dirX = (centerX > viewCenterX) - (centerX < viewCenterX);
+		dirY = (centerY > viewCenterY) - (centerY < viewCenterY);
+	}
+
+	viewCenterX = centerX;
+	viewCenterY = centerY;
+	viewUnderground = underground;
+	hasView = true;
+
+	// Anything further away than the prefetch area (plus some slack so a
+	// small jitter back and forth doesn't throw away requests) is cancelled
+	viewRadius = std::max(ndEndX - ndStartX, ndEndY - ndStartY) / 2 + 1 + ring + lookahead * 2;
+
+	const int32_t fromX = std::max(0, ndStartX - ring - (dirX < 0 ? lookahead : 0));
+	const int32_t fromY = std::max(0, ndStartY - ring - (dirY < 0 ? lookahead : 0));
+	const int32_t toX = std::min(0x3FFF, ndEndX + ring + (dirX > 0 ? lookahead : 0));
+	const int32_t toY = std::min(0x3FFF, ndEndY + ring + (dirY > 0 ? lookahead : 0));
+
+	Map& map = editor->getMap();
+	for(int32_t ndx = fromX; ndx <= toX; ++ndx) {
+		for(int32_t ndy = fromY; ndy <= toY; ++ndy) {
+			QTreeNode* node = map.getLeaf(ndx * 4, ndy * 4);
+			if(!node) {
+				node = map.createLeaf(ndx * 4, ndy * 4);
+			}
+
+			if(node->isVisible(underground) || node->isRequested(underground)) {
+				continue;
+			}
+
+			queryNode(ndx * 4, ndy * 4, underground);
+			node->setRequested(underground, true);
+		}
+	}
+}
+
+void LiveClient::cancelNodeRequest(uint32_t node)
+{
+	const int32_t ndx = node >> 18;
+	const int32_t ndy = (node >> 4) & 0x3FFF;
+
+	QTreeNode* leaf = editor ? editor->getMap().getLeaf(ndx * 4, ndy * 4) : nullptr;
+	if(leaf) {
+		leaf->setRequested(node & 1, false);
+	}
+}
+
 void LiveClient::parsePacket(NetworkMessage message)
 {
 	uint8_t packetType;
-	while(message.position < message.buffer.size()) {
+	while(!message.isEnd()) {
 		packetType = message.read<uint8_t>();
 		switch (packetType) {
 			case PACKET_HELLO_FROM_SERVER:
@@ -378,21 +507,33 @@ void LiveClient::parsePacket(NetworkMessage message)
 			default: {
 				log->Message("Unknown packet receieved!");
 				close();
-				break;
+				return;
 			}
 		}
 	}
+
+	if(message.hasError()) {
+		log->Message("Malformed packet received, disconnecting.");
+		close();
+	}
 }
 
 void LiveClient::parseHello(NetworkMessage& message)
 {
 	ASSERT(editor == nullptr);
+	const std::string& mapName = message.read<std::string>();
+	const uint16_t mapWidth = message.read<uint16_t>();
+	const uint16_t mapHeight = message.read<uint16_t>();
+	if(message.hasError()) {
+		return;
+	}
+
 	editor = newd Editor(g_gui.copybuffer, this);
 
 	Map& map = editor->getMap();
-	map.setName("Live Map - " + message.read<std::string>());
-	map.setWidth(message.read<uint16_t>());
-	map.setHeight(message.read<uint16_t>());
+	map.setName("Live Map - " + mapName);
+	map.setWidth(mapWidth);
+	map.setHeight(mapHeight);
 
 	createEditorWindow();
 }
@@ -400,6 +541,9 @@ void LiveClient::parseHello(NetworkMessage& message)
 void LiveClient::parseKick(NetworkMessage& message)
 {
 	const std::string& kickMessage = message.read<std::string>();
+	if(message.hasError()) {
+		return;
+	}
 	close();
 
 	g_gui.PopupDialog("Disconnected", wxstr(kickMessage), wxOK);
@@ -413,6 +557,9 @@ void LiveClient::parseClientAccepted(NetworkMessage& message)
 void LiveClient::parseChangeClientVersion(NetworkMessage& message)
 {
 	ClientVersionID clientVersion = static_cast<ClientVersionID>(message.read<uint32_t>());
+	if(message.hasError()) {
+		return;
+	}
 	if(!g_gui.CloseAllEditors()) {
 		close();
 		return;
@@ -429,6 +576,9 @@ void LiveClient::parseServerTalk(NetworkMessage& message)
 {
 	const std::string& speaker = message.read<std::string>();
 	const std::string& chatMessage = message.read<std::string>();
+	if(message.hasError()) {
+		return;
+	}
 	log->Chat(
 		wxstr(speaker),
 		wxstr(chatMessage)
@@ -438,6 +588,10 @@ void LiveClient::parseServerTalk(NetworkMessage& message)
 void LiveClient::parseNode(NetworkMessage& message)
 {
 	uint32_t ind = message.read<uint32_t>();
+	if(message.hasError() || !editor) {
+		return;
+	}
+	pendingNodeList.erase(ind);
 
 	// Extract node position
 	int32_t ndx = ind >> 18;
@@ -455,6 +609,9 @@ void LiveClient::parseNode(NetworkMessage& message)
 void LiveClient::parseCursorUpdate(NetworkMessage& message)
 {
 	LiveCursor cursor = readCursor(message);
+	if(message.hasError()) {
+		return;
+	}
 	cursors[cursor.id] = cursor;
 
 	g_gui.RefreshView();
@@ -463,6 +620,9 @@ void LiveClient::parseCursorUpdate(NetworkMessage& message)
 void LiveClient::parseStartOperation(NetworkMessage& message)
 {
 	const std::string& operation = message.read<std::string>();
+	if(message.hasError()) {
+		return;
+	}
 
 	currentOperation = wxstr(operation);
 	g_gui.SetStatusText("Server Operation in Progress: " + currentOperation + "... (0%)");
@@ -22,6 +22,7 @@
 #include "net_connection.h"
 
 #include <set>
+#include <chrono>
 
 class DirtyList;
 class MapTab;
@@ -62,6 +63,9 @@ class LiveClient : public LiveSocket
 
 		// Flags a node as queried and stores it, need to call SendNodeRequest to send it to server
 		void queryNode(int32_t ndx, int32_t ndy, bool underground);
+		// Queries the nodes in a ring around the view box (in tiles), the ring
+		// is extended in the direction the view is scrolling.
+		void prefetchNodes(int32_t startx, int32_t starty, int32_t endx, int32_t endy, int32_t floor);
 
 	protected:
 		void parsePacket(NetworkMessage message);
@@ -77,10 +81,24 @@ class LiveClient : public LiveSocket
 		void parseStartOperation(NetworkMessage& message);
 		void parseUpdateOperation(NetworkMessage& message);
 
+		// Drops a queued node request, the node can be queried again later
+		void cancelNodeRequest(uint32_t node);
+
 		//
 		NetworkMessage readMessage;
 
+		// Queried nodes that have not been sent yet, and the ones sent that
+		// the server has not answered
 		std::set<uint32_t> queryNodeList;
+		std::map<uint32_t, std::chrono::steady_clock::time_point> pendingNodeList;
+
+		// Last view seen by prefetchNodes, in node coordinates
+		int32_t viewCenterX;
+		int32_t viewCenterY;
+		int32_t viewRadius;
+		bool viewUnderground;
+		bool hasView;
+
 		wxString currentOperation;
 
 		std::shared_ptr<asio::ip::tcp::resolver> resolver;
@@ -62,9 +62,10 @@ std::string LivePeer::getHostName() const
 
 void LivePeer::receiveHeader()
 {
+	readMessage = NetworkMessage();
 	readMessage.position = 0;
 	asio::async_read(socket,
-		asio::buffer(readMessage.buffer, 4),
+		asio::buffer(readMessage.getData(), 4),
 		[this](const std::error_code& error, size_t bytesReceived) -> void {
 			if(error) {
 				if(!handleError(error)) {
@@ -73,7 +74,13 @@ void LivePeer::receiveHeader()
 			} else if(bytesReceived < 4) {
 				logMessage(wxString() + getHostName() + ": Could not receive header[size: " + std::to_string(bytesReceived) + "], disconnecting client.");
 			} else {
-				receive(readMessage.read<uint32_t>());
+				const uint32_t packetSize = readMessage.read<uint32_t>();
+				if(packetSize == 0 || packetSize > NetworkMessage::MaxPacketSize) {
+					logMessage(wxString() + getHostName() + ": Invalid packet size " + std::to_string(packetSize) + ", disconnecting.");
+					wxTheApp->CallAfter([this]() { close(); });
+					return;
+				}
+				receive(packetSize);
 			}
 		}
 	);
@@ -81,15 +88,15 @@ void LivePeer::receiveHeader()
 
 void LivePeer::receive(uint32_t packetSize)
 {
-	readMessage.buffer.resize(readMessage.position + packetSize);
+	readMessage.expand(packetSize);
 	asio::async_read(socket,
-		asio::buffer(&readMessage.buffer[readMessage.position], packetSize),
+		asio::buffer(readMessage.getData() + readMessage.position, packetSize),
 		[this](const std::error_code& error, size_t bytesReceived) -> void {
 			if(error) {
 				if(!handleError(error)) {
 					logMessage(wxString() + getHostName() + ": " + error.message());
 				}
-			} else if(bytesReceived < readMessage.buffer.size() - 4) {
+			} else if(bytesReceived < readMessage.size) {
 				logMessage(wxString() + getHostName() + ": Could not receive packet[size: " + std::to_string(bytesReceived) + "], disconnecting client.");
 			} else {
 				wxTheApp->CallAfter([this]() {
@@ -107,10 +114,13 @@ void LivePeer::receive(uint32_t packetSize)
 
 void LivePeer::send(NetworkMessage& message)
 {
-	memcpy(&message.buffer[0], &message.size, 4);
+	// The header is the same for every receiver, so a broadcast can share
+	// the buffer, the handler keeps it alive until the write is done.
+	const uint32_t packetSize = static_cast<uint32_t>(message.size);
+	memcpy(message.getData(), &packetSize, 4);
 	asio::async_write(socket,
-		asio::buffer(message.buffer, message.size + 4),
-		[this](const std::error_code& error, size_t bytesTransferred) -> void {
+		asio::buffer(message.getData(), message.size + 4),
+		[this, buffer = message.buffer](const std::error_code& error, size_t bytesTransferred) -> void {
 			if(error) {
 				logMessage(wxString() + getHostName() + ": " + error.message());
 			}
@@ -121,7 +131,7 @@ void LivePeer::send(NetworkMessage& message)
 void LivePeer::parseLoginPacket(NetworkMessage message)
 {
 	uint8_t packetType;
-	while(message.position < message.buffer.size()) {
+	while(!message.isEnd()) {
 		packetType = message.read<uint8_t>();
 		switch (packetType) {
 			case PACKET_HELLO_FROM_CLIENT:
@@ -133,16 +143,21 @@ void LivePeer::parseLoginPacket(NetworkMessage message)
 			default: {
 				log->Message("Invalid login packet receieved, connection severed.");
 				close();
-				break;
+				return;
 			}
 		}
 	}
+
+	if(message.hasError()) {
+		log->Message(name + " (" + getHostName() + ") sent a malformed packet, connection severed.");
+		close();
+	}
 }
 
 void LivePeer::parseEditorPacket(NetworkMessage message)
 {
 	uint8_t packetType;
-	while(message.position < message.buffer.size()) {
+	while(!message.isEnd()) {
 		packetType = message.read<uint8_t>();
 		switch (packetType) {
 			case PACKET_REQUEST_NODES:
@@ -169,10 +184,15 @@ void LivePeer::parseEditorPacket(NetworkMessage message)
 			default: {
 				log->Message("Invalid editor packet receieved, connection severed.");
 				close();
-				break;
+				return;
 			}
 		}
 	}
+
+	if(message.hasError()) {
+		log->Message(name + " (" + getHostName() + ") sent a malformed packet, connection severed.");
+		close();
+	}
 }
 
 void LivePeer::parseHello(NetworkMessage& message)
@@ -183,6 +203,10 @@ void LivePeer::parseHello(NetworkMessage& message)
 	}
 
 	uint32_t rmeVersion = message.read<uint32_t>();
+	if(message.hasError()) {
+		return;
+	}
+
 	if(rmeVersion != __RME_VERSION_ID__) {
 		NetworkMessage outMessage;
 		outMessage.write<uint8_t>(PACKET_KICK);
@@ -207,6 +231,9 @@ void LivePeer::parseHello(NetworkMessage& message)
 	uint32_t clientVersion = message.read<uint32_t>();
 	std::string nickname = message.read<std::string>();
 	std::string password = message.read<std::string>();
+	if(message.hasError()) {
+		return;
+	}
 
 	if(server->getPassword() != wxString(password.c_str(), wxConvUTF8)) {
 		log->Message("Client tried to connect, but used the wrong password, connection refused.");
@@ -265,7 +292,14 @@ void LivePeer::parseReady(NetworkMessage& message)
 void LivePeer::parseNodeRequest(NetworkMessage& message)
 {
 	Map& map = server->getEditor()->getMap();
-	for(uint32_t nodes = message.read<uint32_t>(); nodes != 0; --nodes) {
+
+	// Don't trust the count, every node takes 4 bytes
+	uint32_t nodes = message.read<uint32_t>();
+	if(!message.canRead(static_cast<size_t>(nodes) * 4)) {
+		return;
+	}
+
+	for(; nodes != 0; --nodes) {
 		uint32_t ind = message.read<uint32_t>();
 
 		int32_t ndx = ind >> 18;
@@ -283,9 +317,13 @@ void LivePeer::parseReceiveChanges(NetworkMessage& message)
 {
 	Editor& editor = *server->getEditor();
 
-	// -1 on address since we skip the first START_NODE when sending
-	const std::string& data = message.read<std::string>();
-	mapReader.assign(reinterpret_cast<const uint8_t*>(data.c_str() - 1), data.size());
+	// -1 on address since we skip the first START_NODE when sending, the
+	// byte before the data is the end of the length prefix
+	std::string_view data = message.read<std::string_view>();
+	if(message.hasError() || data.empty()) {
+		return;
+	}
+	mapReader.assign(reinterpret_cast<const uint8_t*>(data.data() - 1), data.size());
 
 	BinaryNode* rootNode = mapReader.getRootNode();
 	BinaryNode* tileNode = rootNode->getChild();
@@ -322,6 +360,9 @@ void LivePeer::parseRemoveHouse(NetworkMessage& message)
 void LivePeer::parseCursorUpdate(NetworkMessage& message)
 {
 	LiveCursor cursor = readCursor(message);
+	if(message.hasError()) {
+		return;
+	}
 	cursor.id = clientId;
 
 	if(cursor.color != color) {
@@ -336,5 +377,8 @@ void LivePeer::parseCursorUpdate(NetworkMessage& message)
 void LivePeer::parseChatMessage(NetworkMessage& message)
 {
 	const std::string& chatMessage = message.read<std::string>();
+	if(message.hasError()) {
+		return;
+	}
 	server->broadcastChat(name, wxstr(chatMessage));
 }
@@ -117,7 +117,7 @@ void LiveSocket::receiveNode(NetworkMessage& message, Editor& editor, Action* ac
 		return;
 	}
 
-	for(uint_fast8_t z = 0; z < 16; ++z) {
+	for(uint_fast8_t z = 0; z < 16 && !message.hasError(); ++z) {
 		if(testFlags(floorBits, static_cast<uint64_t>(1) << z)) {
 			receiveFloor(message, editor, action, ndx, ndy, z, node, node->getFloor(z));
 		}
@@ -173,6 +173,10 @@ void LiveSocket::receiveFloor(NetworkMessage& message, Editor& editor, Action* a
 	Map& map = editor.getMap();
 
 	uint16_t tileBits = message.read<uint16_t>();
+	if(message.hasError()) {
+		return;
+	}
+
 	if(tileBits == 0) {
 		for(uint_fast8_t x = 0; x < 4; ++x) {
 			for(uint_fast8_t y = 0; y < 4; ++y) {
@@ -182,9 +186,13 @@ void LiveSocket::receiveFloor(NetworkMessage& message, Editor& editor, Action* a
 		return;
 	}
 
-	// -1 on address since we skip the first START_NODE when sending
-	const std::string& data = message.read<std::string>();
-	mapReader.assign(reinterpret_cast<const uint8_t*>(data.c_str() - 1), data.size());
+	// -1 on address since we skip the first START_NODE when sending, the
+	// byte before the data is the end of the length prefix
+	std::string_view data = message.read<std::string_view>();
+	if(message.hasError() || data.empty()) {
+		return;
+	}
+	mapReader.assign(reinterpret_cast<const uint8_t*>(data.data() - 1), data.size());
 
 	BinaryNode* rootNode = mapReader.getRootNode();
 	BinaryNode* tileNode = rootNode->getChild();
@@ -196,8 +204,14 @@ void LiveSocket::receiveFloor(NetworkMessage& message, Editor& editor, Action* a
 			position.y = (ndy * 4) + y;
 
 			if(testFlags(tileBits, static_cast<uint64_t>(1) << ((x * 4) + y))) {
+				// Fewer tiles in the stream than the bits claim
+				if(!tileNode) {
+					continue;
+				}
 				receiveTile(tileNode, editor, action, &position);
-				tileNode->advance();
+				if(!tileNode->advance()) {
+					tileNode = nullptr;
+				}
 			} else {
 				action->addChange(new Change(map.allocator(node->createTile(position.x, position.y, z))));
 			}
@@ -236,11 +250,10 @@ void LiveSocket::sendFloor(NetworkMessage& message, Floor* floor)
 	}
 	mapWriter.endNode();
 
-	std::string stream(
-		reinterpret_cast<char*>(mapWriter.getMemory()),
+	message.write<std::string_view>(std::string_view(
+		reinterpret_cast<const char*>(mapWriter.getMemory()),
 		mapWriter.getSize()
-	);
-	message.write<std::string>(stream);
+	));
 }
 
 void LiveSocket::receiveTile(BinaryNode* node, Editor& editor, Action* action, const Position* position)
@@ -27,6 +27,14 @@
 #include "extension_window.h"
 #include "find_item_window.h"
 #include "duplicated_items_window.h"
+#include "map_tile_exporter.h"
+#include "map_traversal.h"
+#include "bulk_action.h"
+#include "map_query.h"
+#include "map_query_window.h"
+#include "map_reachability.h"
+#include "map_statistics_window.h"
+#include "frame_profiler.h"
 #include "settings.h"
 
 #include "gui.h"
@@ -61,6 +69,7 @@ MainMenuBar::MainMenuBar(MainFrame *frame) : frame(frame)
 	MAKE_ACTION(IMPORT_MONSTERS, wxITEM_NORMAL, OnImportMonsterData);
 	MAKE_ACTION(IMPORT_MINIMAP, wxITEM_NORMAL, OnImportMinimap);
 	MAKE_ACTION(EXPORT_MINIMAP, wxITEM_NORMAL, OnExportMinimap);
+	MAKE_ACTION(EXPORT_TILED_IMAGE, wxITEM_NORMAL, OnExportTiledImage);
 
 	MAKE_ACTION(RELOAD_DATA, wxITEM_NORMAL, OnReloadDataFiles);
 	//MAKE_ACTION(RECENT_FILES, wxITEM_NORMAL, OnRecent);
@@ -78,6 +87,7 @@ MainMenuBar::MainMenuBar(MainFrame *frame) : frame(frame)
 	MAKE_ACTION(SEARCH_ON_MAP_CONTAINER, wxITEM_NORMAL, OnSearchForContainerOnMap);
 	MAKE_ACTION(SEARCH_ON_MAP_WRITEABLE, wxITEM_NORMAL, OnSearchForWriteableOnMap);
 	MAKE_ACTION(SEARCH_ON_MAP_DUPLICATED_ITEMS, wxITEM_NORMAL, OnSearchForDuplicatedItemsOnMap);
+	MAKE_ACTION(SEARCH_ON_MAP_QUERY, wxITEM_NORMAL, OnSearchForQuery);
 	MAKE_ACTION(SEARCH_ON_SELECTION_EVERYTHING, wxITEM_NORMAL, OnSearchForStuffOnSelection);
 	MAKE_ACTION(SEARCH_ON_SELECTION_UNIQUE, wxITEM_NORMAL, OnSearchForUniqueOnSelection);
 	MAKE_ACTION(SEARCH_ON_SELECTION_ACTION, wxITEM_NORMAL, OnSearchForActionOnSelection);
@@ -155,6 +165,8 @@ MainMenuBar::MainMenuBar(MainFrame *frame) : frame(frame)
 	MAKE_ACTION(SHOW_WALL_HOOKS, wxITEM_CHECK, OnChangeViewSettings);
 	MAKE_ACTION(SHOW_PICKUPABLES, wxITEM_CHECK, OnChangeViewSettings);
 	MAKE_ACTION(SHOW_MOVEABLES, wxITEM_CHECK, OnChangeViewSettings);
+	MAKE_ACTION(SHOW_FRAME_PROFILER, wxITEM_CHECK, OnChangeViewSettings);
+	MAKE_ACTION(EXPORT_FRAME_PROFILE, wxITEM_NORMAL, OnExportFrameProfile);
 
 	MAKE_ACTION(WIN_MINIMAP, wxITEM_NORMAL, OnMinimapWindow);
 	MAKE_ACTION(WIN_ACTIONS_HISTORY, wxITEM_NORMAL, OnActionsHistoryWindow);
@@ -235,19 +247,25 @@ MainMenuBar::~MainMenuBar()
 
 namespace OnMapRemoveItems
 {
-	struct RemoveItemCondition
+	// The removal is undone as a whole, -1 if it was cancelled and nothing
+	// was removed
+	int64_t remove(uint16_t itemId, bool selection)
 	{
-		RemoveItemCondition(uint16_t itemId) :
-			itemId(itemId) { }
-
-		uint16_t itemId;
-
-		bool operator()(Map& map, Item* item, int64_t removed, int64_t done) {
-			if(done % 0x8000 == 0)
-				g_gui.SetLoadDone((uint32_t)(100 * done / map.getTileCount()));
+		BulkOperation operation(*g_gui.GetCurrentEditor(), ACTION_REMOVE_ITEMS);
+		MapTraversal& traversal = operation.getTraversal();
+		if(selection)
+			traversal.setSelection(g_gui.GetCurrentEditor()->getSelection());
+		traversal.useItemIndex(ItemIndex::ITEM_ID, itemId);
+		operation.setProgress([](int done) { return g_gui.SetLoadDone(done); });
+		bool finished = operation.removeItems([itemId](Item* item) {
 			return item->getID() == itemId && !item->isComplex();
+		});
+		if(!finished) {
+			operation.rollback();
+			return -1;
 		}
-	};
+		return operation.getChangeCount();
+	}
 }
 
 void MainMenuBar::EnableItem(MenuBar::ActionID id, bool enable)
@@ -329,6 +347,7 @@ void MainMenuBar::Update()
 	EnableItem(IMPORT_MONSTERS, is_local);
 	EnableItem(IMPORT_MINIMAP, false);
 	EnableItem(EXPORT_MINIMAP, is_local);
+	EnableItem(EXPORT_TILED_IMAGE, is_local);
 
 	EnableItem(FIND_ITEM, is_host);
 	EnableItem(REPLACE_ITEMS, is_local);
@@ -338,6 +357,7 @@ void MainMenuBar::Update()
 	EnableItem(SEARCH_ON_MAP_CONTAINER, is_host);
 	EnableItem(SEARCH_ON_MAP_WRITEABLE, is_host);
 	EnableItem(SEARCH_ON_MAP_DUPLICATED_ITEMS, is_host);
+	EnableItem(SEARCH_ON_MAP_QUERY, is_host);
 	EnableItem(SEARCH_ON_SELECTION_EVERYTHING, has_selection && is_host);
 	EnableItem(SEARCH_ON_SELECTION_UNIQUE, has_selection && is_host);
 	EnableItem(SEARCH_ON_SELECTION_ACTION, has_selection && is_host);
@@ -460,6 +480,7 @@ void MainMenuBar::LoadValues()
 	CheckItem(SHOW_WALL_HOOKS, g_settings.getBoolean(Config::SHOW_WALL_HOOKS));
 	CheckItem(SHOW_PICKUPABLES, g_settings.getBoolean(Config::SHOW_PICKUPABLES));
 	CheckItem(SHOW_MOVEABLES, g_settings.getBoolean(Config::SHOW_MOVEABLES));
+	CheckItem(SHOW_FRAME_PROFILER, g_settings.getBoolean(Config::SHOW_FRAME_PROFILER));
 }
 
 void MainMenuBar::LoadRecentFiles()
@@ -820,6 +841,30 @@ void MainMenuBar::OnExportMinimap(wxCommandEvent& WXUNUSED(event))
 	dialog.ShowModal();
 }
 
+void MainMenuBar::OnExportTiledImage(wxCommandEvent& WXUNUSED(event))
+{
+	if(!g_gui.IsEditorOpen()) {
+		return;
+	}
+
+	wxDirDialog dialog(frame, "Select the folder for the map tiles", wxstr(g_settings.getString(Config::MINIMAP_EXPORT_DIR)), wxDD_DEFAULT_STYLE | wxDD_DIR_MUST_EXIST);
+	if(dialog.ShowModal() != wxID_OK) {
+		return;
+	}
+
+	int floor = g_gui.GetCurrentFloor();
+	g_gui.CreateLoadBar(wxString::Format("Exporting floor %d tiles...", floor));
+
+	MapTileExporter exporter(g_gui.GetCurrentMap(), floor);
+	exporter.setProgressCallback([](int done) { g_gui.SetLoadDone(done); });
+	bool success = exporter.exportTiles(nstr(dialog.GetPath()));
+
+	g_gui.DestroyLoadBar();
+	if(!success) {
+		g_gui.PopupDialog("Error", wxstr(exporter.getError()), wxOK);
+	}
+}
+
 void MainMenuBar::OnDebugViewDat(wxCommandEvent& WXUNUSED(event))
 {
 	wxDialog dlg(frame, wxID_ANY, "Debug .dat file", wxDefaultPosition, wxDefaultSize, wxDEFAULT_DIALOG_STYLE | wxRESIZE_BORDER);
@@ -865,29 +910,15 @@ void MainMenuBar::OnRedo(wxCommandEvent& WXUNUSED(event))
 
 namespace OnSearchForItem
 {
-	struct Finder
+	std::vector<std::pair<Tile*, Item*>> find(uint16_t itemId, size_t maxCount, bool selection)
 	{
-		Finder(uint16_t itemId, uint32_t maxCount) :
-			itemId(itemId), maxCount(maxCount) {}
-
-		uint16_t itemId;
-		uint32_t maxCount;
-		std::vector< std::pair<Tile*, Item*> > result;
-
-		bool limitReached() const { return result.size() >= (size_t)maxCount; }
-
-		void operator()(Map& map, Tile* tile, Item* item, long long done)
-		{
-			if(result.size() >= (size_t)maxCount)
-				return;
-
-			if(done % 0x8000 == 0)
-				g_gui.SetLoadDone((unsigned int)(100 * done / map.getTileCount()));
-
-			if(item->getID() == itemId)
-				result.push_back(std::make_pair(tile, item));
-		}
-	};
+		MapTraversal traversal(g_gui.GetCurrentMap());
+		if(selection)
+			traversal.setSelection(g_gui.GetCurrentEditor()->getSelection());
+		traversal.useItemIndex(ItemIndex::ITEM_ID, itemId);
+		traversal.setProgress([](int done) { g_gui.SetLoadDone(done); });
+		return traversal.findItems([itemId](const Item* item) { return item->getID() == itemId; }, maxCount);
+	}
 }
 
 void MainMenuBar::OnSearchForItem(wxCommandEvent& WXUNUSED(event))
@@ -898,17 +929,16 @@ void MainMenuBar::OnSearchForItem(wxCommandEvent& WXUNUSED(event))
 	FindItemDialog dialog(frame, "Search for Item");
 	dialog.setSearchMode((FindItemDialog::SearchMode)g_settings.getInteger(Config::FIND_ITEM_MODE));
 	if(dialog.ShowModal() == wxID_OK) {
-		OnSearchForItem::Finder finder(dialog.getResultID(), (uint32_t)g_settings.getInteger(Config::REPLACE_SIZE));
+		const size_t maxCount = (size_t)g_settings.getInteger(Config::REPLACE_SIZE);
 		g_gui.CreateLoadBar("Searching map...");
 
-		foreach_ItemOnMap(g_gui.GetCurrentMap(), finder, false);
-		std::vector< std::pair<Tile*, Item*> >& result = finder.result;
+		std::vector<std::pair<Tile*, Item*> > result = OnSearchForItem::find(dialog.getResultID(), maxCount, false);
 
 		g_gui.DestroyLoadBar();
 
-		if(finder.limitReached()) {
+		if(maxCount != 0 && result.size() >= maxCount) {
 			wxString msg;
-			msg << "The configured limit has been reached. Only " << finder.maxCount << " results will be displayed.";
+			msg << "The configured limit has been reached. Only " << maxCount << " results will be displayed.";
 			g_gui.PopupDialog("Notice", msg, wxOK);
 		}
 
@@ -953,21 +983,17 @@ namespace OnSearchForStuff
 		bool search_writeable;
 		std::vector<std::pair<Tile*, Item*> > found;
 
-		void operator()(Map& map, Tile* tile, Item* item, long long done)
+		// Called from the worker threads
+		bool matches(Item* item) const
 		{
-			if(done % 0x8000 == 0) {
-				g_gui.SetLoadDone((unsigned int)(100 * done / map.getTileCount()));
-			}
 			Container* container;
-			if((search_unique && item->getUniqueID() > 0) ||
+			return (search_unique && item->getUniqueID() > 0) ||
 				(search_action && item->getActionID() > 0) ||
-				(search_container && ((container = dynamic_cast<Container*>(item)) && container->getItemCount())) ||
-				(search_writeable && item->getText().length() > 0)) {
-				found.push_back(std::make_pair(tile, item));
-			}
+				(search_container && ((container = item->getContainer()) && container->getItemCount())) ||
+				(search_writeable && item->getText().length() > 0);
 		}
 
-		wxString desc(Item* item)
+		static wxString desc(Item* item)
 		{
 			wxString label;
 			if(item->getUniqueID() > 0)
@@ -1038,6 +1064,55 @@ void MainMenuBar::OnSearchForDuplicatedItemsOnMap(wxCommandEvent& WXUNUSED(event
 	SearchDuplicatedItems(false);
 }
 
+void MainMenuBar::OnSearchForQuery(wxCommandEvent& WXUNUSED(event))
+{
+	MapTab* tab = g_gui.GetCurrentMapTab();
+	if(!tab)
+		return;
+
+	Editor* editor = tab->GetEditor();
+	MapQueryDialog dialog(frame, tab->GetView()->GetScreenCenterPosition(), editor->hasSelection());
+	if(dialog.ShowModal() == wxID_OK) {
+		// The dialog doesn't close on invalid conditions
+		MapQuery query;
+		wxString error;
+		dialog.BuildQuery(query, error);
+		if(dialog.IsSelectionOnly())
+			query.setSelection(&editor->getSelection());
+
+		SearchResultWindow* window = g_gui.ShowSearchWindow();
+		window->Clear();
+
+		// Results are listed as they are found, the load bar lets the window
+		// repaint and can stop the search
+		const size_t maxCount = (size_t)g_settings.getInteger(Config::REPLACE_SIZE);
+		size_t count = 0;
+		bool limitReached = false;
+		g_gui.CreateLoadBar("Searching map...", true);
+		query.run(editor->getMap(),
+			[&](const MapQuery::Results& found) {
+				for(const auto& result : found) {
+					if(maxCount != 0 && count >= maxCount) {
+						limitReached = true;
+						return false;
+					}
+					window->AddPosition(OnSearchForStuff::Searcher::desc(result.second), result.first->getPosition());
+					++count;
+				}
+				return true;
+			},
+			[](int done) { return g_gui.SetLoadDone(done); });
+		g_gui.DestroyLoadBar();
+
+		if(limitReached) {
+			wxString msg;
+			msg << "The configured limit has been reached. Only " << maxCount << " results will be displayed.";
+			g_gui.PopupDialog("Notice", msg, wxOK);
+		}
+	}
+	dialog.Destroy();
+}
+
 void MainMenuBar::OnSearchForStuffOnSelection(wxCommandEvent& WXUNUSED(event))
 {
 	SearchItems(true, true, true, true, true);
@@ -1071,17 +1146,16 @@ void MainMenuBar::OnSearchForItemOnSelection(wxCommandEvent& WXUNUSED(event))
 	FindItemDialog dialog(frame, "Search on Selection");
 	dialog.setSearchMode((FindItemDialog::SearchMode)g_settings.getInteger(Config::FIND_ITEM_MODE));
 	if(dialog.ShowModal() == wxID_OK) {
-		OnSearchForItem::Finder finder(dialog.getResultID(), (uint32_t)g_settings.getInteger(Config::REPLACE_SIZE));
+		const size_t maxCount = (size_t)g_settings.getInteger(Config::REPLACE_SIZE);
 		g_gui.CreateLoadBar("Searching on selected area...");
 
-		foreach_ItemOnMap(g_gui.GetCurrentMap(), finder, true);
-		std::vector<std::pair<Tile*, Item*> >& result = finder.result;
+		std::vector<std::pair<Tile*, Item*> > result = OnSearchForItem::find(dialog.getResultID(), maxCount, true);
 
 		g_gui.DestroyLoadBar();
 
-		if(finder.limitReached()) {
+		if(maxCount != 0 && result.size() >= maxCount) {
 			wxString msg;
-			msg << "The configured limit has been reached. Only " << finder.maxCount << " results will be displayed.";
+			msg << "The configured limit has been reached. Only " << maxCount << " results will be displayed.";
 			g_gui.PopupDialog("Notice", msg, wxOK);
 		}
 
@@ -1123,16 +1197,17 @@ void MainMenuBar::OnRemoveItemOnSelection(wxCommandEvent& WXUNUSED(event))
 
 	FindItemDialog dialog(frame, "Remove Item on Selection");
 	if(dialog.ShowModal() == wxID_OK) {
-		g_gui.GetCurrentEditor()->clearActions();
-		g_gui.CreateLoadBar("Searching item on selection to remove...");
-		OnMapRemoveItems::RemoveItemCondition condition(dialog.getResultID());
-		int64_t count = RemoveItemOnMap(g_gui.GetCurrentMap(), condition, true);
+		g_gui.CreateLoadBar("Searching item on selection to remove...", true);
+		int64_t count = OnMapRemoveItems::remove(dialog.getResultID(), true);
 		g_gui.DestroyLoadBar();
 
 		wxString msg;
-		msg << count << " items removed.";
+		if(count < 0)
+			msg << "Cancelled, no items were removed.";
+		else
+			msg << count << " items removed.";
 		g_gui.PopupDialog("Remove Item", msg, wxOK);
-		g_gui.GetCurrentMap().doChange();
+		g_gui.GetCurrentMap().invalidateRender();
 		g_gui.RefreshView();
 	}
 	dialog.Destroy();
@@ -1281,20 +1356,21 @@ void MainMenuBar::OnMapRemoveItems(wxCommandEvent& WXUNUSED(event))
 		uint16_t itemid = dialog.getResultID();
 
 		g_gui.GetCurrentEditor()->getSelection().clear();
-		g_gui.GetCurrentEditor()->clearActions();
 
-		OnMapRemoveItems::RemoveItemCondition condition(itemid);
-		g_gui.CreateLoadBar("Searching map for items to remove...");
+		g_gui.CreateLoadBar("Searching map for items to remove...", true);
 
-		int64_t count = RemoveItemOnMap(g_gui.GetCurrentMap(), condition, false);
+		int64_t count = OnMapRemoveItems::remove(itemid, false);
 
 		g_gui.DestroyLoadBar();
 
 		wxString msg;
-		msg << count << " items deleted.";
+		if(count < 0)
+			msg << "Cancelled, no items were deleted.";
+		else
+			msg << count << " items deleted.";
 
 		g_gui.PopupDialog("Search completed", msg, wxOK);
-		g_gui.GetCurrentMap().doChange();
+		g_gui.GetCurrentMap().invalidateRender();
 		g_gui.RefreshView();
 	}
 	dialog.Destroy();
@@ -1302,17 +1378,11 @@ void MainMenuBar::OnMapRemoveItems(wxCommandEvent& WXUNUSED(event))
 
 namespace OnMapRemoveCorpses
 {
-	struct condition
+	// Called from the worker threads, the tilesets are only read
+	bool condition(Item* item)
 	{
-		condition() {}
-
-		bool operator()(Map& map, Item* item, long long removed, long long done){
-			if(done % 0x800 == 0)
-				g_gui.SetLoadDone((unsigned int)(100 * done / map.getTileCount()));
-
-			return g_materials.isInTileset(item, "Corpses") & !item->isComplex();
-		}
-	};
+		return g_materials.isInTileset(item, "Corpses") && !item->isComplex();
+	}
 }
 
 void MainMenuBar::OnMapRemoveCorpses(wxCommandEvent& WXUNUSED(event))
@@ -1324,96 +1394,135 @@ void MainMenuBar::OnMapRemoveCorpses(wxCommandEvent& WXUNUSED(event))
 
 	if(ok == wxID_YES) {
 		g_gui.GetCurrentEditor()->getSelection().clear();
-		g_gui.GetCurrentEditor()->clearActions();
 
-		OnMapRemoveCorpses::condition func;
-		g_gui.CreateLoadBar("Searching map for items to remove...");
+		g_gui.CreateLoadBar("Searching map for items to remove...", true);
 
-		int64_t count = RemoveItemOnMap(g_gui.GetCurrentMap(), func, false);
+		// Undone as a whole, nothing is removed if it is cancelled
+		BulkOperation operation(*g_gui.GetCurrentEditor(), ACTION_REMOVE_ITEMS);
+		operation.setProgress([](int done) { return g_gui.SetLoadDone(done); });
+		bool finished = operation.removeItems(OnMapRemoveCorpses::condition);
+		if(!finished)
+			operation.rollback();
+		else
+			operation.commit();
 
 		g_gui.DestroyLoadBar();
 
 		wxString msg;
-		msg << count << " items deleted.";
+		if(!finished)
+			msg << "Cancelled, no items were deleted.";
+		else
+			msg << operation.getChangeCount() << " items deleted.";
 		g_gui.PopupDialog("Search completed", msg, wxOK);
-		g_gui.GetCurrentMap().doChange();
+		g_gui.GetCurrentMap().invalidateRender();
 	}
 }
 
-namespace OnMapRemoveUnreachable
+void MainMenuBar::OnMapRemoveUnreachable(wxCommandEvent& WXUNUSED(event))
 {
-	struct condition
-	{
-		condition() {}
+	if(!g_gui.IsEditorOpen())
+		return;
 
-		bool isReachable(Tile* tile)
-		{
-			if(tile == nullptr)
-				return false;
-			if(!tile->isBlocking())
-				return true;
-			return false;
-		}
+	Editor* editor = g_gui.GetCurrentEditor();
+	Map& map = g_gui.GetCurrentMap();
+	MapReachability reachability(map);
+	if(!reachability.addTemples()) {
+		g_gui.PopupDialog("Remove Unreachable Tiles", "No town has a temple position to walk from.", wxOK);
+		return;
+	}
 
-		bool operator()(Map& map, Tile* tile, long long removed, long long done, long long total)
-		{
-			if(done % 0x1000 == 0)
-				g_gui.SetLoadDone((unsigned int)(100 * done / total));
-
-			const Position& pos = tile->getPosition();
-			int sx = std::max(pos.x - 10, 0);
-			int ex = std::min(pos.x + 10, 65535);
-			int sy = std::max(pos.y - 8,  0);
-			int ey = std::min(pos.y + 8,  65535);
-			int sz, ez;
-
-			if(pos.z < 8) {
-				sz = 0;
-				ez = 9;
-			} else {
-				// underground
-				sz = std::max(pos.z - 2, rme::MapGroundLayer);
-				ez = std::min(pos.z + 2, rme::MapMaxLayer);
-			}
+	g_gui.CreateLoadBar("Walking the map from the temples...", true);
+	if(!reachability.run([](int done) { return g_gui.SetLoadDone(done); })) {
+		g_gui.DestroyLoadBar();
+		return;
+	}
 
-			for(int z = sz; z <= ez; ++z) {
-				for(int y = sy; y <= ey; ++y) {
-					for(int x = sx; x <= ex; ++x) {
-						if(isReachable(map.getTile(x, y, z)))
-							return false;
-					}
-				}
-			}
-			return true;
-		}
-	};
-}
+	// Walkable areas that were cut off are listed, they are usually mistakes
+	// rather than decoration
+	g_gui.SetLoadDone(0, "Searching map for tiles to remove...");
+	const std::vector<MapReachability::Area> areas = reachability.findIsolatedAreas();
+
+	PositionVector positions;
+	MapTraversal traversal(map);
+	traversal.setProgress([&traversal](int done) {
+		if(!g_gui.SetLoadDone(done))
+			traversal.cancel();
+	});
+	const bool finished = traversal.forEachTile(positions,
+		[&reachability](PositionVector& chunk, Tile* tile) {
+			if(!reachability.isVisible(tile->getPosition()))
+				chunk.push_back(tile->getPosition());
+		},
+		[](PositionVector& all, PositionVector& chunk) {
+			all.insert(all.end(), chunk.begin(), chunk.end());
+		});
 
-void MainMenuBar::OnMapRemoveUnreachable(wxCommandEvent& WXUNUSED(event))
-{
-	if(!g_gui.IsEditorOpen())
+	g_gui.DestroyLoadBar();
+	if(!finished)
 		return;
 
-	int ok = g_gui.PopupDialog("Remove Unreachable Tiles", "Do you want to remove all unreachable items from the map?", wxYES | wxNO);
+	if(!areas.empty()) {
+		SearchResultWindow* window = g_gui.ShowSearchWindow();
+		window->Clear();
+		for(const MapReachability::Area& area : areas) {
+			wxString description;
+			description << "Isolated area, " << area.size << " tiles (" << area.from.x << ":" << area.from.y << ":" << area.from.z
+				<< " to " << area.to.x << ":" << area.to.y << ":" << area.to.z << ")";
+			window->AddPosition(description, area.position);
+		}
+	}
+
+	wxString msg;
+	msg << reachability.getReachedCount() << " tiles can be walked to from a temple.";
+	if(!areas.empty())
+		msg << "\n" << areas.size() << " walkable areas can't be walked to, they are listed in the search results.";
+	if(positions.empty()) {
+		msg << "\nEvery tile can be seen from somewhere players can walk to.";
+		g_gui.PopupDialog("Search completed", msg, wxOK);
+		return;
+	}
 
-	if(ok == wxID_YES) {
-		g_gui.GetCurrentEditor()->getSelection().clear();
-		g_gui.GetCurrentEditor()->clearActions();
+	msg << "\n\n" << positions.size() << " tiles can't be seen from anywhere players can walk to, do you want to remove them?";
+	long answer;
+	if(areas.empty()) {
+		answer = g_gui.PopupDialog("Remove Unreachable Tiles", msg, wxYES | wxNO);
+	} else {
+		msg << "\nThe isolated areas can be kept, with the tiles that can be seen from them.";
+		wxMessageDialog dialog(g_gui.root, msg, "Remove Unreachable Tiles", wxYES | wxNO | wxCANCEL);
+		dialog.SetYesNoCancelLabels("Remove All", "Keep Isolated Areas", "Cancel");
+		answer = dialog.ShowModal();
+	}
+	if(answer == wxID_CANCEL || (answer == wxID_NO && areas.empty()))
+		return;
 
-		OnMapRemoveUnreachable::condition func;
-		g_gui.CreateLoadBar("Searching map for tiles to remove...");
+	if(answer == wxID_NO) {
+		reachability.findIsolatedAreas(true);
+		positions.erase(std::remove_if(positions.begin(), positions.end(), [&reachability](const Position& position) {
+			return reachability.isVisible(position);
+		}), positions.end());
+		if(positions.empty())
+			return;
+	}
 
-		long long removed = remove_if_TileOnMap(g_gui.GetCurrentMap(), func);
+	editor->getSelection().clear();
 
-		g_gui.DestroyLoadBar();
+	g_gui.CreateLoadBar("Removing unreachable tiles...", true);
 
-		wxString msg;
-		msg << removed << " tiles deleted.";
+	// Undone as a whole, nothing is removed if it is cancelled
+	BulkOperation operation(*editor, ACTION_DELETE_TILES);
+	operation.getTraversal().setPositions(std::move(positions));
+	operation.setProgress([](int done) { return g_gui.SetLoadDone(done); });
+	const bool removed = operation.removeTiles([](Tile*) { return true; });
+	if(removed)
+		operation.commit();
+	else
+		operation.rollback();
 
-		g_gui.PopupDialog("Search completed", msg, wxOK);
+	g_gui.DestroyLoadBar();
 
-		g_gui.GetCurrentMap().doChange();
-	}
+	if(removed)
+		map.doChange();
+	g_gui.RefreshView();
 }
 
 void MainMenuBar::OnMapRemoveEmptySpawns(wxCommandEvent& WXUNUSED(event))
@@ -1427,7 +1536,7 @@ void MainMenuBar::OnMapRemoveEmptySpawns(wxCommandEvent& WXUNUSED(event))
 		Editor* editor = g_gui.GetCurrentEditor();
 		editor->getSelection().clear();
 
-		g_gui.CreateLoadBar("Searching map for empty spawns to remove...");
+		g_gui.CreateLoadBar("Searching map for empty spawns to remove...", true);
 
 		Map& map = g_gui.GetCurrentMap();
 		CreatureVector creatures;
@@ -1461,32 +1570,37 @@ void MainMenuBar::OnMapRemoveEmptySpawns(wxCommandEvent& WXUNUSED(event))
 			creature->reset();
 		}
 
-		BatchAction* batch = editor->createBatch(ACTION_DELETE_TILES);
-		Action* action = editor->createAction(batch);
-
-		const size_t count = toDeleteSpawns.size();
-		size_t removed = 0;
-		for(const auto& tile : toDeleteSpawns) {
-			Tile* newtile = tile->deepCopy(map);
-			map.removeSpawn(newtile);
-			delete newtile->spawn;
-			newtile->spawn = nullptr;
-			if(++removed % 5 == 0) {
-				// update progress bar for each 5 spawns removed
-				g_gui.SetLoadDone(100 * removed / count);
-			}
-			action->addChange(newd Change(newtile));
+		PositionVector positions;
+		for(const Tile* tile : toDeleteSpawns) {
+			positions.push_back(tile->getPosition());
 		}
 
-		batch->addAndCommitAction(action);
-		editor->addBatch(batch);
+		// Committing the tiles removes the spawns from the map
+		BulkOperation operation(*editor, ACTION_DELETE_TILES);
+		operation.getTraversal().setPositions(std::move(positions));
+		operation.setProgress([](int done) { return g_gui.SetLoadDone(done); });
+		const bool finished = operation.run(
+			[](Tile* tile) { return tile->spawn != nullptr; },
+			[](Tile* tile) {
+				delete tile->spawn;
+				tile->spawn = nullptr;
+				return 1;
+			});
+		if(finished)
+			operation.commit();
+		else
+			operation.rollback();
 
 		g_gui.DestroyLoadBar();
 
 		wxString msg;
-		msg << removed << " empty spawns removed.";
+		if(!finished)
+			msg << "Cancelled, no spawns were removed.";
+		else
+			msg << operation.getChangeCount() << " empty spawns removed.";
 		g_gui.PopupDialog("Search completed", msg, wxOK);
 		g_gui.GetCurrentMap().doChange();
+		g_gui.GetCurrentMap().invalidateRender();
 	}
 }
 
@@ -1538,13 +1652,53 @@ void MainMenuBar::OnMapCleanHouseItems(wxCommandEvent& WXUNUSED(event))
 
 	int ret = g_gui.PopupDialog(
 		"Clear Moveable House Items",
-		"Are you sure you want to remove all items inside houses that can be moved (this action cannot be undone)?",
+		"Are you sure you want to remove all items inside houses that can be moved?",
 		wxYES | wxNO
 	);
 
 	if(ret == wxID_YES) {
-		// Editor will do the work
-		//editor->removeHouseItems(true);
+		g_gui.CreateLoadBar("Removing moveable house items...", true);
+
+		// Undone as a whole, nothing is removed if it is cancelled
+		BulkOperation operation(*editor, ACTION_REMOVE_ITEMS);
+		operation.setProgress([](int done) { return g_gui.SetLoadDone(done); });
+		bool finished = operation.run(
+			[](Tile* tile) {
+				if(!tile->isHouseTile())
+					return false;
+				for(const Item* item : tile->items) {
+					if(item->isMoveable())
+						return true;
+				}
+				return false;
+			},
+			[](Tile* tile) {
+				int64_t removed = 0;
+				for(auto it = tile->items.begin(); it != tile->items.end(); ) {
+					if((*it)->isMoveable()) {
+						delete *it;
+						it = tile->items.erase(it);
+						++removed;
+					} else {
+						++it;
+					}
+				}
+				return removed;
+			});
+		if(!finished)
+			operation.rollback();
+		else
+			operation.commit();
+
+		g_gui.DestroyLoadBar();
+
+		wxString msg;
+		if(!finished)
+			msg << "Cancelled, no items were removed.";
+		else
+			msg << operation.getChangeCount() << " items removed from " << operation.getTileCount() << " house tiles.";
+		g_gui.PopupDialog("Clear Moveable House Items", msg, wxOK);
+		editor->getMap().invalidateRender();
 	}
 
 	g_gui.RefreshView();
@@ -1574,224 +1728,61 @@ void MainMenuBar::OnMapStatistics(wxCommandEvent& WXUNUSED(event))
 	if(!g_gui.IsEditorOpen())
 		return;
 
-	g_gui.CreateLoadBar("Collecting data...");
-
-	Map* map = &g_gui.GetCurrentMap();
-
-	int load_counter = 0;
-
-	uint64_t tile_count = 0;
-	uint64_t detailed_tile_count = 0;
-	uint64_t blocking_tile_count = 0;
-	uint64_t walkable_tile_count = 0;
-	double percent_pathable = 0.0;
-	double percent_detailed = 0.0;
-	uint64_t spawn_count = 0;
-	uint64_t creature_count = 0;
-	double creatures_per_spawn = 0.0;
-
-	uint64_t item_count = 0;
-	uint64_t loose_item_count = 0;
-	uint64_t depot_count = 0;
-	uint64_t action_item_count = 0;
-	uint64_t unique_item_count = 0;
-	uint64_t container_count = 0; // Only includes containers containing more than 1 item
-
-	int town_count = map->towns.count();
-	int house_count = map->houses.count();
-	std::map<uint32_t, uint32_t> town_sqm_count;
-	const Town* largest_town = nullptr;
-	uint64_t largest_town_size = 0;
-	uint64_t total_house_sqm = 0;
-	const House* largest_house = nullptr;
-	uint64_t largest_house_size = 0;
-	double houses_per_town = 0.0;
-	double sqm_per_house = 0.0;
-	double sqm_per_town = 0.0;
-
-	for(MapIterator mit = map->begin(); mit != map->end(); ++mit) {
-		Tile* tile = (*mit)->get();
-		if(load_counter % 8192 == 0) {
-			g_gui.SetLoadDone((unsigned int)(int64_t(load_counter) * 95ll / int64_t(map->getTileCount())));
-		}
-
-		if(tile->empty())
-			continue;
-
-		tile_count += 1;
-
-		bool is_detailed = false;
-#define ANALYZE_ITEM(_item) {\
-	item_count += 1; \
-	if(!(_item)->isGroundTile() && !(_item)->isBorder()) { \
-		is_detailed = true; \
-		const ItemType& it = g_items.getItemType((_item)->getID()); \
-		if(it.moveable) { \
-			loose_item_count += 1; \
-		} \
-		if(it.isDepot()) { \
-			depot_count += 1; \
-		} \
-		if((_item)->getActionID() > 0) { \
-			action_item_count += 1; \
-		} \
-		if((_item)->getUniqueID() > 0) { \
-			unique_item_count += 1; \
-		} \
-		if(Container* c = dynamic_cast<Container*>((_item))) { \
-			if(c->getVector().size()) { \
-				container_count += 1; \
-			} \
-		} \
-	} \
-}
-		if(tile->ground) {
-			ANALYZE_ITEM(tile->ground);
-		}
-
-		for(Item* item : tile->items) {
-			ANALYZE_ITEM(item);
-		}
-#undef ANALYZE_ITEM
-
-		if(tile->spawn)
-			spawn_count += 1;
-
-		if(tile->creature)
-			creature_count += 1;
-
-		if(tile->isBlocking())
-			blocking_tile_count += 1;
-		else
-			walkable_tile_count += 1;
-
-		if(is_detailed)
-			detailed_tile_count += 1;
-
-		load_counter += 1;
-	}
-
-	creatures_per_spawn = (spawn_count != 0 ? double(creature_count) / double(spawn_count) : -1.0);
-	percent_pathable = 100.0*(tile_count != 0 ? double(walkable_tile_count) / double(tile_count) : -1.0);
-	percent_detailed = 100.0*(tile_count != 0 ? double(detailed_tile_count) / double(tile_count) : -1.0);
-
-	load_counter = 0;
-	Houses& houses = map->houses;
-	for(HouseMap::const_iterator hit = houses.begin(); hit != houses.end(); ++hit) {
-		const House* house = hit->second;
-
-		if(load_counter % 64)
-			g_gui.SetLoadDone((unsigned int)(95ll + int64_t(load_counter) * 5ll / int64_t(house_count)));
-
-		if(house->size() > largest_house_size) {
-			largest_house = house;
-			largest_house_size = house->size();
-		}
-		total_house_sqm += house->size();
-		town_sqm_count[house->townid] += house->size();
-	}
-
-	houses_per_town = (town_count != 0?  double(house_count) /     double(town_count)  : -1.0);
-	sqm_per_house   = (house_count != 0? double(total_house_sqm) / double(house_count) : -1.0);
-	sqm_per_town    = (town_count != 0?  double(total_house_sqm) / double(town_count)  : -1.0);
-
-	Towns& towns = map->towns;
-	for(std::map<uint32_t, uint32_t>::iterator town_iter = town_sqm_count.begin();
-			town_iter != town_sqm_count.end();
-			++town_iter)
-	{
-		// No load bar for this, load is non-existant
-		uint32_t town_id = town_iter->first;
-		uint32_t town_sqm = town_iter->second;
-		Town* town = towns.getTown(town_id);
-		if(town && town_sqm > largest_town_size) {
-			largest_town = town;
-			largest_town_size = town_sqm;
-		} else {
-			// Non-existant town!
-		}
+	// The window follows the current map, one of them is enough
+	if(wxWindow* window = wxWindow::FindWindowByName("MapStatisticsWindow", frame)) {
+		window->Raise();
+		return;
 	}
 
-	g_gui.DestroyLoadBar();
-
-	std::ostringstream os;
-	os.setf(std::ios::fixed, std::ios::floatfield);
-	os.precision(2);
-	os << "Map statistics for the map \"" << map->getMapDescription() << "\"\n";
-	os << "\tTile data:\n";
-	os << "\t\tTotal number of tiles: " << tile_count << "\n";
-	os << "\t\tNumber of pathable tiles: " << walkable_tile_count << "\n";
-	os << "\t\tNumber of unpathable tiles: " << blocking_tile_count << "\n";
-	if(percent_pathable >= 0.0)
-		os << "\t\tPercent walkable tiles: " << percent_pathable << "%\n";
-	os << "\t\tDetailed tiles: " << detailed_tile_count << "\n";
-	if(percent_detailed >= 0.0)
-		os << "\t\tPercent detailed tiles: " << percent_detailed << "%\n";
-
-	os << "\tItem data:\n";
-	os << "\t\tTotal number of items: " << item_count << "\n";
-	os << "\t\tNumber of moveable tiles: " << loose_item_count << "\n";
-	os << "\t\tNumber of depots: " << depot_count << "\n";
-	os << "\t\tNumber of containers: " << container_count << "\n";
-	os << "\t\tNumber of items with Action ID: " << action_item_count << "\n";
-	os << "\t\tNumber of items with Unique ID: " << unique_item_count << "\n";
-
-	os << "\tCreature data:\n";
-	os << "\t\tTotal creature count: " << creature_count << "\n";
-	os << "\t\tTotal spawn count: " << spawn_count << "\n";
-	if(creatures_per_spawn >= 0)
-		os << "\t\tMean creatures per spawn: " << creatures_per_spawn << "\n";
-
-	os << "\tTown/House data:\n";
-	os << "\t\tTotal number of towns: " << town_count << "\n";
-	os << "\t\tTotal number of houses: " << house_count << "\n";
-	if(houses_per_town >= 0)
-		os << "\t\tMean houses per town: " << houses_per_town << "\n";
-	os << "\t\tTotal amount of housetiles: " << total_house_sqm << "\n";
-	if(sqm_per_house >= 0)
-		os << "\t\tMean tiles per house: " << sqm_per_house << "\n";
-	if(sqm_per_town >= 0)
-		os << "\t\tMean tiles per town: " << sqm_per_town << "\n";
-
-	if(largest_town)
-		os << "\t\tLargest Town: \"" << largest_town->getName() << "\" (" << largest_town_size << " sqm)\n";
-	if(largest_house)
-		os << "\t\tLargest House: \"" << largest_house->name << "\" (" << largest_house_size << " sqm)\n";
-
-	os << "\n";
-	os << "Generated by Remere's Map Editor version " + __RME_VERSION__ + "\n";
-
-
-    wxDialog* dg = newd wxDialog(frame, wxID_ANY, "Map Statistics", wxDefaultPosition, wxDefaultSize, wxRESIZE_BORDER | wxCAPTION | wxCLOSE_BOX);
-	wxSizer* topsizer = newd wxBoxSizer(wxVERTICAL);
-	wxTextCtrl* text_field = newd wxTextCtrl(dg, wxID_ANY, wxstr(os.str()), wxDefaultPosition, wxDefaultSize, wxTE_MULTILINE | wxTE_READONLY);
-	text_field->SetMinSize(wxSize(400, 300));
-	topsizer->Add(text_field, wxSizerFlags(5).Expand());
-
-	wxSizer* choicesizer = newd wxBoxSizer(wxHORIZONTAL);
-	wxButton* export_button = newd wxButton(dg, wxID_OK, "Export as XML");
-	choicesizer->Add(export_button, wxSizerFlags(1).Center());
-	export_button->Enable(false);
-	choicesizer->Add(newd wxButton(dg, wxID_CANCEL, "OK"), wxSizerFlags(1).Center());
-	topsizer->Add(choicesizer, wxSizerFlags(1).Center());
-	dg->SetSizerAndFit(topsizer);
-	dg->Centre(wxBOTH);
-
-	int ret = dg->ShowModal();
-
-	if(ret == wxID_OK) {
-		//std::cout << "XML EXPORT";
-	} else if(ret == wxID_CANCEL) {
-		//std::cout << "OK";
-	}
+	MapStatisticsWindow* window = newd MapStatisticsWindow(frame);
+	window->UpdateStatistics(true);
+	window->Show();
 }
 
 void MainMenuBar::OnMapCleanup(wxCommandEvent& WXUNUSED(event))
 {
+	Editor* editor = g_gui.GetCurrentEditor();
+	if(!editor)
+		return;
+
 	int ok = g_gui.PopupDialog("Clean map", "Do you want to remove all invalid items from the map?", wxYES | wxNO);
+	if(ok != wxID_YES)
+		return;
 
-	if(ok == wxID_YES)
-		g_gui.GetCurrentMap().cleanInvalidTiles(true);
+	g_gui.CreateLoadBar("Removing invalid tiles...", true);
+
+	// Undone as a whole, nothing is removed if it is cancelled
+	BulkOperation operation(*editor, ACTION_REMOVE_ITEMS);
+	operation.setProgress([](int done) { return g_gui.SetLoadDone(done); });
+	bool finished = operation.run(
+		[](Tile* tile) {
+			for(const Item* item : tile->items) {
+				if(!g_items.isValidID(item->getID()))
+					return true;
+			}
+			return false;
+		},
+		[](Tile* tile) {
+			int64_t removed = 0;
+			for(auto it = tile->items.begin(); it != tile->items.end(); ) {
+				if(!g_items.isValidID((*it)->getID())) {
+					delete *it;
+					it = tile->items.erase(it);
+					++removed;
+				} else {
+					++it;
+				}
+			}
+			return removed;
+		});
+	if(!finished)
+		operation.rollback();
+	else
+		operation.commit();
+
+	g_gui.DestroyLoadBar();
+	editor->getMap().invalidateRender();
+	g_gui.RefreshView();
 }
 
 void MainMenuBar::OnMapProperties(wxCommandEvent& WXUNUSED(event))
@@ -1864,6 +1855,28 @@ void MainMenuBar::OnTakeScreenshot(wxCommandEvent& WXUNUSED(event))
 
 }
 
+void MainMenuBar::OnExportFrameProfile(wxCommandEvent& WXUNUSED(event))
+{
+	if(g_profiler.getFrames().empty()) {
+		g_gui.PopupDialog("Export Frame Profile", "No frames have been recorded, enable View > Show Frame Profiler first.", wxOK);
+		return;
+	}
+
+	wxFileDialog dialog(frame, "Export Frame Profile...", "", "", "Chrome Trace (*.json)|*.json|CSV (*.csv)|*.csv", wxFD_SAVE | wxFD_OVERWRITE_PROMPT);
+	if(dialog.ShowModal() != wxID_OK)
+		return;
+
+	wxFileName file(dialog.GetPath());
+	bool result;
+	if(file.GetExt().Lower() == "csv")
+		result = g_profiler.exportCSV(nstr(file.GetFullPath()));
+	else
+		result = g_profiler.exportTrace(nstr(file.GetFullPath()));
+
+	if(!result)
+		g_gui.PopupDialog("Error", "Could not write " + file.GetFullPath(), wxOK);
+}
+
 void MainMenuBar::OnZoomIn(wxCommandEvent& event)
 {
 	double zoom = g_gui.GetCurrentZoom();
@@ -1915,6 +1928,7 @@ void MainMenuBar::OnChangeViewSettings(wxCommandEvent& event)
 	g_settings.setInteger(Config::SHOW_WALL_HOOKS, IsItemChecked(MenuBar::SHOW_WALL_HOOKS));
 	g_settings.setInteger(Config::SHOW_PICKUPABLES, IsItemChecked(MenuBar::SHOW_PICKUPABLES));
 	g_settings.setInteger(Config::SHOW_MOVEABLES, IsItemChecked(MenuBar::SHOW_MOVEABLES));
+	g_settings.setInteger(Config::SHOW_FRAME_PROFILER, IsItemChecked(MenuBar::SHOW_FRAME_PROFILER));
 
 	g_gui.RefreshView();
 	g_gui.root->GetAuiToolBar()->UpdateIndicators();
@@ -2158,7 +2172,21 @@ void MainMenuBar::SearchItems(bool unique, bool action, bool container, bool wri
 	searcher.search_container = container;
 	searcher.search_writeable = writable;
 
-	foreach_ItemOnMap(g_gui.GetCurrentMap(), searcher, onSelection);
+	MapTraversal traversal(g_gui.GetCurrentMap());
+	if(onSelection)
+		traversal.setSelection(g_gui.GetCurrentEditor()->getSelection());
+	traversal.setProgress([](int done) { g_gui.SetLoadDone(done); });
+
+	// Action and unique ids are indexed, containers and text are not
+	if(!container && !writable) {
+		bool indexed = true;
+		if(unique)
+			indexed = traversal.useItemIndex(ItemIndex::UNIQUE_ID);
+		if(indexed && action)
+			traversal.useItemIndex(ItemIndex::ACTION_ID);
+	}
+
+	searcher.found = traversal.findItems([&searcher](Item* item) { return searcher.matches(item); });
 	searcher.sort();
 	std::vector<std::pair<Tile*, Item*> >& found = searcher.found;
 
@@ -36,6 +36,7 @@ namespace MenuBar
 		IMPORT_MONSTERS,
 		IMPORT_MINIMAP,
 		EXPORT_MINIMAP,
+		EXPORT_TILED_IMAGE,
 		RELOAD_DATA,
 		RECENT_FILES,
 		PREFERENCES,
@@ -50,6 +51,7 @@ namespace MenuBar
 		SEARCH_ON_MAP_CONTAINER,
 		SEARCH_ON_MAP_WRITEABLE,
 		SEARCH_ON_MAP_DUPLICATED_ITEMS,
+		SEARCH_ON_MAP_QUERY,
 		SEARCH_ON_SELECTION_EVERYTHING,
 		SEARCH_ON_SELECTION_UNIQUE,
 		SEARCH_ON_SELECTION_ACTION,
@@ -120,6 +122,8 @@ namespace MenuBar
 		SHOW_WALL_HOOKS,
 		SHOW_PICKUPABLES,
 		SHOW_MOVEABLES,
+		SHOW_FRAME_PROFILER,
+		EXPORT_FRAME_PROFILE,
 		WIN_MINIMAP,
 		WIN_ACTIONS_HISTORY,
 		NEW_PALETTE,
@@ -201,6 +205,7 @@ public:
 	void OnImportMonsterData(wxCommandEvent& event);
 	void OnImportMinimap(wxCommandEvent& event);
 	void OnExportMinimap(wxCommandEvent& event);
+	void OnExportTiledImage(wxCommandEvent& event);
 	void OnReloadDataFiles(wxCommandEvent& event);
 
 	// Edit Menu
@@ -233,6 +238,7 @@ public:
 	void OnSearchForContainerOnMap(wxCommandEvent& event);
 	void OnSearchForWriteableOnMap(wxCommandEvent& event);
 	void OnSearchForDuplicatedItemsOnMap(wxCommandEvent& event);
+	void OnSearchForQuery(wxCommandEvent& event);
 
 	// Select menu
 	void OnSearchForStuffOnSelection(wxCommandEvent& event);
@@ -273,6 +279,7 @@ public:
 	void OnActionsHistoryWindow(wxCommandEvent& event);
 	void OnNewPalette(wxCommandEvent& event);
 	void OnTakeScreenshot(wxCommandEvent& event);
+	void OnExportFrameProfile(wxCommandEvent& event);
 	void OnSelectTerrainPalette(wxCommandEvent& event);
 	void OnSelectDoodadPalette(wxCommandEvent& event);
 	void OnSelectItemPalette(wxCommandEvent& event);
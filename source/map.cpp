@@ -20,6 +20,8 @@
 #include "gui.h" // loadbar
 
 #include "map.h"
+#include "map_traversal.h"
+#include "map_conversion.h"
 
 #include <sstream>
 
@@ -35,6 +37,9 @@ Map::Map() : BaseMap(),
 	// Caller is responsible for converting us to proper version
 	mapVersion.otbm = MAP_OTBM_1;
 	mapVersion.client = CLIENT_VERSION_NONE;
+
+	if(!g_settings.getBoolean(Config::USE_ITEM_INDEX))
+		item_index.invalidate();
 }
 
 Map::~Map()
@@ -63,6 +68,8 @@ bool Map::open(const std::string file)
 	}
 
 	has_changed = false;
+	// Loading filled it tile by tile
+	item_index.compact();
 
 	wxFileName fn = wxstr(file);
 	filename = fn.GetFullPath().mb_str(wxConvUTF8);
@@ -124,149 +131,57 @@ bool Map::convert(MapVersion to, bool showdialog)
 		return true;
 	}
 
-	/* TODO
-
-	if(to.otbm == MAP_OTBM_4 && to.client < CLIENT_VERSION_850)
-		return false;
+	// Item ids were renumbered between these clients, so the items of a map
+	// made for one are replaced on the way to the other. A new map has no
+	// client yet and nothing to replace.
+	if(mapVersion.client != CLIENT_VERSION_NONE) {
+		if(mapVersion.client >= CLIENT_VERSION_760 && to.client < CLIENT_VERSION_760)
+			convert(getReplacementMapFrom760To740(), showdialog);
 
-	if(mapVersion.client >= CLIENT_VERSION_760 && to.client < CLIENT_VERSION_760)
-		convert(getReplacementMapFrom760To740(), showdialog);
+		if(mapVersion.client < CLIENT_VERSION_810 && to.client >= CLIENT_VERSION_810)
+			convert(getReplacementMapFrom800To810(), showdialog);
 
-	if(mapVersion.client < CLIENT_VERSION_810 && to.client >= CLIENT_VERSION_810)
-		convert(getReplacementMapFrom800To810(), showdialog);
+		if(mapVersion.client == CLIENT_VERSION_854_BAD && to.client >= CLIENT_VERSION_854)
+			convert(getReplacementMapFrom854To854(), showdialog);
+	}
 
-	if(mapVersion.client == CLIENT_VERSION_854_BAD && to.client >= CLIENT_VERSION_854)
-		convert(getReplacementMapFrom854To854(), showdialog);
-	*/
 	mapVersion = to;
 
 	return true;
 }
 
-bool Map::convert(const ConversionMap& rm, bool showdialog)
+bool Map::convert(const ConversionMap& rm, bool showdialog, ConversionHits* hits)
 {
 	if(showdialog)
 		g_gui.CreateLoadBar("Converting map ...");
 
-	uint64_t tiles_done = 0;
-	std::vector<uint16_t> id_list;
-
-	//std::ofstream conversions("converted_items.txt");
-
-	for(MapIterator miter = begin(); miter != end(); ++miter) {
-		Tile* tile = (*miter)->get();
-		ASSERT(tile);
-
-		if(tile->size() == 0)
-			continue;
-
-		// id_list try MTM conversion
-		id_list.clear();
-
-		if(tile->ground)
-			id_list.push_back(tile->ground->getID());
-		for(ItemVector::const_iterator item_iter = tile->items.begin(); item_iter != tile->items.end(); ++item_iter)
-			if((*item_iter)->isBorder())
-				id_list.push_back((*item_iter)->getID());
-
-		std::sort(id_list.begin(), id_list.end());
-
-		ConversionMap::MTM::const_iterator cfmtm = rm.mtm.end();
-
-		while(id_list.size()) {
-			cfmtm = rm.mtm.find(id_list);
-			if(cfmtm != rm.mtm.end())
-				break;
-			id_list.pop_back();
-		}
-
-		// Keep track of how many items have been inserted at the bottom
-		size_t inserted_items = 0;
-
-		if(cfmtm != rm.mtm.end()) {
-			const std::vector<uint16_t>& v = cfmtm->first;
-
-			if(tile->ground && std::find(v.begin(), v.end(), tile->ground->getID()) != v.end()) {
-				delete tile->ground;
-				tile->ground = nullptr;
-			}
-
-			for(ItemVector::iterator item_iter = tile->items.begin(); item_iter != tile->items.end(); ) {
-				if(std::find(v.begin(), v.end(), (*item_iter)->getID()) != v.end()) {
-					delete *item_iter;
-					item_iter = tile->items.erase(item_iter);
-				}
-				else
-					++item_iter;
-			}
-
-			const std::vector<uint16_t>& new_items = cfmtm->second;
-			for(std::vector<uint16_t>::const_iterator iit = new_items.begin(); iit != new_items.end(); ++iit) {
-				Item* item = Item::Create(*iit);
-				if(item->isGroundTile())
-					tile->ground = item;
-				else {
-					tile->items.insert(tile->items.begin(), item);
-					++inserted_items;
-				}
-			}
-		}
-
-		if(tile->ground) {
-			ConversionMap::STM::const_iterator cfstm = rm.stm.find(tile->ground->getID());
-			if(cfstm != rm.stm.end()) {
-				uint16_t aid = tile->ground->getActionID();
-				uint16_t uid = tile->ground->getUniqueID();
-				delete tile->ground;
-				tile->ground = nullptr;
-
-				const std::vector<uint16_t>& v = cfstm->second;
-				//conversions << "Converted " << tile->getX() << ":" << tile->getY() << ":" << tile->getZ() << " " << id << " -> ";
-				for(std::vector<uint16_t>::const_iterator iit = v.begin(); iit != v.end(); ++iit) {
-					Item* item = Item::Create(*iit);
-					//conversions << *iit << " ";
-					if(item->isGroundTile()) {
-						item->setActionID(aid);
-						item->setUniqueID(uid);
-						tile->addItem(item);
-					} else {
-						tile->items.insert(tile->items.begin(), item);
-						++inserted_items;
-					}
-				}
-				//conversions << std::endl;
-			}
-		}
+	// Every tile is converted on its own, only the items lying on it are
+	// created and deleted, so the tiles are converted on all cores
+	const ConversionTable table(rm);
+	ConversionHits result = table.createHits();
+	MapTraversal traversal(*this);
+	if(showdialog)
+		traversal.setProgress([](int done) { g_gui.SetLoadDone(done); });
+	traversal.forEachTile(result,
+		[&table](ConversionHits& chunk, Tile* tile) { table.convert(tile, chunk); },
+		[](ConversionHits& all, ConversionHits& chunk) { all.merge(chunk); });
 
-		for(ItemVector::iterator replace_item_iter = tile->items.begin() + inserted_items; replace_item_iter != tile->items.end(); ) {
-			uint16_t id = (*replace_item_iter)->getID();
-			ConversionMap::STM::const_iterator cf = rm.stm.find(id);
-			if(cf != rm.stm.end()) {
-				//uint16_t aid = (*replace_item_iter)->getActionID();
-				//uint16_t uid = (*replace_item_iter)->getUniqueID();
-				delete *replace_item_iter;
-
-				replace_item_iter = tile->items.erase(replace_item_iter);
-				const std::vector<uint16_t>& v = cf->second;
-				for(std::vector<uint16_t>::const_iterator iit = v.begin(); iit != v.end(); ++iit) {
-					replace_item_iter = tile->items.insert(replace_item_iter, Item::Create(*iit));
-					//conversions << "Converted " << tile->getX() << ":" << tile->getY() << ":" << tile->getZ() << " " << id << " -> " << *iit << std::endl;
-					++replace_item_iter;
-				}
-			}
-			else
-				++replace_item_iter;
-		}
+	if(showdialog) {
+		g_gui.DestroyLoadBar();
 
-		++tiles_done;
-		if(showdialog && tiles_done % 0x10000 == 0) {
-			g_gui.SetLoadDone(int(tiles_done / double(getTileCount()) * 100.0));
-		}
+		// How often every rule was applied, to check the conversion map
+		std::ostringstream report;
+		table.writeReport(report, result);
+		g_gui.ShowTextBox("Conversion Report", wxstr(report.str()));
 	}
 
-	if(showdialog)
-		g_gui.DestroyLoadBar();
+	if(hits)
+		*hits = std::move(result);
 
+	invalidateRender();
+	invalidateItemIndex();
+	invalidateSummaries();
+	invalidateStatistics();
 	return true;
 }
 
@@ -275,15 +190,25 @@ void Map::cleanInvalidTiles(bool showdialog)
 	if(showdialog)
 		g_gui.CreateLoadBar("Removing invalid tiles...");
 
-	uint64_t tiles_done = 0;
-
-	for(MapIterator miter = begin(); miter != end(); ++miter) {
-		Tile* tile = (*miter)->get();
-		ASSERT(tile);
-
-		if(tile->size() == 0)
-			continue;
+	// Tiles holding invalid items are found on all cores, then cleaned here
+	TileVector tiles;
+	MapTraversal traversal(*this);
+	if(showdialog)
+		traversal.setProgress([](int done) { g_gui.SetLoadDone(done); });
+	traversal.forEachTile(tiles,
+		[](TileVector& chunk, Tile* tile) {
+			for(const Item* item : tile->items) {
+				if(!g_items.isValidID(item->getID())) {
+					chunk.push_back(tile);
+					break;
+				}
+			}
+		},
+		[](TileVector& all, TileVector& chunk) {
+			all.insert(all.end(), chunk.begin(), chunk.end());
+		});
 
+	for(Tile* tile : tiles) {
 		for(ItemVector::iterator item_iter = tile->items.begin(); item_iter != tile->items.end();) {
 			if(g_items.isValidID((*item_iter)->getID()))
 				++item_iter;
@@ -292,15 +217,14 @@ void Map::cleanInvalidTiles(bool showdialog)
 				item_iter = tile->items.erase(item_iter);
 			}
 		}
-
-		++tiles_done;
-		if(showdialog && tiles_done % 0x10000 == 0) {
-			g_gui.SetLoadDone(int(tiles_done / double(getTileCount()) * 100.0));
-		}
 	}
 
 	if(showdialog)
 		g_gui.DestroyLoadBar();
+
+	invalidateRender();
+	invalidateItemIndex();
+	invalidateStatistics();
 }
 
 bool Map::doChange()
@@ -370,6 +294,8 @@ bool Map::addSpawn(Tile* tile)
 			}
 		}
 		spawns.addSpawn(tile);
+		invalidateRender();
+		invalidateSummary(tile->getPosition());
 		return true;
 	}
 	return false;
@@ -393,6 +319,8 @@ void Map::removeSpawnInternal(Tile* tile)
 				ctile_loc->decreaseSpawnCount();
 		}
 	}
+	invalidateRender();
+	invalidateSummary(tile->getPosition());
 }
 
 void Map::removeSpawn(Tile* tile)
@@ -658,6 +586,31 @@ void Map::updateUniqueIds(Tile* old_tile, Tile* new_tile)
 	}
 }
 
+void Map::updateItemIndex(Tile* old_tile, Tile* new_tile)
+{
+	item_index.update(old_tile, new_tile);
+}
+
+void Map::updateStatistics(Tile* old_tile, Tile* new_tile)
+{
+	statistics.update(old_tile, new_tile);
+}
+
+const MapStatistics& Map::getStatistics(bool showdialog)
+{
+	if(!statistics.isValid()) {
+		if(showdialog)
+			g_gui.CreateLoadBar("Collecting data...");
+		statistics.build(*this, [showdialog](int done) {
+			if(showdialog)
+				g_gui.SetLoadDone(done);
+		});
+		if(showdialog)
+			g_gui.DestroyLoadBar();
+	}
+	return statistics;
+}
+
 void Map::addUniqueId(uint16_t uid)
 {
 	auto it = std::find(uniqueIds.begin(), uniqueIds.end(), uid);
@@ -682,3 +635,28 @@ bool Map::hasUniqueId(uint16_t uid) const
 	auto it = std::find(uniqueIds.begin(), uniqueIds.end(), uid);
 	return it != uniqueIds.end();
 }
+
+bool Map::findItems(ItemIndex::Key key, uint16_t id, PositionVector& positions)
+{
+	if(!g_settings.getBoolean(Config::USE_ITEM_INDEX))
+		return false;
+
+	// Dropped by a bulk change or turned on after the map was loaded
+	if(!item_index.isValid())
+		item_index.build(*this);
+
+	item_index.find(key, id, positions);
+	return true;
+}
+
+bool Map::findItems(ItemIndex::Key key, PositionVector& positions)
+{
+	if(!g_settings.getBoolean(Config::USE_ITEM_INDEX))
+		return false;
+
+	if(!item_index.isValid())
+		item_index.build(*this);
+
+	item_index.findAny(key, positions);
+	return true;
+}
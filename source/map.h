@@ -26,6 +26,10 @@
 #include "complexitem.h"
 #include "waypoints.h"
 #include "templates.h"
+#include "item_index.h"
+#include "map_statistics.h"
+
+struct ConversionHits;
 
 class Map : public BaseMap
 {
@@ -40,7 +44,9 @@ public:
 	bool exportMinimap(FileName filename, int floor = rme::MapGroundLayer, bool showdialog = false);
 	//
 	bool convert(MapVersion to, bool showdialog = false);
-	bool convert(const ConversionMap& cm, bool showdialog = false);
+	// Replaces items by the rules of the conversion map, hits gets how often
+	// each rule was applied. With the dialog, those counts are shown after.
+	bool convert(const ConversionMap& cm, bool showdialog = false, ConversionHits* hits = nullptr);
 
 	// Query information about the map
 
@@ -93,6 +99,23 @@ public:
 
 	bool hasUniqueId(uint16_t uid) const;
 
+	// Positions of the tiles holding items with the given id, or with any id
+	// of the kind. False when the item index is turned off, callers search
+	// the map themselves then.
+	bool findItems(ItemIndex::Key key, uint16_t id, PositionVector& positions);
+	bool findItems(ItemIndex::Key key, PositionVector& positions);
+	// Code that changes items of tiles in place, instead of replacing the
+	// tiles, either keeps the index up to date or drops it
+	ItemIndex& getItemIndex() noexcept { return item_index; }
+	const ItemIndex& getItemIndex() const noexcept { return item_index; }
+	void invalidateItemIndex() { item_index.invalidate(); }
+
+	// Running totals of the tiles, counted on all cores first if they were
+	// never counted or a change made to tiles in place dropped them
+	const MapStatistics& getStatistics(bool showdialog = false);
+	bool hasStatistics() const noexcept { return statistics.isValid(); }
+	void invalidateStatistics() { statistics.invalidate(); }
+
 protected:
 	// Loads a map
 	bool open(const std::string identifier);
@@ -122,6 +145,8 @@ public:
 
 protected:
 	void updateUniqueIds(Tile* old_tile, Tile* new_tile) override;
+	void updateItemIndex(Tile* old_tile, Tile* new_tile) override;
+	void updateStatistics(Tile* old_tile, Tile* new_tile) override;
 	void addUniqueId(uint16_t uid);
 	void removeUniqueId(uint16_t uid);
 
@@ -137,124 +162,8 @@ public:
 
 private:
 	std::vector<uint16_t> uniqueIds;
+	ItemIndex item_index;
+	MapStatistics statistics;
 };
 
-template <typename ForeachType>
-inline void foreach_ItemOnMap(Map& map, ForeachType& foreach, bool selectedTiles)
-{
-	MapIterator tileiter = map.begin();
-	MapIterator end = map.end();
-	long long done = 0;
-
-	while(tileiter != end) {
-		++done;
-		Tile* tile = (*tileiter)->get();
-		if(selectedTiles && !tile->isSelected()) {
-			++tileiter;
-			continue;
-		}
-
-		if(tile->ground) {
-			foreach(map, tile, tile->ground, done);
-		}
-
-		std::queue<Container*> containers;
-		for(ItemVector::iterator itemiter = tile->items.begin(); itemiter != tile->items.end(); ++itemiter) {
-			Item* item = *itemiter;
-			Container* container = dynamic_cast<Container*>(item);
-			foreach(map, tile, item, done);
-			if(container) {
-				containers.push(container);
-
-				do {
-					container = containers.front();
-					ItemVector& v = container->getVector();
-					for(ItemVector::iterator containeriter = v.begin(); containeriter != v.end(); ++containeriter) {
-						Item* i = *containeriter;
-						Container* c = dynamic_cast<Container*>(i);
-						foreach(map, tile, i, done);
-						if(c) {
-							containers.push(c);
-						}
-					}
-					containers.pop();
-				} while(containers.size());
-			}
-		}
-		++tileiter;
-	}
-}
-
-template <typename ForeachType>
-inline void foreach_TileOnMap(Map& map, ForeachType& foreach)
-{
-	MapIterator tileiter = map.begin();
-	MapIterator end = map.end();
-	long long done = 0;
-
-	while(tileiter != end)
-		foreach(map, (*tileiter++)->get(), ++done);
-}
-
-template <typename RemoveIfType>
-inline long long remove_if_TileOnMap(Map& map, RemoveIfType& remove_if)
-{
-	MapIterator tileiter = map.begin();
-	MapIterator end = map.end();
-	long long done = 0;
-	long long removed = 0;
-	long long total = map.getTileCount();
-
-	while(tileiter != end) {
-		Tile* tile = (*tileiter)->get();
-		if(remove_if(map, tile, removed, done, total)) {
-			map.setTile(tile->getPosition(), nullptr, true);
-			++removed;
-		}
-		++tileiter;
-		++done;
-	}
-
-	return removed;
-}
-
-template <typename RemoveIfType>
-inline int64_t RemoveItemOnMap(Map& map, RemoveIfType& condition, bool selectedOnly) {
-	int64_t done = 0;
-	int64_t removed = 0;
-
-	MapIterator it = map.begin();
-	MapIterator end = map.end();
-
-	while(it != end) {
-		++done;
-		Tile* tile = (*it)->get();
-		if(selectedOnly && !tile->isSelected()) {
-			++it;
-			continue;
-		}
-
-		if(tile->ground) {
-			if(condition(map, tile->ground, removed, done)) {
-				delete tile->ground;
-				tile->ground = nullptr;
-				++removed;
-			}
-		}
-
-		for(auto iit = tile->items.begin(); iit != tile->items.end();) {
-			Item* item = *iit;
-			if(condition(map, item, removed, done)) {
-				iit = tile->items.erase(iit);
-				delete item;
-				++removed;
-			}
-			else
-				++iit;
-		}
-		++it;
-	}
-	return removed;
-}
-
 #endif
@@ -0,0 +1,257 @@
+//////////////////////////////////////////////////////////////////////
+// This file is part of Remere's Map Editor
+//////////////////////////////////////////////////////////////////////
+// Remere's Map Editor is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// Remere's Map Editor is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <http://www.gnu.org/licenses/>.
+//////////////////////////////////////////////////////////////////////
+
+#include "main.h"
+
+#include "map_conversion.h"
+#include "tile.h"
+#include "item.h"
+
+namespace {
+	void writeIds(std::ostream& stream, const std::vector<uint16_t>& ids)
+	{
+		for(size_t i = 0; i < ids.size(); ++i) {
+			stream << (i == 0 ? "" : " ") << ids[i];
+		}
+	}
+}
+
+void ConversionHits::merge(const ConversionHits& other)
+{
+	mtm.resize(std::max(mtm.size(), other.mtm.size()));
+	for(size_t rule = 0; rule < other.mtm.size(); ++rule) {
+		mtm[rule] += other.mtm[rule];
+	}
+	stm.resize(std::max(stm.size(), other.stm.size()));
+	for(size_t rule = 0; rule < other.stm.size(); ++rule) {
+		stm[rule] += other.stm[rule];
+	}
+	converted_tiles += other.converted_tiles;
+}
+
+ConversionTable::ConversionTable(const ConversionMap& conversion_map) :
+	stm_table(0x10000, -1)
+{
+	// The trie is built with a map of children for every node, then those
+	// are laid out next to each other, sorted by id
+	std::vector<std::map<uint16_t, uint32_t>> children(1);
+	nodes.resize(1);
+	for(const auto& entry : conversion_map.mtm) {
+		// An empty key never matched
+		if(entry.first.empty())
+			continue;
+
+		uint32_t node = 0;
+		for(uint16_t id : entry.first) {
+			auto it = children[node].find(id);
+			if(it == children[node].end()) {
+				it = children[node].emplace(id, uint32_t(nodes.size())).first;
+				nodes.emplace_back();
+				children.emplace_back();
+			}
+			node = it->second;
+		}
+		nodes[node].rule = int32_t(mtm_rules.size());
+		mtm_rules.emplace_back(entry.first, entry.second);
+	}
+
+	for(size_t node = 0; node < nodes.size(); ++node) {
+		nodes[node].first_edge = uint32_t(edges.size());
+		nodes[node].edge_count = uint32_t(children[node].size());
+		for(const auto& child : children[node]) {
+			edges.push_back(Edge{child.first, child.second});
+		}
+	}
+
+	for(const auto& entry : conversion_map.stm) {
+		stm_table[entry.first] = int32_t(stm_rules.size());
+		stm_rules.emplace_back(entry.first, entry.second);
+	}
+}
+
+int32_t ConversionTable::findMTMRule(const std::vector<uint16_t>& ids) const
+{
+	int32_t rule = -1;
+	uint32_t node = 0;
+	for(uint16_t id : ids) {
+		const Node& current = nodes[node];
+		auto first = edges.begin() + current.first_edge;
+		auto last = first + current.edge_count;
+		auto edge = std::lower_bound(first, last, id, [](const Edge& other, uint16_t value) { return other.id < value; });
+		if(edge == last || edge->id != id)
+			break;
+
+		node = edge->node;
+		if(nodes[node].rule != -1)
+			rule = nodes[node].rule;
+	}
+	return rule;
+}
+
+bool ConversionTable::convert(Tile* tile, ConversionHits& hits) const
+{
+	if(tile->size() == 0)
+		return false;
+
+	if(hits.mtm.size() != mtm_rules.size() || hits.stm.size() != stm_rules.size()) {
+		hits.mtm.resize(mtm_rules.size());
+		hits.stm.resize(stm_rules.size());
+	}
+
+	bool converted = false;
+	// Keep track of how many items have been inserted at the bottom
+	size_t inserted_items = 0;
+
+	if(!mtm_rules.empty()) {
+		std::vector<uint16_t>& ids = hits.ids;
+		ids.clear();
+		if(tile->ground)
+			ids.push_back(tile->ground->getID());
+		for(const Item* item : tile->items) {
+			if(item->isBorder())
+				ids.push_back(item->getID());
+		}
+		std::sort(ids.begin(), ids.end());
+
+		const int32_t rule = findMTMRule(ids);
+		if(rule != -1) {
+			const std::vector<uint16_t>& key = mtm_rules[rule].first;
+			auto inKey = [&key](const Item* item) { return std::find(key.begin(), key.end(), item->getID()) != key.end(); };
+
+			if(tile->ground && inKey(tile->ground)) {
+				delete tile->ground;
+				tile->ground = nullptr;
+			}
+
+			for(auto it = tile->items.begin(); it != tile->items.end(); ) {
+				if(inKey(*it)) {
+					delete *it;
+					it = tile->items.erase(it);
+				} else {
+					++it;
+				}
+			}
+
+			for(uint16_t id : mtm_rules[rule].second) {
+				Item* item = Item::Create(id);
+				if(!item)
+					continue;
+
+				if(item->isGroundTile()) {
+					delete tile->ground;
+					tile->ground = item;
+				} else {
+					tile->items.insert(tile->items.begin(), item);
+					++inserted_items;
+				}
+			}
+			++hits.mtm[rule];
+			converted = true;
+		}
+	}
+
+	if(tile->ground) {
+		const int32_t rule = stm_table[tile->ground->getID()];
+		if(rule != -1) {
+			const uint16_t aid = tile->ground->getActionID();
+			const uint16_t uid = tile->ground->getUniqueID();
+			delete tile->ground;
+			tile->ground = nullptr;
+
+			for(uint16_t id : stm_rules[rule].second) {
+				Item* item = Item::Create(id);
+				if(!item)
+					continue;
+
+				if(item->isGroundTile()) {
+					item->setActionID(aid);
+					item->setUniqueID(uid);
+					tile->addItem(item);
+				} else {
+					tile->items.insert(tile->items.begin(), item);
+					++inserted_items;
+				}
+			}
+			++hits.stm[rule];
+			converted = true;
+		}
+	}
+
+	for(auto it = tile->items.begin() + inserted_items; it != tile->items.end(); ) {
+		const int32_t rule = stm_table[(*it)->getID()];
+		if(rule == -1) {
+			++it;
+			continue;
+		}
+
+		delete *it;
+		it = tile->items.erase(it);
+		for(uint16_t id : stm_rules[rule].second) {
+			if(Item* item = Item::Create(id)) {
+				it = tile->items.insert(it, item);
+				++it;
+			}
+		}
+		++hits.stm[rule];
+		converted = true;
+	}
+
+	if(converted)
+		++hits.converted_tiles;
+	return converted;
+}
+
+ConversionHits ConversionTable::createHits() const
+{
+	ConversionHits hits;
+	hits.mtm.resize(mtm_rules.size());
+	hits.stm.resize(stm_rules.size());
+	return hits;
+}
+
+void ConversionTable::writeReport(std::ostream& stream, const ConversionHits& hits) const
+{
+	// Many to many rules first, each kind sorted by hits
+	std::vector<std::pair<uint64_t, size_t>> applied;
+	for(size_t rule = 0; rule < hits.mtm.size() && rule < mtm_rules.size(); ++rule) {
+		if(hits.mtm[rule] != 0)
+			applied.emplace_back(hits.mtm[rule], rule);
+	}
+	const size_t mtm_applied = applied.size();
+	for(size_t rule = 0; rule < hits.stm.size() && rule < stm_rules.size(); ++rule) {
+		if(hits.stm[rule] != 0)
+			applied.emplace_back(hits.stm[rule], rule);
+	}
+
+	auto byHits = [](const std::pair<uint64_t, size_t>& a, const std::pair<uint64_t, size_t>& b) { return a.first > b.first; };
+	std::stable_sort(applied.begin(), applied.begin() + mtm_applied, byHits);
+	std::stable_sort(applied.begin() + mtm_applied, applied.end(), byHits);
+
+	stream << "Converted tiles: " << hits.converted_tiles << "\n";
+	for(size_t i = 0; i < applied.size(); ++i) {
+		stream << applied[i].first << "\t";
+		if(i < mtm_applied) {
+			writeIds(stream, mtm_rules[applied[i].second].first);
+			stream << " -> ";
+			writeIds(stream, mtm_rules[applied[i].second].second);
+		} else {
+			stream << stm_rules[applied[i].second].first << " -> ";
+			writeIds(stream, stm_rules[applied[i].second].second);
+		}
+		stream << "\n";
+	}
+}
@@ -0,0 +1,83 @@
+//////////////////////////////////////////////////////////////////////
+// This file is part of Remere's Map Editor
+//////////////////////////////////////////////////////////////////////
+// Remere's Map Editor is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// Remere's Map Editor is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <http://www.gnu.org/licenses/>.
+//////////////////////////////////////////////////////////////////////
+
+#ifndef RME_MAP_CONVERSION_H_
+#define RME_MAP_CONVERSION_H_
+
+#include "templates.h"
+
+#include <ostream>
+
+class Tile;
+class Item;
+
+// How often each rule of a conversion map was applied, in the order the
+// rules have in the map
+struct ConversionHits {
+	std::vector<uint64_t> mtm;
+	std::vector<uint64_t> stm;
+	uint64_t converted_tiles = 0;
+	// The sorted ids of the tile being converted, kept to reuse the memory
+	std::vector<uint16_t> ids;
+
+	void merge(const ConversionHits& other);
+};
+
+// A conversion map compiled for converting many tiles. Single item rules
+// are looked up by item id in a flat table and the keys of the many to many
+// rules form a trie, walked once with the sorted ids of a tile. Converting
+// a tile only touches that tile, so tiles can be converted on all cores.
+class ConversionTable
+{
+public:
+	explicit ConversionTable(const ConversionMap& conversion_map);
+
+	// Same result as the conversion map: the longest key made of the first
+	// of the sorted ground and border ids is replaced, then single items
+	// are. True if anything on the tile was replaced.
+	bool convert(Tile* tile, ConversionHits& hits) const;
+
+	ConversionHits createHits() const;
+	// One line for every rule that was applied, the most used first
+	void writeReport(std::ostream& stream, const ConversionHits& hits) const;
+
+	size_t getMTMRuleCount() const noexcept { return mtm_rules.size(); }
+	size_t getSTMRuleCount() const noexcept { return stm_rules.size(); }
+
+private:
+	struct Node {
+		uint32_t first_edge = 0;
+		uint32_t edge_count = 0;
+		int32_t rule = -1;
+	};
+	struct Edge {
+		uint16_t id;
+		uint32_t node;
+	};
+
+	// The rule of the longest key ids starts with, or -1
+	int32_t findMTMRule(const std::vector<uint16_t>& ids) const;
+
+	std::vector<Node> nodes;
+	std::vector<Edge> edges;
+	std::vector<std::pair<std::vector<uint16_t>, std::vector<uint16_t>>> mtm_rules;
+	// Rule index by item id, -1 for items that stay
+	std::vector<int32_t> stm_table;
+	std::vector<std::pair<uint16_t, std::vector<uint16_t>>> stm_rules;
+};
+
+#endif
@@ -35,6 +35,7 @@
 #include "application.h"
 #include "live_server.h"
 #include "browse_tile_window.h"
+#include "frame_profiler.h"
 
 #include "doodad_brush.h"
 #include "house_exit_brush.h"
@@ -194,7 +195,11 @@ void MapCanvas::OnPaint(wxPaintEvent& event)
 {
 	SetCurrent(*g_gui.GetGLContext(this));
 
+	g_profiler.setEnabled(g_settings.getBoolean(Config::SHOW_FRAME_PROFILER));
+	g_profiler.beginFrame();
+
 	if(g_gui.IsRenderingEnabled()) {
+		g_profiler.beginPhase("setup");
 		DrawingOptions& options = drawer->getOptions();
 		if(screenshot_buffer) {
 			options.SetIngame();
@@ -223,6 +228,8 @@ void MapCanvas::OnPaint(wxPaintEvent& event)
 			options.show_pickupables = g_settings.getBoolean(Config::SHOW_PICKUPABLES);
 			options.show_moveables = g_settings.getBoolean(Config::SHOW_MOVEABLES);
 			options.hide_items_when_zoomed = g_settings.getBoolean(Config::HIDE_ITEMS_WHEN_ZOOMED);
+			options.overview_zoom = g_settings.getInteger(Config::OVERVIEW_ZOOM);
+			options.show_profiler = g_profiler.isEnabled();
 		}
 
 		options.dragging = boundbox_selection;
@@ -234,22 +241,68 @@ void MapCanvas::OnPaint(wxPaintEvent& event)
 
 		drawer->SetupVars();
 		drawer->SetupGL();
+		g_profiler.endPhase();
+
+		g_profiler.beginPhase("draw");
 		drawer->Draw();
+		g_profiler.endPhase();
 
 		if(screenshot_buffer)
 			drawer->TakeScreenshot(screenshot_buffer);
 
 		drawer->Release();
+
+		// Time spent waiting for the driver to finish the queued commands,
+		// a large share of the frame here means the frame is GPU bound
+		if(g_profiler.isEnabled()) {
+			ProfileScope scope(FrameProfiler::GpuWaitPhase);
+			glFinish();
+		}
 	}
 
 	// Clean unused textures
+	g_profiler.beginPhase("texture gc");
 	g_gui.gfx.garbageCollection();
+	g_profiler.endPhase();
 
 	// Swap buffer
+	g_profiler.beginPhase("swap");
 	SwapBuffers();
+	g_profiler.endPhase();
 
 	// Send newd node requests
+	g_profiler.beginPhase("live requests");
+	if(editor.IsLiveClient()) {
+		int screensize_x, screensize_y;
+		GetViewBox(&view_scroll_x, &view_scroll_y, &screensize_x, &screensize_y);
+
+		int start_x = view_scroll_x / rme::TileSize;
+		int start_y = view_scroll_y / rme::TileSize;
+		int end_x = start_x + int(screensize_x * zoom) / rme::TileSize + 1;
+		int end_y = start_y + int(screensize_y * zoom) / rme::TileSize + 1;
+		editor.PrefetchNodes(start_x, start_y, end_x, end_y, floor);
+	}
 	editor.SendNodeRequests();
+	g_profiler.endPhase();
+
+	g_profiler.endFrame();
+}
+
+void MapCanvas::DrawOffscreen(const DrawingOptions& options)
+{
+	SetCurrent(*g_gui.GetGLContext(this));
+
+	// Every frame draws the map, as a frame after a real camera move would
+	drawer->getOptions() = options;
+	drawer->InvalidateLayers();
+
+	drawer->SetupVars();
+	drawer->SetupGL();
+	drawer->Draw();
+	drawer->Release();
+
+	g_gui.gfx.garbageCollection();
+	glFinish();
 }
 
 void MapCanvas::ShowPositionIndicator(const Position& position)
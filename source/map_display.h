@@ -28,6 +28,7 @@ class MapWindow;
 class MapPopupMenu;
 class AnimationTimer;
 class MapDrawer;
+class DrawingOptions;
 
 class MapCanvas : public wxGLCanvas
 {
@@ -110,6 +111,9 @@ public:
 	int GetFloor() const noexcept { return floor; }
 	double GetZoom() const noexcept { return zoom; }
 	void SetZoom(double value);
+	// Draws a frame with the given options into the back buffer without
+	// swapping it to the screen, and waits until the driver is done
+	void DrawOffscreen(const DrawingOptions& options);
 	void GetViewBox(int* view_scroll_x, int* view_scroll_y, int* screensize_x, int* screensize_y) const;
 
 	MapWindow* GetMapWindow() const;
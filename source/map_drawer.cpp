@@ -43,6 +43,10 @@
 #include "table_brush.h"
 #include "waypoint_brush.h"
 #include "light_drawer.h"
+#include "overview_drawer.h"
+#include "worker_pool.h"
+#include "frame_profiler.h"
+#include "map_layer_cache.h"
 
 DrawingOptions::DrawingOptions()
 {
@@ -78,6 +82,8 @@ void DrawingOptions::SetDefault()
 	show_pickupables = false;
 	show_moveables = false;
 	hide_items_when_zoomed = true;
+	overview_zoom = 0;
+	show_profiler = false;
 }
 
 void DrawingOptions::SetIngame()
@@ -109,6 +115,8 @@ void DrawingOptions::SetIngame()
 	show_pickupables = false;
 	show_moveables = false;
 	hide_items_when_zoomed = false;
+	overview_zoom = 0;
+	show_profiler = false;
 }
 
 bool DrawingOptions::isOnlyColors() const noexcept
@@ -133,14 +141,17 @@ bool DrawingOptions::isDrawLight() const noexcept
 	return show_ingame_box && show_lights;
 }
 
-MapDrawer::MapDrawer(MapCanvas* canvas) : canvas(canvas), editor(canvas->editor)
+MapDrawer::MapDrawer(MapCanvas* canvas) : canvas(canvas), editor(canvas->editor), render_frame(0), layer_tile_revision(0)
 {
 	light_drawer = std::make_shared<LightDrawer>();
+	overview_drawer = std::make_shared<OverviewDrawer>();
+	layer_cache = std::make_shared<MapLayerCache>();
 }
 
 MapDrawer::~MapDrawer()
 {
 	Release();
+	ClearTooltips();
 }
 
 void MapDrawer::SetupVars()
@@ -177,6 +188,15 @@ void MapDrawer::SetupVars()
 
 	end_x = start_x + screensize_x / tile_size + 2;
 	end_y = start_y + screensize_y / tile_size + 2;
+
+	// The current house we're drawing
+	current_house_id = 0;
+	if(Brush* brush = g_gui.GetCurrentBrush()) {
+		if(brush->isHouse())
+			current_house_id = brush->asHouse()->getHouseID();
+		else if(brush->isHouseExit())
+			current_house_id = brush->asHouseExit()->getHouseID();
+	}
 }
 
 void MapDrawer::SetupGL()
@@ -201,14 +221,8 @@ void MapDrawer::SetupGL()
 
 void MapDrawer::Release()
 {
-	for(auto it = tooltips.begin(); it != tooltips.end(); ++it) {
-		delete *it;
-	}
-	tooltips.clear();
-
-	if(light_drawer) {
-		light_drawer->clear();
-	}
+	// Tooltips and lights are kept until the map is drawn again, the
+	// overlays of frames drawn from the layer cache still need them
 
 	// Disable 2D mode
 	glMatrixMode(GL_PROJECTION);
@@ -219,20 +233,169 @@ void MapDrawer::Release()
 
 void MapDrawer::Draw()
 {
-	DrawBackground();
-	DrawMap();
-	DrawDraggingShadow();
-	DrawHigherFloors();
-	if(options.dragging)
+	if(!DrawCachedLayers())
+		DrawLayers();
+
+	if(options.dragging) {
+		ProfileScope scope("selection box");
 		DrawSelectionBox();
-	DrawLiveCursors();
-	DrawBrush();
-	if(options.show_grid && zoom <= 10.f)
+	}
+	{
+		ProfileScope scope("live cursors");
+		DrawLiveCursors();
+	}
+	{
+		ProfileScope scope("brush");
+		DrawBrush();
+	}
+	if(options.show_grid && zoom <= 10.f) {
+		ProfileScope scope("grid");
 		DrawGrid();
-	if(options.show_ingame_box)
+	}
+	if(options.show_ingame_box) {
+		ProfileScope scope("ingame box");
 		DrawIngameBox();
-	if(options.isTooltips())
+	}
+	if(options.isTooltips()) {
+		ProfileScope scope("tooltips");
 		DrawTooltips();
+	}
+	if(options.show_profiler)
+		DrawProfilerOverlay();
+}
+
+void MapDrawer::DrawLayers()
+{
+	{
+		ProfileScope scope("background");
+		DrawBackground();
+	}
+	{
+		ProfileScope scope("map");
+		DrawMap();
+	}
+	{
+		ProfileScope scope("dragging shadow");
+		DrawDraggingShadow();
+	}
+	{
+		ProfileScope scope("higher floors");
+		DrawHigherFloors();
+	}
+}
+
+bool MapDrawer::DrawCachedLayers()
+{
+	// Previews drawn in between the floors follow the mouse, the position
+	// indicator is animated and live leaves arrive without replacing tiles
+	bool secondary_map = !options.ingame && g_gui.secondary_map;
+	if(dragging || secondary_map || editor.IsLiveClient() || GetPositionIndicatorTime() != 0) {
+		layer_cache->invalidate();
+		return false;
+	}
+
+	Map& map = editor.getMap();
+
+	LayerCacheKey key;
+	key.options = options;
+	key.view_scroll_x = view_scroll_x;
+	key.view_scroll_y = view_scroll_y;
+	key.screensize_x = screensize_x;
+	key.screensize_y = screensize_y;
+	key.zoom = zoom;
+	key.floor = floor;
+	key.map_generation = map.getRenderGeneration();
+	key.gfx_generation = g_gui.gfx.getGeneration();
+	key.house_id = current_house_id;
+	// Animations move on with the 100 ms animation timer of the canvas
+	key.animation_tick = options.show_preview ? g_gui.gfx.getElapsedTime() / 100 : 0;
+
+	wxRect dirty;
+	bool redraw = !layer_cache->isValid() || key != layer_cache_key || !GetDirtyBox(layer_tile_revision, dirty);
+	layer_cache_key = key;
+	layer_tile_revision = map.getTileRevision();
+
+	if(redraw) {
+		DrawLayers();
+		layer_cache->store(0, 0, screensize_x, screensize_y, screensize_x, screensize_y);
+		return true;
+	}
+
+	{
+		ProfileScope scope("cached layers");
+		DrawBackground();
+		layer_cache->restore();
+	}
+
+	if(dirty.IsEmpty()) {
+		// Leave things as drawing the layers would, the overlays expect the
+		// tile range DrawMap widened once per floor and texturing as it was
+		int floors = std::max(0, start_z - superend_z + 1);
+		start_x -= floors;
+		start_y -= floors;
+		end_x += floors;
+		end_y += floors;
+
+		bool higher_floors = options.transparent_floors && floor != 0 && floor != 8;
+		if(options.isOnlyColors() || higher_floors)
+			glDisable(GL_TEXTURE_2D);
+		else
+			glEnable(GL_TEXTURE_2D);
+		return true;
+	}
+
+	// Only the tiles replaced since the last frame are drawn again
+	ProfileScope scope("dirty layers");
+	glEnable(GL_SCISSOR_TEST);
+	glScissor(dirty.x, dirty.y, dirty.width, dirty.height);
+	DrawLayers();
+	layer_cache->store(dirty.x, dirty.y, dirty.width, dirty.height, screensize_x, screensize_y);
+	glDisable(GL_SCISSOR_TEST);
+	return true;
+}
+
+void MapDrawer::InvalidateLayers()
+{
+	layer_cache->invalidate();
+}
+
+bool MapDrawer::GetDirtyBox(uint32_t revision, wxRect& box)
+{
+	PositionVector positions;
+	if(!editor.getMap().getChangesSince(revision, positions))
+		return false;
+
+	// Large sprites and elevation reach a couple of tiles up and left of
+	// their tile, one tile of slack is kept on the other sides
+	constexpr int margin = rme::TileSize * 3;
+
+	box = wxRect();
+	for(const Position& position : positions) {
+		int draw_x, draw_y;
+		getDrawPosition(position, draw_x, draw_y);
+
+		// Map units to window pixels, GL counts rows from the bottom
+		int left = int(std::floor((draw_x - margin) / zoom));
+		int top = int(std::floor((draw_y - margin) / zoom));
+		int right = int(std::ceil((draw_x + rme::TileSize * 2) / zoom));
+		int bottom = int(std::ceil((draw_y + rme::TileSize * 2) / zoom));
+
+		wxRect rect(left, screensize_y - bottom, right - left, bottom - top);
+		box = box.IsEmpty() ? rect : box.Union(rect);
+	}
+
+	box.Intersect(wxRect(0, 0, screensize_x, screensize_y));
+	if(box.width <= 0 || box.height <= 0)
+		box = wxRect();
+	return true;
+}
+
+void MapDrawer::ClearTooltips()
+{
+	for(MapTooltip* tooltip : tooltips) {
+		delete tooltip;
+	}
+	tooltips.clear();
 }
 
 void MapDrawer::DrawBackground()
@@ -250,6 +413,22 @@ void MapDrawer::DrawBackground()
 	//glEnable(GL_ALPHA_TEST);
 }
 
+inline RenderCommand& RecordCommand(RenderCommandList& commands, RenderCommand::Type type, int x, int y, int red = 255, int green = 255, int blue = 255, int alpha = 255)
+{
+	RenderCommand& command = commands.emplace_back();
+	command.type = type;
+	command.sprite = nullptr;
+	command.item = nullptr;
+	command.index = 0;
+	command.x = static_cast<int16_t>(x);
+	command.y = static_cast<int16_t>(y);
+	command.red = static_cast<uint8_t>(red);
+	command.green = static_cast<uint8_t>(green);
+	command.blue = static_cast<uint8_t>(blue);
+	command.alpha = static_cast<uint8_t>(alpha);
+	return command;
+}
+
 inline int getFloorAdjustment(int floor)
 {
 	if(floor > rme::MapGroundLayer) // Underground
@@ -289,86 +468,42 @@ void MapDrawer::DrawMap()
 	int box_start_map_y = center_y - view_scroll_x + offset_y;
 	int box_end_map_x = center_x + rme::ClientMapWidth;
 	int box_end_map_y = center_y + rme::ClientMapHeight + offset_y;
+	light_box = wxRect(box_start_map_x, box_start_map_y, box_end_map_x - box_start_map_x + 1, box_end_map_y - box_start_map_y + 1);
 
 	bool live_client = editor.IsLiveClient();
 
-	Brush* brush = g_gui.GetCurrentBrush();
-
-	// The current house we're drawing
-	current_house_id = 0;
-	if(brush) {
-		if(brush->isHouse())
-			current_house_id = brush->asHouse()->getHouseID();
-		else if(brush->isHouseExit())
-			current_house_id = brush->asHouseExit()->getHouseID();
-	}
+	// Collected again while the leaves are drawn
+	ClearTooltips();
+	light_drawer->clear();
 
 	bool only_colors = options.isOnlyColors();
-	bool tile_indicators = options.isTileIndicators();
+
+	// Far out, the map is drawn from baked minimap color regions instead
+	bool overview = !live_client && options.overview_zoom > 0 && zoom >= options.overview_zoom;
+	if(overview)
+		overview_drawer->beginFrame(editor.getMap());
+
+	// Tooltips are collected while drawing, so those frames are drawn tile by tile
+	bool use_cache = !overview && !options.isTooltips() && !options.show_only_modified;
+	if(use_cache)
+		UpdateRenderCache();
 
 	for(int map_z = start_z; map_z >= superend_z; map_z--) {
 		if(options.show_shade) {
 			DrawShade(map_z);
 		}
 
-		if(map_z >= end_z) {
+		if(map_z >= end_z && overview) {
+			glEnable(GL_TEXTURE_2D);
+			DrawOverview(map_z);
+			glDisable(GL_TEXTURE_2D);
+
+			DrawPositionIndicator(map_z);
+		} else if(map_z >= end_z) {
 			if(!only_colors)
 				glEnable(GL_TEXTURE_2D);
 
-			int nd_start_x = start_x & ~3;
-			int nd_start_y = start_y & ~3;
-			int nd_end_x = (end_x & ~3) + 4;
-			int nd_end_y = (end_y & ~3) + 4;
-
-			for(int nd_map_x = nd_start_x; nd_map_x <= nd_end_x; nd_map_x += 4) {
-				for(int nd_map_y = nd_start_y; nd_map_y <= nd_end_y; nd_map_y += 4) {
-					QTreeNode* nd = editor.getMap().getLeaf(nd_map_x, nd_map_y);
-					if(!nd) {
-						if(!live_client)
-							continue;
-						nd = editor.getMap().createLeaf(nd_map_x, nd_map_y);
-						nd->setVisible(false, false);
-					}
-
-					if(!live_client || nd->isVisible(map_z > rme::MapGroundLayer)) {
-						for(int map_x = 0; map_x < 4; ++map_x) {
-							for(int map_y = 0; map_y < 4; ++map_y) {
-								TileLocation* location = nd->getTile(map_x, map_y, map_z);
-								DrawTile(location);
-								if(location && options.isDrawLight()) {
-									auto& position = location->getPosition();
-									if(position.x >= box_start_map_x && position.x <= box_end_map_x && position.y >= box_start_map_y && position.y <= box_end_map_y) {
-										AddLight(location);
-									}
-								}
-							}
-						}
-						if(tile_indicators) {
-							for(int map_x = 0; map_x < 4; ++map_x) {
-								for(int map_y = 0; map_y < 4; ++map_y) {
-									DrawTileIndicators(nd->getTile(map_x, map_y, map_z));
-								}
-							}
-						}
-					} else {
-						if(!nd->isRequested(map_z > rme::MapGroundLayer)) {
-							// Request the node
-							editor.QueryNode(nd_map_x, nd_map_y, map_z > rme::MapGroundLayer);
-							nd->setRequested(map_z > rme::MapGroundLayer, true);
-						}
-						int cy = (nd_map_y) * rme::TileSize - view_scroll_y - getFloorAdjustment(floor);
-						int cx = (nd_map_x) * rme::TileSize - view_scroll_x - getFloorAdjustment(floor);
-
-						glColor4ub(255, 0, 255, 128);
-						glBegin(GL_QUADS);
-							glVertex2f(cx, cy + rme::TileSize * 4);
-							glVertex2f(cx + rme::TileSize * 4, cy + rme::TileSize * 4);
-							glVertex2f(cx + rme::TileSize * 4, cy);
-							glVertex2f(cx,     cy);
-						glEnd();
-					}
-				}
-			}
+			DrawLeaves(map_z, use_cache);
 
 			if(!only_colors)
 				glDisable(GL_TEXTURE_2D);
@@ -387,6 +522,34 @@ void MapDrawer::DrawMap()
 
 	if(!only_colors)
 		glEnable(GL_TEXTURE_2D);
+
+	// Drop the leaves that went off screen once the cache grows too large
+	if(use_cache && render_cache.size() > rme::RenderCacheMinLeaves) {
+		std::erase_if(render_cache, [this](const auto& pair) {
+			return pair.second.last_frame != render_frame;
+		});
+	}
+
+	if(overview)
+		overview_drawer->endFrame();
+}
+
+void MapDrawer::DrawOverview(int map_z)
+{
+	constexpr int region_size = OverviewDrawer::RegionSize;
+
+	int rg_start_x = std::max(start_x, 0) & ~(region_size - 1);
+	int rg_start_y = std::max(start_y, 0) & ~(region_size - 1);
+	int rg_end_x = std::min(end_x, rme::MapMaxWidth);
+	int rg_end_y = std::min(end_y, rme::MapMaxHeight);
+
+	for(int rg_map_x = rg_start_x; rg_map_x <= rg_end_x; rg_map_x += region_size) {
+		for(int rg_map_y = rg_start_y; rg_map_y <= rg_end_y; rg_map_y += region_size) {
+			int x, y;
+			getDrawPosition(Position(rg_map_x, rg_map_y, map_z), x, y);
+			overview_drawer->draw(editor.getMap(), rg_map_x, rg_map_y, map_z, x, y);
+		}
+	}
 }
 
 void MapDrawer::DrawSecondaryMap(int map_z)
@@ -1074,118 +1237,12 @@ void MapDrawer::DrawBrush()
 
 void MapDrawer::BlitItem(int& draw_x, int& draw_y, const Tile* tile, const Item* item, bool ephemeral, int red, int green, int blue, int alpha)
 {
-	const ItemType& type = g_items.getItemType(item->getID());
-	if(type.id == 0) {
-		glDisable(GL_TEXTURE_2D);
-		glBlitSquare(draw_x, draw_y, *wxRED);
-		glEnable(GL_TEXTURE_2D);
-		return;
-	}
-
-	if(!options.ingame && !ephemeral && item->isSelected()) {
-		red /= 2;
-		blue /= 2;
-		green /= 2;
-	}
-
-	// Ugly hacks. :)
-	if(type.id == 459 && !options.ingame) {
-		glDisable(GL_TEXTURE_2D);
-		glBlitSquare(draw_x, draw_y, red, green, 0, alpha/3*2);
-		glEnable(GL_TEXTURE_2D);
-		return;
-	} else if(type.id == 460 && !options.ingame) {
-		glDisable(GL_TEXTURE_2D);
-		glBlitSquare(draw_x, draw_y, red, 0, 0, alpha/3*2);
-		glEnable(GL_TEXTURE_2D);
-		return;
-	}
-
-	if(type.isMetaItem())
-		return;
-	if(!ephemeral && type.pickupable && !options.show_items)
-		return;
-
-	GameSprite* sprite = type.sprite;
-	if(!sprite)
-		return;
-
-	int screenx = draw_x - sprite->getDrawOffset().x;
-	int screeny = draw_y - sprite->getDrawOffset().y;
-
-	const Position& pos = tile->getPosition();
-
-	// Set the newd drawing height accordingly
-	draw_x -= sprite->getDrawHeight();
-	draw_y -= sprite->getDrawHeight();
-
-	int subtype = -1;
-
-	int pattern_x = 0;
-	int pattern_y = 0;
-	int pattern_z = pos.z % sprite->pattern_z;
-
-	if(type.isSplash() || type.isFluidContainer()) {
-		subtype = item->getSubtype();
-	} else if(type.isHangable) {
-		if(tile->hasProperty(HOOK_SOUTH)) {
-			pattern_x = 1;
-		} else if(tile->hasProperty(HOOK_EAST)) {
-			pattern_x = 2;
-		}
-	} else if(type.stackable && sprite->pattern_x == 4 && sprite->pattern_y == 2) {
-		int count = item->getSubtype();
-		if(count <= 0) {
-			pattern_x = 0;
-			pattern_y = 0;
-		} else if(count < 5) {
-			pattern_x = count - 1;
-			pattern_y = 0;
-		} else if(count < 10) {
-			pattern_x = 0;
-			pattern_y = 1;
-		} else if(count < 25) {
-			pattern_x = 1;
-			pattern_y = 1;
-		} else if(count < 50) {
-			pattern_x = 2;
-			pattern_y = 1;
-		} else {
-			pattern_x = 3;
-			pattern_y = 1;
-		}
-	} else {
-		pattern_x = pos.x % sprite->pattern_x;
-		pattern_y = pos.y % sprite->pattern_y;
-	}
-
-	if(!ephemeral && options.transparent_items &&
-			(!type.isGroundTile() || sprite->width > 1 || sprite->height > 1) &&
-			!type.isSplash() &&
-			(!type.isBorder || sprite->width > 1 || sprite->height > 1)
-	  )
-	{
-		alpha /= 2;
-	}
-
-	int frame = item->getFrame();
-	for(int cx = 0; cx != sprite->width; cx++) {
-		for(int cy = 0; cy != sprite->height; cy++) {
-			for(int cf = 0; cf != sprite->layers; cf++) {
-				int texnum = sprite->getHardwareID(cx,cy,cf,
-					subtype,
-					pattern_x,
-					pattern_y,
-					pattern_z,
-					frame
-				);
-				glBlitTexture(screenx - cx * rme::TileSize, screeny - cy * rme::TileSize, texnum, red, green, blue, alpha);
-			}
-		}
-	}
-
-	if(options.show_hooks && (type.hookSouth || type.hookEast))
-		DrawHookIndicator(draw_x, draw_y, type);
+	int x = 0, y = 0;
+	render_scratch.clear();
+	RecordItem(render_scratch, x, y, tile, item, ephemeral, red, green, blue, alpha);
+	DrawCommands(render_scratch, draw_x, draw_y);
+	draw_x += x;
+	draw_y += y;
 }
 
 void MapDrawer::BlitItem(int& draw_x, int& draw_y, const Position& pos, const Item* item, bool ephemeral, int red, int green, int blue, int alpha)
@@ -1421,29 +1478,214 @@ void MapDrawer::WriteTooltip(const Waypoint* waypoint, std::ostringstream& strea
 	stream << "wp: " << waypoint->name << "\n";
 }
 
-void MapDrawer::DrawTile(TileLocation* location)
+void MapDrawer::DrawLeaves(int map_z, bool use_cache)
 {
-	if(!location) return;
+	Map& map = editor.getMap();
+	bool live_client = editor.IsLiveClient();
+	bool show_tooltips = options.isTooltips();
+	bool draw_lights = options.isDrawLight();
+
+	int nd_start_x = start_x & ~3;
+	int nd_start_y = start_y & ~3;
+	int nd_end_x = (end_x & ~3) + 4;
+	int nd_end_y = (end_y & ~3) + 4;
+
+	// Walk the visible leaves and find out which ones need recording
+	size_t job_count = 0;
+	size_t record_count = 0;
+	for(int nd_map_x = nd_start_x; nd_map_x <= nd_end_x; nd_map_x += 4) {
+		for(int nd_map_y = nd_start_y; nd_map_y <= nd_end_y; nd_map_y += 4) {
+			QTreeNode* nd = map.getLeaf(nd_map_x, nd_map_y);
+			if(!nd) {
+				if(!live_client)
+					continue;
+				nd = map.createLeaf(nd_map_x, nd_map_y);
+				nd->setVisible(false, false);
+			}
 
-	Tile* tile = location->get();
-	if(!tile) return;
+			bool visible = !live_client || nd->isVisible(map_z > rme::MapGroundLayer);
+			const Floor* map_floor = nd->getFloor(map_z);
+			if(visible && !map_floor)
+				continue;
 
-	if(options.show_only_modified && !tile->isModified())
-		return;
+			if(job_count == leaf_jobs.size())
+				leaf_jobs.emplace_back();
+
+			LeafJob& job = leaf_jobs[job_count++];
+			job.node = nd;
+			job.nd_map_x = nd_map_x;
+			job.nd_map_y = nd_map_y;
+			job.visible = visible;
+			job.record = false;
+			job.commands = nullptr;
+			job.tooltips.clear();
+			job.lights.clear();
+
+			if(!visible) {
+				if(!nd->isRequested(map_z > rme::MapGroundLayer)) {
+					// Request the node
+					editor.QueryNode(nd_map_x, nd_map_y, map_z > rme::MapGroundLayer);
+					nd->setRequested(map_z > rme::MapGroundLayer, true);
+				}
+				continue;
+			}
 
-	const Position& position = location->getPosition();
+			if(use_cache) {
+				// Leaves are only ever replaced tile by tile, which bumps the floor revision
+				uint64_t key = (uint64_t(uint16_t(nd_map_x)) << 24) | (uint64_t(uint16_t(nd_map_y)) << 8) | uint64_t(map_z);
+				RenderCacheEntry& entry = render_cache[key];
+				if(entry.floor != map_floor || entry.revision != map_floor->revision) {
+					entry.floor = map_floor;
+					entry.revision = map_floor->revision;
+					entry.commands.clear();
+					job.record = true;
+				}
+				entry.last_frame = render_frame;
+				job.commands = &entry.commands;
+			} else {
+				job.scratch.clear();
+				job.record = true;
+				job.commands = &job.scratch;
+			}
+
+			if(job.record || show_tooltips || draw_lights)
+				++record_count;
+		}
+	}
+
+	// Recording only reads the map, so it is split across threads when it pays off
+	g_profiler.beginPhase("record leaves");
+	auto record = [this, map_z, show_tooltips, draw_lights](size_t index) {
+		LeafJob& job = leaf_jobs[index];
+		if(job.visible && (job.record || show_tooltips || draw_lights))
+			RecordLeaf(job, map_z);
+	};
+	if(record_count >= 16) {
+		WorkerPool::getInstance().run(job_count, record);
+	} else {
+		for(size_t index = 0; index < job_count; ++index) {
+			record(index);
+		}
+	}
+	g_profiler.endPhase();
+
+	ProfileScope scope("submit leaves");
+	for(size_t index = 0; index < job_count; ++index) {
+		SubmitLeaf(leaf_jobs[index], map_z);
+	}
+}
+
+void MapDrawer::RecordLeaf(LeafJob& job, int map_z)
+{
 	bool show_tooltips = options.isTooltips();
+	bool draw_lights = options.isDrawLight();
+
+	g_profiler.count(FrameProfiler::TILES_VISITED, 16);
+	for(int map_x = 0; map_x < 4; ++map_x) {
+		for(int map_y = 0; map_y < 4; ++map_y) {
+			const TileLocation* location = job.node->getTile(map_x, map_y, map_z);
+			int draw_x = map_x * rme::TileSize;
+			int draw_y = map_y * rme::TileSize;
+			if(job.record)
+				RecordTile(location, *job.commands, draw_x, draw_y);
+			if(show_tooltips)
+				MakeTileTooltip(location, draw_x, draw_y, job.tooltips);
+			if(draw_lights)
+				AddLight(location, job.lights);
+		}
+	}
+}
 
-	if(show_tooltips && location->getWaypointCount() > 0) {
-		Waypoint* waypoint = canvas->editor.getMap().waypoints.getWaypoint(position);
-		if(waypoint)
-			WriteTooltip(waypoint, tooltip);
+void MapDrawer::SubmitLeaf(LeafJob& job, int map_z)
+{
+	if(!job.visible) {
+		int cy = (job.nd_map_y) * rme::TileSize - view_scroll_y - getFloorAdjustment(floor);
+		int cx = (job.nd_map_x) * rme::TileSize - view_scroll_x - getFloorAdjustment(floor);
+
+		glColor4ub(255, 0, 255, 128);
+		glBegin(GL_QUADS);
+			glVertex2f(cx, cy + rme::TileSize * 4);
+			glVertex2f(cx + rme::TileSize * 4, cy + rme::TileSize * 4);
+			glVertex2f(cx + rme::TileSize * 4, cy);
+			glVertex2f(cx,     cy);
+		glEnd();
+		return;
 	}
 
-	bool only_colors = options.isOnlyColors();
+	int x, y;
+	getDrawPosition(Position(job.nd_map_x, job.nd_map_y, map_z), x, y);
+	DrawCommands(*job.commands, x, y);
+
+	for(MapTooltip* tooltip : job.tooltips) {
+		tooltip->x += x;
+		tooltip->y += y;
+		tooltips.push_back(tooltip);
+	}
+	job.tooltips.clear();
+
+	for(const PendingLight& light : job.lights) {
+		if(light_box.Contains(light.x, light.y)) {
+			SpriteLight sprite_light;
+			sprite_light.intensity = light.intensity;
+			sprite_light.color = light.color;
+			light_drawer->addLight(light.x, light.y, sprite_light);
+		}
+	}
+
+	if(options.isTileIndicators()) {
+		for(int map_x = 0; map_x < 4; ++map_x) {
+			for(int map_y = 0; map_y < 4; ++map_y) {
+				DrawTileIndicators(job.node->getTile(map_x, map_y, map_z));
+			}
+		}
+	}
+}
+
+void MapDrawer::DrawCommands(const RenderCommandList& commands, int x, int y)
+{
+	bool animate = options.show_preview && zoom <= 2.0;
+	for(const RenderCommand& command : commands) {
+		int draw_x = x + command.x;
+		int draw_y = y + command.y;
+		switch(command.type) {
+			case RenderCommand::SPRITE: {
+				int texnum = command.sprite->getHardwareID(command.index);
+				glBlitTexture(draw_x, draw_y, texnum, command.red, command.green, command.blue, command.alpha);
+				break;
+			}
+			case RenderCommand::ANIMATED_SPRITE: {
+				GameSprite* sprite = command.sprite;
+				int frame = animate ? sprite->animator->getFrame() : command.item->getFrame();
+				int texnum = sprite->getHardwareID(command.index + frame * sprite->frameStride());
+				glBlitTexture(draw_x, draw_y, texnum, command.red, command.green, command.blue, command.alpha);
+				break;
+			}
+			case RenderCommand::SQUARE:
+				glDisable(GL_TEXTURE_2D);
+				glBlitSquare(draw_x, draw_y, command.red, command.green, command.blue, command.alpha);
+				glEnable(GL_TEXTURE_2D);
+				break;
+			case RenderCommand::CREATURE:
+				BlitCreature(draw_x, draw_y, command.creature);
+				break;
+			case RenderCommand::HOOK:
+				DrawHookIndicator(draw_x, draw_y, *command.hook);
+				break;
+		}
+	}
+}
 
-	int draw_x, draw_y;
-	getDrawPosition(position, draw_x, draw_y);
+void MapDrawer::RecordTile(const TileLocation* location, RenderCommandList& commands, int& draw_x, int& draw_y)
+{
+	if(!location) return;
+
+	const Tile* tile = location->get();
+	if(!tile) return;
+
+	if(options.show_only_modified && !tile->isModified())
+		return;
+
+	bool only_colors = options.isOnlyColors();
 
 	uint8_t r = 255,g = 255,b = 255;
 	if(only_colors || tile->hasGround()) {
@@ -1501,54 +1743,130 @@ void MapDrawer::DrawTile(TileLocation* location)
 		}
 
 		if(only_colors) {
-			glDisable(GL_TEXTURE_2D);
 			if(options.show_as_minimap) {
 				wxColor color = colorFromEightBit(tile->getMiniMapColor());
-				glBlitSquare(draw_x, draw_y, color);
+				RecordCommand(commands, RenderCommand::SQUARE, draw_x, draw_y, color.Red(), color.Green(), color.Blue(), color.Alpha());
 			} else if(r != 255 || g != 255 || b != 255) {
-				glBlitSquare(draw_x, draw_y, r, g, b, 128);
+				RecordCommand(commands, RenderCommand::SQUARE, draw_x, draw_y, r, g, b, 128);
 			}
-			glEnable(GL_TEXTURE_2D);
 		} else {
-			if(options.show_preview && zoom <= 2.0)
-				tile->ground->animate();
-
-			BlitItem(draw_x, draw_y, tile, tile->ground, false, r, g, b);
+			RecordItem(commands, draw_x, draw_y, tile, tile->ground, false, r, g, b);
 		}
-
-		if(show_tooltips && position.z == floor)
-			WriteTooltip(tile->ground, tooltip);
 	}
 
 	bool hidden = only_colors || (options.hide_items_when_zoomed && zoom > 10.f);
 
 	if(!hidden && !tile->items.empty()) {
-		for(Item* item : tile->items) {
-			if(show_tooltips && position.z == floor)
-				WriteTooltip(item, tooltip);
-
-			if(options.show_preview && zoom <= 2.0)
-				item->animate();
-
+		for(const Item* item : tile->items) {
 			if(item->isBorder()) {
-				BlitItem(draw_x, draw_y, tile, item, false, r, g, b);
+				RecordItem(commands, draw_x, draw_y, tile, item, false, r, g, b);
 			} else {
-				BlitItem(draw_x, draw_y, tile, item);
+				RecordItem(commands, draw_x, draw_y, tile, item, false);
 			}
 		}
 	}
 
 	if(!hidden && options.show_creatures && tile->creature) {
-		BlitCreature(draw_x, draw_y, tile->creature);
+		RenderCommand& command = RecordCommand(commands, RenderCommand::CREATURE, draw_x, draw_y);
+		command.creature = tile->creature;
 	}
+}
 
-	if(show_tooltips) {
-		if(location->getWaypointCount() > 0)
-			MakeTooltip(draw_x, draw_y, tooltip.str(), 0, 255, 0);
-		else
-			MakeTooltip(draw_x, draw_y, tooltip.str());
-		tooltip.str("");
+void MapDrawer::RecordItem(RenderCommandList& commands, int& draw_x, int& draw_y, const Tile* tile, const Item* item, bool ephemeral, int red, int green, int blue, int alpha)
+{
+	const ItemType& type = g_items.getItemType(item->getID());
+	if(type.id == 0) {
+		RecordCommand(commands, RenderCommand::SQUARE, draw_x, draw_y, 255, 0, 0);
+		return;
 	}
+
+	if(!options.ingame && !ephemeral && item->isSelected()) {
+		red /= 2;
+		blue /= 2;
+		green /= 2;
+	}
+
+	// Ugly hacks. :)
+	if(type.id == 459 && !options.ingame) {
+		RecordCommand(commands, RenderCommand::SQUARE, draw_x, draw_y, red, green, 0, alpha/3*2);
+		return;
+	} else if(type.id == 460 && !options.ingame) {
+		RecordCommand(commands, RenderCommand::SQUARE, draw_x, draw_y, red, 0, 0, alpha/3*2);
+		return;
+	}
+
+	if(type.isMetaItem())
+		return;
+	if(!ephemeral && type.pickupable && !options.show_items)
+		return;
+
+	GameSprite* sprite = type.sprite;
+	if(!sprite)
+		return;
+
+	const GameSprite::ItemPattern pattern = sprite->getItemPattern(tile, item, draw_x, draw_y);
+
+	if(!ephemeral && options.transparent_items &&
+			(!type.isGroundTile() || sprite->width > 1 || sprite->height > 1) &&
+			!type.isSplash() &&
+			(!type.isBorder || sprite->width > 1 || sprite->height > 1)
+	  )
+	{
+		alpha /= 2;
+	}
+
+	// Animated items only store the frame 0 index, the rest is picked on replay
+	for(int cx = 0; cx != sprite->width; cx++) {
+		for(int cy = 0; cy != sprite->height; cy++) {
+			for(int cf = 0; cf != sprite->layers; cf++) {
+				RenderCommand& command = RecordCommand(commands,
+					pattern.animated ? RenderCommand::ANIMATED_SPRITE : RenderCommand::SPRITE,
+					pattern.screenx - cx * rme::TileSize, pattern.screeny - cy * rme::TileSize,
+					red, green, blue, alpha);
+				command.sprite = sprite;
+				command.item = item;
+				command.index = pattern.getSpriteIndex(sprite, cx, cy, cf);
+			}
+		}
+	}
+
+	if(options.show_hooks && (type.hookSouth || type.hookEast)) {
+		RenderCommand& command = RecordCommand(commands, RenderCommand::HOOK, draw_x, draw_y);
+		command.hook = &type;
+	}
+}
+
+void MapDrawer::UpdateRenderCache()
+{
+	RenderCacheKey key;
+	key.map_generation = editor.getMap().getRenderGeneration();
+	key.gfx_generation = g_gui.gfx.getGeneration();
+	key.house_id = options.show_houses ? current_house_id : 0;
+
+	const bool flags[] = {
+		options.ingame,
+		options.show_as_minimap,
+		options.show_only_colors,
+		options.show_special_tiles,
+		options.show_blocking,
+		options.highlight_items,
+		options.show_spawns,
+		options.show_houses,
+		options.show_creatures,
+		options.show_items,
+		options.transparent_items,
+		options.show_hooks,
+		options.hide_items_when_zoomed && zoom > 10.f,
+	};
+	for(bool flag : flags) {
+		key.flags = (key.flags << 1) | (flag ? 1 : 0);
+	}
+
+	if(key != render_cache_key) {
+		render_cache.clear();
+		render_cache_key = key;
+	}
+	++render_frame;
 }
 
 void MapDrawer::DrawBrushIndicator(int x, int y, Brush* brush, uint8_t r, uint8_t g, uint8_t b)
@@ -1820,19 +2138,113 @@ void MapDrawer::DrawTooltips()
 	glEnable(GL_TEXTURE_2D);
 }
 
-void MapDrawer::MakeTooltip(int screenx, int screeny, const std::string& text, uint8_t r, uint8_t g, uint8_t b)
+void MapDrawer::DrawProfilerOverlay()
 {
-	if(text.empty())
+	std::vector<std::string> lines = g_profiler.getSummary();
+	if(lines.empty())
 		return;
 
+	// Drawn in window pixels so it stays readable at every zoom
+	glMatrixMode(GL_PROJECTION);
+	glPushMatrix();
+	glLoadIdentity();
+	glOrtho(0, screensize_x, screensize_y, 0, -1, 1);
+	glMatrixMode(GL_MODELVIEW);
+	glPushMatrix();
+	glLoadIdentity();
+
+	int width = 0;
+	for(const std::string& line : lines) {
+		int line_width = 0;
+		for(char c : line) {
+			line_width += glutBitmapWidth(GLUT_BITMAP_HELVETICA_12, c);
+		}
+		width = std::max(width, line_width);
+	}
+
+	const int line_height = 14;
+	int right = width + 16;
+	int bottom = int(lines.size()) * line_height + 12;
+
+	glDisable(GL_TEXTURE_2D);
+	glColor4ub(0, 0, 0, 180);
+	glBegin(GL_QUADS);
+		glVertex2f(4, 4);
+		glVertex2f(right, 4);
+		glVertex2f(right, bottom);
+		glVertex2f(4, bottom);
+	glEnd();
+
+	glColor4ub(255, 255, 255, 255);
+	int y = 4 + line_height;
+	for(const std::string& line : lines) {
+		glRasterPos2i(10, y);
+		for(char c : line) {
+			glutBitmapCharacter(GLUT_BITMAP_HELVETICA_12, c);
+		}
+		y += line_height;
+	}
+	glEnable(GL_TEXTURE_2D);
+
+	glPopMatrix();
+	glMatrixMode(GL_PROJECTION);
+	glPopMatrix();
+	glMatrixMode(GL_MODELVIEW);
+}
+
+void MapDrawer::MakeTileTooltip(const TileLocation* location, int x, int y, std::vector<MapTooltip*>& target)
+{
+	if(!location) return;
+
+	const Tile* tile = location->get();
+	if(!tile) return;
+
+	if(options.show_only_modified && !tile->isModified())
+		return;
+
+	std::ostringstream stream;
+	const Position& position = location->getPosition();
+	if(location->getWaypointCount() > 0) {
+		Waypoint* waypoint = canvas->editor.getMap().waypoints.getWaypoint(position);
+		if(waypoint)
+			WriteTooltip(waypoint, stream);
+	}
+
+	if(position.z == floor) {
+		bool only_colors = options.isOnlyColors();
+		if(only_colors || tile->hasGround())
+			WriteTooltip(tile->ground, stream);
+
+		bool hidden = only_colors || (options.hide_items_when_zoomed && zoom > 10.f);
+		if(!hidden) {
+			for(const Item* item : tile->items) {
+				WriteTooltip(item, stream);
+			}
+		}
+	}
+
+	MapTooltip* tooltip;
+	if(location->getWaypointCount() > 0)
+		tooltip = MakeTooltip(x, y, stream.str(), 0, 255, 0);
+	else
+		tooltip = MakeTooltip(x, y, stream.str());
+	if(tooltip)
+		target.push_back(tooltip);
+}
+
+MapTooltip* MapDrawer::MakeTooltip(int screenx, int screeny, const std::string& text, uint8_t r, uint8_t g, uint8_t b)
+{
+	if(text.empty())
+		return nullptr;
+
 	MapTooltip *tooltip = new MapTooltip(screenx, screeny, text, r, g, b);
 	tooltip->checkLineEnding();
-	tooltips.push_back(tooltip);
+	return tooltip;
 }
 
-void MapDrawer::AddLight(TileLocation* location)
+void MapDrawer::AddLight(const TileLocation* location, std::vector<PendingLight>& lights)
 {
-	if(!options.isDrawLight() || !location) {
+	if(!location) {
 		return;
 	}
 
@@ -1845,7 +2257,8 @@ void MapDrawer::AddLight(TileLocation* location)
 
 	if(tile->ground) {
 		if (tile->ground->hasLight()) {
-			light_drawer->addLight(position.x, position.y, tile->ground->getLight());
+			SpriteLight light = tile->ground->getLight();
+			lights.push_back(PendingLight { position.x, position.y, light.intensity, light.color });
 		}
 	}
 
@@ -1853,7 +2266,8 @@ void MapDrawer::AddLight(TileLocation* location)
 	if(!hidden && !tile->items.empty()) {
 		for(auto item : tile->items) {
 			if(item->hasLight()) {
-				light_drawer->addLight(position.x, position.y, item->getLight());
+				SpriteLight light = item->getLight();
+				lights.push_back(PendingLight { position.x, position.y, light.intensity, light.color });
 			}
 		}
 	}
@@ -1893,6 +2307,9 @@ void MapDrawer::glBlitTexture(int x, int y, int textureId, int red, int green, i
 	if(textureId <= 0)
 		return;
 
+	g_profiler.count(FrameProfiler::TEXTURE_BINDS);
+	g_profiler.count(FrameProfiler::DRAW_CALLS);
+
 	glBindTexture(GL_TEXTURE_2D, textureId);
 	glColor4ub(uint8_t(red), uint8_t(green), uint8_t(blue), uint8_t(alpha));
 	glBegin(GL_QUADS);
@@ -1926,6 +2343,7 @@ void MapDrawer::glBlitTexture(int x, int y, int textureId, int red, int green, i
 
 void MapDrawer::glBlitSquare(int x, int y, int red, int green, int blue, int alpha)
 {
+	g_profiler.count(FrameProfiler::DRAW_CALLS);
 	glColor4ub(uint8_t(red), uint8_t(green), uint8_t(blue), uint8_t(alpha));
 	glBegin(GL_QUADS);
 		glVertex2f(x, y);
@@ -1937,6 +2355,7 @@ void MapDrawer::glBlitSquare(int x, int y, int red, int green, int blue, int alp
 
 void MapDrawer::glBlitSquare(int x, int y, const wxColor& color)
 {
+	g_profiler.count(FrameProfiler::DRAW_CALLS);
 	glColor4ub(color.Red(), color.Green(), color.Blue(), color.Alpha());
 	glBegin(GL_QUADS);
 		glVertex2f(x, y);
@@ -18,7 +18,11 @@
 #ifndef RME_MAP_DRAWER_H_
 #define RME_MAP_DRAWER_H_
 
+#include <unordered_map>
+
 class GameSprite;
+class Floor;
+class QTreeNode;
 
 struct MapTooltip
 {
@@ -84,10 +88,43 @@ public:
 	bool show_pickupables;
 	bool show_moveables;
 	bool hide_items_when_zoomed;
+	// Zoom from which the map is drawn from minimap colors, 0 to disable
+	int overview_zoom;
+	bool show_profiler;
+
+	bool operator==(const DrawingOptions& other) const = default;
+};
+
+// A single recorded blit, positions are relative to the origin the command
+// list was recorded at, so leaves can be replayed at any scroll offset.
+struct RenderCommand
+{
+	enum Type : uint8_t {
+		SPRITE,
+		ANIMATED_SPRITE, // index is for frame 0, the frame is picked on replay
+		SQUARE,
+		CREATURE,
+		HOOK,
+	};
+
+	union {
+		GameSprite* sprite;
+		const Creature* creature;
+		const ItemType* hook;
+	};
+	const Item* item;
+	uint32_t index;
+	int16_t x, y;
+	uint8_t red, green, blue, alpha;
+	Type type;
 };
 
+using RenderCommandList = std::vector<RenderCommand>;
+
 class MapCanvas;
 class LightDrawer;
+class OverviewDrawer;
+class MapLayerCache;
 
 class MapDrawer
 {
@@ -95,6 +132,8 @@ class MapDrawer
 	Editor& editor;
 	DrawingOptions options;
 	std::shared_ptr<LightDrawer> light_drawer;
+	std::shared_ptr<OverviewDrawer> overview_drawer;
+	std::shared_ptr<MapLayerCache> layer_cache;
 
 	float zoom;
 
@@ -108,9 +147,75 @@ class MapDrawer
 	int tile_size;
 	int floor;
 
+	// Recorded commands of one floor of a leaf, keyed on the floor revision
+	struct RenderCacheEntry {
+		const Floor* floor = nullptr;
+		uint32_t revision = 0;
+		uint32_t last_frame = 0;
+		RenderCommandList commands;
+	};
+
+	// Everything the recorded commands depend on besides the tiles themselves
+	struct RenderCacheKey {
+		uint32_t map_generation = 0;
+		uint32_t gfx_generation = 0;
+		uint32_t house_id = 0;
+		uint32_t flags = 0;
+
+		bool operator==(const RenderCacheKey& other) const = default;
+	};
+
+	std::unordered_map<uint64_t, RenderCacheEntry> render_cache;
+	RenderCacheKey render_cache_key;
+	uint32_t render_frame;
+	RenderCommandList render_scratch;
+
+	struct PendingLight {
+		int x, y;
+		uint8_t intensity, color;
+	};
+
+	// One visible leaf of the floor being drawn. Recording fills the command
+	// list, tooltips and lights on a worker thread, positions relative to the
+	// leaf, and the GL thread submits the jobs in order afterwards.
+	struct LeafJob {
+		QTreeNode* node = nullptr;
+		int nd_map_x = 0;
+		int nd_map_y = 0;
+		bool visible = true; // Live client leaves not received yet are drawn as placeholders
+		bool record = false;
+		RenderCommandList* commands = nullptr;
+		RenderCommandList scratch;
+		std::vector<MapTooltip*> tooltips;
+		std::vector<PendingLight> lights;
+	};
+
+	std::vector<LeafJob> leaf_jobs;
+	// Tiles whose lights reach the ingame box
+	wxRect light_box;
+
+	// Everything the map layers on screen depend on besides the tiles
+	struct LayerCacheKey {
+		DrawingOptions options;
+		int view_scroll_x = 0;
+		int view_scroll_y = 0;
+		int screensize_x = 0;
+		int screensize_y = 0;
+		float zoom = 0.f;
+		int floor = 0;
+		uint32_t map_generation = 0;
+		uint32_t gfx_generation = 0;
+		uint32_t house_id = 0;
+		long animation_tick = 0;
+
+		bool operator==(const LayerCacheKey& other) const = default;
+	};
+
+	LayerCacheKey layer_cache_key;
+	uint32_t layer_tile_revision;
+
 protected:
 	std::vector<MapTooltip*> tooltips;
-	std::ostringstream tooltip;
 
 	wxStopWatch pos_indicator_timer;
 	Position pos_indicator;
@@ -127,9 +232,12 @@ public:
 	void Release();
 
 	void Draw();
+	void DrawLayers();
+	bool DrawCachedLayers();
 	void DrawBackground();
 	void DrawShade(int mapz);
 	void DrawMap();
+	void DrawOverview(int map_z);
 	void DrawSecondaryMap(int mapz);
 	void DrawDraggingShadow();
 	void DrawHigherFloors();
@@ -139,6 +247,7 @@ public:
 	void DrawIngameBox();
 	void DrawGrid();
 	void DrawTooltips();
+	void DrawProfilerOverlay();
 
 	void TakeScreenshot(uint8_t* screenshot_buffer);
 
@@ -152,6 +261,8 @@ public:
 	}
 
 	DrawingOptions& getOptions() noexcept { return options; }
+	// The next frame draws the map layers again instead of reusing them
+	void InvalidateLayers();
 
 protected:
 	void BlitItem(int& screenx, int& screeny, const Tile* tile, const Item* item, bool ephemeral = false, int red = 255, int green = 255, int blue = 255, int alpha = 255);
@@ -160,7 +271,15 @@ protected:
 	void BlitSpriteType(int screenx, int screeny, GameSprite* spr, int red = 255, int green = 255, int blue = 255, int alpha = 255);
 	void BlitCreature(int screenx, int screeny, const Creature* c, int red = 255, int green = 255, int blue = 255, int alpha = 255);
 	void BlitCreature(int screenx, int screeny, const Outfit& outfit, Direction dir, int red = 255, int green = 255, int blue = 255, int alpha = 255);
-	void DrawTile(TileLocation* tile);
+	void DrawLeaves(int map_z, bool use_cache);
+	void RecordLeaf(LeafJob& job, int map_z);
+	void SubmitLeaf(LeafJob& job, int map_z);
+	void DrawCommands(const RenderCommandList& commands, int x, int y);
+	void RecordTile(const TileLocation* location, RenderCommandList& commands, int& draw_x, int& draw_y);
+	void RecordItem(RenderCommandList& commands, int& draw_x, int& draw_y, const Tile* tile, const Item* item, bool ephemeral, int red = 255, int green = 255, int blue = 255, int alpha = 255);
+	void UpdateRenderCache();
+	bool GetDirtyBox(uint32_t revision, wxRect& box);
+	void ClearTooltips();
 	void DrawBrushIndicator(int x, int y, Brush* brush, uint8_t r, uint8_t g, uint8_t b);
 	void DrawHookIndicator(int x, int y, const ItemType& type);
 	void DrawTileIndicators(TileLocation* location);
@@ -168,8 +287,9 @@ protected:
 	void DrawPositionIndicator(int z);
 	void WriteTooltip(const Item* item, std::ostringstream& stream);
 	void WriteTooltip(const Waypoint* item, std::ostringstream& stream);
-	void MakeTooltip(int screenx, int screeny, const std::string& text, uint8_t r = 255, uint8_t g = 255, uint8_t b = 255);
-	void AddLight(TileLocation* location);
+	void MakeTileTooltip(const TileLocation* location, int x, int y, std::vector<MapTooltip*>& target);
+	MapTooltip* MakeTooltip(int screenx, int screeny, const std::string& text, uint8_t r = 255, uint8_t g = 255, uint8_t b = 255);
+	void AddLight(const TileLocation* location, std::vector<PendingLight>& lights);
 
 	enum BrushColor {
 		COLOR_BRUSH,
@@ -0,0 +1,290 @@
+//////////////////////////////////////////////////////////////////////
+// This file is part of Remere's Map Editor
+//////////////////////////////////////////////////////////////////////
+// Remere's Map Editor is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// Remere's Map Editor is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <http://www.gnu.org/licenses/>.
+//////////////////////////////////////////////////////////////////////
+
+#include "main.h"
+
+#include "map_issues.h"
+#include "map_traversal.h"
+#include "complexitem.h"
+#include "spawn.h"
+
+namespace {
+	struct UniqueId {
+		uint16_t id;
+		Position position;
+	};
+
+	struct SpawnArea {
+		Position position;
+		int radius;
+		uint16_t overlaps;
+	};
+
+	// What the worker threads found, the issues that need the whole map are
+	// worked out once everything was merged
+	struct Found {
+		std::vector<MapIssues::Issue> issues;
+		std::vector<UniqueId> unique_ids;
+		std::vector<SpawnArea> spawns;
+	};
+
+	uint16_t clampCount(size_t count)
+	{
+		return uint16_t(std::min<size_t>(count, 0xFFFF));
+	}
+
+	void addUniqueIds(Found& found, Item* item, const Position& position)
+	{
+		if(const uint16_t id = item->getUniqueID(); id != 0)
+			found.unique_ids.push_back(UniqueId{id, position});
+
+		if(Container* container = item->getContainer()) {
+			for(Item* content : container->getVector()) {
+				addUniqueIds(found, content, position);
+			}
+		}
+	}
+
+	void checkTile(Found& found, const Map& map, Tile* tile)
+	{
+		const Position& position = tile->getPosition();
+		ItemVector& items = tile->items;
+
+		// Every item is compared to the items above it, unless an item below
+		// it already counted it
+		for(size_t i = 0; i < items.size(); ++i) {
+			bool counted = false;
+			for(size_t j = 0; j < i && !counted; ++j) {
+				counted = MapIssues::isIdentical(items[j], items[i]);
+			}
+			if(counted)
+				continue;
+
+			size_t copies = 0;
+			for(size_t j = i + 1; j < items.size(); ++j) {
+				if(MapIssues::isIdentical(items[i], items[j]))
+					++copies;
+			}
+			if(copies != 0)
+				found.issues.push_back(MapIssues::Issue{position, items[i]->getID(), clampCount(copies), MapIssues::STACKED_ITEMS});
+		}
+
+		const size_t things = (tile->ground ? 1 : 0) + (tile->creature ? 1 : 0) + items.size();
+		if(things > size_t(MapIssues::ClientTileLimit)) {
+			const uint32_t hidden = uint32_t(things - MapIssues::ClientTileLimit);
+			found.issues.push_back(MapIssues::Issue{position, hidden, clampCount(things), MapIssues::CLIENT_TILE_LIMIT});
+		}
+
+		if(tile->isHouseTile() && !map.houses.getHouse(tile->getHouseID()))
+			found.issues.push_back(MapIssues::Issue{position, tile->getHouseID(), 1, MapIssues::HOUSE_TILE_NO_HOUSE});
+
+		if(tile->ground)
+			addUniqueIds(found, tile->ground, position);
+		for(Item* item : items) {
+			addUniqueIds(found, item, position);
+		}
+
+		if(tile->spawn)
+			found.spawns.push_back(SpawnArea{position, tile->spawn->getSize(), 0});
+	}
+
+	void findDuplicateUniqueIds(std::vector<UniqueId>& unique_ids, std::vector<MapIssues::Issue>& issues)
+	{
+		// Stable, so the items of an id stay in map order
+		std::stable_sort(unique_ids.begin(), unique_ids.end(), [](const UniqueId& a, const UniqueId& b) { return a.id < b.id; });
+		for(size_t first = 0; first < unique_ids.size(); ) {
+			size_t last = first + 1;
+			while(last < unique_ids.size() && unique_ids[last].id == unique_ids[first].id) {
+				++last;
+			}
+			if(last - first > 1) {
+				for(size_t i = first; i < last; ++i) {
+					issues.push_back(MapIssues::Issue{unique_ids[i].position, unique_ids[i].id, clampCount(last - first), MapIssues::DUPLICATE_UNIQUE_ID});
+				}
+			}
+			first = last;
+		}
+	}
+
+	void findOverlappingSpawns(std::vector<SpawnArea>& spawns, std::vector<MapIssues::Issue>& issues)
+	{
+		// Sorted by floor and by left edge, each spawn is only compared to
+		// the spawns starting before its right edge
+		std::sort(spawns.begin(), spawns.end(), [](const SpawnArea& a, const SpawnArea& b) {
+			if(a.position.z != b.position.z)
+				return a.position.z < b.position.z;
+			return a.position.x - a.radius < b.position.x - b.radius;
+		});
+
+		for(size_t i = 0; i < spawns.size(); ++i) {
+			SpawnArea& spawn = spawns[i];
+			for(size_t j = i + 1; j < spawns.size(); ++j) {
+				SpawnArea& other = spawns[j];
+				if(other.position.z != spawn.position.z || other.position.x - other.radius > spawn.position.x + spawn.radius)
+					break;
+				if(std::abs(other.position.y - spawn.position.y) <= spawn.radius + other.radius) {
+					++spawn.overlaps;
+					++other.overlaps;
+				}
+			}
+		}
+
+		for(const SpawnArea& spawn : spawns) {
+			if(spawn.overlaps != 0)
+				issues.push_back(MapIssues::Issue{spawn.position, uint32_t(spawn.radius), spawn.overlaps, MapIssues::OVERLAPPING_SPAWN});
+		}
+	}
+}
+
+bool MapIssues::find(MapTraversal& traversal)
+{
+	issues.clear();
+	std::fill(std::begin(counts), std::end(counts), 0);
+
+	const Map& map = traversal.getMap();
+	Found found;
+	const bool finished = traversal.forEachTile(found,
+		[&map](Found& chunk, Tile* tile) {
+			checkTile(chunk, map, tile);
+		},
+		[](Found& all, Found& chunk) {
+			all.issues.insert(all.issues.end(), chunk.issues.begin(), chunk.issues.end());
+			all.unique_ids.insert(all.unique_ids.end(), chunk.unique_ids.begin(), chunk.unique_ids.end());
+			all.spawns.insert(all.spawns.end(), chunk.spawns.begin(), chunk.spawns.end());
+		});
+
+	issues.swap(found.issues);
+	findDuplicateUniqueIds(found.unique_ids, issues);
+	findOverlappingSpawns(found.spawns, issues);
+
+	sort(SORT_BY_KIND);
+	for(const Issue& issue : issues) {
+		++counts[issue.kind];
+	}
+	return finished;
+}
+
+void MapIssues::sort(SortKey key, bool descending)
+{
+	auto byKind = [](const Issue& a, const Issue& b) {
+		if(a.kind != b.kind)
+			return a.kind < b.kind;
+		if(a.position != b.position)
+			return a.position < b.position;
+		return a.value < b.value;
+	};
+
+	auto compare = [key](const Issue& a, const Issue& b) -> int {
+		switch(key) {
+			case SORT_BY_POSITION:
+				return a.position < b.position ? -1 : (b.position < a.position ? 1 : 0);
+			case SORT_BY_VALUE:
+				return a.value < b.value ? -1 : (a.value > b.value ? 1 : 0);
+			case SORT_BY_COUNT:
+				return a.count < b.count ? -1 : (a.count > b.count ? 1 : 0);
+			default:
+				return a.kind < b.kind ? -1 : (a.kind > b.kind ? 1 : 0);
+		}
+	};
+
+	std::sort(issues.begin(), issues.end(), [&](const Issue& a, const Issue& b) {
+		const int order = compare(a, b);
+		if(order != 0)
+			return descending ? order > 0 : order < 0;
+		return byKind(a, b);
+	});
+}
+
+void MapIssues::remove(const std::function<bool(const Issue&)>& predicate)
+{
+	auto it = std::remove_if(issues.begin(), issues.end(), [&](const Issue& issue) {
+		if(!predicate(issue))
+			return false;
+		--counts[issue.kind];
+		return true;
+	});
+	issues.erase(it, issues.end());
+}
+
+void MapIssues::writeCsv(std::ostream& stream) const
+{
+	stream << "kind,x,y,z,value,count\n";
+	for(const Issue& issue : issues) {
+		stream << getKindName(issue.kind) << ","
+			<< issue.position.x << "," << issue.position.y << "," << issue.position.z << ","
+			<< issue.value << "," << issue.count << "\n";
+	}
+}
+
+const char* MapIssues::getKindName(Kind kind)
+{
+	switch(kind) {
+		case STACKED_ITEMS: return "stacked items";
+		case DUPLICATE_UNIQUE_ID: return "duplicate unique id";
+		case OVERLAPPING_SPAWN: return "overlapping spawn";
+		case HOUSE_TILE_NO_HOUSE: return "house tile without house";
+		case CLIENT_TILE_LIMIT: return "too many items";
+		default: return "unknown";
+	}
+}
+
+bool MapIssues::isIdentical(Item* item, Item* other)
+{
+	if(item->getID() != other->getID() || item->getSubtype() != other->getSubtype() ||
+			item->getActionID() != other->getActionID() || item->getUniqueID() != other->getUniqueID())
+		return false;
+
+	Container* container = item->getContainer();
+	Container* other_container = other->getContainer();
+	if((container && container->getItemCount() != 0) || (other_container && other_container->getItemCount() != 0))
+		return false;
+
+	Teleport* teleport = item->getTeleport();
+	Teleport* other_teleport = other->getTeleport();
+	if((teleport != nullptr) != (other_teleport != nullptr) || (teleport && teleport->getDestination() != other_teleport->getDestination()))
+		return false;
+
+	Door* door = item->getDoor();
+	Door* other_door = other->getDoor();
+	if((door != nullptr) != (other_door != nullptr) || (door && door->getDoorID() != other_door->getDoorID()))
+		return false;
+
+	Depot* depot = item->getDepot();
+	Depot* other_depot = other->getDepot();
+	if((depot != nullptr) != (other_depot != nullptr) || (depot && depot->getDepotID() != other_depot->getDepotID()))
+		return false;
+
+	return item->getText() == other->getText();
+}
+
+int64_t MapIssues::removeStackedItems(Tile* tile)
+{
+	int64_t removed = 0;
+	ItemVector& items = tile->items;
+	for(size_t i = 0; i < items.size(); ++i) {
+		for(auto it = items.begin() + i + 1; it != items.end(); ) {
+			if(isIdentical(items[i], *it)) {
+				delete *it;
+				it = items.erase(it);
+				++removed;
+			} else {
+				++it;
+			}
+		}
+	}
+	return removed;
+}
@@ -0,0 +1,95 @@
+//////////////////////////////////////////////////////////////////////
+// This file is part of Remere's Map Editor
+//////////////////////////////////////////////////////////////////////
+// Remere's Map Editor is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// Remere's Map Editor is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <http://www.gnu.org/licenses/>.
+//////////////////////////////////////////////////////////////////////
+
+#ifndef RME_MAP_ISSUES_H_
+#define RME_MAP_ISSUES_H_
+
+#include "position.h"
+
+#include <functional>
+#include <ostream>
+
+class MapTraversal;
+class Tile;
+class Item;
+
+// Finds duplicated and overlapping things in one pass over the map on all
+// cores: identical items stacked on a tile, unique ids used more than once,
+// spawns whose areas overlap, house tiles of houses that don't exist and
+// tiles holding more than the client shows. Every finding is one entry of
+// a flat array, which can be sorted and written as CSV.
+class MapIssues
+{
+public:
+	enum Kind : uint8_t {
+		STACKED_ITEMS,       // value: item id, count: copies on top of the first
+		DUPLICATE_UNIQUE_ID, // value: unique id, count: items using it
+		OVERLAPPING_SPAWN,   // value: spawn radius, count: spawns it overlaps
+		HOUSE_TILE_NO_HOUSE, // value: house id, count: 1
+		CLIENT_TILE_LIMIT,   // value: things the client doesn't show, count: things on the tile
+		KIND_COUNT
+	};
+
+	enum SortKey {
+		SORT_BY_KIND,
+		SORT_BY_POSITION,
+		SORT_BY_VALUE,
+		SORT_BY_COUNT
+	};
+
+	struct Issue {
+		Position position;
+		uint32_t value;
+		uint16_t count;
+		Kind kind;
+	};
+
+	MapIssues() = default;
+
+	// Looks at the tiles the traversal visits, the results of an earlier
+	// run are dropped. False if it was cancelled.
+	bool find(MapTraversal& traversal);
+
+	const std::vector<Issue>& getIssues() const noexcept { return issues; }
+	size_t size() const noexcept { return issues.size(); }
+	bool empty() const noexcept { return issues.empty(); }
+	const Issue& operator[](size_t index) const { return issues[index]; }
+	size_t getCount(Kind kind) const noexcept { return counts[kind]; }
+
+	// Ties are broken by kind, position and value
+	void sort(SortKey key, bool descending = false);
+	// Drops the issues for which predicate(issue) is true
+	void remove(const std::function<bool(const Issue&)>& predicate);
+
+	// One line per issue with a header line, in the current order
+	void writeCsv(std::ostream& stream) const;
+
+	static const char* getKindName(Kind kind);
+	// Same id, subtype, action id, unique id and text, and nothing inside
+	static bool isIdentical(Item* item, Item* other);
+	// Deletes the items identical to an item below them, how many were deleted
+	static int64_t removeStackedItems(Tile* tile);
+
+	// Things on a tile the client shows, ground and creature included
+	static constexpr int ClientTileLimit = 10;
+
+private:
+	std::vector<Issue> issues;
+	size_t counts[KIND_COUNT] = {};
+};
+
+#endif
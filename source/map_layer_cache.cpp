@@ -0,0 +1,113 @@
+//////////////////////////////////////////////////////////////////////
+// This file is part of Remere's Map Editor
+//////////////////////////////////////////////////////////////////////
+// Remere's Map Editor is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// Remere's Map Editor is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <http://www.gnu.org/licenses/>.
+//////////////////////////////////////////////////////////////////////
+
+#include "main.h"
+
+#include "map_layer_cache.h"
+#include "frame_profiler.h"
+
+MapLayerCache::MapLayerCache() :
+	texture(0),
+	width(0),
+	height(0),
+	valid(false)
+{
+	////
+}
+
+MapLayerCache::~MapLayerCache()
+{
+	clear();
+}
+
+void MapLayerCache::store(int x, int y, int copy_width, int copy_height, int canvas_width, int canvas_height)
+{
+	if(canvas_width <= 0 || canvas_height <= 0) {
+		valid = false;
+		return;
+	}
+
+	if(texture == 0) {
+		glGenTextures(1, &texture);
+		g_profiler.count(FrameProfiler::TEXTURES_CREATED);
+	}
+
+	glBindTexture(GL_TEXTURE_2D, texture);
+	if(width != canvas_width || height != canvas_height) {
+		// The canvas was resized, nothing of the old copy is usable
+		width = canvas_width;
+		height = canvas_height;
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, 0x812F); // GL_CLAMP_TO_EDGE
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, 0x812F); // GL_CLAMP_TO_EDGE
+		glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+		x = 0;
+		y = 0;
+		copy_width = width;
+		copy_height = height;
+	}
+
+	glCopyTexSubImage2D(GL_TEXTURE_2D, 0, x, y, x, y, copy_width, copy_height);
+	valid = true;
+}
+
+void MapLayerCache::restore() const
+{
+	if(!valid)
+		return;
+
+	// One texel per window pixel, so the copy comes back unfiltered
+	glMatrixMode(GL_PROJECTION);
+	glPushMatrix();
+	glLoadIdentity();
+	glOrtho(0, width, 0, height, -1, 1);
+	glMatrixMode(GL_MODELVIEW);
+	glPushMatrix();
+	glLoadIdentity();
+
+	g_profiler.count(FrameProfiler::TEXTURE_BINDS);
+	g_profiler.count(FrameProfiler::DRAW_CALLS);
+
+	glDisable(GL_BLEND);
+	glEnable(GL_TEXTURE_2D);
+	glBindTexture(GL_TEXTURE_2D, texture);
+	glColor4ub(255, 255, 255, 255);
+	glBegin(GL_QUADS);
+		glTexCoord2f(0.f, 0.f); glVertex2f(0, 0);
+		glTexCoord2f(1.f, 0.f); glVertex2f(width, 0);
+		glTexCoord2f(1.f, 1.f); glVertex2f(width, height);
+		glTexCoord2f(0.f, 1.f); glVertex2f(0, height);
+	glEnd();
+	glEnable(GL_BLEND);
+
+	glPopMatrix();
+	glMatrixMode(GL_PROJECTION);
+	glPopMatrix();
+	glMatrixMode(GL_MODELVIEW);
+}
+
+void MapLayerCache::clear()
+{
+	if(texture != 0) {
+		glDeleteTextures(1, &texture);
+		texture = 0;
+	}
+	width = 0;
+	height = 0;
+	valid = false;
+}
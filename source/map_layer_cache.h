@@ -0,0 +1,51 @@
+//////////////////////////////////////////////////////////////////////
+// This file is part of Remere's Map Editor
+//////////////////////////////////////////////////////////////////////
+// Remere's Map Editor is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// Remere's Map Editor is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <http://www.gnu.org/licenses/>.
+//////////////////////////////////////////////////////////////////////
+
+#ifndef RME_MAP_LAYER_CACHE_H_
+#define RME_MAP_LAYER_CACHE_H_
+
+// Keeps a copy of the map layers of the last drawn frame in a texture the
+// size of the canvas. Frames where only the overlays changed (cursor, brush
+// preview, selection box) put it back on screen with a single quad instead
+// of drawing the map again. Rectangles are in window pixels with the origin
+// at the bottom left, as GL reads them.
+class MapLayerCache
+{
+public:
+	MapLayerCache();
+	~MapLayerCache();
+
+	MapLayerCache(const MapLayerCache&) = delete;
+	MapLayerCache& operator=(const MapLayerCache&) = delete;
+
+	bool isValid() const noexcept { return valid; }
+	void invalidate() noexcept { valid = false; }
+
+	// Copies the given part of the back buffer, the whole canvas the first time
+	void store(int x, int y, int width, int height, int canvas_width, int canvas_height);
+	// Draws the cached frame over the whole viewport
+	void restore() const;
+	void clear();
+
+private:
+	GLuint texture;
+	int width;
+	int height;
+	bool valid;
+};
+
+#endif
@@ -0,0 +1,244 @@
+//////////////////////////////////////////////////////////////////////
+// This file is part of Remere's Map Editor
+//////////////////////////////////////////////////////////////////////
+// Remere's Map Editor is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// Remere's Map Editor is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <http://www.gnu.org/licenses/>.
+//////////////////////////////////////////////////////////////////////
+
+#include "main.h"
+
+#include "map_query.h"
+#include "map_traversal.h"
+#include "complexitem.h"
+#include "items.h"
+
+MapQuery::MapQuery() :
+	properties(0),
+	use_text(false),
+	house_id(0),
+	use_house(false),
+	zones(0),
+	use_area(false),
+	selection(nullptr),
+	use_ids(false)
+{
+	////
+}
+
+void MapQuery::setItemIds(uint16_t from, uint16_t to)
+{
+	item_ids.from = std::min(from, to);
+	item_ids.to = std::max(from, to);
+	item_ids.set = true;
+}
+
+void MapQuery::setActionIds(uint16_t from, uint16_t to)
+{
+	action_ids.from = std::min(from, to);
+	action_ids.to = std::max(from, to);
+	action_ids.set = true;
+}
+
+void MapQuery::setUniqueIds(uint16_t from, uint16_t to)
+{
+	unique_ids.from = std::min(from, to);
+	unique_ids.to = std::max(from, to);
+	unique_ids.set = true;
+}
+
+bool MapQuery::setText(const std::string& pattern, std::string& error)
+{
+	try {
+		text = std::regex(pattern, std::regex::ECMAScript | std::regex::icase | std::regex::optimize);
+	} catch(const std::regex_error& e) {
+		error = e.what();
+		return false;
+	}
+	use_text = true;
+	return true;
+}
+
+void MapQuery::setHouse(uint32_t id)
+{
+	house_id = id;
+	use_house = true;
+}
+
+void MapQuery::setArea(const Position& from, const Position& to)
+{
+	area_from = from;
+	area_to = to;
+	use_area = true;
+}
+
+bool MapQuery::hasConditions() const noexcept
+{
+	return item_ids.set || properties != 0 || action_ids.set || unique_ids.set ||
+		use_text || use_house || zones != 0;
+}
+
+bool MapQuery::hasProperties(const ItemType& type) const
+{
+	return !(((properties & PROPERTY_UNPASSABLE) && !type.unpassable) ||
+		((properties & PROPERTY_UNMOVABLE) && type.moveable) ||
+		((properties & PROPERTY_BLOCK_MISSILES) && !type.blockMissiles) ||
+		((properties & PROPERTY_BLOCK_PATHFINDER) && !type.blockPathfinder) ||
+		((properties & PROPERTY_READABLE) && !type.canReadText) ||
+		((properties & PROPERTY_WRITEABLE) && !type.canWriteText) ||
+		((properties & PROPERTY_PICKUPABLE) && !type.pickupable) ||
+		((properties & PROPERTY_STACKABLE) && !type.stackable) ||
+		((properties & PROPERTY_ROTATABLE) && !type.rotable) ||
+		((properties & PROPERTY_HANGABLE) && !type.isHangable) ||
+		((properties & PROPERTY_HOOK_EAST) && !type.hookEast) ||
+		((properties & PROPERTY_HOOK_SOUTH) && !type.hookSouth) ||
+		((properties & PROPERTY_HAS_ELEVATION) && !type.hasElevation) ||
+		((properties & PROPERTY_IGNORE_LOOK) && !type.ignoreLook) ||
+		((properties & PROPERTY_FLOOR_CHANGE) && !type.isFloorChange()) ||
+		((properties & PROPERTY_CONTAINER) && !type.isContainer()) ||
+		((properties & PROPERTY_DOOR) && !type.isDoor()) ||
+		((properties & PROPERTY_TELEPORT) && !type.isTeleport()) ||
+		((properties & PROPERTY_DEPOT) && !type.isDepot()));
+}
+
+bool MapQuery::prepareIds()
+{
+	ids.clear();
+	matching_ids.clear();
+	use_ids = item_ids.set || properties != 0;
+	if(!use_ids)
+		return true;
+
+	ids.assign(g_items.getMaxID() + 1, 0);
+	for(int id = g_items.getMinID(); id <= g_items.getMaxID(); ++id) {
+		if(item_ids.set && (id < item_ids.from || id > item_ids.to))
+			continue;
+
+		const ItemType& type = g_items.getItemType(id);
+		if(type.id == 0 || !hasProperties(type))
+			continue;
+
+		ids[id] = 1;
+		matching_ids.push_back(uint16_t(id));
+	}
+	return !matching_ids.empty();
+}
+
+bool MapQuery::mayMatch(const LeafSummary& summary) const
+{
+	if(use_house && summary.house_tiles == 0)
+		return false;
+	if((summary.map_flags & zones) != zones)
+		return false;
+	if(use_ids && matching_ids.size() <= MaxFilteredIds) {
+		return std::any_of(matching_ids.begin(), matching_ids.end(), [&summary](uint16_t id) {
+			return summary.mayContain(id);
+		});
+	}
+	return true;
+}
+
+bool MapQuery::matchesTile(const Tile* tile) const
+{
+	if(use_house) {
+		uint32_t id = tile->getHouseID();
+		if(id == 0 || (house_id != 0 && id != house_id))
+			return false;
+	}
+	return (tile->getMapFlags() & zones) == zones;
+}
+
+bool MapQuery::matchesItem(Item* item) const
+{
+	const uint16_t id = item->getID();
+	if(use_ids && (id >= ids.size() || !ids[id]))
+		return false;
+
+	if(action_ids.set) {
+		uint16_t action_id = item->getActionID();
+		if(action_id == 0 || action_id < action_ids.from || action_id > action_ids.to)
+			return false;
+	}
+
+	if(unique_ids.set) {
+		uint16_t unique_id = item->getUniqueID();
+		if(unique_id == 0 || unique_id < unique_ids.from || unique_id > unique_ids.to)
+			return false;
+	}
+
+	if(use_text) {
+		// Regular expressions hold no state while matching, all threads share it
+		const std::string item_text = item->getText();
+		if(item_text.empty() || !std::regex_search(item_text, text))
+			return false;
+	}
+	return true;
+}
+
+void MapQuery::visit(Results& results, Tile* tile, Item* item) const
+{
+	if(matchesItem(item))
+		results.emplace_back(tile, item);
+
+	if(Container* container = item->getContainer()) {
+		for(Item* content : container->getVector()) {
+			visit(results, tile, content);
+		}
+	}
+}
+
+bool MapQuery::run(Map& map, const std::function<bool(const Results&)>& found, const std::function<bool(int)>& progress)
+{
+	if(!prepareIds())
+		return true;
+
+	MapTraversal traversal(map);
+	if(selection)
+		traversal.setSelection(*selection);
+	if(use_area)
+		traversal.setArea(area_from, area_to);
+
+	// The index lists tiles for single ids, a few of them are still fewer
+	// tiles than the whole map
+	if(use_ids && matching_ids.size() <= MaxIndexedIds) {
+		for(uint16_t id : matching_ids) {
+			traversal.useItemIndex(ItemIndex::ITEM_ID, id);
+		}
+	} else if(unique_ids.set) {
+		traversal.useItemIndex(ItemIndex::UNIQUE_ID);
+	} else if(action_ids.set) {
+		traversal.useItemIndex(ItemIndex::ACTION_ID);
+	}
+
+	traversal.setLeafFilter([this](const LeafSummary& summary) { return mayMatch(summary); });
+	traversal.setProgress([&traversal, &progress](int done) {
+		if(!progress(done))
+			traversal.cancel();
+	});
+
+	Results unused;
+	return traversal.forEachTile(unused,
+		[this](Results& chunk, Tile* tile) {
+			if(!matchesTile(tile))
+				return;
+
+			if(tile->ground)
+				visit(chunk, tile, tile->ground);
+			for(Item* item : tile->items) {
+				visit(chunk, tile, item);
+			}
+		},
+		[&traversal, &found](Results&, Results& chunk) {
+			if(!chunk.empty() && !traversal.isCancelled() && !found(chunk))
+				traversal.cancel();
+		});
+}
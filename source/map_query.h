@@ -0,0 +1,131 @@
+//////////////////////////////////////////////////////////////////////
+// This file is part of Remere's Map Editor
+//////////////////////////////////////////////////////////////////////
+// Remere's Map Editor is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// Remere's Map Editor is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <http://www.gnu.org/licenses/>.
+//////////////////////////////////////////////////////////////////////
+
+#ifndef RME_MAP_QUERY_H_
+#define RME_MAP_QUERY_H_
+
+#include "position.h"
+
+#include <functional>
+#include <regex>
+
+class Map;
+class Selection;
+class Tile;
+class Item;
+class ItemType;
+struct LeafSummary;
+
+// Finds the items matching every condition that is set, in one pass over
+// the map. Conditions on the item type are turned into a table of matching
+// ids before the map is read, conditions on the tile are checked once for
+// all of its items, and the item index, the area and the summaries of the
+// quad tree leaves keep the tiles that cannot match from being read at all.
+class MapQuery
+{
+public:
+	enum Property : uint32_t {
+		PROPERTY_UNPASSABLE = 1 << 0,
+		PROPERTY_UNMOVABLE = 1 << 1,
+		PROPERTY_BLOCK_MISSILES = 1 << 2,
+		PROPERTY_BLOCK_PATHFINDER = 1 << 3,
+		PROPERTY_READABLE = 1 << 4,
+		PROPERTY_WRITEABLE = 1 << 5,
+		PROPERTY_PICKUPABLE = 1 << 6,
+		PROPERTY_STACKABLE = 1 << 7,
+		PROPERTY_ROTATABLE = 1 << 8,
+		PROPERTY_HANGABLE = 1 << 9,
+		PROPERTY_HOOK_EAST = 1 << 10,
+		PROPERTY_HOOK_SOUTH = 1 << 11,
+		PROPERTY_HAS_ELEVATION = 1 << 12,
+		PROPERTY_IGNORE_LOOK = 1 << 13,
+		PROPERTY_FLOOR_CHANGE = 1 << 14,
+		PROPERTY_CONTAINER = 1 << 15,
+		PROPERTY_DOOR = 1 << 16,
+		PROPERTY_TELEPORT = 1 << 17,
+		PROPERTY_DEPOT = 1 << 18,
+	};
+
+	using Results = std::vector<std::pair<Tile*, Item*>>;
+
+	MapQuery();
+
+	void setItemIds(uint16_t from, uint16_t to);
+	// Items need all of these properties
+	void setProperties(uint32_t new_properties) noexcept { properties = new_properties; }
+	void setActionIds(uint16_t from, uint16_t to);
+	void setUniqueIds(uint16_t from, uint16_t to);
+	// Case insensitive regular expression, false if it doesn't compile
+	bool setText(const std::string& pattern, std::string& error);
+	// Tiles of the house, any house for 0
+	void setHouse(uint32_t id);
+	// Tiles need all of these zone flags (TILESTATE_PROTECTIONZONE, ...)
+	void setZones(uint16_t flags) noexcept { zones = flags; }
+	void setArea(const Position& from, const Position& to);
+	void setSelection(const Selection* new_selection) noexcept { selection = new_selection; }
+
+	bool hasConditions() const noexcept;
+
+	// Calls found with what every batch of chunks turned up as soon as it
+	// is merged, on this thread and in map order, so results can be shown
+	// while the rest of the map is read. Stops once found or progress
+	// return false, and returns false then.
+	bool run(Map& map, const std::function<bool(const Results&)>& found, const std::function<bool(int)>& progress);
+
+	// Ids of the item index used to narrow the search, more than this are
+	// searched for on the whole map
+	static constexpr size_t MaxIndexedIds = 32;
+	// Ids looked up in the summaries of the leaves, more than this don't
+	// rule out enough leaves to pay for the lookups
+	static constexpr size_t MaxFilteredIds = 256;
+
+private:
+	struct Range {
+		uint16_t from = 0;
+		uint16_t to = 0;
+		bool set = false;
+	};
+
+	bool hasProperties(const ItemType& type) const;
+	// Fills the table of item ids whose type matches, false if none does
+	bool prepareIds();
+	bool mayMatch(const LeafSummary& summary) const;
+	bool matchesTile(const Tile* tile) const;
+	bool matchesItem(Item* item) const;
+	void visit(Results& results, Tile* tile, Item* item) const;
+
+	Range item_ids;
+	Range action_ids;
+	Range unique_ids;
+	uint32_t properties;
+	std::regex text;
+	bool use_text;
+	uint32_t house_id;
+	bool use_house;
+	uint16_t zones;
+	Position area_from;
+	Position area_to;
+	bool use_area;
+	const Selection* selection;
+
+	// Indexed by item id, only used when item ids or properties are set
+	std::vector<uint8_t> ids;
+	std::vector<uint16_t> matching_ids;
+	bool use_ids;
+};
+
+#endif
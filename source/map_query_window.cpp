@@ -0,0 +1,261 @@
+//////////////////////////////////////////////////////////////////////
+// This file is part of Remere's Map Editor
+//////////////////////////////////////////////////////////////////////
+// Remere's Map Editor is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// Remere's Map Editor is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <http://www.gnu.org/licenses/>.
+//////////////////////////////////////////////////////////////////////
+
+#include "main.h"
+
+#include "map_query_window.h"
+#include "map_query.h"
+#include "positionctrl.h"
+#include "gui.h"
+#include "items.h"
+#include "tile.h"
+
+namespace {
+	struct PropertyName {
+		const char* name;
+		uint32_t property;
+	};
+
+	const PropertyName propertyNames[] = {
+		{ "Unpassable", MapQuery::PROPERTY_UNPASSABLE },
+		{ "Unmovable", MapQuery::PROPERTY_UNMOVABLE },
+		{ "Block Missiles", MapQuery::PROPERTY_BLOCK_MISSILES },
+		{ "Block Pathfinder", MapQuery::PROPERTY_BLOCK_PATHFINDER },
+		{ "Readable", MapQuery::PROPERTY_READABLE },
+		{ "Writeable", MapQuery::PROPERTY_WRITEABLE },
+		{ "Pickupable", MapQuery::PROPERTY_PICKUPABLE },
+		{ "Stackable", MapQuery::PROPERTY_STACKABLE },
+		{ "Rotatable", MapQuery::PROPERTY_ROTATABLE },
+		{ "Hangable", MapQuery::PROPERTY_HANGABLE },
+		{ "Hook East", MapQuery::PROPERTY_HOOK_EAST },
+		{ "Hook South", MapQuery::PROPERTY_HOOK_SOUTH },
+		{ "Has Elevation", MapQuery::PROPERTY_HAS_ELEVATION },
+		{ "Ignore Look", MapQuery::PROPERTY_IGNORE_LOOK },
+		{ "Floor Change", MapQuery::PROPERTY_FLOOR_CHANGE },
+		{ "Container", MapQuery::PROPERTY_CONTAINER },
+		{ "Door", MapQuery::PROPERTY_DOOR },
+		{ "Teleport", MapQuery::PROPERTY_TELEPORT },
+		{ "Depot", MapQuery::PROPERTY_DEPOT },
+	};
+
+	wxSpinCtrl* newSpin(wxWindow* parent, int min, int max, int value)
+	{
+		wxSpinCtrl* spin = newd wxSpinCtrl(parent, wxID_ANY, wxEmptyString, wxDefaultPosition, wxSize(80, -1), wxSP_ARROW_KEYS, min, max, value);
+		spin->Enable(false);
+		return spin;
+	}
+
+	void addRange(wxWindow* parent, wxSizer* sizer, wxCheckBox* checkbox, wxSpinCtrl* from, wxSpinCtrl* to)
+	{
+		wxBoxSizer* range_sizer = newd wxBoxSizer(wxHORIZONTAL);
+		range_sizer->Add(checkbox, 1, wxALIGN_CENTER_VERTICAL);
+		range_sizer->Add(from, 0, wxLEFT, 5);
+		range_sizer->Add(newd wxStaticText(parent, wxID_ANY, "to"), 0, wxALIGN_CENTER_VERTICAL | wxLEFT | wxRIGHT, 5);
+		range_sizer->Add(to, 0);
+		sizer->Add(range_sizer, 0, wxALL | wxEXPAND, 5);
+	}
+}
+
+MapQueryDialog::MapQueryDialog(wxWindow* parent, const Position& center, bool hasSelection) :
+	wxDialog(parent, wxID_ANY, "Find by Query", wxDefaultPosition, wxDefaultSize, wxDEFAULT_DIALOG_STYLE)
+{
+	wxBoxSizer* sizer = newd wxBoxSizer(wxVERTICAL);
+
+	// --------------- Items ---------------
+
+	wxStaticBoxSizer* items_sizer = newd wxStaticBoxSizer(wxVERTICAL, this, "Items");
+	wxWindow* items_box = items_sizer->GetStaticBox();
+
+	item_ids_checkbox = newd wxCheckBox(items_box, wxID_ANY, "Server IDs");
+	item_from_spin = newSpin(items_box, g_items.getMinID(), g_items.getMaxID(), g_items.getMinID());
+	item_to_spin = newSpin(items_box, g_items.getMinID(), g_items.getMaxID(), g_items.getMaxID());
+	addRange(items_box, items_sizer, item_ids_checkbox, item_from_spin, item_to_spin);
+
+	wxGridSizer* properties_sizer = newd wxGridSizer(3, 2, 10);
+	for(const PropertyName& property : propertyNames) {
+		wxCheckBox* checkbox = newd wxCheckBox(items_box, wxID_ANY, property.name);
+		properties_sizer->Add(checkbox);
+		property_boxes.push_back({ checkbox, property.property });
+	}
+	items_sizer->Add(properties_sizer, 0, wxALL | wxEXPAND, 5);
+	sizer->Add(items_sizer, 0, wxALL | wxEXPAND, 5);
+
+	// --------------- Attributes ---------------
+
+	wxStaticBoxSizer* attributes_sizer = newd wxStaticBoxSizer(wxVERTICAL, this, "Attributes");
+	wxWindow* attributes_box = attributes_sizer->GetStaticBox();
+
+	action_ids_checkbox = newd wxCheckBox(attributes_box, wxID_ANY, "Action IDs");
+	action_from_spin = newSpin(attributes_box, 1, rme::MaxActionId, rme::MinActionId);
+	action_to_spin = newSpin(attributes_box, 1, rme::MaxActionId, rme::MaxActionId);
+	addRange(attributes_box, attributes_sizer, action_ids_checkbox, action_from_spin, action_to_spin);
+
+	unique_ids_checkbox = newd wxCheckBox(attributes_box, wxID_ANY, "Unique IDs");
+	unique_from_spin = newSpin(attributes_box, 1, rme::MaxUniqueId, rme::MinUniqueId);
+	unique_to_spin = newSpin(attributes_box, 1, rme::MaxUniqueId, rme::MaxUniqueId);
+	addRange(attributes_box, attributes_sizer, unique_ids_checkbox, unique_from_spin, unique_to_spin);
+
+	wxBoxSizer* text_sizer = newd wxBoxSizer(wxHORIZONTAL);
+	text_sizer->Add(newd wxStaticText(attributes_box, wxID_ANY, "Text"), 1, wxALIGN_CENTER_VERTICAL);
+	text_input = newd wxTextCtrl(attributes_box, wxID_ANY, wxEmptyString, wxDefaultPosition, wxSize(200, -1));
+	text_input->SetToolTip("Regular expression the text of the item has to contain, not case sensitive. Leave empty to not check the text.");
+	text_sizer->Add(text_input, 0, wxLEFT, 5);
+	attributes_sizer->Add(text_sizer, 0, wxALL | wxEXPAND, 5);
+	sizer->Add(attributes_sizer, 0, wxALL | wxEXPAND, 5);
+
+	// --------------- Tiles ---------------
+
+	wxStaticBoxSizer* tiles_sizer = newd wxStaticBoxSizer(wxVERTICAL, this, "Tiles");
+	wxWindow* tiles_box = tiles_sizer->GetStaticBox();
+
+	wxBoxSizer* house_sizer = newd wxBoxSizer(wxHORIZONTAL);
+	house_checkbox = newd wxCheckBox(tiles_box, wxID_ANY, "House ID (0 for any house)");
+	house_sizer->Add(house_checkbox, 1, wxALIGN_CENTER_VERTICAL);
+	house_spin = newSpin(tiles_box, 0, 0xFFFFFF, 0);
+	house_sizer->Add(house_spin, 0, wxLEFT, 5);
+	tiles_sizer->Add(house_sizer, 0, wxALL | wxEXPAND, 5);
+
+	wxGridSizer* zones_sizer = newd wxGridSizer(4, 2, 10);
+	pz_checkbox = newd wxCheckBox(tiles_box, wxID_ANY, "PZ");
+	zones_sizer->Add(pz_checkbox);
+	nopvp_checkbox = newd wxCheckBox(tiles_box, wxID_ANY, "No PvP");
+	zones_sizer->Add(nopvp_checkbox);
+	nologout_checkbox = newd wxCheckBox(tiles_box, wxID_ANY, "No Logout");
+	zones_sizer->Add(nologout_checkbox);
+	pvpzone_checkbox = newd wxCheckBox(tiles_box, wxID_ANY, "PvP Zone");
+	zones_sizer->Add(pvpzone_checkbox);
+	tiles_sizer->Add(zones_sizer, 0, wxALL | wxEXPAND, 5);
+	sizer->Add(tiles_sizer, 0, wxALL | wxEXPAND, 5);
+
+	// --------------- Area ---------------
+
+	wxStaticBoxSizer* area_sizer = newd wxStaticBoxSizer(wxVERTICAL, this, "Area");
+	wxWindow* area_box = area_sizer->GetStaticBox();
+
+	area_checkbox = newd wxCheckBox(area_box, wxID_ANY, "Only between these positions");
+	area_sizer->Add(area_checkbox, 0, wxALL, 5);
+	wxBoxSizer* positions_sizer = newd wxBoxSizer(wxHORIZONTAL);
+	area_from_ctrl = newd PositionCtrl(area_box, "From", std::max(center.x - 50, 0), std::max(center.y - 50, 0), center.z);
+	positions_sizer->Add(area_from_ctrl, 1, wxRIGHT, 5);
+	area_to_ctrl = newd PositionCtrl(area_box, "To", center.x + 50, center.y + 50, center.z);
+	positions_sizer->Add(area_to_ctrl, 1);
+	area_sizer->Add(positions_sizer, 0, wxALL | wxEXPAND, 5);
+
+	selection_checkbox = newd wxCheckBox(area_box, wxID_ANY, "Only on the selected area");
+	selection_checkbox->SetValue(hasSelection);
+	selection_checkbox->Enable(hasSelection);
+	area_sizer->Add(selection_checkbox, 0, wxALL, 5);
+	sizer->Add(area_sizer, 0, wxALL | wxEXPAND, 5);
+
+	sizer->Add(CreateStdDialogButtonSizer(wxOK | wxCANCEL), 0, wxALL | wxALIGN_CENTER, 5);
+
+	SetSizerAndFit(sizer);
+	Centre(wxBOTH);
+	UpdateWidgets();
+
+	item_ids_checkbox->Bind(wxEVT_CHECKBOX, &MapQueryDialog::OnToggle, this);
+	action_ids_checkbox->Bind(wxEVT_CHECKBOX, &MapQueryDialog::OnToggle, this);
+	unique_ids_checkbox->Bind(wxEVT_CHECKBOX, &MapQueryDialog::OnToggle, this);
+	house_checkbox->Bind(wxEVT_CHECKBOX, &MapQueryDialog::OnToggle, this);
+	area_checkbox->Bind(wxEVT_CHECKBOX, &MapQueryDialog::OnToggle, this);
+	Bind(wxEVT_BUTTON, &MapQueryDialog::OnClickOK, this, wxID_OK);
+}
+
+bool MapQueryDialog::BuildQuery(MapQuery& query, wxString& error) const
+{
+	if(item_ids_checkbox->GetValue())
+		query.setItemIds(item_from_spin->GetValue(), item_to_spin->GetValue());
+
+	uint32_t properties = 0;
+	for(const PropertyBox& box : property_boxes) {
+		if(box.checkbox->GetValue())
+			properties |= box.property;
+	}
+	query.setProperties(properties);
+
+	if(action_ids_checkbox->GetValue())
+		query.setActionIds(action_from_spin->GetValue(), action_to_spin->GetValue());
+	if(unique_ids_checkbox->GetValue())
+		query.setUniqueIds(unique_from_spin->GetValue(), unique_to_spin->GetValue());
+
+	const std::string pattern = nstr(text_input->GetValue());
+	if(!pattern.empty()) {
+		std::string message;
+		if(!query.setText(pattern, message)) {
+			error = "The text is not a valid regular expression: " + wxstr(message);
+			return false;
+		}
+	}
+
+	if(house_checkbox->GetValue())
+		query.setHouse(house_spin->GetValue());
+
+	uint16_t zones = 0;
+	if(pz_checkbox->GetValue())
+		zones |= TILESTATE_PROTECTIONZONE;
+	if(nopvp_checkbox->GetValue())
+		zones |= TILESTATE_NOPVP;
+	if(nologout_checkbox->GetValue())
+		zones |= TILESTATE_NOLOGOUT;
+	if(pvpzone_checkbox->GetValue())
+		zones |= TILESTATE_PVPZONE;
+	query.setZones(zones);
+
+	if(area_checkbox->GetValue())
+		query.setArea(area_from_ctrl->GetPosition(), area_to_ctrl->GetPosition());
+
+	if(!query.hasConditions()) {
+		error = "Choose at least one condition on the items or tiles to find.";
+		return false;
+	}
+	return true;
+}
+
+bool MapQueryDialog::IsSelectionOnly() const
+{
+	return selection_checkbox->GetValue();
+}
+
+void MapQueryDialog::UpdateWidgets()
+{
+	item_from_spin->Enable(item_ids_checkbox->GetValue());
+	item_to_spin->Enable(item_ids_checkbox->GetValue());
+	action_from_spin->Enable(action_ids_checkbox->GetValue());
+	action_to_spin->Enable(action_ids_checkbox->GetValue());
+	unique_from_spin->Enable(unique_ids_checkbox->GetValue());
+	unique_to_spin->Enable(unique_ids_checkbox->GetValue());
+	house_spin->Enable(house_checkbox->GetValue());
+	area_from_ctrl->Enable(area_checkbox->GetValue());
+	area_to_ctrl->Enable(area_checkbox->GetValue());
+}
+
+void MapQueryDialog::OnToggle(wxCommandEvent& WXUNUSED(event))
+{
+	UpdateWidgets();
+}
+
+void MapQueryDialog::OnClickOK(wxCommandEvent& event)
+{
+	// Checked here so the dialog stays open on mistakes
+	MapQuery query;
+	wxString error;
+	if(!BuildQuery(query, error)) {
+		g_gui.PopupDialog(this, "Find by Query", error, wxOK);
+		return;
+	}
+	event.Skip();
+}
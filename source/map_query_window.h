@@ -0,0 +1,73 @@
+//////////////////////////////////////////////////////////////////////
+// This file is part of Remere's Map Editor
+//////////////////////////////////////////////////////////////////////
+// Remere's Map Editor is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// Remere's Map Editor is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <http://www.gnu.org/licenses/>.
+//////////////////////////////////////////////////////////////////////
+
+#ifndef RME_MAP_QUERY_WINDOW_H_
+#define RME_MAP_QUERY_WINDOW_H_
+
+#include "main.h"
+
+#include <wx/spinctrl.h>
+
+class MapQuery;
+class PositionCtrl;
+
+class MapQueryDialog : public wxDialog
+{
+public:
+	MapQueryDialog(wxWindow* parent, const Position& center, bool hasSelection);
+
+	// False with a message if a condition is invalid
+	bool BuildQuery(MapQuery& query, wxString& error) const;
+	bool IsSelectionOnly() const;
+
+private:
+	struct PropertyBox {
+		wxCheckBox* checkbox;
+		uint32_t property;
+	};
+
+	void UpdateWidgets();
+	void OnToggle(wxCommandEvent& event);
+	void OnClickOK(wxCommandEvent& event);
+
+	wxCheckBox* item_ids_checkbox;
+	wxSpinCtrl* item_from_spin;
+	wxSpinCtrl* item_to_spin;
+	std::vector<PropertyBox> property_boxes;
+
+	wxCheckBox* action_ids_checkbox;
+	wxSpinCtrl* action_from_spin;
+	wxSpinCtrl* action_to_spin;
+	wxCheckBox* unique_ids_checkbox;
+	wxSpinCtrl* unique_from_spin;
+	wxSpinCtrl* unique_to_spin;
+	wxTextCtrl* text_input;
+
+	wxCheckBox* house_checkbox;
+	wxSpinCtrl* house_spin;
+	wxCheckBox* pz_checkbox;
+	wxCheckBox* nopvp_checkbox;
+	wxCheckBox* nologout_checkbox;
+	wxCheckBox* pvpzone_checkbox;
+
+	wxCheckBox* area_checkbox;
+	PositionCtrl* area_from_ctrl;
+	PositionCtrl* area_to_ctrl;
+	wxCheckBox* selection_checkbox;
+};
+
+#endif
@@ -0,0 +1,328 @@
+//////////////////////////////////////////////////////////////////////
+// This file is part of Remere's Map Editor
+//////////////////////////////////////////////////////////////////////
+// Remere's Map Editor is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// Remere's Map Editor is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <http://www.gnu.org/licenses/>.
+//////////////////////////////////////////////////////////////////////
+
+#include "main.h"
+
+#include "map_reachability.h"
+#include "map_traversal.h"
+#include "complexitem.h"
+#include "worker_pool.h"
+
+namespace {
+	bool hasFloorChangeDown(const Tile* tile)
+	{
+		if(tile->ground && g_items.getItemType(tile->ground->getID()).floorChangeDown)
+			return true;
+		for(const Item* item : tile->items) {
+			if(g_items.getItemType(item->getID()).floorChangeDown)
+				return true;
+		}
+		return false;
+	}
+}
+
+MapReachability::MapReachability(Map& map) :
+	map(map),
+	reached_count(0)
+{
+	////
+}
+
+void MapReachability::addStart(const Position& position)
+{
+	frontier.push_back(position);
+}
+
+bool MapReachability::addTemples()
+{
+	bool found = false;
+	for(const auto& entry : map.towns) {
+		const Position& position = entry.second->getTemplePosition();
+		if(position.isValid()) {
+			addStart(position);
+			found = true;
+		}
+	}
+	return found;
+}
+
+bool MapReachability::isMarked(const BitMap& bits, const Position& position)
+{
+	auto it = bits.find(getKey(position.x, position.y));
+	if(it == bits.end())
+		return false;
+
+	const int bit = getBit(position.x, position.y, position.z);
+	return (it->second[bit >> 6] >> (bit & 63)) & 1;
+}
+
+bool MapReachability::mark(BitMap& bits, const Position& position)
+{
+	Bits& leaf = bits[getKey(position.x, position.y)];
+	const int bit = getBit(position.x, position.y, position.z);
+	const uint64_t mask = uint64_t(1) << (bit & 63);
+	if(leaf[bit >> 6] & mask)
+		return false;
+
+	leaf[bit >> 6] |= mask;
+	return true;
+}
+
+bool MapReachability::isWalkable(const Tile* tile) const
+{
+	if(!tile)
+		return false;
+	if(!tile->isBlocking())
+		return true;
+
+	// Closed doors block the tile, but players open them
+	if(tile->ground && tile->ground->isBlocking())
+		return false;
+
+	bool door = false;
+	for(const Item* item : tile->items) {
+		if(item->isBlocking()) {
+			if(!item->isDoor())
+				return false;
+			door = true;
+		}
+	}
+	return door;
+}
+
+void MapReachability::addIfWalkable(int x, int y, int z, const BitMap& marked, PositionVector& next) const
+{
+	if(x < 0 || x > rme::MapMaxWidth || y < 0 || y > rme::MapMaxHeight || z < 0 || z > rme::MapMaxLayer)
+		return;
+
+	const Position position(x, y, z);
+	if(!isMarked(marked, position) && isWalkable(map.getTile(position)))
+		next.push_back(position);
+}
+
+void MapReachability::expand(const Tile* tile, const BitMap& marked, PositionVector& next) const
+{
+	const Position& position = tile->getPosition();
+	for(int y = -1; y <= 1; ++y) {
+		for(int x = -1; x <= 1; ++x) {
+			if(x != 0 || y != 0)
+				addIfWalkable(position.x + x, position.y + y, position.z, marked, next);
+		}
+	}
+
+	bool down = false;
+	auto visit = [&](Item* item) {
+		const ItemType& type = g_items.getItemType(item->getID());
+		down |= type.floorChangeDown;
+
+		// Stairs and ramps lead one floor up, one step in their direction
+		if(position.z > 0) {
+			if(type.floorChangeNorth)
+				addIfWalkable(position.x, position.y - 1, position.z - 1, marked, next);
+			if(type.floorChangeSouth)
+				addIfWalkable(position.x, position.y + 1, position.z - 1, marked, next);
+			if(type.floorChangeEast)
+				addIfWalkable(position.x + 1, position.y, position.z - 1, marked, next);
+			if(type.floorChangeWest)
+				addIfWalkable(position.x - 1, position.y, position.z - 1, marked, next);
+		}
+
+		if(Teleport* teleport = item->getTeleport()) {
+			const Position& destination = teleport->getDestination();
+			if(destination.isValid())
+				addIfWalkable(destination.x, destination.y, destination.z, marked, next);
+		}
+	};
+	if(tile->ground)
+		visit(tile->ground);
+	for(Item* item : tile->items) {
+		visit(item);
+	}
+
+	// Holes and stairs down drop players onto the floor below, they get
+	// pushed off the tile they land on
+	if(down && position.z < rme::MapMaxLayer) {
+		for(int y = -1; y <= 1; ++y) {
+			for(int x = -1; x <= 1; ++x) {
+				addIfWalkable(position.x + x, position.y + y, position.z + 1, marked, next);
+			}
+		}
+	}
+
+	// Ladders and rope spots lie below a hole and lead next to it
+	if(position.z > 0) {
+		const Tile* above = map.getTile(position.x, position.y, position.z - 1);
+		if(above && hasFloorChangeDown(above)) {
+			for(int y = -1; y <= 1; ++y) {
+				for(int x = -1; x <= 1; ++x) {
+					if(x != 0 || y != 0)
+						addIfWalkable(position.x + x, position.y + y, position.z - 1, marked, next);
+				}
+			}
+		}
+	}
+}
+
+bool MapReachability::run(const std::function<bool(int)>& progress)
+{
+	PositionVector start;
+	start.swap(frontier);
+	for(const Position& position : start) {
+		if(isWalkable(map.getTile(position)) && mark(reached, position)) {
+			frontier.push_back(position);
+			++reached_count;
+		}
+	}
+
+	// Every step is expanded on the worker threads, which only read the
+	// reached tiles, and marked here
+	WorkerPool& pool = WorkerPool::getInstance();
+	const uint64_t tile_count = std::max<uint64_t>(map.getTileCount(), 1);
+	std::vector<PositionVector> found;
+	while(!frontier.empty()) {
+		const size_t chunks = (frontier.size() + PositionsPerChunk - 1) / PositionsPerChunk;
+		found.assign(chunks, PositionVector());
+		pool.run(chunks, [this, &found](size_t chunk) {
+			PositionVector& next = found[chunk];
+			const size_t end = std::min(frontier.size(), (chunk + 1) * PositionsPerChunk);
+			for(size_t i = chunk * PositionsPerChunk; i < end; ++i) {
+				if(const Tile* tile = map.getTile(frontier[i]))
+					expand(tile, reached, next);
+			}
+		});
+
+		frontier.clear();
+		for(const PositionVector& next : found) {
+			for(const Position& position : next) {
+				if(mark(reached, position)) {
+					frontier.push_back(position);
+					++reached_count;
+				}
+			}
+		}
+
+		if(progress && !progress(int(std::min<uint64_t>(100, reached_count * 100 / tile_count))))
+			return false;
+	}
+	return true;
+}
+
+bool MapReachability::isReached(const Position& position) const
+{
+	return isMarked(reached, position);
+}
+
+bool MapReachability::isReachedInLeaf(int leaf_x, int leaf_y, int from_z, int to_z, int from_x, int to_x, int from_y, int to_y) const
+{
+	auto it = reached.find(getKey(leaf_x, leaf_y));
+	if(it == reached.end())
+		return false;
+
+	// The tiles of the rectangle on one floor, the same bits on every floor
+	uint64_t mask = 0;
+	const uint64_t column = (uint64_t(1) << (to_y - from_y + 1)) - 1;
+	for(int x = from_x & 3; x <= (to_x & 3); ++x) {
+		mask |= column << (x * 4 + (from_y & 3));
+	}
+
+	const Bits& bits = it->second;
+	for(int z = from_z; z <= to_z; ++z) {
+		if((bits[z >> 2] >> ((z & 3) * 16)) & mask)
+			return true;
+	}
+	return false;
+}
+
+bool MapReachability::isVisible(const Position& position) const
+{
+	const int from_x = std::max(position.x - ViewRangeX, 0);
+	const int to_x = std::min(position.x + ViewRangeX, rme::MapMaxWidth);
+	const int from_y = std::max(position.y - ViewRangeY, 0);
+	const int to_y = std::min(position.y + ViewRangeY, rme::MapMaxHeight);
+	int from_z, to_z;
+	if(position.z <= rme::MapGroundLayer) {
+		from_z = 0;
+		to_z = rme::MapGroundLayer + 2;
+	} else {
+		// underground
+		from_z = std::max(position.z - 2, rme::MapGroundLayer);
+		to_z = std::min(position.z + 2, rme::MapMaxLayer);
+	}
+
+	// Leaf by leaf, every leaf is looked up once
+	for(int leaf_x = from_x & ~3; leaf_x <= to_x; leaf_x += 4) {
+		for(int leaf_y = from_y & ~3; leaf_y <= to_y; leaf_y += 4) {
+			if(isReachedInLeaf(leaf_x, leaf_y, from_z, to_z,
+					std::max(from_x, leaf_x), std::min(to_x, leaf_x + 3),
+					std::max(from_y, leaf_y), std::min(to_y, leaf_y + 3)))
+				return true;
+		}
+	}
+	return false;
+}
+
+std::vector<MapReachability::Area> MapReachability::findIsolatedAreas(bool keep)
+{
+	// Walkable tiles that weren't reached, in map order
+	PositionVector positions;
+	MapTraversal traversal(map);
+	traversal.forEachTile(positions,
+		[this](PositionVector& chunk, Tile* tile) {
+			if(isWalkable(tile) && !isReached(tile->getPosition()))
+				chunk.push_back(tile->getPosition());
+		},
+		[](PositionVector& all, PositionVector& chunk) {
+			all.insert(all.end(), chunk.begin(), chunk.end());
+		});
+
+	std::vector<Area> areas;
+	BitMap seen = reached;
+	PositionVector queue;
+	PositionVector next;
+	for(const Position& start : positions) {
+		if(!mark(seen, start))
+			continue;
+
+		Area area;
+		area.position = start;
+		area.from = start;
+		area.to = start;
+		queue.assign(1, start);
+		while(!queue.empty()) {
+			const Position position = queue.back();
+			queue.pop_back();
+
+			++area.size;
+			area.from = Position(std::min(area.from.x, position.x), std::min(area.from.y, position.y), std::min(area.from.z, position.z));
+			area.to = Position(std::max(area.to.x, position.x), std::max(area.to.y, position.y), std::max(area.to.z, position.z));
+
+			next.clear();
+			expand(map.getTile(position), seen, next);
+			for(const Position& neighbour : next) {
+				if(mark(seen, neighbour))
+					queue.push_back(neighbour);
+			}
+		}
+		areas.push_back(area);
+	}
+
+	if(keep)
+		reached.swap(seen);
+
+	std::stable_sort(areas.begin(), areas.end(), [](const Area& a, const Area& b) { return a.size > b.size; });
+	return areas;
+}
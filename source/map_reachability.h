@@ -0,0 +1,98 @@
+//////////////////////////////////////////////////////////////////////
+// This file is part of Remere's Map Editor
+//////////////////////////////////////////////////////////////////////
+// Remere's Map Editor is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// Remere's Map Editor is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <http://www.gnu.org/licenses/>.
+//////////////////////////////////////////////////////////////////////
+
+#ifndef RME_MAP_REACHABILITY_H_
+#define RME_MAP_REACHABILITY_H_
+
+#include "position.h"
+
+#include <array>
+#include <functional>
+#include <unordered_map>
+
+class Map;
+class Tile;
+
+// Finds the tiles players can walk to from a set of start positions, over
+// walkable tiles and closed doors and through stairs, holes, the ladders
+// below them and teleports. The search goes breadth first and the tiles of
+// every step are expanded on all cores, reached tiles are marked in a
+// bitmap per quad tree leaf. The map must not change until the results
+// were used.
+class MapReachability
+{
+public:
+	// Walkable tiles that can be walked between, but not from a start position
+	struct Area {
+		Position position; // First tile of the area in map order
+		Position from;
+		Position to;
+		uint64_t size = 0;
+	};
+
+	explicit MapReachability(Map& map);
+
+	void addStart(const Position& position);
+	// Adds the temple of every town, false if no town has one
+	bool addTemples();
+
+	// progress gets 0 to 100 and stops the search by returning false, it
+	// returns false then
+	bool run(const std::function<bool(int)>& progress = nullptr);
+
+	uint64_t getReachedCount() const noexcept { return reached_count; }
+	bool isReached(const Position& position) const;
+	// True if a reached tile is in view of the position, the same view
+	// range players have: the floors seen from there and ViewRangeX tiles
+	// to the sides, ViewRangeY up and down
+	bool isVisible(const Position& position) const;
+	// Sorted by size, the largest first. If keep is set, the tiles of the
+	// areas count as reached afterwards, so they and what can be seen from
+	// them are visible too. The reached count stays the same.
+	std::vector<Area> findIsolatedAreas(bool keep = false);
+
+	static constexpr int ViewRangeX = 10;
+	static constexpr int ViewRangeY = 8;
+	// Positions expanded by one task on the worker threads
+	static constexpr size_t PositionsPerChunk = 2048;
+
+private:
+	// One bit for each tile of a leaf, 16 floors of 4x4 tiles
+	using Bits = std::array<uint64_t, 4>;
+	using BitMap = std::unordered_map<uint32_t, Bits>;
+
+	static uint32_t getKey(int x, int y) noexcept { return (uint32_t(x >> 2) << 14) | uint32_t(y >> 2); }
+	static int getBit(int x, int y, int z) noexcept { return z * 16 + (x & 3) * 4 + (y & 3); }
+	static bool isMarked(const BitMap& bits, const Position& position);
+	// False if it was marked already
+	static bool mark(BitMap& bits, const Position& position);
+
+	// Not blocking, or only blocked by doors
+	bool isWalkable(const Tile* tile) const;
+	// Adds the walkable positions the tile leads to and that are not marked
+	void expand(const Tile* tile, const BitMap& marked, PositionVector& next) const;
+	void addIfWalkable(int x, int y, int z, const BitMap& marked, PositionVector& next) const;
+	// Whether any tile of the floors and the rectangle inside one leaf is reached
+	bool isReachedInLeaf(int leaf_x, int leaf_y, int from_z, int to_z, int from_x, int to_x, int from_y, int to_y) const;
+
+	Map& map;
+	BitMap reached;
+	PositionVector frontier;
+	uint64_t reached_count;
+};
+
+#endif
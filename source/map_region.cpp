@@ -21,6 +21,7 @@
 #include "basemap.h"
 #include "position.h"
 #include "tile.h"
+#include "complexitem.h"
 
 //**************** Tile Location **********************
 
@@ -61,7 +62,8 @@ HouseExitList* TileLocation::createHouseExits()
 
 //**************** Floor **********************
 
-Floor::Floor(int sx, int sy, int z)
+Floor::Floor(int sx, int sy, int z) :
+	revision(0)
 {
 	sx = sx & ~3;
 	sy = sy & ~3;
@@ -73,6 +75,53 @@ Floor::Floor(int sx, int sy, int z)
 	}
 }
 
+//**************** LeafSummary **********************
+
+void LeafSummary::clear() noexcept
+{
+	filter.fill(0);
+	tile_count = 0;
+	house_tiles = 0;
+	spawn_tiles = 0;
+	waypoint_tiles = 0;
+	map_flags = 0;
+}
+
+void LeafSummary::add(const TileLocation& location)
+{
+	const Tile* tile = location.get();
+	if(!tile)
+		return;
+
+	++tile_count;
+	if(tile->isHouseTile())
+		++house_tiles;
+	if(tile->spawn)
+		++spawn_tiles;
+	if(location.getWaypointCount() > 0)
+		++waypoint_tiles;
+	map_flags |= tile->getMapFlags();
+
+	if(tile->ground)
+		addItem(tile->ground);
+	for(Item* item : tile->items) {
+		addItem(item);
+	}
+}
+
+void LeafSummary::addItem(Item* item)
+{
+	const uint32_t hash = getHash(item->getID());
+	setBit(hash >> 24);
+	setBit((hash >> 16) & 0xFF);
+
+	if(Container* container = item->getContainer()) {
+		for(Item* content : container->getVector()) {
+			addItem(content);
+		}
+	}
+}
+
 //**************** QTreeNode **********************
 
 QTreeNode::QTreeNode(BaseMap& map) :
@@ -134,6 +183,8 @@ QTreeNode* QTreeNode::getLeafForce(int x, int y)
 			if(level == 0) {
 				qt = newd QTreeNode(map);
 				qt->isLeaf = true;
+				// Empty, so its summary is already up to date
+				qt->summary.generation = map.summary_generation;
 				return qt;
 			} else {
 				qt = newd QTreeNode(map);
@@ -248,6 +299,15 @@ Tile* QTreeNode::setTile(int x, int y, int z, Tile* newtile)
 	TileLocation* tmp = &f->locs[offset_x*4+offset_y];
 	Tile* oldtile = tmp->tile;
 	tmp->tile = newtile;
+	map.logChange(x, y, z);
+	f->revision = map.getTileRevision();
+
+	// The filter can't forget the ids of a tile that is taken away, the
+	// summary is rebuilt once it is needed
+	if(oldtile)
+		summary.generation = 0;
+	else if(newtile && summary.generation == map.summary_generation)
+		summary.add(*tmp);
 
 	if(newtile && !oldtile)
 		++map.tilecount;
@@ -268,4 +328,7 @@ void QTreeNode::clearTile(int x, int y, int z)
 	TileLocation* tmp = &f->locs[offset_x*4+offset_y];
 	delete tmp->tile;
 	tmp->tile = map.allocator(tmp);
+	map.logChange(x, y, z);
+	f->revision = map.getTileRevision();
+	summary.generation = 0;
 }
@@ -21,7 +21,10 @@
 #include "const.h"
 #include "position.h"
 
+#include <array>
+
 class Tile;
+class Item;
 class Floor;
 class BaseMap;
 
@@ -75,6 +78,46 @@ class Floor
 public:
 	Floor(int x, int y, int z);
 	TileLocation locs[rme::MapLayers];
+	// The map's tile revision when one of the tiles was last replaced, so a
+	// floor that is deleted and made again doesn't start over, see MapDrawer
+	uint32_t revision;
+};
+
+// What the tiles of a leaf hold, so searches can pass over leaves that
+// cannot match without reading their tiles. Item ids, including those in
+// containers, go into a bloom filter: an id it doesn't have is on none of
+// the tiles, one it has may still be missing.
+struct LeafSummary
+{
+	static constexpr uint32_t FilterBits = 256;
+
+	void clear() noexcept;
+	// Adds the tile of the location and its waypoints
+	void add(const TileLocation& location);
+	bool mayContain(uint16_t id) const noexcept {
+		const uint32_t hash = getHash(id);
+		return hasBit(hash >> 24) && hasBit((hash >> 16) & 0xFF);
+	}
+
+	uint16_t tile_count = 0;
+	uint16_t house_tiles = 0;
+	uint16_t spawn_tiles = 0;
+	uint16_t waypoint_tiles = 0;
+	// Every zone flag set on any of the tiles
+	uint16_t map_flags = 0;
+
+private:
+	static uint32_t getHash(uint16_t id) noexcept { return id * 0x9E3779B1u; }
+	bool hasBit(uint32_t bit) const noexcept { return (filter[bit >> 6] >> (bit & 63)) & 1; }
+	void setBit(uint32_t bit) noexcept { filter[bit >> 6] |= uint64_t(1) << (bit & 63); }
+	void addItem(Item* item);
+
+	std::array<uint64_t, FilterBits / 64> filter {};
+	// Summary generation of the map it was built for, 0 once it went stale
+	uint32_t generation = 0;
+
+	friend class BaseMap;
+	friend class QTreeNode;
 };
 
 // This is not a QuadTree, but a HexTree (16 child nodes to every node), so the name is abit misleading
@@ -117,6 +160,8 @@ public:
 protected:
 	BaseMap& map;
 	uint32_t visible;
+	// Only kept for leaves, see BaseMap::getSummary
+	LeafSummary summary;
 
 	bool isLeaf;
 
@@ -0,0 +1,274 @@
+//////////////////////////////////////////////////////////////////////
+// This file is part of Remere's Map Editor
+//////////////////////////////////////////////////////////////////////
+// Remere's Map Editor is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// Remere's Map Editor is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <http://www.gnu.org/licenses/>.
+//////////////////////////////////////////////////////////////////////
+
+#include "main.h"
+
+#include "map_statistics.h"
+#include "map_traversal.h"
+#include "complexitem.h"
+#include "creature.h"
+#include "spawn.h"
+
+void MapStatistics::Totals::count(const Tile* tile, int64_t sign)
+{
+	if(tile->empty())
+		return;
+
+	tile_count += sign;
+	floor_tiles[tile->getZ()] += sign;
+	memory[MEMORY_TILES] += sign * int64_t(sizeof(Tile) + sizeof(Item*) * tile->items.capacity());
+
+	// Worked out from the items, the blocking flag of a tile is only updated
+	// after it was placed on the map
+	bool is_detailed = false;
+	bool is_blocking = !tile->ground && tile->items.empty();
+	if(tile->ground)
+		is_blocking |= countItem(tile->ground, sign, is_detailed);
+	for(Item* item : tile->items) {
+		is_blocking |= countItem(item, sign, is_detailed);
+	}
+
+	if(tile->isHouseTile())
+		house_tile_count += sign;
+
+	if(tile->spawn) {
+		spawn_count += sign;
+		memory[MEMORY_SPAWNS] += sign * int64_t(sizeof(Spawn));
+	}
+
+	if(tile->creature) {
+		creature_count += sign;
+		memory[MEMORY_CREATURES] += sign * int64_t(sizeof(Creature));
+	}
+
+	if(is_blocking)
+		blocking_tile_count += sign;
+	else
+		walkable_tile_count += sign;
+
+	if(is_detailed)
+		detailed_tile_count += sign;
+}
+
+bool MapStatistics::Totals::countItem(Item* item, int64_t sign, bool& is_detailed)
+{
+	const ItemType& it = g_items.getItemType(item->getID());
+	item_count += sign;
+	group_items[it.group < ITEM_GROUP_LAST ? it.group : ITEM_GROUP_NONE] += sign;
+	memory[MEMORY_ITEMS] += sign * int64_t(item->memsize());
+	if(it.isGroundTile() || it.isBorder)
+		return it.unpassable;
+
+	is_detailed = true;
+	if(it.moveable)
+		loose_item_count += sign;
+	if(it.isDepot())
+		depot_count += sign;
+	if(item->getActionID() > 0)
+		action_item_count += sign;
+	if(item->getUniqueID() > 0)
+		unique_item_count += sign;
+	if(Container* c = item->getContainer()) {
+		if(c->getVector().size())
+			container_count += sign;
+	}
+	return it.unpassable;
+}
+
+void MapStatistics::Totals::merge(const Totals& other)
+{
+	tile_count += other.tile_count;
+	detailed_tile_count += other.detailed_tile_count;
+	blocking_tile_count += other.blocking_tile_count;
+	walkable_tile_count += other.walkable_tile_count;
+	house_tile_count += other.house_tile_count;
+	spawn_count += other.spawn_count;
+	creature_count += other.creature_count;
+	for(int z = 0; z < rme::MapLayers; ++z) {
+		floor_tiles[z] += other.floor_tiles[z];
+	}
+
+	item_count += other.item_count;
+	loose_item_count += other.loose_item_count;
+	depot_count += other.depot_count;
+	action_item_count += other.action_item_count;
+	unique_item_count += other.unique_item_count;
+	container_count += other.container_count;
+	for(int group = 0; group < ITEM_GROUP_LAST; ++group) {
+		group_items[group] += other.group_items[group];
+	}
+
+	for(int category = 0; category < MEMORY_LAST; ++category) {
+		memory[category] += other.memory[category];
+	}
+}
+
+MapStatistics::MapStatistics() :
+	valid(false)
+{
+	////
+}
+
+void MapStatistics::build(Map& map, const std::function<void(int)>& progress)
+{
+	totals = Totals();
+	MapTraversal traversal(map);
+	if(progress)
+		traversal.setProgress(progress);
+	traversal.forEachTile(totals,
+		[](Totals& chunk, Tile* tile) { chunk.add(tile); },
+		[](Totals& all, Totals& chunk) { all.merge(chunk); });
+	valid = true;
+}
+
+void MapStatistics::update(const Tile* old_tile, const Tile* new_tile)
+{
+	if(!valid)
+		return;
+
+	if(old_tile)
+		totals.remove(old_tile);
+	if(new_tile)
+		totals.add(new_tile);
+}
+
+MapStatistics::HouseTotals MapStatistics::countHouses(const Map& map)
+{
+	HouseTotals result;
+	result.house_count = map.houses.count();
+	result.town_count = map.towns.count();
+
+	std::map<uint32_t, uint64_t> town_sqm;
+	for(const auto& entry : map.houses) {
+		const House* house = entry.second;
+		const uint64_t size = house->size();
+		if(size > result.largest_house_size) {
+			result.largest_house = house;
+			result.largest_house_size = size;
+		}
+		result.house_tiles += size;
+		town_sqm[house->townid] += size;
+	}
+
+	for(const auto& entry : town_sqm) {
+		auto town = map.towns.find(entry.first);
+		if(town != map.towns.end() && entry.second > result.largest_town_size) {
+			result.largest_town = town->second;
+			result.largest_town_size = entry.second;
+		}
+	}
+	return result;
+}
+
+const char* MapStatistics::getGroupName(ItemGroup_t group)
+{
+	switch(group) {
+		case ITEM_GROUP_GROUND: return "ground";
+		case ITEM_GROUP_CONTAINER: return "container";
+		case ITEM_GROUP_WEAPON: return "weapon";
+		case ITEM_GROUP_AMMUNITION: return "ammunition";
+		case ITEM_GROUP_ARMOR: return "armor";
+		case ITEM_GROUP_RUNE: return "rune";
+		case ITEM_GROUP_TELEPORT: return "teleport";
+		case ITEM_GROUP_MAGICFIELD: return "magic_field";
+		case ITEM_GROUP_WRITEABLE: return "writeable";
+		case ITEM_GROUP_KEY: return "key";
+		case ITEM_GROUP_SPLASH: return "splash";
+		case ITEM_GROUP_FLUID: return "fluid";
+		case ITEM_GROUP_DOOR: return "door";
+		case ITEM_GROUP_DEPRECATED: return "deprecated";
+		default: return "other";
+	}
+}
+
+const char* MapStatistics::getMemoryName(Memory memory)
+{
+	switch(memory) {
+		case MEMORY_TILES: return "tiles";
+		case MEMORY_ITEMS: return "items";
+		case MEMORY_CREATURES: return "creatures";
+		case MEMORY_SPAWNS: return "spawns";
+		default: return "unknown";
+	}
+}
+
+void MapStatistics::writeJson(std::ostream& stream, const Map& map) const
+{
+	const HouseTotals houses = countHouses(map);
+
+	stream << "{\n\t\"version\": ";
+	writeJsonString(stream, __RME_VERSION__);
+	stream << ",\n\t\"map\": ";
+	writeJsonString(stream, map.getMapDescription());
+
+	stream << ",\n\t\"tiles\": {"
+		<< "\"total\": " << totals.tile_count
+		<< ", \"walkable\": " << totals.walkable_tile_count
+		<< ", \"blocking\": " << totals.blocking_tile_count
+		<< ", \"detailed\": " << totals.detailed_tile_count
+		<< ", \"house\": " << totals.house_tile_count
+		<< ", \"floors\": [";
+	for(int z = 0; z < rme::MapLayers; ++z) {
+		stream << (z == 0 ? "" : ", ") << totals.floor_tiles[z];
+	}
+	stream << "]}";
+
+	stream << ",\n\t\"items\": {"
+		<< "\"total\": " << totals.item_count
+		<< ", \"moveable\": " << totals.loose_item_count
+		<< ", \"depots\": " << totals.depot_count
+		<< ", \"containers\": " << totals.container_count
+		<< ", \"action_ids\": " << totals.action_item_count
+		<< ", \"unique_ids\": " << totals.unique_item_count
+		<< ", \"groups\": {";
+	bool first = true;
+	for(int group = 0; group < ITEM_GROUP_LAST; ++group) {
+		if(totals.group_items[group] == 0)
+			continue;
+
+		stream << (first ? "" : ", ") << '"' << getGroupName(ItemGroup_t(group)) << "\": " << totals.group_items[group];
+		first = false;
+	}
+	stream << "}}";
+
+	stream << ",\n\t\"creatures\": {"
+		<< "\"total\": " << totals.creature_count
+		<< ", \"spawns\": " << totals.spawn_count
+		<< "}";
+
+	stream << ",\n\t\"houses\": {"
+		<< "\"total\": " << houses.house_count
+		<< ", \"towns\": " << houses.town_count
+		<< ", \"sqm\": " << houses.house_tiles;
+	if(houses.largest_house) {
+		stream << ", \"largest_house\": {\"name\": ";
+		writeJsonString(stream, houses.largest_house->name);
+		stream << ", \"sqm\": " << houses.largest_house_size << "}";
+	}
+	if(houses.largest_town) {
+		stream << ", \"largest_town\": {\"name\": ";
+		writeJsonString(stream, houses.largest_town->getName());
+		stream << ", \"sqm\": " << houses.largest_town_size << "}";
+	}
+	stream << "}";
+
+	stream << ",\n\t\"memory\": {";
+	for(int category = 0; category < MEMORY_LAST; ++category) {
+		stream << (category == 0 ? "" : ", ") << '"' << getMemoryName(Memory(category)) << "\": " << totals.memory[category];
+	}
+	stream << "}\n}\n";
+}
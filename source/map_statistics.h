@@ -0,0 +1,117 @@
+//////////////////////////////////////////////////////////////////////
+// This file is part of Remere's Map Editor
+//////////////////////////////////////////////////////////////////////
+// Remere's Map Editor is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// Remere's Map Editor is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <http://www.gnu.org/licenses/>.
+//////////////////////////////////////////////////////////////////////
+
+#ifndef RME_MAP_STATISTICS_H_
+#define RME_MAP_STATISTICS_H_
+
+#include "const.h"
+#include "items.h"
+
+#include <array>
+#include <functional>
+#include <ostream>
+
+class Map;
+class Tile;
+class Item;
+class House;
+class Town;
+
+// Running totals over the tiles of a map. Like the item index they are kept
+// up to date as tiles are replaced, and counted again on all cores once a
+// change made to tiles in place dropped them.
+class MapStatistics
+{
+public:
+	enum Memory : uint8_t {
+		MEMORY_TILES,
+		MEMORY_ITEMS,
+		MEMORY_CREATURES,
+		MEMORY_SPAWNS,
+		MEMORY_LAST
+	};
+
+	// Counts over a set of tiles. A tile is taken away again with the same
+	// values it was added with, as long as it wasn't changed in between.
+	struct Totals
+	{
+		void add(const Tile* tile) { count(tile, 1); }
+		void remove(const Tile* tile) { count(tile, -1); }
+		void merge(const Totals& other);
+
+		int64_t tile_count = 0;
+		int64_t detailed_tile_count = 0;
+		int64_t blocking_tile_count = 0;
+		int64_t walkable_tile_count = 0;
+		int64_t house_tile_count = 0;
+		int64_t spawn_count = 0;
+		int64_t creature_count = 0;
+		std::array<int64_t, rme::MapLayers> floor_tiles {};
+
+		// Grounds and items lying on tiles, not the contents of containers
+		int64_t item_count = 0;
+		int64_t loose_item_count = 0;
+		int64_t depot_count = 0;
+		int64_t action_item_count = 0;
+		int64_t unique_item_count = 0;
+		int64_t container_count = 0; // Only includes containers containing more than 1 item
+		std::array<int64_t, ITEM_GROUP_LAST> group_items {};
+
+		// In bytes, as far as it can be told from the objects
+		std::array<int64_t, MEMORY_LAST> memory {};
+
+	private:
+		void count(const Tile* tile, int64_t sign);
+		// Returns whether the item blocks the tile
+		bool countItem(Item* item, int64_t sign, bool& is_detailed);
+	};
+
+	// Counted from the house list whenever they are asked for
+	struct HouseTotals
+	{
+		uint64_t house_count = 0;
+		uint64_t town_count = 0;
+		uint64_t house_tiles = 0;
+		const House* largest_house = nullptr;
+		uint64_t largest_house_size = 0;
+		const Town* largest_town = nullptr;
+		uint64_t largest_town_size = 0;
+	};
+
+	MapStatistics();
+
+	// Tile changes are ignored while the totals are invalid
+	bool isValid() const noexcept { return valid; }
+	void invalidate() noexcept { valid = false; }
+	// Counts every tile again on all cores, progress gets 0 to 100
+	void build(Map& map, const std::function<void(int)>& progress = nullptr);
+	void update(const Tile* old_tile, const Tile* new_tile);
+
+	const Totals& getTotals() const noexcept { return totals; }
+	static HouseTotals countHouses(const Map& map);
+	static const char* getGroupName(ItemGroup_t group);
+	static const char* getMemoryName(Memory memory);
+
+	// Writes the totals, houses and towns as one JSON object
+	void writeJson(std::ostream& stream, const Map& map) const;
+
+private:
+	Totals totals;
+	bool valid;
+};
+
+#endif
@@ -0,0 +1,215 @@
+//////////////////////////////////////////////////////////////////////
+// This file is part of Remere's Map Editor
+//////////////////////////////////////////////////////////////////////
+// Remere's Map Editor is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// Remere's Map Editor is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <http://www.gnu.org/licenses/>.
+//////////////////////////////////////////////////////////////////////
+
+#include "main.h"
+
+#include "map_statistics_window.h"
+#include "gui.h"
+#include "map.h"
+#include "settings.h"
+
+#include <fstream>
+
+MapStatisticsWindow::MapStatisticsWindow(wxWindow* parent) :
+	wxDialog(parent, wxID_ANY, "Map Statistics", wxDefaultPosition, wxDefaultSize, wxRESIZE_BORDER | wxCAPTION | wxCLOSE_BOX, "MapStatisticsWindow"),
+	refresh_timer(this),
+	shown_map(nullptr),
+	shown_revision(0),
+	shown_outdated(false)
+{
+	wxSizer* topsizer = newd wxBoxSizer(wxVERTICAL);
+	text_field = newd wxTextCtrl(this, wxID_ANY, wxEmptyString, wxDefaultPosition, wxDefaultSize, wxTE_MULTILINE | wxTE_READONLY);
+	text_field->SetMinSize(wxSize(400, 300));
+	topsizer->Add(text_field, wxSizerFlags(5).Expand());
+
+	wxSizer* choicesizer = newd wxBoxSizer(wxHORIZONTAL);
+	refresh_button = newd wxButton(this, wxID_REFRESH, "Refresh");
+	choicesizer->Add(refresh_button, wxSizerFlags(1).Center());
+	export_button = newd wxButton(this, wxID_SAVE, "Export as JSON");
+	choicesizer->Add(export_button, wxSizerFlags(1).Center());
+	choicesizer->Add(newd wxButton(this, wxID_CLOSE, "OK"), wxSizerFlags(1).Center());
+	topsizer->Add(choicesizer, wxSizerFlags(1).Center());
+	SetSizerAndFit(topsizer);
+	Centre(wxBOTH);
+
+	Bind(wxEVT_TIMER, &MapStatisticsWindow::OnRefreshTimer, this);
+	Bind(wxEVT_BUTTON, &MapStatisticsWindow::OnClickRefresh, this, wxID_REFRESH);
+	Bind(wxEVT_BUTTON, &MapStatisticsWindow::OnClickExport, this, wxID_SAVE);
+	Bind(wxEVT_BUTTON, &MapStatisticsWindow::OnClickClose, this, wxID_CLOSE);
+	Bind(wxEVT_CLOSE_WINDOW, &MapStatisticsWindow::OnClose, this);
+
+	refresh_timer.Start(RefreshInterval);
+}
+
+MapStatisticsWindow::~MapStatisticsWindow()
+{
+	refresh_timer.Stop();
+}
+
+void MapStatisticsWindow::UpdateStatistics(bool force)
+{
+	if(!g_gui.IsEditorOpen()) {
+		if(shown_map || force)
+			text_field->ChangeValue("No map is open.");
+		refresh_button->Enable(false);
+		export_button->Enable(false);
+		shown_map = nullptr;
+		return;
+	}
+
+	Map& map = g_gui.GetCurrentMap();
+	if(!force && shown_map == &map && shown_revision == map.getTileRevision() && map.hasStatistics())
+		return;
+
+	// Counting the whole map can take a while, the timer only follows the
+	// tiles that were replaced. Tools that change tiles in place drop the
+	// totals, they are counted again once asked for.
+	if(!force && !map.hasStatistics()) {
+		if(shown_map != &map || !shown_outdated)
+			text_field->ChangeValue("The statistics are out of date, press Refresh to count the map again.");
+		refresh_button->Enable(true);
+		export_button->Enable(true);
+		shown_map = &map;
+		shown_outdated = true;
+		return;
+	}
+
+	const MapStatistics& statistics = map.getStatistics(true);
+	const MapStatistics::Totals& totals = statistics.getTotals();
+	const MapStatistics::HouseTotals houses = MapStatistics::countHouses(map);
+	shown_map = &map;
+	shown_revision = map.getTileRevision();
+	shown_outdated = false;
+
+	const double creatures_per_spawn = (totals.spawn_count != 0 ? double(totals.creature_count) / double(totals.spawn_count) : -1.0);
+	const double percent_pathable = 100.0*(totals.tile_count != 0 ? double(totals.walkable_tile_count) / double(totals.tile_count) : -1.0);
+	const double percent_detailed = 100.0*(totals.tile_count != 0 ? double(totals.detailed_tile_count) / double(totals.tile_count) : -1.0);
+	const double houses_per_town = (houses.town_count != 0 ? double(houses.house_count) / double(houses.town_count) : -1.0);
+	const double sqm_per_house = (houses.house_count != 0 ? double(houses.house_tiles) / double(houses.house_count) : -1.0);
+	const double sqm_per_town = (houses.town_count != 0 ? double(houses.house_tiles) / double(houses.town_count) : -1.0);
+
+	std::ostringstream os;
+	os.setf(std::ios::fixed, std::ios::floatfield);
+	os.precision(2);
+	os << "Map statistics for the map \"" << map.getMapDescription() << "\"\n";
+	os << "\tTile data:\n";
+	os << "\t\tTotal number of tiles: " << totals.tile_count << "\n";
+	os << "\t\tNumber of pathable tiles: " << totals.walkable_tile_count << "\n";
+	os << "\t\tNumber of unpathable tiles: " << totals.blocking_tile_count << "\n";
+	if(percent_pathable >= 0.0)
+		os << "\t\tPercent walkable tiles: " << percent_pathable << "%\n";
+	os << "\t\tDetailed tiles: " << totals.detailed_tile_count << "\n";
+	if(percent_detailed >= 0.0)
+		os << "\t\tPercent detailed tiles: " << percent_detailed << "%\n";
+	for(int z = 0; z < rme::MapLayers; ++z) {
+		if(totals.floor_tiles[z] != 0)
+			os << "\t\tTiles on floor " << z << ": " << totals.floor_tiles[z] << "\n";
+	}
+
+	os << "\tItem data:\n";
+	os << "\t\tTotal number of items: " << totals.item_count << "\n";
+	os << "\t\tNumber of moveable tiles: " << totals.loose_item_count << "\n";
+	os << "\t\tNumber of depots: " << totals.depot_count << "\n";
+	os << "\t\tNumber of containers: " << totals.container_count << "\n";
+	os << "\t\tNumber of items with Action ID: " << totals.action_item_count << "\n";
+	os << "\t\tNumber of items with Unique ID: " << totals.unique_item_count << "\n";
+	for(int group = 0; group < ITEM_GROUP_LAST; ++group) {
+		if(totals.group_items[group] != 0)
+			os << "\t\tItems of type " << MapStatistics::getGroupName(ItemGroup_t(group)) << ": " << totals.group_items[group] << "\n";
+	}
+
+	const ItemIndex& item_index = map.getItemIndex();
+	if(!g_settings.getBoolean(Config::USE_ITEM_INDEX))
+		os << "\t\tItem index: turned off\n";
+	else if(!item_index.isValid())
+		os << "\t\tItem index: built with the next search\n";
+	else
+		os << "\t\tItem index: " << item_index.getEntryCount() << " entries, " << (item_index.getMemoryUsage() + 1023) / 1024 << " KB\n";
+
+	os << "\tCreature data:\n";
+	os << "\t\tTotal creature count: " << totals.creature_count << "\n";
+	os << "\t\tTotal spawn count: " << totals.spawn_count << "\n";
+	if(creatures_per_spawn >= 0)
+		os << "\t\tMean creatures per spawn: " << creatures_per_spawn << "\n";
+
+	os << "\tTown/House data:\n";
+	os << "\t\tTotal number of towns: " << houses.town_count << "\n";
+	os << "\t\tTotal number of houses: " << houses.house_count << "\n";
+	if(houses_per_town >= 0)
+		os << "\t\tMean houses per town: " << houses_per_town << "\n";
+	os << "\t\tTotal amount of housetiles: " << houses.house_tiles << "\n";
+	if(sqm_per_house >= 0)
+		os << "\t\tMean tiles per house: " << sqm_per_house << "\n";
+	if(sqm_per_town >= 0)
+		os << "\t\tMean tiles per town: " << sqm_per_town << "\n";
+
+	if(houses.largest_town)
+		os << "\t\tLargest Town: \"" << houses.largest_town->getName() << "\" (" << houses.largest_town_size << " sqm)\n";
+	if(houses.largest_house)
+		os << "\t\tLargest House: \"" << houses.largest_house->name << "\" (" << houses.largest_house_size << " sqm)\n";
+
+	os << "\tMemory usage:\n";
+	for(int category = 0; category < MapStatistics::MEMORY_LAST; ++category) {
+		os << "\t\t" << MapStatistics::getMemoryName(MapStatistics::Memory(category)) << ": " << (totals.memory[category] + 1023) / 1024 << " KB\n";
+	}
+
+	os << "\n";
+	os << "Generated by Remere's Map Editor version " + __RME_VERSION__ + "\n";
+
+	text_field->ChangeValue(wxstr(os.str()));
+	refresh_button->Enable(true);
+	export_button->Enable(true);
+}
+
+void MapStatisticsWindow::OnRefreshTimer(wxTimerEvent& WXUNUSED(event))
+{
+	UpdateStatistics();
+}
+
+void MapStatisticsWindow::OnClickRefresh(wxCommandEvent& WXUNUSED(event))
+{
+	UpdateStatistics(true);
+}
+
+void MapStatisticsWindow::OnClickExport(wxCommandEvent& WXUNUSED(event))
+{
+	if(!g_gui.IsEditorOpen())
+		return;
+
+	wxFileDialog dialog(this, "Export Map Statistics...", "", "", "JSON (*.json)|*.json", wxFD_SAVE | wxFD_OVERWRITE_PROMPT);
+	if(dialog.ShowModal() != wxID_OK)
+		return;
+
+	Map& map = g_gui.GetCurrentMap();
+	std::ofstream file(nstr(dialog.GetPath()), std::ios::trunc | std::ios::out);
+	if(file.is_open())
+		map.getStatistics(true).writeJson(file, map);
+
+	if(!file.good())
+		g_gui.PopupDialog(this, "Error", "Could not write " + dialog.GetPath(), wxOK);
+}
+
+void MapStatisticsWindow::OnClickClose(wxCommandEvent& WXUNUSED(event))
+{
+	Close();
+}
+
+void MapStatisticsWindow::OnClose(wxCloseEvent& WXUNUSED(event))
+{
+	refresh_timer.Stop();
+	Destroy();
+}
@@ -0,0 +1,56 @@
+//////////////////////////////////////////////////////////////////////
+// This file is part of Remere's Map Editor
+//////////////////////////////////////////////////////////////////////
+// Remere's Map Editor is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// Remere's Map Editor is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <http://www.gnu.org/licenses/>.
+//////////////////////////////////////////////////////////////////////
+
+#ifndef RME_MAP_STATISTICS_WINDOW_H_
+#define RME_MAP_STATISTICS_WINDOW_H_
+
+#include "main.h"
+
+class Map;
+
+// Shows the statistics of the current map and keeps them up to date while
+// the window is open, the map can be edited meanwhile
+class MapStatisticsWindow : public wxDialog
+{
+public:
+	MapStatisticsWindow(wxWindow* parent);
+	virtual ~MapStatisticsWindow();
+
+	// Shows the statistics again if the map changed since they were shown.
+	// Counting the whole map again is only done when forced, with a load bar.
+	void UpdateStatistics(bool force = false);
+
+	static constexpr int RefreshInterval = 1000;
+
+private:
+	void OnRefreshTimer(wxTimerEvent& event);
+	void OnClickRefresh(wxCommandEvent& event);
+	void OnClickExport(wxCommandEvent& event);
+	void OnClickClose(wxCommandEvent& event);
+	void OnClose(wxCloseEvent& event);
+
+	wxTextCtrl* text_field;
+	wxButton* refresh_button;
+	wxButton* export_button;
+	wxTimer refresh_timer;
+
+	const Map* shown_map;
+	uint32_t shown_revision;
+	bool shown_outdated;
+};
+
+#endif
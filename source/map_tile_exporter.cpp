@@ -0,0 +1,363 @@
+//////////////////////////////////////////////////////////////////////
+// This file is part of Remere's Map Editor
+//////////////////////////////////////////////////////////////////////
+// Remere's Map Editor is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// Remere's Map Editor is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <http://www.gnu.org/licenses/>.
+//////////////////////////////////////////////////////////////////////
+
+#include "main.h"
+
+#include "map_tile_exporter.h"
+
+#include "map.h"
+#include "tile.h"
+#include "item.h"
+#include "items.h"
+#include "graphics.h"
+#include "worker_pool.h"
+
+#include <wx/image.h>
+
+namespace {
+	// How many tiles a sprite can reach up and left of its own tile
+	constexpr int Overhang = 3;
+	// Tiles handed to the worker pool at once, bounds the pixel buffers alive
+	constexpr size_t BatchSize = 256;
+	constexpr size_t ImageBytes = MapTileExporter::ImageSize * MapTileExporter::ImageSize * rme::PixelFormatRGBA;
+
+	bool isBlank(const uint8_t* pixels)
+	{
+		for(size_t i = 3; i < ImageBytes; i += rme::PixelFormatRGBA) {
+			if(pixels[i] != 0)
+				return false;
+		}
+		return true;
+	}
+}
+
+MapTileExporter::MapTileExporter(Map& map, int floor) :
+	m_map(map),
+	m_floor(floor),
+	m_startFloor(floor <= rme::MapGroundLayer ? rme::MapGroundLayer : std::min(rme::MapMaxLayer, floor + 2))
+{
+	////
+}
+
+bool MapTileExporter::exportTiles(const std::string& directory)
+{
+	m_directory = directory;
+	m_error.clear();
+
+	if(m_floor < rme::MapMinLayer || m_floor > rme::MapMaxLayer) {
+		m_error = "Invalid floor.";
+		return false;
+	}
+
+	std::vector<TileIndex> tiles = collectBaseTiles();
+	if(tiles.empty()) {
+		m_error = "There is nothing to export on this floor.";
+		return false;
+	}
+
+	// Drawing the deepest level is most of the work
+	if(!runLevel(m_maxZoom, tiles, 0, 80))
+		return false;
+
+	for(int zoom = m_maxZoom - 1; zoom >= 0; --zoom) {
+		for(TileIndex& index : tiles) {
+			index.x /= 2;
+			index.y /= 2;
+		}
+		std::sort(tiles.begin(), tiles.end());
+		tiles.erase(std::unique(tiles.begin(), tiles.end()), tiles.end());
+
+		int from = 80 + 20 * (m_maxZoom - 1 - zoom) / m_maxZoom;
+		int to = 80 + 20 * (m_maxZoom - zoom) / m_maxZoom;
+		if(!runLevel(zoom, tiles, from, to))
+			return false;
+	}
+	return true;
+}
+
+std::vector<MapTileExporter::TileIndex> MapTileExporter::collectBaseTiles()
+{
+	// Floors below are drawn shifted down and right, up to one tile per floor
+	const int grid = (rme::MapMaxWidth + rme::MapLayers) / TilesPerImage + 1;
+	std::vector<bool> marked(size_t(grid) * grid, false);
+
+	int max_index = 0;
+	for(auto it = m_map.begin(); it != m_map.end(); ++it) {
+		const Tile* tile = (*it)->get();
+		if(!tile || (!tile->ground && tile->items.empty()))
+			continue;
+
+		const Position& position = tile->getPosition();
+		if(position.z < m_floor || position.z > m_startFloor)
+			continue;
+
+		int offset = position.z - m_floor;
+		int x = position.x + offset;
+		int y = position.y + offset;
+		for(int ix = std::max(0, x - Overhang) / TilesPerImage; ix <= x / TilesPerImage; ++ix) {
+			for(int iy = std::max(0, y - Overhang) / TilesPerImage; iy <= y / TilesPerImage; ++iy) {
+				marked[size_t(ix) * grid + iy] = true;
+				max_index = std::max(max_index, std::max(ix, iy));
+			}
+		}
+	}
+
+	std::vector<TileIndex> tiles;
+	for(int ix = 0; ix < grid; ++ix) {
+		for(int iy = 0; iy < grid; ++iy) {
+			if(marked[size_t(ix) * grid + iy])
+				tiles.push_back(TileIndex { uint16_t(ix), uint16_t(iy) });
+		}
+	}
+
+	m_maxZoom = 0;
+	while((1 << m_maxZoom) <= max_index) {
+		++m_maxZoom;
+	}
+	return tiles;
+}
+
+bool MapTileExporter::runLevel(int zoom, const std::vector<TileIndex>& tiles, int progress_from, int progress_to)
+{
+	if(!createDirectories(zoom, tiles))
+		return false;
+
+	WorkerPool& pool = WorkerPool::getInstance();
+	std::atomic<bool> failed(false);
+	for(size_t batch = 0; batch < tiles.size(); batch += BatchSize) {
+		size_t count = std::min(BatchSize, tiles.size() - batch);
+		pool.run(count, [&](size_t task) {
+			const TileIndex& index = tiles[batch + task];
+			std::vector<uint8_t> pixels(ImageBytes, 0);
+			if(zoom == m_maxZoom)
+				renderBaseTile(index, pixels.data());
+			else
+				mergeChildren(zoom, index, pixels.data());
+
+			// Blank tiles are left out, viewers show the background instead
+			if(!isBlank(pixels.data()) && !saveImage(getTilePath(zoom, index), pixels.data()))
+				failed = true;
+		});
+
+		if(failed) {
+			m_error = "Couldn't write the tile images to " + m_directory + ".";
+			return false;
+		}
+
+		if(m_progress)
+			m_progress(progress_from + int((progress_to - progress_from) * (batch + count) / tiles.size()));
+	}
+	return true;
+}
+
+bool MapTileExporter::createDirectories(int zoom, const std::vector<TileIndex>& tiles)
+{
+	// Tiles are sorted by column, so every column directory is made once
+	int last_x = -1;
+	for(const TileIndex& index : tiles) {
+		if(index.x == last_x)
+			continue;
+		last_x = index.x;
+
+		wxFileName directory = wxFileName::DirName(wxstr(m_directory));
+		directory.AppendDir(wxString::Format("%d", m_floor));
+		directory.AppendDir(wxString::Format("%d", zoom));
+		directory.AppendDir(wxString::Format("%d", index.x));
+		if(!directory.DirExists() && !directory.Mkdir(wxS_DIR_DEFAULT, wxPATH_MKDIR_FULL)) {
+			m_error = "Couldn't create the directory " + nstr(directory.GetFullPath()) + ".";
+			return false;
+		}
+	}
+	return true;
+}
+
+wxString MapTileExporter::getTilePath(int zoom, const TileIndex& index) const
+{
+	wxFileName file = wxFileName::DirName(wxstr(m_directory));
+	file.AppendDir(wxString::Format("%d", m_floor));
+	file.AppendDir(wxString::Format("%d", zoom));
+	file.AppendDir(wxString::Format("%d", index.x));
+	file.SetFullName(wxString::Format("%d.png", index.y));
+	return file.GetFullPath();
+}
+
+void MapTileExporter::renderBaseTile(const TileIndex& index, uint8_t* pixels)
+{
+	ImageCache cache;
+	int start_x = index.x * TilesPerImage;
+	int start_y = index.y * TilesPerImage;
+
+	// Same order as the map view, lower floors first and tile by tile after
+	for(int map_z = m_startFloor; map_z >= m_floor; --map_z) {
+		int offset = map_z - m_floor;
+		for(int map_x = start_x - offset - 1; map_x < start_x - offset + TilesPerImage + Overhang; ++map_x) {
+			for(int map_y = start_y - offset - 1; map_y < start_y - offset + TilesPerImage + Overhang; ++map_y) {
+				if(map_x < 0 || map_y < 0)
+					continue;
+
+				const Tile* tile = m_map.getTile(map_x, map_y, map_z);
+				if(tile)
+					drawTile(pixels, cache, tile, (map_x + offset - start_x) * rme::TileSize, (map_y + offset - start_y) * rme::TileSize);
+			}
+		}
+	}
+}
+
+void MapTileExporter::drawTile(uint8_t* pixels, ImageCache& cache, const Tile* tile, int draw_x, int draw_y)
+{
+	if(tile->ground)
+		drawItem(pixels, cache, tile, tile->ground, draw_x, draw_y);
+
+	// Creatures are not part of the world image
+	for(const Item* item : tile->items) {
+		drawItem(pixels, cache, tile, item, draw_x, draw_y);
+	}
+}
+
+void MapTileExporter::drawItem(uint8_t* pixels, ImageCache& cache, const Tile* tile, const Item* item, int& draw_x, int& draw_y)
+{
+	const ItemType& type = g_items.getItemType(item->getID());
+	if(type.id == 0 || type.isMetaItem())
+		return;
+
+	GameSprite* sprite = type.sprite;
+	if(!sprite)
+		return;
+
+	const GameSprite::ItemPattern pattern = sprite->getItemPattern(tile, item, draw_x, draw_y);
+
+	// Animated items are exported on their first frame
+	for(int cx = 0; cx != sprite->width; cx++) {
+		for(int cy = 0; cy != sprite->height; cy++) {
+			for(int cf = 0; cf != sprite->layers; cf++) {
+				uint32_t index = pattern.getSpriteIndex(sprite, cx, cy, cf);
+				blitImage(pixels, cache, sprite, index, pattern.screenx - cx * rme::TileSize, pattern.screeny - cy * rme::TileSize);
+			}
+		}
+	}
+}
+
+void MapTileExporter::blitImage(uint8_t* pixels, ImageCache& cache, GameSprite* sprite, uint32_t index, int screenx, int screeny)
+{
+	int begin_x = std::max(0, -screenx);
+	int begin_y = std::max(0, -screeny);
+	int end_x = std::min(rme::SpritePixels, ImageSize - screenx);
+	int end_y = std::min(rme::SpritePixels, ImageSize - screeny);
+	if(begin_x >= end_x || begin_y >= end_y)
+		return;
+
+	uint32_t id = sprite->getImageID(index);
+	auto it = cache.find(id);
+	if(it == cache.end())
+		it = cache.emplace(id, std::unique_ptr<uint8_t[]>(sprite->getRGBAData(index))).first;
+	const uint8_t* image = it->second.get();
+
+	for(int y = begin_y; y < end_y; ++y) {
+		const uint8_t* src = image + (y * rme::SpritePixels + begin_x) * rme::PixelFormatRGBA;
+		uint8_t* dst = pixels + ((screeny + y) * ImageSize + screenx + begin_x) * rme::PixelFormatRGBA;
+		for(int x = begin_x; x < end_x; ++x, src += rme::PixelFormatRGBA, dst += rme::PixelFormatRGBA) {
+			int alpha = src[3];
+			if(alpha == 0)
+				continue;
+
+			if(alpha == 255 || dst[3] == 0) {
+				dst[0] = src[0];
+				dst[1] = src[1];
+				dst[2] = src[2];
+				dst[3] = alpha;
+				continue;
+			}
+
+			// Source over destination, both with straight alpha
+			int below = dst[3] * (255 - alpha) / 255;
+			int total = alpha + below;
+			dst[0] = (src[0] * alpha + dst[0] * below) / total;
+			dst[1] = (src[1] * alpha + dst[1] * below) / total;
+			dst[2] = (src[2] * alpha + dst[2] * below) / total;
+			dst[3] = total;
+		}
+	}
+}
+
+bool MapTileExporter::mergeChildren(int zoom, const TileIndex& index, uint8_t* pixels) const
+{
+	constexpr int half = ImageSize / 2;
+
+	bool merged = false;
+	for(int child = 0; child < 4; ++child) {
+		TileIndex child_index { uint16_t(index.x * 2 + (child & 1)), uint16_t(index.y * 2 + (child >> 1)) };
+		wxString path = getTilePath(zoom + 1, child_index);
+		if(!wxFileExists(path))
+			continue;
+
+		wxImage image;
+		if(!image.LoadFile(path, wxBITMAP_TYPE_PNG) || image.GetWidth() != ImageSize || image.GetHeight() != ImageSize)
+			continue;
+
+		const uint8_t* rgb = image.GetData();
+		const uint8_t* alpha = image.HasAlpha() ? image.GetAlpha() : nullptr;
+		int offset_x = (child & 1) * half;
+		int offset_y = (child >> 1) * half;
+		for(int y = 0; y < half; ++y) {
+			for(int x = 0; x < half; ++x) {
+				// Colors are weighted by alpha so transparent pixels don't darken edges
+				int alpha_sum = 0, red = 0, green = 0, blue = 0;
+				for(int i = 0; i < 4; ++i) {
+					size_t source = size_t(y * 2 + (i >> 1)) * ImageSize + x * 2 + (i & 1);
+					int a = alpha ? alpha[source] : 255;
+					alpha_sum += a;
+					red += rgb[source * 3 + 0] * a;
+					green += rgb[source * 3 + 1] * a;
+					blue += rgb[source * 3 + 2] * a;
+				}
+
+				if(alpha_sum > 0) {
+					uint8_t* out = pixels + ((offset_y + y) * ImageSize + offset_x + x) * rme::PixelFormatRGBA;
+					out[0] = red / alpha_sum;
+					out[1] = green / alpha_sum;
+					out[2] = blue / alpha_sum;
+					out[3] = alpha_sum / 4;
+				}
+			}
+		}
+		merged = true;
+	}
+	return merged;
+}
+
+bool MapTileExporter::saveImage(const wxString& path, const uint8_t* pixels)
+{
+	// wxImage takes both buffers and frees them with free()
+	const size_t count = ImageSize * ImageSize;
+	uint8_t* rgb = static_cast<uint8_t*>(malloc(count * rme::PixelFormatRGB));
+	uint8_t* alpha = static_cast<uint8_t*>(malloc(count));
+	if(!rgb || !alpha) {
+		free(rgb);
+		free(alpha);
+		return false;
+	}
+
+	for(size_t i = 0; i < count; ++i) {
+		rgb[i * 3 + 0] = pixels[i * 4 + 0];
+		rgb[i * 3 + 1] = pixels[i * 4 + 1];
+		rgb[i * 3 + 2] = pixels[i * 4 + 2];
+		alpha[i] = pixels[i * 4 + 3];
+	}
+
+	wxImage image(ImageSize, ImageSize, rgb, alpha);
+	return image.SaveFile(path, wxBITMAP_TYPE_PNG);
+}
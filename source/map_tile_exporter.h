@@ -0,0 +1,87 @@
+//////////////////////////////////////////////////////////////////////
+// This file is part of Remere's Map Editor
+//////////////////////////////////////////////////////////////////////
+// Remere's Map Editor is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// Remere's Map Editor is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <http://www.gnu.org/licenses/>.
+//////////////////////////////////////////////////////////////////////
+
+#ifndef RME_MAP_TILE_EXPORTER_H_
+#define RME_MAP_TILE_EXPORTER_H_
+
+#include <functional>
+#include <unordered_map>
+
+class Map;
+class Tile;
+class Item;
+class GameSprite;
+
+// Renders one floor of the map at full sprite resolution and writes it as a
+// pyramid of PNG tiles, <directory>/<floor>/<zoom>/<x>/<y>.png, the layout
+// web map viewers expect. Zoom 0 is a single tile covering the whole exported
+// map area and the deepest zoom is one pixel per sprite pixel.
+//
+// Drawing happens on the CPU from the sprite file, so no GL context is
+// needed, only the display the editor itself runs on. Tiles are rendered
+// and written in batches across the worker pool, and coarser zoom levels
+// are built from the tiles already on disk, so memory stays bounded no
+// matter how large the map is.
+class MapTileExporter
+{
+public:
+	static constexpr int ImageSize = 256;
+	static constexpr int TilesPerImage = ImageSize / rme::TileSize;
+
+	MapTileExporter(Map& map, int floor);
+
+	// Called on the calling thread between batches with 0-100
+	void setProgressCallback(std::function<void(int)> callback) { m_progress = std::move(callback); }
+
+	bool exportTiles(const std::string& directory);
+
+	int getMaxZoom() const noexcept { return m_maxZoom; }
+	const std::string& getError() const noexcept { return m_error; }
+
+private:
+	struct TileIndex {
+		uint16_t x;
+		uint16_t y;
+		bool operator==(const TileIndex&) const = default;
+		bool operator<(const TileIndex& other) const noexcept { return x != other.x ? x < other.x : y < other.y; }
+	};
+
+	// Decoded sprite images of one task, keyed on GameSprite::getImageID
+	using ImageCache = std::unordered_map<uint32_t, std::unique_ptr<uint8_t[]>>;
+
+	std::vector<TileIndex> collectBaseTiles();
+	void renderBaseTile(const TileIndex& index, uint8_t* pixels);
+	void drawTile(uint8_t* pixels, ImageCache& cache, const Tile* tile, int draw_x, int draw_y);
+	void drawItem(uint8_t* pixels, ImageCache& cache, const Tile* tile, const Item* item, int& draw_x, int& draw_y);
+	void blitImage(uint8_t* pixels, ImageCache& cache, GameSprite* sprite, uint32_t index, int screenx, int screeny);
+	bool mergeChildren(int zoom, const TileIndex& index, uint8_t* pixels) const;
+
+	bool runLevel(int zoom, const std::vector<TileIndex>& tiles, int progress_from, int progress_to);
+	bool createDirectories(int zoom, const std::vector<TileIndex>& tiles);
+	wxString getTilePath(int zoom, const TileIndex& index) const;
+	static bool saveImage(const wxString& path, const uint8_t* pixels);
+
+	Map& m_map;
+	int m_floor;
+	int m_startFloor;
+	int m_maxZoom = 0;
+	std::string m_directory;
+	std::string m_error;
+	std::function<void(int)> m_progress;
+};
+
+#endif
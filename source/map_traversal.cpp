@@ -0,0 +1,222 @@
+//////////////////////////////////////////////////////////////////////
+// This file is part of Remere's Map Editor
+//////////////////////////////////////////////////////////////////////
+// Remere's Map Editor is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// Remere's Map Editor is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <http://www.gnu.org/licenses/>.
+//////////////////////////////////////////////////////////////////////
+
+#include "main.h"
+
+#include "map_traversal.h"
+#include "selection.h"
+#include "worker_pool.h"
+
+MapTraversal::MapTraversal(Map& map) :
+	map(map),
+	use_positions(false),
+	use_selection(false),
+	use_area(false),
+	cancelled(false)
+{
+	////
+}
+
+void MapTraversal::setSelection(const Selection& selection)
+{
+	selected.clear();
+	selected.reserve(selection.size());
+	for(const Tile* tile : selection.getTiles()) {
+		selected.push_back(tile->getPosition());
+	}
+	// The set is unordered, sorted by floor, row and column the order is
+	// always the same and can be intersected with indexed positions
+	std::sort(selected.begin(), selected.end());
+	use_selection = true;
+}
+
+void MapTraversal::setArea(const Position& from, const Position& to)
+{
+	area_from = Position(std::min(from.x, to.x), std::min(from.y, to.y), std::min(from.z, to.z));
+	area_to = Position(std::max(from.x, to.x), std::max(from.y, to.y), std::max(from.z, to.z));
+	use_area = true;
+}
+
+void MapTraversal::setPositions(PositionVector new_positions)
+{
+	positions = std::move(new_positions);
+	use_positions = true;
+}
+
+bool MapTraversal::useItemIndex(ItemIndex::Key key, uint16_t id)
+{
+	PositionVector found;
+	if(addIndexed(map.findItems(key, id, found), found))
+		return true;
+
+	if(key == ItemIndex::ITEM_ID)
+		filter_ids.push_back(id);
+	return false;
+}
+
+bool MapTraversal::useItemIndex(ItemIndex::Key key)
+{
+	PositionVector found;
+	return addIndexed(map.findItems(key, found), found);
+}
+
+bool MapTraversal::addIndexed(bool indexed, PositionVector& found)
+{
+	if(!indexed) {
+		positions.clear();
+		use_positions = false;
+		return false;
+	}
+
+	// Several kinds or ids visit the union of their tiles
+	if(use_positions) {
+		found.insert(found.end(), positions.begin(), positions.end());
+		std::sort(found.begin(), found.end());
+		found.erase(std::unique(found.begin(), found.end()), found.end());
+	}
+	setPositions(std::move(found));
+	return true;
+}
+
+void MapTraversal::prepare()
+{
+	if(use_selection) {
+		if(!use_positions) {
+			positions = selected;
+			use_positions = true;
+		} else {
+			PositionVector both;
+			std::sort(positions.begin(), positions.end());
+			std::set_intersection(positions.begin(), positions.end(), selected.begin(), selected.end(), std::back_inserter(both));
+			positions.swap(both);
+		}
+	}
+
+	if(use_area && use_positions) {
+		positions.erase(std::remove_if(positions.begin(), positions.end(), [this](const Position& position) {
+			return position.z < area_from.z || position.z > area_to.z || !isInArea(position.x, position.y);
+		}), positions.end());
+	}
+}
+
+bool MapTraversal::isLeafInArea(QTreeNode* leaf)
+{
+	// Leaves hold 4x4 tiles on every floor, the first one is at the corner
+	for(int z = area_from.z; z <= area_to.z; ++z) {
+		Floor* floor = leaf->getFloor(z);
+		if(!floor)
+			continue;
+
+		const Position& corner = floor->locs[0].getPosition();
+		return corner.x + 3 >= area_from.x && corner.x <= area_to.x &&
+			corner.y + 3 >= area_from.y && corner.y <= area_to.y;
+	}
+	return false;
+}
+
+bool MapTraversal::isLeafWanted(QTreeNode* leaf)
+{
+	if(filter_ids.empty() && !leaf_filter)
+		return true;
+
+	const LeafSummary& summary = map.getSummary(leaf);
+	if(!filter_ids.empty() && std::none_of(filter_ids.begin(), filter_ids.end(), [&summary](uint16_t id) { return summary.mayContain(id); }))
+		return false;
+	return !leaf_filter || leaf_filter(summary);
+}
+
+size_t MapTraversal::getBatchSize() const
+{
+	// A few chunks per thread, so one slow chunk doesn't leave the others idle
+	return WorkerPool::getInstance().size() * 4;
+}
+
+void MapTraversal::visitChunk(size_t chunk, const std::function<void(Tile*)>& visit)
+{
+	if(use_positions) {
+		size_t end = std::min(positions.size(), (chunk + 1) * PositionsPerChunk);
+		for(size_t i = chunk * PositionsPerChunk; i < end; ++i) {
+			if(Tile* tile = map.getTile(positions[i]))
+				visit(tile);
+		}
+		return;
+	}
+
+	const int first_z = use_area ? area_from.z : 0;
+	const int last_z = use_area ? area_to.z : rme::MapMaxLayer;
+	size_t end = std::min(leaves.size(), (chunk + 1) * LeavesPerChunk);
+	for(size_t i = chunk * LeavesPerChunk; i < end; ++i) {
+		QTreeNode* leaf = leaves[i];
+		if(!isLeafWanted(leaf))
+			continue;
+
+		for(int z = first_z; z <= last_z; ++z) {
+			Floor* floor = leaf->getFloor(z);
+			if(!floor)
+				continue;
+
+			for(TileLocation& location : floor->locs) {
+				Tile* tile = location.get();
+				if(tile && (!use_area || isInArea(location.getX(), location.getY())))
+					visit(tile);
+			}
+		}
+	}
+}
+
+bool MapTraversal::run(size_t slots, const std::function<void(size_t, size_t)>& work, const std::function<void(size_t)>& merge)
+{
+	prepare();
+
+	size_t chunks;
+	if(use_positions) {
+		chunks = (positions.size() + PositionsPerChunk - 1) / PositionsPerChunk;
+	} else {
+		leaves.clear();
+		map.getLeaves(leaves);
+		if(use_area) {
+			leaves.erase(std::remove_if(leaves.begin(), leaves.end(), [this](QTreeNode* leaf) {
+				return !isLeafInArea(leaf);
+			}), leaves.end());
+		}
+		chunks = (leaves.size() + LeavesPerChunk - 1) / LeavesPerChunk;
+	}
+
+	WorkerPool& pool = WorkerPool::getInstance();
+	for(size_t first = 0; first < chunks; first += slots) {
+		if(isCancelled())
+			return false;
+
+		size_t count = std::min(slots, chunks - first);
+		pool.run(count, [&](size_t task) {
+			if(!isCancelled())
+				work(first + task, task);
+		});
+
+		// Some chunks of the batch may have been skipped
+		if(isCancelled())
+			return false;
+
+		for(size_t slot = 0; slot < count; ++slot) {
+			merge(slot);
+		}
+
+		if(progress)
+			progress(int(100 * (first + count) / chunks));
+	}
+	return !isCancelled();
+}
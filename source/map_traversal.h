@@ -0,0 +1,186 @@
+//////////////////////////////////////////////////////////////////////
+// This file is part of Remere's Map Editor
+//////////////////////////////////////////////////////////////////////
+// Remere's Map Editor is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// Remere's Map Editor is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <http://www.gnu.org/licenses/>.
+//////////////////////////////////////////////////////////////////////
+
+#ifndef RME_MAP_TRAVERSAL_H_
+#define RME_MAP_TRAVERSAL_H_
+
+#include "map.h"
+
+#include <atomic>
+#include <functional>
+
+class Selection;
+
+// Walks the tiles of a map on all cores. The map is split into chunks of
+// quad tree leaves (or of positions, when only some tiles are of interest)
+// and every chunk fills an accumulator of its own. Those are merged on the
+// calling thread in map order, so results don't depend on how the work was
+// split. Visit functions run on worker threads and must not change the map,
+// other than the items of the tile they were given, changes are collected
+// and applied once the tiles have been visited.
+class MapTraversal
+{
+public:
+	explicit MapTraversal(Map& map);
+
+	MapTraversal(const MapTraversal&) = delete;
+	MapTraversal& operator=(const MapTraversal&) = delete;
+
+	Map& getMap() noexcept { return map; }
+
+	// Only visits the selected tiles, sorted by floor, row and column. The
+	// cost depends on the size of the selection, not of the map.
+	void setSelection(const Selection& selection);
+	// Only visits these tiles, in this order, instead of the whole map
+	void setPositions(PositionVector new_positions);
+	// Only visits the tiles inside the box, leaves and floors outside of it
+	// are not read at all
+	void setArea(const Position& from, const Position& to);
+	// Only visits the tiles the item index lists for the id, or for any id
+	// of the kind. The whole map is visited if the index is turned off,
+	// without the leaves whose summary doesn't have any of the item ids.
+	bool useItemIndex(ItemIndex::Key key, uint16_t id);
+	bool useItemIndex(ItemIndex::Key key);
+	// Passes over the leaves for which filter(summary) is false when the
+	// whole map is visited. Called on the worker threads.
+	void setLeafFilter(std::function<bool(const LeafSummary&)> filter) { leaf_filter = std::move(filter); }
+
+	// Called on the calling thread with 0 to 100 as chunks are done
+	void setProgress(std::function<void(int)> callback) { progress = std::move(callback); }
+	// Can be called from any thread, the chunks being worked on are finished
+	// but not merged anymore
+	void cancel() noexcept { cancelled.store(true, std::memory_order_relaxed); }
+	bool isCancelled() const noexcept { return cancelled.load(std::memory_order_relaxed); }
+
+	// Calls visit(accumulator, tile) on the worker threads and merge(result,
+	// accumulator) on this one. False if it was cancelled, result holds what
+	// was merged until then.
+	template <typename Accumulator, typename Visit, typename Merge>
+	bool forEachTile(Accumulator& result, Visit visit, Merge merge);
+	// Same with visit(accumulator, tile, item), for grounds, items and the
+	// contents of containers
+	template <typename Accumulator, typename Visit, typename Merge>
+	bool forEachItem(Accumulator& result, Visit visit, Merge merge);
+
+	// Items for which predicate(item) is true, in map order. Stops once limit
+	// items were found, 0 for no limit.
+	template <typename Predicate>
+	std::vector<std::pair<Tile*, Item*>> findItems(Predicate predicate, size_t limit = 0);
+
+	static constexpr size_t LeavesPerChunk = 64;
+	static constexpr size_t PositionsPerChunk = 1024;
+
+private:
+	template <typename Accumulator, typename Visit>
+	static void visitItem(Accumulator& accumulator, Tile* tile, Item* item, Visit& visit);
+
+	bool addIndexed(bool indexed, PositionVector& found);
+	// Leaves only the positions that are also selected and inside the area
+	void prepare();
+	bool isInArea(int x, int y) const noexcept {
+		return x >= area_from.x && x <= area_to.x && y >= area_from.y && y <= area_to.y;
+	}
+	bool isLeafInArea(QTreeNode* leaf);
+	// False if the summary shows no tile of the leaf can be of interest
+	bool isLeafWanted(QTreeNode* leaf);
+	size_t getBatchSize() const;
+	// Calls visit for every tile of the chunk that passes the filters
+	void visitChunk(size_t chunk, const std::function<void(Tile*)>& visit);
+	// Runs work(chunk, slot) for batches of slots chunks on the worker pool,
+	// then merge(slot) for all of them in order
+	bool run(size_t slots, const std::function<void(size_t, size_t)>& work, const std::function<void(size_t)>& merge);
+
+	Map& map;
+	std::vector<QTreeNode*> leaves;
+	PositionVector positions;
+	PositionVector selected;
+	Position area_from;
+	Position area_to;
+	bool use_positions;
+	bool use_selection;
+	bool use_area;
+	// Item ids the index would have been used for
+	std::vector<uint16_t> filter_ids;
+	std::function<bool(const LeafSummary&)> leaf_filter;
+	std::function<void(int)> progress;
+	std::atomic<bool> cancelled;
+};
+
+template <typename Accumulator, typename Visit, typename Merge>
+inline bool MapTraversal::forEachTile(Accumulator& result, Visit visit, Merge merge)
+{
+	std::vector<Accumulator> accumulators(getBatchSize());
+	return run(accumulators.size(),
+		[&](size_t chunk, size_t slot) {
+			Accumulator& accumulator = accumulators[slot];
+			visitChunk(chunk, [&](Tile* tile) { visit(accumulator, tile); });
+		},
+		[&](size_t slot) {
+			merge(result, accumulators[slot]);
+			accumulators[slot] = Accumulator();
+		});
+}
+
+template <typename Accumulator, typename Visit, typename Merge>
+inline bool MapTraversal::forEachItem(Accumulator& result, Visit visit, Merge merge)
+{
+	return forEachTile(result,
+		[&visit](Accumulator& accumulator, Tile* tile) {
+			if(tile->ground)
+				visitItem(accumulator, tile, tile->ground, visit);
+			for(Item* item : tile->items) {
+				visitItem(accumulator, tile, item, visit);
+			}
+		},
+		merge);
+}
+
+template <typename Accumulator, typename Visit>
+inline void MapTraversal::visitItem(Accumulator& accumulator, Tile* tile, Item* item, Visit& visit)
+{
+	visit(accumulator, tile, item);
+	if(Container* container = item->getContainer()) {
+		for(Item* content : container->getVector()) {
+			visitItem(accumulator, tile, content, visit);
+		}
+	}
+}
+
+template <typename Predicate>
+inline std::vector<std::pair<Tile*, Item*>> MapTraversal::findItems(Predicate predicate, size_t limit)
+{
+	using Found = std::vector<std::pair<Tile*, Item*>>;
+	Found result;
+	forEachItem(result,
+		[&predicate](Found& chunk, Tile* tile, Item* item) {
+			if(predicate(item))
+				chunk.emplace_back(tile, item);
+		},
+		[this, limit](Found& all, Found& chunk) {
+			if(limit != 0 && all.size() >= limit)
+				return;
+
+			all.insert(all.end(), chunk.begin(), chunk.end());
+			if(limit != 0 && all.size() >= limit) {
+				all.resize(limit);
+				cancel();
+			}
+		});
+	return result;
+}
+
+#endif
@@ -18,6 +18,45 @@
 #include "main.h"
 #include "net_connection.h"
 
+// NetworkBufferPool
+NetworkBufferPool& NetworkBufferPool::getInstance()
+{
+	// Never destroyed, buffers may still be released by pending handlers
+	// while static objects are torn down.
+	static NetworkBufferPool* pool = newd NetworkBufferPool;
+	return *pool;
+}
+
+NetworkBufferPool::BufferPtr NetworkBufferPool::acquire()
+{
+	Buffer* buffer = nullptr;
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		if(!freeBuffers.empty()) {
+			buffer = freeBuffers.back();
+			freeBuffers.pop_back();
+		}
+	}
+
+	if(!buffer) {
+		buffer = newd Buffer(SlabSize);
+	}
+	return BufferPtr(buffer, [this](Buffer* buffer) { release(buffer); });
+}
+
+void NetworkBufferPool::release(Buffer* buffer)
+{
+	if(buffer->size() <= MaxPooledSize) {
+		std::lock_guard<std::mutex> lock(mutex);
+		if(freeBuffers.size() < MaxPooledBuffers) {
+			freeBuffers.push_back(buffer);
+			return;
+		}
+	}
+	delete buffer;
+}
+
+// NetworkMessage
 NetworkMessage::NetworkMessage()
 {
 	clear();
@@ -25,25 +64,45 @@ NetworkMessage::NetworkMessage()
 
 void NetworkMessage::clear()
 {
-	buffer.resize(4);
+	buffer = NetworkBufferPool::getInstance().acquire();
 	position = 4;
 	size = 0;
+	error = false;
 }
 
 void NetworkMessage::expand(const size_t length)
 {
-	if(position + length >= buffer.size()) {
-		buffer.resize(position + length + 1);
+	const size_t required = position + length;
+	if(required > buffer->size()) {
+		buffer->resize(std::max(required, buffer->size() * 2));
 	}
 	size += length;
 }
 
+void NetworkMessage::writeBytes(const uint8_t* bytes, size_t length)
+{
+	expand(length);
+	if(length > 0) {
+		memcpy(&(*buffer)[position], bytes, length);
+		position += length;
+	}
+}
+
 template<> std::string NetworkMessage::read<std::string>()
+{
+	return std::string(read<std::string_view>());
+}
+
+template<> std::string_view NetworkMessage::read<std::string_view>()
 {
 	const uint16_t length = read<uint16_t>();
-	char* strBuffer = reinterpret_cast<char*>(&buffer[position]);
+	if(!canRead(length)) {
+		return std::string_view();
+	}
+
+	const char* data = reinterpret_cast<const char*>(&(*buffer)[position]);
 	position += length;
-	return std::string(strBuffer, length);
+	return std::string_view(data, length);
 }
 
 template<> Position NetworkMessage::read<Position>()
@@ -56,13 +115,15 @@ template<> Position NetworkMessage::read<Position>()
 }
 
 template<> void NetworkMessage::write<std::string>(const std::string& value)
+{
+	write<std::string_view>(value);
+}
+
+template<> void NetworkMessage::write<std::string_view>(const std::string_view& value)
 {
 	const size_t length = value.length();
 	write<uint16_t>(length);
-
-	expand(length);
-	memcpy(&buffer[position], &value[0], length);
-	position += length;
+	writeBytes(reinterpret_cast<const uint8_t*>(value.data()), length);
 }
 
 template<> void NetworkMessage::write<Position>(const Position& value)
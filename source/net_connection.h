@@ -21,11 +21,42 @@
 #include "position.h"
 
 #include <string>
+#include <string_view>
 #include <vector>
 #include <cstdint>
+#include <memory>
 #include <thread>
 #include <mutex>
 
+// Message buffers are recycled so the live hot path doesn't allocate once
+// it has warmed up. A buffer goes back to the pool when the last message
+// (or pending asio write) holding it lets go.
+class NetworkBufferPool
+{
+	public:
+		using Buffer = std::vector<uint8_t>;
+		using BufferPtr = std::shared_ptr<Buffer>;
+
+		static NetworkBufferPool& getInstance();
+
+		BufferPtr acquire();
+
+		static constexpr size_t SlabSize = 8 * 1024;
+		static constexpr size_t MaxPooledBuffers = 256;
+		static constexpr size_t MaxPooledSize = 1024 * 1024;
+
+	private:
+		NetworkBufferPool() = default;
+		void release(Buffer* buffer);
+
+		std::mutex mutex;
+		std::vector<Buffer*> freeBuffers;
+};
+
+// Layout of buffer: 4 byte size header followed by size bytes of payload.
+// Reads are bounds checked, reading past the payload returns a zero value
+// and flags the message as malformed, callers check hasError() before
+// trusting anything they read.
 struct NetworkMessage
 {
 	NetworkMessage();
@@ -36,27 +67,54 @@ struct NetworkMessage
 	//
 	template<typename T> T read()
 	{
-		T& value = *reinterpret_cast<T*>(&buffer[position]);
-		position += sizeof(T);
+		T value = T();
+		if(canRead(sizeof(T))) {
+			memcpy(&value, &(*buffer)[position], sizeof(T));
+			position += sizeof(T);
+		}
 		return value;
 	}
 
 	template<typename T> void write(const T& value)
 	{
 		expand(sizeof(T));
-		memcpy(&buffer[position], &value, sizeof(T));
+		memcpy(&(*buffer)[position], &value, sizeof(T));
 		position += sizeof(T);
 	}
 
+	void writeBytes(const uint8_t* bytes, size_t length);
+
+	bool canRead(size_t length)
+	{
+		if(error || position + length > size + 4) {
+			error = true;
+			return false;
+		}
+		return true;
+	}
+
+	bool isEnd() const noexcept { return error || position >= size + 4; }
+	bool hasError() const noexcept { return error; }
+	uint8_t* getData() noexcept { return buffer->data(); }
+
+	// Largest payload a peer may announce, anything bigger is rejected
+	// before a buffer is allocated for it.
+	static constexpr uint32_t MaxPacketSize = 4 * 1024 * 1024;
+
 	//
-	std::vector<uint8_t> buffer;
+	NetworkBufferPool::BufferPtr buffer;
 	size_t position;
 	size_t size;
+	bool error;
 };
 
+// The view points into the message buffer, it is only valid as long as
+// the message is.
 template<> std::string NetworkMessage::read<std::string>();
+template<> std::string_view NetworkMessage::read<std::string_view>();
 template<> Position NetworkMessage::read<Position>();
 template<> void NetworkMessage::write<std::string>(const std::string& value);
+template<> void NetworkMessage::write<std::string_view>(const std::string_view& value);
 template<> void NetworkMessage::write<Position>(const Position& value);
 
 class NetworkConnection
@@ -0,0 +1,191 @@
+//////////////////////////////////////////////////////////////////////
+// This file is part of Remere's Map Editor
+//////////////////////////////////////////////////////////////////////
+// Remere's Map Editor is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// Remere's Map Editor is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <http://www.gnu.org/licenses/>.
+//////////////////////////////////////////////////////////////////////
+
+#include "main.h"
+
+#include "overview_drawer.h"
+#include "basemap.h"
+#include "map_region.h"
+#include "graphics.h"
+#include "gui.h"
+#include "frame_profiler.h"
+
+namespace {
+	// Regions kept around before the ones off screen are released, 16 MB of textures
+	constexpr size_t MaxCachedRegions = 1024;
+	constexpr int RegionLeaves = OverviewDrawer::RegionSize / 4;
+}
+
+OverviewDrawer::OverviewDrawer() :
+	map_generation(0),
+	gfx_generation(0),
+	frame(0)
+{
+	buffer.resize(static_cast<size_t>(RegionSize * RegionSize * rme::PixelFormatRGBA));
+}
+
+OverviewDrawer::~OverviewDrawer()
+{
+	clear();
+}
+
+void OverviewDrawer::beginFrame(BaseMap& map)
+{
+	if(map.getRenderGeneration() != map_generation || g_gui.gfx.getGeneration() != gfx_generation) {
+		clear();
+		map_generation = map.getRenderGeneration();
+		gfx_generation = g_gui.gfx.getGeneration();
+	}
+	++frame;
+}
+
+void OverviewDrawer::draw(BaseMap& map, int map_x, int map_y, int map_z, int x, int y)
+{
+	uint64_t key = (uint64_t(uint16_t(map_x)) << 24) | (uint64_t(uint16_t(map_y)) << 8) | uint64_t(map_z);
+	auto it = regions.find(key);
+	if(it == regions.end()) {
+		it = regions.emplace(key, Region()).first;
+		Region& region = it->second;
+		region.stamp = getStamp(map, map_x, map_y, map_z);
+		region.tile_revision = map.getTileRevision();
+		bake(map, region, map_x, map_y, map_z);
+	}
+
+	Region& region = it->second;
+	region.last_frame = frame;
+
+	// Only look at the leaves again when something on the map was replaced
+	if(region.tile_revision != map.getTileRevision()) {
+		region.tile_revision = map.getTileRevision();
+		uint64_t stamp = getStamp(map, map_x, map_y, map_z);
+		if(stamp != region.stamp) {
+			region.stamp = stamp;
+			bake(map, region, map_x, map_y, map_z);
+		}
+	}
+
+	if(region.empty)
+		return;
+
+	constexpr int size = RegionSize * rme::TileSize;
+
+	g_profiler.count(FrameProfiler::TEXTURE_BINDS);
+	g_profiler.count(FrameProfiler::DRAW_CALLS);
+	glBindTexture(GL_TEXTURE_2D, region.texture);
+	glColor4ub(255, 255, 255, 255);
+	glBegin(GL_QUADS);
+		glTexCoord2f(0.f, 0.f); glVertex2f(x, y);
+		glTexCoord2f(1.f, 0.f); glVertex2f(x + size, y);
+		glTexCoord2f(1.f, 1.f); glVertex2f(x + size, y + size);
+		glTexCoord2f(0.f, 1.f); glVertex2f(x, y + size);
+	glEnd();
+}
+
+void OverviewDrawer::endFrame()
+{
+	if(regions.size() <= MaxCachedRegions)
+		return;
+
+	for(auto it = regions.begin(); it != regions.end();) {
+		Region& region = it->second;
+		if(region.last_frame != frame) {
+			if(region.texture != 0)
+				glDeleteTextures(1, &region.texture);
+			it = regions.erase(it);
+		} else {
+			++it;
+		}
+	}
+}
+
+void OverviewDrawer::clear()
+{
+	for(auto& pair : regions) {
+		if(pair.second.texture != 0)
+			glDeleteTextures(1, &pair.second.texture);
+	}
+	regions.clear();
+}
+
+uint64_t OverviewDrawer::getStamp(BaseMap& map, int map_x, int map_y, int map_z) const
+{
+	// Floors take the map wide tile revision, so any replaced tile changes the
+	// stamp, also on floors that were deleted and made again
+	uint64_t stamp = 14695981039346656037ULL;
+	for(int lx = 0; lx < RegionLeaves; ++lx) {
+		for(int ly = 0; ly < RegionLeaves; ++ly) {
+			uint64_t revision = 0;
+			if(QTreeNode* leaf = map.getLeaf(map_x + lx * 4, map_y + ly * 4)) {
+				if(const Floor* floor = leaf->getFloor(map_z))
+					revision = uint64_t(floor->revision) + 1;
+			}
+			stamp = (stamp ^ revision) * 1099511628211ULL;
+		}
+	}
+	return stamp;
+}
+
+void OverviewDrawer::bake(BaseMap& map, Region& region, int map_x, int map_y, int map_z)
+{
+	std::fill(buffer.begin(), buffer.end(), 0);
+
+	region.empty = true;
+	for(int lx = 0; lx < RegionLeaves; ++lx) {
+		for(int ly = 0; ly < RegionLeaves; ++ly) {
+			QTreeNode* leaf = map.getLeaf(map_x + lx * 4, map_y + ly * 4);
+			Floor* floor = leaf ? leaf->getFloor(map_z) : nullptr;
+			if(!floor)
+				continue;
+
+			for(int i = 0; i < rme::MapLayers; ++i) {
+				const Tile* tile = floor->locs[i].get();
+				if(!tile)
+					continue;
+
+				uint8_t color = tile->getMiniMapColor();
+				if(color == 0)
+					continue;
+
+				// Floor locations are stored column by column
+				int tx = lx * 4 + (i >> 2);
+				int ty = ly * 4 + (i & 3);
+				wxColor rgb = colorFromEightBit(color);
+				uint8_t* pixel = &buffer[(ty * RegionSize + tx) * rme::PixelFormatRGBA];
+				pixel[0] = rgb.Red();
+				pixel[1] = rgb.Green();
+				pixel[2] = rgb.Blue();
+				pixel[3] = 255;
+				region.empty = false;
+			}
+		}
+	}
+
+	if(region.empty)
+		return;
+
+	if(region.texture == 0) {
+		glGenTextures(1, &region.texture);
+		g_profiler.count(FrameProfiler::TEXTURES_CREATED);
+	}
+
+	glBindTexture(GL_TEXTURE_2D, region.texture);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, 0x812F); // GL_CLAMP_TO_EDGE
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, 0x812F); // GL_CLAMP_TO_EDGE
+	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, RegionSize, RegionSize, 0, GL_RGBA, GL_UNSIGNED_BYTE, buffer.data());
+}
@@ -0,0 +1,67 @@
+//////////////////////////////////////////////////////////////////////
+// This file is part of Remere's Map Editor
+//////////////////////////////////////////////////////////////////////
+// Remere's Map Editor is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// Remere's Map Editor is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <http://www.gnu.org/licenses/>.
+//////////////////////////////////////////////////////////////////////
+
+#ifndef RME_OVERVIEW_DRAWER_H_
+#define RME_OVERVIEW_DRAWER_H_
+
+#include <unordered_map>
+
+class BaseMap;
+
+// Draws the map with one texel per tile when zoomed far out. The tile
+// minimap colors of each region are baked into a texture, which is only
+// baked again after a tile inside the region was replaced.
+class OverviewDrawer
+{
+	struct Region {
+		GLuint texture = 0;
+		uint64_t stamp = 0;
+		uint32_t tile_revision = 0;
+		uint32_t last_frame = 0;
+		bool empty = true;
+	};
+
+public:
+	// Width and height of a region in tiles, a multiple of the leaf size
+	static constexpr int RegionSize = 64;
+
+	OverviewDrawer();
+	~OverviewDrawer();
+
+	OverviewDrawer(const OverviewDrawer&) = delete;
+	OverviewDrawer& operator=(const OverviewDrawer&) = delete;
+
+	// Drops every region when the map was edited in place or the client data was reloaded
+	void beginFrame(BaseMap& map);
+	// Draws the region whose top left tile is map_x, map_y at screen position x, y
+	void draw(BaseMap& map, int map_x, int map_y, int map_z, int x, int y);
+	// Releases the textures of regions that went off screen once there are too many
+	void endFrame();
+	void clear();
+
+private:
+	uint64_t getStamp(BaseMap& map, int map_x, int map_y, int map_z) const;
+	void bake(BaseMap& map, Region& region, int map_x, int map_y, int map_z);
+
+	std::unordered_map<uint64_t, Region> regions;
+	std::vector<uint8_t> buffer;
+	uint32_t map_generation;
+	uint32_t gfx_generation;
+	uint32_t frame;
+};
+
+#endif
@@ -107,9 +107,9 @@ wxNotebookPage* PreferencesWindow::CreateGeneralPage()
 	SetWindowToolTip(tmptext, undo_mem_size_spin, "The approximite limit for the memory usage of the undo queue.");
 
 	grid_sizer->Add(tmptext = newd wxStaticText(general_page, wxID_ANY, "Worker Threads: "), 0);
-	worker_threads_spin = newd wxSpinCtrl(general_page, wxID_ANY, i2ws(g_settings.getInteger(Config::WORKER_THREADS)), wxDefaultPosition, wxDefaultSize, wxSP_ARROW_KEYS, 1, 64);
+	worker_threads_spin = newd wxSpinCtrl(general_page, wxID_ANY, i2ws(g_settings.getInteger(Config::WORKER_THREADS)), wxDefaultPosition, wxDefaultSize, wxSP_ARROW_KEYS, 0, 64);
 	grid_sizer->Add(worker_threads_spin, 0);
-	SetWindowToolTip(tmptext, worker_threads_spin, "How many threads the editor will use for intensive operations. This should be equivalent to the amount of logical processors in your system.");
+	SetWindowToolTip(tmptext, worker_threads_spin, "How many threads the editor will use for intensive operations, 0 uses one per logical processor in your system. Takes effect after restarting the editor.");
 
 	grid_sizer->Add(tmptext = newd wxStaticText(general_page, wxID_ANY, "Replace count: "), 0);
 	replace_size_spin = newd wxSpinCtrl(general_page, wxID_ANY, i2ws(g_settings.getInteger(Config::REPLACE_SIZE)), wxDefaultPosition, wxDefaultSize, wxSP_ARROW_KEYS, 0, 100000);
@@ -193,6 +193,18 @@ wxNotebookPage* PreferencesWindow::CreateEditorPage()
 	merge_paste_chkbox->SetToolTip("Pasted tiles won't replace already placed tiles.");
 	sizer->Add(merge_paste_chkbox, 0, wxLEFT | wxTOP, 5);
 
+	sizer->AddSpacer(10);
+
+	item_index_chkbox = newd wxCheckBox(editor_page, wxID_ANY, "Index items for searching");
+	item_index_chkbox->SetValue(g_settings.getBoolean(Config::USE_ITEM_INDEX));
+	item_index_chkbox->SetToolTip("Keeps a list of where every item, action id and unique id is on the map, so searching and replacing items doesn't go through the whole map. Uses some memory, the amount is shown in the map statistics.");
+	sizer->Add(item_index_chkbox, 0, wxLEFT | wxTOP, 5);
+
+	bulk_undo_on_disk_chkbox = newd wxCheckBox(editor_page, wxID_ANY, "Keep undo data of map wide tools on disk");
+	bulk_undo_on_disk_chkbox->SetValue(g_settings.getBoolean(Config::BULK_UNDO_ON_DISK));
+	bulk_undo_on_disk_chkbox->SetToolTip("Tools that change the whole map, like removing or replacing items, write the tiles needed to undo them to a temporary file instead of keeping them in memory. Undoing them takes longer.");
+	sizer->Add(bulk_undo_on_disk_chkbox, 0, wxLEFT | wxTOP, 5);
+
 	editor_page->SetSizerAndFit(sizer);
 
 	return editor_page;
@@ -605,6 +617,16 @@ void PreferencesWindow::Apply()
 	g_settings.setInteger(Config::RAW_LIKE_SIMONE, allow_multiple_orderitems_chkbox->GetValue());
 	g_settings.setInteger(Config::MERGE_MOVE, merge_move_chkbox->GetValue());
 	g_settings.setInteger(Config::MERGE_PASTE, merge_paste_chkbox->GetValue());
+	if(g_settings.getBoolean(Config::USE_ITEM_INDEX) && !item_index_chkbox->GetValue()) {
+		// Turning it on builds it with the next search
+		for(int index = 0; index < g_gui.GetTabCount(); ++index) {
+			if(auto* tab = dynamic_cast<MapTab*>(g_gui.GetTab(index))) {
+				tab->GetMap()->invalidateItemIndex();
+			}
+		}
+	}
+	g_settings.setInteger(Config::USE_ITEM_INDEX, item_index_chkbox->GetValue());
+	g_settings.setInteger(Config::BULK_UNDO_ON_DISK, bulk_undo_on_disk_chkbox->GetValue());
 
 	// Graphics
 	g_settings.setInteger(Config::USE_GUI_SELECTION_SHADOW, icon_selection_shadow_chkbox->GetValue());
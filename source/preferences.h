@@ -67,6 +67,8 @@ protected:
 	wxCheckBox* allow_multiple_orderitems_chkbox;
 	wxCheckBox* merge_move_chkbox;
 	wxCheckBox* merge_paste_chkbox;
+	wxCheckBox* item_index_chkbox;
+	wxCheckBox* bulk_undo_on_disk_chkbox;
 
 	// Graphics
 	wxCheckBox* icon_selection_shadow_chkbox;
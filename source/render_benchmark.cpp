@@ -0,0 +1,281 @@
+//////////////////////////////////////////////////////////////////////
+// This file is part of Remere's Map Editor
+//////////////////////////////////////////////////////////////////////
+// Remere's Map Editor is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// Remere's Map Editor is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <http://www.gnu.org/licenses/>.
+//////////////////////////////////////////////////////////////////////
+
+#include "main.h"
+
+#include "render_benchmark.h"
+#include "map.h"
+#include "map_display.h"
+#include "map_window.h"
+#include "gui.h"
+
+#include <chrono>
+#include <iomanip>
+
+namespace {
+	struct OptionName {
+		const char* name;
+		bool DrawingOptions::* option;
+	};
+
+	const OptionName optionNames[] = {
+		{ "ingame-box", &DrawingOptions::show_ingame_box },
+		{ "lights", &DrawingOptions::show_lights },
+		{ "all-floors", &DrawingOptions::show_all_floors },
+		{ "ghost-floors", &DrawingOptions::transparent_floors },
+		{ "ghost-items", &DrawingOptions::transparent_items },
+		{ "shade", &DrawingOptions::show_shade },
+		{ "creatures", &DrawingOptions::show_creatures },
+		{ "spawns", &DrawingOptions::show_spawns },
+		{ "houses", &DrawingOptions::show_houses },
+		{ "special", &DrawingOptions::show_special_tiles },
+		{ "items", &DrawingOptions::show_items },
+		{ "tooltips", &DrawingOptions::show_tooltips },
+		{ "preview", &DrawingOptions::show_preview },
+		{ "minimap", &DrawingOptions::show_as_minimap },
+	};
+
+	// Nearest rank, times must be sorted
+	double percentile(const std::vector<double>& times, double rank)
+	{
+		size_t index = size_t(std::ceil(rank / 100.0 * times.size()));
+		return times[std::clamp<size_t>(index, 1, times.size()) - 1];
+	}
+}
+
+RenderBenchmark::RenderBenchmark(Map& map, MapCanvas& canvas) :
+	m_map(map),
+	m_canvas(canvas)
+{
+	////
+}
+
+bool RenderBenchmark::load(const std::string& path)
+{
+	pugi::xml_document doc;
+	pugi::xml_parse_result result = doc.load_file(path.c_str());
+	if(!result) {
+		m_error = "Could not open " + path + " (file not found or syntax error)";
+		return false;
+	}
+
+	pugi::xml_node node = doc.child("benchmark");
+	if(!node) {
+		m_error = path + ": Invalid rootheader.";
+		return false;
+	}
+
+	m_steps.clear();
+	Step step;
+	for(pugi::xml_node stepNode = node.child("step"); stepNode; stepNode = stepNode.next_sibling("step")) {
+		step.name = stepNode.attribute("name").as_string();
+		step.x = stepNode.attribute("x").as_double(step.x);
+		step.y = stepNode.attribute("y").as_double(step.y);
+		step.z = std::clamp(stepNode.attribute("z").as_int(step.z), 0, rme::MapMaxLayer);
+		step.zoom = std::clamp(stepNode.attribute("zoom").as_double(step.zoom), 0.125, 25.0);
+		step.frames = std::max(1, stepNode.attribute("frames").as_int(1));
+
+		step.options.clear();
+		for(const OptionName& option : optionNames) {
+			pugi::xml_attribute attribute = stepNode.attribute(option.name);
+			if(attribute)
+				step.options.emplace_back(option.option, attribute.as_bool());
+		}
+		m_steps.push_back(step);
+	}
+
+	if(m_steps.empty()) {
+		m_error = path + ": The camera path has no steps.";
+		return false;
+	}
+	return true;
+}
+
+void RenderBenchmark::createDefaultPath()
+{
+	Position start(m_map.getWidth() / 2, m_map.getHeight() / 2, rme::MapGroundLayer);
+	for(const auto& town : m_map.towns) {
+		if(town.second->getTemplePosition().isValid()) {
+			start = town.second->getTemplePosition();
+			break;
+		}
+	}
+
+	auto add = [this](const std::string& name, double x, double y, int z, double zoom, int frames) -> Step& {
+		Step& step = m_steps.emplace_back();
+		step.name = name;
+		step.x = x;
+		step.y = y;
+		step.z = z;
+		step.zoom = zoom;
+		step.frames = frames;
+		return step;
+	};
+
+	const double x = start.x;
+	const double y = start.y;
+	const int z = start.z;
+	const int lower = std::min(z + 1, int(rme::MapMaxLayer));
+
+	m_steps.clear();
+	add("settle", x, y, z, 1.0, 30);
+	add("pan east", x + 40, y, z, 1.0, 120);
+	add("pan south", x + 40, y + 40, z, 1.0, 120);
+	add("pan back", x, y, z, 1.0, 120);
+	add("zoom out", x, y, z, 4.0, 60);
+	add("pan zoomed out", x + 80, y + 80, z, 4.0, 120);
+	add("zoom in", x, y, z, 1.0, 60);
+	add("floor down", x, y, lower, 1.0, 30);
+	add("floor up", x, y, z, 1.0, 30);
+	add("single floor", x, y, z, 1.0, 60).options.emplace_back(&DrawingOptions::show_all_floors, false);
+	add("all floors", x, y, z, 1.0, 60).options.emplace_back(&DrawingOptions::show_all_floors, true);
+
+	Step& lights = add("lights", x + 20, y + 20, z, 1.0, 120);
+	lights.options.emplace_back(&DrawingOptions::show_ingame_box, true);
+	lights.options.emplace_back(&DrawingOptions::show_lights, true);
+
+	Step& no_lights = add("no lights", x, y, z, 1.0, 30);
+	no_lights.options.emplace_back(&DrawingOptions::show_ingame_box, false);
+	no_lights.options.emplace_back(&DrawingOptions::show_lights, false);
+
+	add("no creatures", x + 20, y, z, 1.0, 60).options.emplace_back(&DrawingOptions::show_creatures, false);
+	add("creatures", x, y, z, 1.0, 60).options.emplace_back(&DrawingOptions::show_creatures, true);
+}
+
+bool RenderBenchmark::run()
+{
+	if(m_steps.empty()) {
+		m_error = "The camera path has no steps.";
+		return false;
+	}
+
+	MapWindow* window = m_canvas.GetMapWindow();
+	m_canvas.GetSize(&m_width, &m_height);
+	if(m_width <= 0 || m_height <= 0) {
+		m_error = "The map canvas has no size.";
+		return false;
+	}
+
+	// The defaults, not the settings of whoever runs it, so runs compare
+	DrawingOptions options;
+	options.SetDefault();
+
+	double x = m_steps.front().x;
+	double y = m_steps.front().y;
+	double zoom = m_steps.front().zoom;
+
+	m_times.clear();
+	for(const Step& step : m_steps) {
+		for(const auto& option : step.options) {
+			options.*option.first = option.second;
+		}
+
+		if(step.z != m_canvas.GetFloor())
+			m_canvas.ChangeFloor(step.z);
+
+		std::vector<double>& times = m_times.emplace_back();
+		times.reserve(step.frames);
+		for(int frame = 1; frame <= step.frames; ++frame) {
+			double t = double(frame) / step.frames;
+			m_canvas.SetZoom(zoom + (step.zoom - zoom) * t);
+
+			// Same as MapWindow::SetScreenCenterPosition, with sub tile steps
+			int scroll_x = int((x + (step.x - x) * t) * rme::TileSize);
+			int scroll_y = int((y + (step.y - y) * t) * rme::TileSize);
+			if(step.z <= rme::MapGroundLayer) {
+				scroll_x -= (rme::MapGroundLayer - step.z) * rme::TileSize;
+				scroll_y -= (rme::MapGroundLayer - step.z) * rme::TileSize;
+			}
+			window->Scroll(scroll_x, scroll_y, true);
+
+			auto start = std::chrono::steady_clock::now();
+			m_canvas.DrawOffscreen(options);
+			auto end = std::chrono::steady_clock::now();
+			times.push_back(std::chrono::duration<double, std::milli>(end - start).count());
+		}
+
+		x = step.x;
+		y = step.y;
+		zoom = step.zoom;
+	}
+
+	// Puts the last real frame back on screen
+	m_canvas.Refresh();
+	return true;
+}
+
+RenderBenchmark::Statistics RenderBenchmark::getStatistics(std::vector<double> times)
+{
+	Statistics statistics;
+	if(times.empty())
+		return statistics;
+
+	std::sort(times.begin(), times.end());
+	for(double time : times) {
+		statistics.total += time;
+	}
+	statistics.min = times.front();
+	statistics.max = times.back();
+	statistics.mean = statistics.total / times.size();
+	statistics.p50 = percentile(times, 50);
+	statistics.p90 = percentile(times, 90);
+	statistics.p95 = percentile(times, 95);
+	statistics.p99 = percentile(times, 99);
+	return statistics;
+}
+
+void RenderBenchmark::writeStatistics(std::ostream& stream, const Statistics& statistics, size_t frames)
+{
+	stream << "\"frames\": " << frames
+		<< ", \"total_ms\": " << statistics.total
+		<< ", \"fps\": " << (statistics.total > 0 ? frames * 1000.0 / statistics.total : 0.0)
+		<< ", \"frame_ms\": {"
+		<< "\"min\": " << statistics.min
+		<< ", \"mean\": " << statistics.mean
+		<< ", \"p50\": " << statistics.p50
+		<< ", \"p90\": " << statistics.p90
+		<< ", \"p95\": " << statistics.p95
+		<< ", \"p99\": " << statistics.p99
+		<< ", \"max\": " << statistics.max
+		<< "}";
+}
+
+void RenderBenchmark::writeReport(std::ostream& stream) const
+{
+	std::vector<double> all;
+	for(const std::vector<double>& times : m_times) {
+		all.insert(all.end(), times.begin(), times.end());
+	}
+
+	stream << std::fixed << std::setprecision(3);
+	stream << "{\n\t\"version\": ";
+	writeJsonString(stream, __RME_VERSION__);
+	stream << ",\n\t\"map\": ";
+	writeJsonString(stream, m_map.getFilename());
+	stream << ",\n\t\"width\": " << m_width << ",\n\t\"height\": " << m_height << ",\n\t";
+	writeStatistics(stream, getStatistics(all), all.size());
+	stream << ",\n\t\"steps\": [";
+
+	for(size_t i = 0; i < m_times.size(); ++i) {
+		stream << (i == 0 ? "\n" : ",\n") << "\t\t{\"name\": ";
+		writeJsonString(stream, m_steps[i].name);
+		stream << ", ";
+		writeStatistics(stream, getStatistics(m_times[i]), m_times[i].size());
+		stream << "}";
+	}
+	stream << "\n\t]\n}\n";
+}
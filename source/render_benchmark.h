@@ -0,0 +1,91 @@
+//////////////////////////////////////////////////////////////////////
+// This file is part of Remere's Map Editor
+//////////////////////////////////////////////////////////////////////
+// Remere's Map Editor is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// Remere's Map Editor is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <http://www.gnu.org/licenses/>.
+//////////////////////////////////////////////////////////////////////
+
+#ifndef RME_RENDER_BENCHMARK_H_
+#define RME_RENDER_BENCHMARK_H_
+
+#include "map_drawer.h"
+
+class Map;
+class MapCanvas;
+
+// Replays a camera path over the open map and times every frame MapDrawer
+// draws for it. Frames are drawn to the back buffer and never swapped, and
+// each one waits for the driver, so the times include the GPU work.
+//
+// A path is a list of steps, the camera moves linearly from where the last
+// step left it to the position and zoom of the step over its frames:
+//
+// <benchmark>
+//     <step name="start" x="1000" y="1000" z="7" zoom="1" frames="30"/>
+//     <step name="pan" x="1040" frames="120"/>
+//     <step name="lights" lights="true" ingame-box="true" frames="60"/>
+// </benchmark>
+//
+// Omitted attributes keep their previous value, drawing options are turned
+// on or off when the step starts.
+class RenderBenchmark
+{
+public:
+	struct Step {
+		std::string name;
+		double x = 0;
+		double y = 0;
+		int z = rme::MapGroundLayer;
+		double zoom = 1.0;
+		int frames = 1;
+		std::vector<std::pair<bool DrawingOptions::*, bool>> options;
+	};
+
+	RenderBenchmark(Map& map, MapCanvas& canvas);
+
+	bool load(const std::string& path);
+	// Pans, zooms, changes floors and toggles options around the first
+	// temple, or the middle of the map when there are no towns
+	void createDefaultPath();
+
+	bool run();
+	void writeReport(std::ostream& stream) const;
+
+	const std::string& getError() const noexcept { return m_error; }
+
+private:
+	struct Statistics {
+		double total = 0;
+		double min = 0;
+		double mean = 0;
+		double p50 = 0;
+		double p90 = 0;
+		double p95 = 0;
+		double p99 = 0;
+		double max = 0;
+	};
+
+	static Statistics getStatistics(std::vector<double> times);
+	static void writeStatistics(std::ostream& stream, const Statistics& statistics, size_t frames);
+
+	Map& m_map;
+	MapCanvas& m_canvas;
+	std::vector<Step> m_steps;
+	// Frame times in milliseconds, one list per step
+	std::vector<std::vector<double>> m_times;
+	int m_width = 0;
+	int m_height = 0;
+	std::string m_error;
+};
+
+#endif
@@ -22,6 +22,8 @@
 #include "gui.h"
 #include "artprovider.h"
 #include "items.h"
+#include "map_traversal.h"
+#include "bulk_action.h"
 
 // ============================================================================
 // ReplaceItemsButton
@@ -315,6 +317,36 @@ void ReplaceItemsDialog::OnRemoveButtonClicked(wxCommandEvent& WXUNUSED(event))
 	UpdateWidgets();
 }
 
+namespace {
+	bool hasItem(Item* item, uint16_t id)
+	{
+		if(item->getID() == id)
+			return true;
+		if(Container* container = item->getContainer()) {
+			for(Item* content : container->getVector()) {
+				if(hasItem(content, id))
+					return true;
+			}
+		}
+		return false;
+	}
+
+	// The contents of a container that is replaced itself are copied along
+	// with it and not looked at
+	void collectItems(Item* item, uint16_t id, std::vector<Item*>& found)
+	{
+		if(item->getID() == id) {
+			found.push_back(item);
+			return;
+		}
+		if(Container* container = item->getContainer()) {
+			for(Item* content : container->getVector()) {
+				collectItems(content, id, found);
+			}
+		}
+	}
+}
+
 void ReplaceItemsDialog::OnExecuteButtonClicked(wxCommandEvent& WXUNUSED(event))
 {
 	if(!g_gui.IsEditorOpen())
@@ -338,33 +370,51 @@ void ReplaceItemsDialog::OnExecuteButtonClicked(wxCommandEvent& WXUNUSED(event))
 
 	Editor* editor = tab->GetEditor();
 
+	const size_t limit = (size_t)std::max(0, g_settings.getInteger(Config::REPLACE_SIZE));
+
 	int done = 0;
+	std::vector<Item*> found;
 	for(const ReplacingItem& info : items) {
-		ItemFinder finder(info.replaceId, (uint32_t)g_settings.getInteger(Config::REPLACE_SIZE));
+		const uint16_t replaceId = info.replaceId;
+		const uint16_t withId = info.withId;
 
-		// search on map
-		foreach_ItemOnMap(editor->getMap(), finder, selectionOnly);
+		// The tiles are copied and replaced in chunks, undone as one
+		BulkOperation operation(*editor, ACTION_REPLACE_ITEMS);
+		MapTraversal& traversal = operation.getTraversal();
+		if(selectionOnly)
+			traversal.setSelection(editor->getSelection());
+		traversal.useItemIndex(ItemIndex::ITEM_ID, replaceId);
 
 		uint32_t total = 0;
-		const auto& result = finder.result;
-
-		if(!result.empty()) {
-			BatchAction* batch = editor->createBatch(ACTION_REPLACE_ITEMS);
-			Action* action = editor->createAction(batch);
-			for(const auto& pair : result) {
-				Tile* new_tile = pair.first->deepCopy(editor->getMap());
-				int index = pair.first->getIndexOf(pair.second);
-				ASSERT(index != wxNOT_FOUND);
-				Item* item = new_tile->getItemAt(index);
-				ASSERT(item && item->getID() == pair.second->getID());
-				transformItem(item, info.withId, new_tile);
-				action->addChange(new Change(new_tile));
-				total++;
-			}
-			batch->addAndCommitAction(action);
-			editor->addBatch(batch);
-			editor->updateActions();
-		}
+		operation.run(
+			[replaceId](Tile* tile) {
+				if(tile->ground && hasItem(tile->ground, replaceId))
+					return true;
+				for(Item* item : tile->items) {
+					if(hasItem(item, replaceId))
+						return true;
+				}
+				return false;
+			},
+			[&](Tile* tile) {
+				found.clear();
+				if(tile->ground)
+					collectItems(tile->ground, replaceId, found);
+				for(Item* item : tile->items) {
+					collectItems(item, replaceId, found);
+				}
+
+				int64_t replaced = 0;
+				for(Item* item : found) {
+					if(limit != 0 && total >= limit)
+						break;
+					transformItem(item, withId, tile);
+					++total;
+					++replaced;
+				}
+				return replaced;
+			});
+		operation.commit();
 
 		done++;
 		const int value = static_cast<int>((done / items.size()) * 100);
@@ -216,6 +216,7 @@ void Selection::clear()
 			tile->deselect();
 		}
 		tiles.clear();
+		editor.getMap().invalidateRender();
 	}
 }
 
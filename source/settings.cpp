@@ -214,6 +214,7 @@ void Settings::IO(IOMode mode)
 	Int(SHOW_WALL_HOOKS, 0);
 	Int(SHOW_PICKUPABLES, 0);
 	Int(SHOW_MOVEABLES, 0);
+	Int(SHOW_FRAME_PROFILER, 0);
 
 	section("Version");
 	Int(VERSION_ID, 0);
@@ -225,7 +226,7 @@ void Settings::IO(IOMode mode)
 
 	section("Editor");
 	String(RECENT_FILES, "");
-	Int(WORKER_THREADS, 1);
+	Int(WORKER_THREADS, 0);
 	Int(MERGE_MOVE, 0);
 	Int(MERGE_PASTE, 0);
 	Int(UNDO_SIZE, 400);
@@ -262,6 +263,12 @@ void Settings::IO(IOMode mode)
 	Int(SAVE_WITH_OTB_MAGIC_NUMBER, 0);
 	Int(REPLACE_SIZE, 500);
 	Int(COPY_POSITION_FORMAT, 0);
+	Int(LIVE_PREFETCH_RING, 2);
+	Int(LIVE_PREFETCH_LOOKAHEAD, 6);
+	Int(LIVE_MAX_PENDING_NODES, 256);
+	Int(USE_DATA_CACHE, 1);
+	Int(USE_ITEM_INDEX, 1);
+	Int(BULK_UNDO_ON_DISK, 0);
 
 	section("Graphics");
 	Int(TEXTURE_MANAGEMENT, 1);
@@ -273,6 +280,7 @@ void Settings::IO(IOMode mode)
 	Int(ICON_BACKGROUND, 0);
 	Int(HARD_REFRESH_RATE, 200);
 	Int(HIDE_ITEMS_WHEN_ZOOMED, 1);
+	Int(OVERVIEW_ZOOM, 12);
 	String(SCREENSHOT_DIRECTORY, "");
 	String(SCREENSHOT_FORMAT, "png");
 	IntToSave(USE_MEMCACHED_SPRITES, 0);
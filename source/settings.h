@@ -59,10 +59,12 @@ namespace Config {
 		SHOW_WALL_HOOKS,
 		SHOW_PICKUPABLES,
 		SHOW_MOVEABLES,
+		SHOW_FRAME_PROFILER,
 		SHOW_AS_MINIMAP,
 		SHOW_ONLY_TILEFLAGS,
 		SHOW_ONLY_MODIFIED_TILES,
 		HIDE_ITEMS_WHEN_ZOOMED,
+		OVERVIEW_ZOOM,
 		GROUP_ACTIONS,
 		SCROLL_SPEED,
 		ZOOM_SPEED,
@@ -129,6 +131,12 @@ namespace Config {
 		LISTBOX_EATS_ALL_EVENTS,
 		RAW_LIKE_SIMONE,
 		WORKER_THREADS,
+		LIVE_PREFETCH_RING,
+		LIVE_PREFETCH_LOOKAHEAD,
+		LIVE_MAX_PENDING_NODES,
+		USE_DATA_CACHE,
+		USE_ITEM_INDEX,
+		BULK_UNDO_ON_DISK,
 		COPY_POSITION_FORMAT,
 
 		GOTO_WEBSITE_ON_BOOT,
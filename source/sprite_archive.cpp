@@ -0,0 +1,226 @@
+//////////////////////////////////////////////////////////////////////
+// This file is part of Remere's Map Editor
+//////////////////////////////////////////////////////////////////////
+// Remere's Map Editor is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// Remere's Map Editor is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <http://www.gnu.org/licenses/>.
+//////////////////////////////////////////////////////////////////////
+
+#include "main.h"
+
+#include "sprite_archive.h"
+
+#ifdef __WINDOWS__
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+SpriteArchive::SpriteArchive() :
+	data(nullptr),
+	data_size(0),
+	mapped(false),
+#ifdef __WINDOWS__
+	file_handle(nullptr),
+	mapping_handle(nullptr),
+#endif
+	signature(0)
+{
+	////
+}
+
+SpriteArchive::~SpriteArchive()
+{
+	close();
+}
+
+bool SpriteArchive::open(const std::string& filename, bool extended, bool preload, wxString& error)
+{
+	close();
+
+	if(preload || !map(filename)) {
+		FILE* file = fopen(filename.c_str(), "rb");
+		if(!file) {
+			error = "Failed to open file for reading";
+			return false;
+		}
+
+		fseek(file, 0, SEEK_END);
+		long length = ftell(file);
+		fseek(file, 0, SEEK_SET);
+		if(length > 0) {
+			buffer.resize(length);
+			if(fread(buffer.data(), 1, buffer.size(), file) != buffer.size()) {
+				buffer.clear();
+			}
+		}
+		fclose(file);
+
+		if(buffer.empty()) {
+			error = "Failed to read sprite file";
+			return false;
+		}
+		data = buffer.data();
+		data_size = buffer.size();
+	}
+
+	const size_t header_size = extended ? 8 : 6;
+	if(data_size < header_size) {
+		error = "Sprite file is too small";
+		close();
+		return false;
+	}
+
+	memcpy(&signature, data, 4);
+
+	uint32_t count = 0;
+	if(extended) {
+		memcpy(&count, data + 4, 4);
+	} else {
+		uint16_t u16;
+		memcpy(&u16, data + 4, 2);
+		count = u16;
+	}
+
+	if(header_size + static_cast<size_t>(count) * 4 > data_size) {
+		error = "Sprite file is truncated";
+		close();
+		return false;
+	}
+
+	offsets.resize(count);
+	memcpy(offsets.data(), data + header_size, static_cast<size_t>(count) * 4);
+	return true;
+}
+
+void SpriteArchive::close()
+{
+	unmap();
+	buffer.clear();
+	buffer.shrink_to_fit();
+	offsets.clear();
+	data = nullptr;
+	data_size = 0;
+	signature = 0;
+}
+
+const uint8_t* SpriteArchive::getSprite(uint32_t id, uint16_t& size) const
+{
+	size = 0;
+	if(id == 0 || id > offsets.size()) {
+		return nullptr;
+	}
+
+	// Each sprite starts with a 3 byte color key and a 2 byte size
+	size_t offset = offsets[id - 1];
+	if(offset == 0 || offset + 5 > data_size) {
+		return nullptr;
+	}
+
+	uint16_t length;
+	memcpy(&length, data + offset + 3, 2);
+	if(offset + 5 + length > data_size) {
+		return nullptr;
+	}
+
+	size = length;
+	return length > 0 ? data + offset + 5 : nullptr;
+}
+
+#ifdef __WINDOWS__
+
+bool SpriteArchive::map(const std::string& filename)
+{
+	HANDLE file = CreateFileW(wxstr(filename).wc_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+	if(file == INVALID_HANDLE_VALUE) {
+		return false;
+	}
+
+	LARGE_INTEGER length;
+	if(!GetFileSizeEx(file, &length) || length.QuadPart == 0) {
+		CloseHandle(file);
+		return false;
+	}
+
+	HANDLE mapping = CreateFileMappingW(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+	if(!mapping) {
+		CloseHandle(file);
+		return false;
+	}
+
+	void* view = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+	if(!view) {
+		CloseHandle(mapping);
+		CloseHandle(file);
+		return false;
+	}
+
+	file_handle = file;
+	mapping_handle = mapping;
+	data = static_cast<const uint8_t*>(view);
+	data_size = static_cast<size_t>(length.QuadPart);
+	mapped = true;
+	return true;
+}
+
+void SpriteArchive::unmap()
+{
+	if(mapped) {
+		UnmapViewOfFile(data);
+		CloseHandle(mapping_handle);
+		CloseHandle(file_handle);
+		file_handle = nullptr;
+		mapping_handle = nullptr;
+		mapped = false;
+	}
+}
+
+#else
+
+bool SpriteArchive::map(const std::string& filename)
+{
+	int fd = ::open(filename.c_str(), O_RDONLY);
+	if(fd < 0) {
+		return false;
+	}
+
+	struct stat st;
+	if(fstat(fd, &st) != 0 || st.st_size == 0) {
+		::close(fd);
+		return false;
+	}
+
+	void* view = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+	// The mapping stays valid after the descriptor is closed
+	::close(fd);
+	if(view == MAP_FAILED) {
+		return false;
+	}
+
+	data = static_cast<const uint8_t*>(view);
+	data_size = static_cast<size_t>(st.st_size);
+	mapped = true;
+	return true;
+}
+
+void SpriteArchive::unmap()
+{
+	if(mapped) {
+		munmap(const_cast<uint8_t*>(data), data_size);
+		mapped = false;
+	}
+}
+
+#endif
@@ -0,0 +1,65 @@
+//////////////////////////////////////////////////////////////////////
+// This file is part of Remere's Map Editor
+//////////////////////////////////////////////////////////////////////
+// Remere's Map Editor is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// Remere's Map Editor is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <http://www.gnu.org/licenses/>.
+//////////////////////////////////////////////////////////////////////
+
+#ifndef RME_SPRITE_ARCHIVE_H_
+#define RME_SPRITE_ARCHIVE_H_
+
+// Read-only view of a client .spr file.
+// The file is memory mapped once, or read into memory in one go when
+// preloading (memcached sprites) or when mapping is not possible. Sprites
+// are handed out as pointers into it, nothing is copied or re-opened per
+// sprite.
+class SpriteArchive
+{
+public:
+	SpriteArchive();
+	~SpriteArchive();
+
+	SpriteArchive(const SpriteArchive&) = delete;
+	SpriteArchive& operator=(const SpriteArchive&) = delete;
+
+	bool open(const std::string& filename, bool extended, bool preload, wxString& error);
+	void close();
+
+	bool isOpen() const noexcept { return data != nullptr; }
+	uint32_t getSignature() const noexcept { return signature; }
+	uint32_t getSpriteCount() const noexcept { return static_cast<uint32_t>(offsets.size()); }
+
+	// Returns the compressed pixel data of a sprite, nullptr for empty,
+	// missing or out of bounds sprites (size is set to 0)
+	const uint8_t* getSprite(uint32_t id, uint16_t& size) const;
+
+private:
+	bool map(const std::string& filename);
+	void unmap();
+
+	const uint8_t* data;
+	size_t data_size;
+	bool mapped;
+	std::vector<uint8_t> buffer; // Used when preloading or if the file couldn't be mapped
+
+#ifdef __WINDOWS__
+	void* file_handle;
+	void* mapping_handle;
+#endif
+
+	uint32_t signature;
+	// offsets[id - 1] is the position of sprite id in the file, 0 means empty
+	std::vector<uint32_t> offsets;
+};
+
+#endif
@@ -0,0 +1,191 @@
+//////////////////////////////////////////////////////////////////////
+// This file is part of Remere's Map Editor
+//////////////////////////////////////////////////////////////////////
+// Remere's Map Editor is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// Remere's Map Editor is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <http://www.gnu.org/licenses/>.
+//////////////////////////////////////////////////////////////////////
+
+#include "main.h"
+
+#include "sprite_pixels.h"
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#	define RME_SPRITE_PIXELS_SSE2
+#	include <emmintrin.h>
+#endif
+
+namespace {
+	constexpr size_t ImageBytes = rme::SpritePixelsSize * rme::PixelFormatRGBA;
+
+	// Color multiplier in memory order (r, g, b, a), alpha is kept
+	inline uint32_t toMultiplier(uint32_t color)
+	{
+		return 0xFF000000 | (color & 0xFF) << 16 | (color & 0xFF00) | (color & 0xFF0000) >> 16;
+	}
+
+	// Exact x / 255 for every x up to 255 * 255
+	inline uint32_t divide255(uint32_t x)
+	{
+		return (x + 1 + (x >> 8)) >> 8;
+	}
+
+	void colorizeScalar(uint8_t* rgba, const uint8_t* template_rgba, const uint32_t (&multipliers)[8], size_t count)
+	{
+		for(size_t i = 0; i < count; ++i, rgba += 4, template_rgba += 4) {
+			// Bit 0 red, bit 1 green, bit 2 blue
+			int part = (template_rgba[0] != 0) | (template_rgba[1] != 0) << 1 | (template_rgba[2] != 0) << 2;
+			uint32_t multiplier = multipliers[part];
+			rgba[0] = divide255(rgba[0] * (multiplier & 0xFF));
+			rgba[1] = divide255(rgba[1] * (multiplier >> 8 & 0xFF));
+			rgba[2] = divide255(rgba[2] * (multiplier >> 16 & 0xFF));
+		}
+	}
+
+#ifdef RME_SPRITE_PIXELS_SSE2
+	inline __m128i divide255(__m128i x)
+	{
+		const __m128i one = _mm_set1_epi16(1);
+		return _mm_srli_epi16(_mm_add_epi16(_mm_add_epi16(x, one), _mm_srli_epi16(x, 8)), 8);
+	}
+
+	// Four pixels at a time, the part of every pixel is picked with masks
+	void colorizeSSE2(uint8_t* rgba, const uint8_t* template_rgba, const uint32_t (&multipliers)[8], size_t count)
+	{
+		const __m128i zero = _mm_setzero_si128();
+		const __m128i red_mask = _mm_set1_epi32(0x000000FF);
+		const __m128i green_mask = _mm_set1_epi32(0x0000FF00);
+		const __m128i blue_mask = _mm_set1_epi32(0x00FF0000);
+		const __m128i white = _mm_set1_epi32(-1);
+		const __m128i head = _mm_set1_epi32(int(multipliers[3]));
+		const __m128i body = _mm_set1_epi32(int(multipliers[1]));
+		const __m128i legs = _mm_set1_epi32(int(multipliers[2]));
+		const __m128i feet = _mm_set1_epi32(int(multipliers[4]));
+
+		size_t i = 0;
+		for(; i + 4 <= count; i += 4) {
+			__m128i pixels = _mm_loadu_si128(reinterpret_cast<const __m128i*>(rgba + i * 4));
+			__m128i parts = _mm_loadu_si128(reinterpret_cast<const __m128i*>(template_rgba + i * 4));
+
+			// All ones where the channel is zero
+			__m128i no_red = _mm_cmpeq_epi32(_mm_and_si128(parts, red_mask), zero);
+			__m128i no_green = _mm_cmpeq_epi32(_mm_and_si128(parts, green_mask), zero);
+			__m128i no_blue = _mm_cmpeq_epi32(_mm_and_si128(parts, blue_mask), zero);
+
+			__m128i is_head = _mm_andnot_si128(no_red, _mm_andnot_si128(no_green, no_blue));
+			__m128i is_body = _mm_andnot_si128(no_red, _mm_and_si128(no_green, no_blue));
+			__m128i is_legs = _mm_and_si128(no_red, _mm_andnot_si128(no_green, no_blue));
+			__m128i is_feet = _mm_andnot_si128(no_blue, _mm_and_si128(no_red, no_green));
+			__m128i other = _mm_xor_si128(_mm_or_si128(_mm_or_si128(is_head, is_body), _mm_or_si128(is_legs, is_feet)), white);
+
+			__m128i multiplier = _mm_or_si128(
+				_mm_or_si128(_mm_and_si128(is_head, head), _mm_and_si128(is_body, body)),
+				_mm_or_si128(_mm_or_si128(_mm_and_si128(is_legs, legs), _mm_and_si128(is_feet, feet)), other));
+
+			__m128i low = divide255(_mm_mullo_epi16(_mm_unpacklo_epi8(pixels, zero), _mm_unpacklo_epi8(multiplier, zero)));
+			__m128i high = divide255(_mm_mullo_epi16(_mm_unpackhi_epi8(pixels, zero), _mm_unpackhi_epi8(multiplier, zero)));
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(rgba + i * 4), _mm_packus_epi16(low, high));
+		}
+
+		colorizeScalar(rgba + i * 4, template_rgba + i * 4, multipliers, count - i);
+	}
+#endif
+}
+
+void decodeSpritePixels(const uint8_t* dump, size_t size, bool has_alpha, uint8_t* rgba)
+{
+	// Transparent runs are skipped over, colored runs are copied in one go
+	memset(rgba, 0, ImageBytes);
+
+	const size_t bpp = has_alpha ? 4 : 3;
+	size_t write = 0;
+	size_t read = 0;
+	while(read + 4 <= size && write < ImageBytes) {
+		size_t transparent = dump[read] | dump[read + 1] << 8;
+		if(has_alpha && transparent >= rme::SpritePixelsSize) // Corrupted sprite?
+			break;
+		read += 2;
+		write = std::min(ImageBytes, write + transparent * 4);
+
+		size_t colored = dump[read] | dump[read + 1] << 8;
+		read += 2;
+		colored = std::min(colored, std::min((ImageBytes - write) / 4, (size - read) / bpp));
+
+		if(has_alpha) {
+			memcpy(rgba + write, dump + read, colored * 4);
+		} else {
+			const uint8_t* source = dump + read;
+			uint8_t* target = rgba + write;
+			for(size_t i = 0; i < colored; ++i, source += 3, target += 4) {
+				target[0] = source[0];
+				target[1] = source[1];
+				target[2] = source[2];
+				target[3] = 0xFF;
+			}
+		}
+		write += colored * 4;
+		read += colored * bpp;
+	}
+}
+
+void colorizeOutfitPixels(uint8_t* rgba, const uint8_t* template_rgba, uint32_t head, uint32_t body, uint32_t legs, uint32_t feet)
+{
+	// Indexed by the template channels that are set, see colorizeScalar
+	const uint32_t multipliers[8] = {
+		0xFFFFFFFF, toMultiplier(body), toMultiplier(legs), toMultiplier(head),
+		toMultiplier(feet), 0xFFFFFFFF, 0xFFFFFFFF, 0xFFFFFFFF
+	};
+
+#ifdef RME_SPRITE_PIXELS_SSE2
+	colorizeSSE2(rgba, template_rgba, multipliers, rme::SpritePixelsSize);
+#else
+	colorizeScalar(rgba, template_rgba, multipliers, rme::SpritePixelsSize);
+#endif
+}
+
+bool OutfitCache::get(uint32_t image_id, uint32_t template_id, uint32_t color_hash, uint8_t* rgba)
+{
+	auto it = index.find(Key { image_id, template_id, color_hash });
+	if(it == index.end())
+		return false;
+
+	entries.splice(entries.begin(), entries, it->second);
+	memcpy(rgba, it->second->pixels.get(), ImageBytes);
+	return true;
+}
+
+void OutfitCache::put(uint32_t image_id, uint32_t template_id, uint32_t color_hash, const uint8_t* rgba)
+{
+	Key key { image_id, template_id, color_hash };
+	if(capacity == 0 || index.find(key) != index.end())
+		return;
+
+	std::unique_ptr<uint8_t[]> pixels;
+	if(entries.size() >= capacity) {
+		// Reuse the buffer of the oldest entry
+		pixels = std::move(entries.back().pixels);
+		index.erase(entries.back().key);
+		entries.pop_back();
+	} else {
+		pixels.reset(newd uint8_t[ImageBytes]);
+	}
+
+	memcpy(pixels.get(), rgba, ImageBytes);
+	entries.push_front(Entry { key, std::move(pixels) });
+	index[key] = entries.begin();
+}
+
+void OutfitCache::clear()
+{
+	index.clear();
+	entries.clear();
+}
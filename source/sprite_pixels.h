@@ -0,0 +1,72 @@
+//////////////////////////////////////////////////////////////////////
+// This file is part of Remere's Map Editor
+//////////////////////////////////////////////////////////////////////
+// Remere's Map Editor is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// Remere's Map Editor is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <http://www.gnu.org/licenses/>.
+//////////////////////////////////////////////////////////////////////
+
+#ifndef RME_SPRITE_PIXELS_H_
+#define RME_SPRITE_PIXELS_H_
+
+#include <list>
+#include <unordered_map>
+
+// Decodes one run length encoded image of the .spr file into 32x32 RGBA.
+// Transparent pixels are all zero, has_alpha tells if colored pixels are
+// stored with an alpha byte.
+void decodeSpritePixels(const uint8_t* dump, size_t size, bool has_alpha, uint8_t* rgba);
+
+// Multiplies every pixel of an outfit image by the head, body, legs or feet
+// color (0xRRGGBB) picked by the template pixel: yellow, red, green or blue.
+// Both images are 32x32 RGBA, other template colors leave the pixel as is.
+void colorizeOutfitPixels(uint8_t* rgba, const uint8_t* template_rgba, uint32_t head, uint32_t body, uint32_t legs, uint32_t feet);
+
+// Colorized outfit images, least recently used ones are dropped first.
+// Templates lose their texture to the garbage collector all the time in
+// areas full of creatures, this saves decoding and colorizing them again.
+class OutfitCache
+{
+public:
+	explicit OutfitCache(size_t capacity) : capacity(capacity) {}
+
+	// Copies the cached pixels into rgba, returns false if there are none
+	bool get(uint32_t image_id, uint32_t template_id, uint32_t color_hash, uint8_t* rgba);
+	void put(uint32_t image_id, uint32_t template_id, uint32_t color_hash, const uint8_t* rgba);
+	void clear();
+
+private:
+	struct Key {
+		uint32_t image_id;
+		uint32_t template_id;
+		uint32_t color_hash;
+		bool operator==(const Key&) const = default;
+	};
+
+	struct KeyHash {
+		size_t operator()(const Key& key) const noexcept {
+			uint64_t value = (uint64_t(key.image_id) << 32 | key.template_id) * 0x9E3779B97F4A7C15ull;
+			return size_t(value ^ key.color_hash);
+		}
+	};
+
+	struct Entry {
+		Key key;
+		std::unique_ptr<uint8_t[]> pixels;
+	};
+
+	size_t capacity;
+	std::list<Entry> entries; // Most recently used first
+	std::unordered_map<Key, std::list<Entry>::iterator, KeyHash> index;
+};
+
+#endif
@@ -35,6 +35,7 @@ void Waypoints::addWaypoint(Waypoint* wp)
 		if(!t)
 			map.setTile(wp->pos, t = map.allocator(map.createTileL(wp->pos)));
 		t->getLocation()->increaseWaypointCount();
+		map.invalidateSummary(wp->pos);
 	}
 	waypoints.insert(std::make_pair(as_lower_str(wp->name), wp));
 }
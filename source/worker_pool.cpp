@@ -0,0 +1,120 @@
+//////////////////////////////////////////////////////////////////////
+// This file is part of Remere's Map Editor
+//////////////////////////////////////////////////////////////////////
+// Remere's Map Editor is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// Remere's Map Editor is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <http://www.gnu.org/licenses/>.
+//////////////////////////////////////////////////////////////////////
+
+#include "main.h"
+#include "worker_pool.h"
+#include "settings.h"
+
+WorkerPool& WorkerPool::getInstance()
+{
+	static WorkerPool instance(getThreadSetting() - 1);
+	return instance;
+}
+
+size_t WorkerPool::getThreadSetting()
+{
+	int threads = g_settings.getInteger(Config::WORKER_THREADS);
+	if(threads > 0)
+		return threads;
+	return std::max(std::thread::hardware_concurrency(), 1u);
+}
+
+WorkerPool::WorkerPool(size_t thread_count) :
+	current_task(nullptr),
+	task_count(0),
+	next_task(0),
+	active_workers(0),
+	generation(0),
+	busy(false),
+	stopping(false)
+{
+	for(size_t i = 0; i < thread_count; ++i) {
+		threads.emplace_back(&WorkerPool::work, this);
+	}
+}
+
+WorkerPool::~WorkerPool()
+{
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		stopping = true;
+	}
+	wake.notify_all();
+	for(std::thread& thread : threads) {
+		thread.join();
+	}
+}
+
+void WorkerPool::run(size_t count, const std::function<void(size_t)>& task)
+{
+	if(count == 0)
+		return;
+
+	std::unique_lock<std::mutex> lock(mutex);
+	if(busy || threads.empty() || count == 1) {
+		lock.unlock();
+		for(size_t i = 0; i < count; ++i) {
+			task(i);
+		}
+		return;
+	}
+
+	busy = true;
+	current_task = &task;
+	task_count = count;
+	next_task = 0;
+	active_workers = threads.size();
+	++generation;
+	lock.unlock();
+	wake.notify_all();
+
+	drain();
+
+	lock.lock();
+	finished.wait(lock, [this]() { return active_workers == 0; });
+	current_task = nullptr;
+	busy = false;
+}
+
+void WorkerPool::work()
+{
+	uint64_t seen = 0;
+	while(true) {
+		{
+			std::unique_lock<std::mutex> lock(mutex);
+			wake.wait(lock, [this, seen]() { return stopping || generation != seen; });
+			if(stopping)
+				return;
+			seen = generation;
+		}
+
+		drain();
+
+		std::lock_guard<std::mutex> lock(mutex);
+		if(--active_workers == 0) {
+			finished.notify_one();
+		}
+	}
+}
+
+void WorkerPool::drain()
+{
+	const std::function<void(size_t)>& task = *current_task;
+	for(size_t i = next_task++; i < task_count; i = next_task++) {
+		task(i);
+	}
+}
@@ -0,0 +1,69 @@
+//////////////////////////////////////////////////////////////////////
+// This file is part of Remere's Map Editor
+//////////////////////////////////////////////////////////////////////
+// Remere's Map Editor is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// Remere's Map Editor is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <http://www.gnu.org/licenses/>.
+//////////////////////////////////////////////////////////////////////
+
+#ifndef RME_WORKER_POOL_H_
+#define RME_WORKER_POOL_H_
+
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+
+// A fixed set of threads for splitting short, frame sized jobs (like
+// recording map drawing commands) across cores. The calling thread works
+// along and run() only returns once every task finished.
+class WorkerPool
+{
+public:
+	// Sized after getThreadSetting() once, changing the setting takes a restart
+	static WorkerPool& getInstance();
+	// The "worker_threads" setting, or the core count when it is 0
+	static size_t getThreadSetting();
+
+	explicit WorkerPool(size_t thread_count);
+	~WorkerPool();
+
+	WorkerPool(const WorkerPool&) = delete;
+	WorkerPool& operator=(const WorkerPool&) = delete;
+
+	// Number of threads tasks run on, including the caller
+	size_t size() const noexcept { return threads.size() + 1; }
+
+	// Calls task(i) for every i below count. Tasks must not call run() again,
+	// nested calls just run inline on the calling thread.
+	void run(size_t count, const std::function<void(size_t)>& task);
+
+private:
+	void work();
+	void drain();
+
+	std::vector<std::thread> threads;
+	std::mutex mutex;
+	std::condition_variable wake;
+	std::condition_variable finished;
+
+	const std::function<void(size_t)>* current_task;
+	size_t task_count;
+	std::atomic<size_t> next_task;
+	size_t active_workers;
+	uint64_t generation;
+	bool busy;
+	bool stopping;
+};
+
+#endif
@@ -0,0 +1,962 @@
+//////////////////////////////////////////////////////////////////////
+// This file is part of Remere's Map Editor
+//////////////////////////////////////////////////////////////////////
+// Remere's Map Editor is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// Remere's Map Editor is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <http://www.gnu.org/licenses/>.
+//////////////////////////////////////////////////////////////////////
+
+// Live editing load generator.
+//
+// Connects N simulated mappers to a running live server (File > Live > Host
+// Server) and drives it with node requests, change lists and cursor updates
+// at fixed rates. At the end it prints message throughput, latency
+// percentiles per packet kind and, when given the server pid, the CPU time
+// the server process consumed during the run.
+//
+// Change lists overwrite tiles with a single ground item, so always run this
+// against a scratch copy of the map.
+
+#include "../source/definitions.h"
+#include "../source/live_packets.h"
+
+#include <asio.hpp>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <deque>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <random>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#ifdef __linux__
+#	include <unistd.h>
+#endif
+
+namespace
+{
+	using Clock = std::chrono::steady_clock;
+
+	// OTBM framing, mirrors filehandle.h and iomap_otbm.h
+	constexpr uint8_t NODE_START = 0xFE;
+	constexpr uint8_t NODE_END = 0xFF;
+	constexpr uint8_t ESCAPE_CHAR = 0xFD;
+	constexpr uint8_t OTBM_TILE = 5;
+	constexpr uint8_t OTBM_ATTR_ITEM = 9;
+
+	// The server hands out one bit of a 16 bit mask per client
+	constexpr int MAX_SERVER_CLIENTS = 16;
+
+	struct BenchOptions
+	{
+		std::string host = "127.0.0.1";
+		uint16_t port = 31313;
+		std::string password;
+		int clients = 8;
+		int threads = 0;
+		int duration = 30;
+		double nodeRate = 10.0;
+		int nodesPerRequest = 16;
+		double changeRate = 2.0;
+		int tilesPerChange = 4;
+		double cursorRate = 10.0;
+		int originX = 1000;
+		int originY = 1000;
+		int originZ = 7;
+		int spread = 64;
+		uint16_t itemId = 4526;
+		uint32_t clientVersion = 0;
+		int serverPid = 0;
+		uint32_t seed = 0x5EED;
+	};
+
+	enum LatencyKind
+	{
+		LATENCY_LOGIN,
+		LATENCY_NODE,
+		LATENCY_CHANGE,
+		LATENCY_CURSOR,
+		LATENCY_COUNT
+	};
+
+	const char* latencyNames[LATENCY_COUNT] = {
+		"login",
+		"node request",
+		"change fan-out",
+		"cursor fan-out",
+	};
+
+	struct Counters
+	{
+		uint64_t sentPackets[256] = {};
+		uint64_t receivedPackets[256] = {};
+		uint64_t sentBytes = 0;
+		uint64_t receivedBytes = 0;
+		uint64_t errors = 0;
+		std::vector<double> latency[LATENCY_COUNT];
+
+		void merge(const Counters& other) {
+			for(int i = 0; i < 256; ++i) {
+				sentPackets[i] += other.sentPackets[i];
+				receivedPackets[i] += other.receivedPackets[i];
+			}
+			sentBytes += other.sentBytes;
+			receivedBytes += other.receivedBytes;
+			errors += other.errors;
+			for(int i = 0; i < LATENCY_COUNT; ++i) {
+				latency[i].insert(latency[i].end(), other.latency[i].begin(), other.latency[i].end());
+			}
+		}
+	};
+
+	// State every mapper can see, used to attribute broadcasts to the
+	// mapper that caused them.
+	struct SharedState
+	{
+		struct ChangeStamp {
+			Clock::time_point time;
+			int sender;
+		};
+
+		std::mutex lock;
+		std::unordered_map<uint32_t, ChangeStamp> changes;
+		std::unordered_map<uint32_t, Clock::time_point> cursors;
+		std::atomic<int> connected { 0 };
+	};
+
+	double millisecondsSince(Clock::time_point start)
+	{
+		return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+	}
+
+	uint32_t makeNodeIndex(int x, int y, int z)
+	{
+		// Same encoding as LiveClient::queryNode and LiveSocket::sendNode
+		return ((x >> 2) << 18) | ((y >> 2) << 4) | (z > 7 ? 1 : 0);
+	}
+
+	//
+	class OutMessage
+	{
+		public:
+			OutMessage() : buffer(4, 0) {}
+
+			template<typename T> void write(T value) {
+				const uint8_t* bytes = reinterpret_cast<const uint8_t*>(&value);
+				buffer.insert(buffer.end(), bytes, bytes + sizeof(T));
+			}
+
+			void writeString(const std::string& value) {
+				write<uint16_t>(static_cast<uint16_t>(value.size()));
+				buffer.insert(buffer.end(), value.begin(), value.end());
+			}
+
+			std::shared_ptr<std::vector<uint8_t>> finish() {
+				const uint32_t size = static_cast<uint32_t>(buffer.size() - 4);
+				memcpy(&buffer[0], &size, 4);
+				return std::make_shared<std::vector<uint8_t>>(std::move(buffer));
+			}
+
+		private:
+			std::vector<uint8_t> buffer;
+	};
+
+	class InMessage
+	{
+		public:
+			InMessage(const std::vector<uint8_t>& buffer) : buffer(buffer), position(0) {}
+
+			template<typename T> bool read(T& value) {
+				if(position + sizeof(T) > buffer.size()) {
+					return false;
+				}
+				memcpy(&value, &buffer[position], sizeof(T));
+				position += sizeof(T);
+				return true;
+			}
+
+			bool readString(std::string& value) {
+				uint16_t length;
+				if(!read(length) || position + length > buffer.size()) {
+					return false;
+				}
+				value.assign(reinterpret_cast<const char*>(&buffer[position]), length);
+				position += length;
+				return true;
+			}
+
+		private:
+			const std::vector<uint8_t>& buffer;
+			size_t position;
+	};
+
+	template<typename T> void appendEscaped(std::string& stream, T value)
+	{
+		const uint8_t* bytes = reinterpret_cast<const uint8_t*>(&value);
+		for(size_t i = 0; i < sizeof(T); ++i) {
+			if(bytes[i] == NODE_START || bytes[i] == NODE_END || bytes[i] == ESCAPE_CHAR) {
+				stream.push_back(static_cast<char>(ESCAPE_CHAR));
+			}
+			stream.push_back(static_cast<char>(bytes[i]));
+		}
+	}
+
+	//
+	class Mapper
+	{
+		public:
+			Mapper(asio::io_context& service, const BenchOptions& options, SharedState& shared, int index);
+
+			void start(const asio::ip::tcp::resolver::results_type& endpoints);
+			void stop();
+
+			const Counters& getCounters() const { return counters; }
+
+		private:
+			void receiveHeader();
+			void receive(uint32_t packetSize);
+			void parsePacket();
+			void send(uint8_t packetType, std::shared_ptr<std::vector<uint8_t>> data);
+			void flush();
+			void fail(const std::string& reason);
+
+			void sendHello();
+			void sendReady();
+			void sendNodeRequest();
+			void sendChanges();
+			void sendCursor();
+
+			void schedule(asio::steady_timer& timer, double rate, void (Mapper::*action)());
+			void walk();
+
+			//
+			const BenchOptions& options;
+			SharedState& shared;
+			int index;
+
+			asio::ip::tcp::socket socket;
+			asio::steady_timer nodeTimer;
+			asio::steady_timer changeTimer;
+			asio::steady_timer cursorTimer;
+
+			std::vector<uint8_t> readBuffer;
+			std::deque<std::pair<uint8_t, std::shared_ptr<std::vector<uint8_t>>>> writeQueue;
+			std::unordered_map<uint32_t, Clock::time_point> pendingNodes;
+
+			std::mt19937 random;
+			int x, y;
+			int dx, dy;
+			Clock::time_point helloTime;
+			bool ready;
+			bool stopped;
+
+			Counters counters;
+	};
+
+	Mapper::Mapper(asio::io_context& service, const BenchOptions& options, SharedState& shared, int index) :
+		options(options), shared(shared), index(index),
+		socket(service), nodeTimer(service), changeTimer(service), cursorTimer(service),
+		random(options.seed + index), x(options.originX), y(options.originY), dx(1), dy(0),
+		ready(false), stopped(false)
+	{
+		std::uniform_int_distribution<int> offset(-options.spread, options.spread);
+		x += offset(random);
+		y += offset(random);
+
+		static const int directions[4][2] = { { 1, 0 }, { -1, 0 }, { 0, 1 }, { 0, -1 } };
+		dx = directions[index & 3][0];
+		dy = directions[index & 3][1];
+	}
+
+	void Mapper::start(const asio::ip::tcp::resolver::results_type& endpoints)
+	{
+		asio::async_connect(socket, endpoints,
+			[this](const std::error_code& error, const asio::ip::tcp::endpoint&) {
+				if(error) {
+					fail("connect: " + error.message());
+					return;
+				}
+
+				asio::error_code ignored;
+				socket.set_option(asio::ip::tcp::no_delay(true), ignored);
+
+				sendHello();
+				receiveHeader();
+			});
+	}
+
+	void Mapper::stop()
+	{
+		stopped = true;
+		nodeTimer.cancel();
+		changeTimer.cancel();
+		cursorTimer.cancel();
+
+		asio::error_code ignored;
+		socket.shutdown(asio::ip::tcp::socket::shutdown_both, ignored);
+		socket.close(ignored);
+	}
+
+	void Mapper::fail(const std::string& reason)
+	{
+		if(stopped) {
+			return;
+		}
+
+		++counters.errors;
+		std::cerr << "mapper " << index << ": " << reason << std::endl;
+		if(ready) {
+			--shared.connected;
+		}
+		stop();
+	}
+
+	void Mapper::receiveHeader()
+	{
+		readBuffer.resize(4);
+		asio::async_read(socket, asio::buffer(readBuffer),
+			[this](const std::error_code& error, size_t) {
+				if(error) {
+					fail("receive: " + error.message());
+					return;
+				}
+
+				uint32_t packetSize;
+				memcpy(&packetSize, readBuffer.data(), 4);
+				if(packetSize == 0) {
+					fail("received an empty packet");
+					return;
+				}
+				receive(packetSize);
+			});
+	}
+
+	void Mapper::receive(uint32_t packetSize)
+	{
+		readBuffer.resize(packetSize);
+		asio::async_read(socket, asio::buffer(readBuffer),
+			[this](const std::error_code& error, size_t bytesReceived) {
+				if(error) {
+					fail("receive: " + error.message());
+					return;
+				}
+
+				counters.receivedBytes += bytesReceived + 4;
+				parsePacket();
+				if(!stopped) {
+					receiveHeader();
+				}
+			});
+	}
+
+	void Mapper::parsePacket()
+	{
+		InMessage message(readBuffer);
+
+		uint8_t packetType;
+		message.read(packetType);
+		++counters.receivedPackets[packetType];
+
+		switch(packetType) {
+			case PACKET_ACCEPTED_CLIENT:
+			case PACKET_CHANGE_CLIENT_VERSION:
+				// The server tells us which client version it runs, we don't
+				// load any data files so there is nothing to switch.
+				sendReady();
+				break;
+			case PACKET_HELLO_FROM_SERVER: {
+				counters.latency[LATENCY_LOGIN].push_back(millisecondsSince(helloTime));
+				ready = true;
+				++shared.connected;
+
+				schedule(nodeTimer, options.nodeRate, &Mapper::sendNodeRequest);
+				schedule(changeTimer, options.changeRate, &Mapper::sendChanges);
+				schedule(cursorTimer, options.cursorRate, &Mapper::sendCursor);
+				break;
+			}
+			case PACKET_KICK: {
+				std::string reason;
+				message.readString(reason);
+				fail("kicked: " + reason);
+				break;
+			}
+			case PACKET_NODE: {
+				uint32_t node;
+				if(!message.read(node)) {
+					fail("malformed node packet");
+					break;
+				}
+
+				auto it = pendingNodes.find(node);
+				if(it != pendingNodes.end()) {
+					counters.latency[LATENCY_NODE].push_back(millisecondsSince(it->second));
+					pendingNodes.erase(it);
+					break;
+				}
+
+				// Not something we asked for, so it's a broadcast caused by
+				// another mapper's change list.
+				std::lock_guard<std::mutex> guard(shared.lock);
+				auto change = shared.changes.find(node);
+				if(change != shared.changes.end() && change->second.sender != index) {
+					counters.latency[LATENCY_CHANGE].push_back(millisecondsSince(change->second.time));
+				}
+				break;
+			}
+			case PACKET_CURSOR_UPDATE: {
+				uint32_t id;
+				uint32_t color;
+				if(!message.read(id) || !message.read(color)) {
+					fail("malformed cursor packet");
+					break;
+				}
+
+				std::lock_guard<std::mutex> guard(shared.lock);
+				auto it = shared.cursors.find(color);
+				if(it != shared.cursors.end()) {
+					counters.latency[LATENCY_CURSOR].push_back(millisecondsSince(it->second));
+				}
+				break;
+			}
+			default:
+				break;
+		}
+	}
+
+	void Mapper::send(uint8_t packetType, std::shared_ptr<std::vector<uint8_t>> data)
+	{
+		if(stopped) {
+			return;
+		}
+
+		writeQueue.emplace_back(packetType, std::move(data));
+		if(writeQueue.size() == 1) {
+			flush();
+		}
+	}
+
+	void Mapper::flush()
+	{
+		const auto& data = writeQueue.front().second;
+		asio::async_write(socket, asio::buffer(*data),
+			[this](const std::error_code& error, size_t bytesTransferred) {
+				if(error) {
+					fail("send: " + error.message());
+					return;
+				}
+
+				++counters.sentPackets[writeQueue.front().first];
+				counters.sentBytes += bytesTransferred;
+
+				writeQueue.pop_front();
+				if(!writeQueue.empty()) {
+					flush();
+				}
+			});
+	}
+
+	void Mapper::schedule(asio::steady_timer& timer, double rate, void (Mapper::*action)())
+	{
+		if(rate <= 0.0 || stopped) {
+			return;
+		}
+
+		// Jitter the interval a little so the mappers don't fire in lockstep
+		std::uniform_real_distribution<double> jitter(0.8, 1.2);
+		const auto interval = std::chrono::duration<double>(jitter(random) / rate);
+
+		timer.expires_after(std::chrono::duration_cast<Clock::duration>(interval));
+		timer.async_wait([this, &timer, rate, action](const std::error_code& error) {
+			if(error || stopped) {
+				return;
+			}
+			(this->*action)();
+			schedule(timer, rate, action);
+		});
+	}
+
+	void Mapper::walk()
+	{
+		// Scroll one node at a time, turning around at the edge of the area
+		// and sometimes changing direction like a mapper would.
+		std::uniform_int_distribution<int> turn(0, 15);
+		if(turn(random) == 0) {
+			std::swap(dx, dy);
+		}
+
+		x += dx * 4;
+		y += dy * 4;
+
+		if(x < options.originX - options.spread || x > options.originX + options.spread) {
+			dx = -dx;
+			x += dx * 8;
+		}
+		if(y < options.originY - options.spread || y > options.originY + options.spread) {
+			dy = -dy;
+			y += dy * 8;
+		}
+	}
+
+	void Mapper::sendHello()
+	{
+		std::ostringstream name;
+		name << "bench" << index;
+
+		OutMessage message;
+		message.write<uint8_t>(PACKET_HELLO_FROM_CLIENT);
+		message.write<uint32_t>(__RME_VERSION_ID__);
+		message.write<uint32_t>(__LIVE_NET_VERSION__);
+		message.write<uint32_t>(options.clientVersion);
+		message.writeString(name.str());
+		message.writeString(options.password);
+
+		helloTime = Clock::now();
+		send(PACKET_HELLO_FROM_CLIENT, message.finish());
+	}
+
+	void Mapper::sendReady()
+	{
+		OutMessage message;
+		message.write<uint8_t>(PACKET_READY_CLIENT);
+		send(PACKET_READY_CLIENT, message.finish());
+	}
+
+	void Mapper::sendNodeRequest()
+	{
+		walk();
+
+		// Request a square window of nodes around the mapper, like the
+		// viewport does when it scrolls into unknown territory.
+		const int side = std::max(1, static_cast<int>(std::ceil(std::sqrt(static_cast<double>(options.nodesPerRequest)))));
+		const int startX = x - (side / 2) * 4;
+		const int startY = y - (side / 2) * 4;
+		const auto now = Clock::now();
+
+		std::vector<uint32_t> nodes;
+		for(int i = 0; i < side && static_cast<int>(nodes.size()) < options.nodesPerRequest; ++i) {
+			for(int j = 0; j < side && static_cast<int>(nodes.size()) < options.nodesPerRequest; ++j) {
+				const int nx = startX + i * 4;
+				const int ny = startY + j * 4;
+				if(nx < 0 || ny < 0 || nx > 0xFFFF || ny > 0xFFFF) {
+					continue;
+				}
+
+				const uint32_t node = makeNodeIndex(nx, ny, options.originZ);
+				if(pendingNodes.emplace(node, now).second) {
+					nodes.push_back(node);
+				}
+			}
+		}
+
+		if(nodes.empty()) {
+			return;
+		}
+
+		OutMessage message;
+		message.write<uint8_t>(PACKET_REQUEST_NODES);
+		message.write<uint32_t>(static_cast<uint32_t>(nodes.size()));
+		for(uint32_t node : nodes) {
+			message.write<uint32_t>(node);
+		}
+		send(PACKET_REQUEST_NODES, message.finish());
+	}
+
+	void Mapper::sendChanges()
+	{
+		std::uniform_int_distribution<int> offset(-8, 8);
+
+		// Same layout LiveClient::sendChanges produces, the leading
+		// NODE_START is skipped by the server.
+		std::string stream;
+		std::vector<uint32_t> nodes;
+		for(int i = 0; i < options.tilesPerChange; ++i) {
+			const uint16_t tileX = static_cast<uint16_t>(std::clamp(x + offset(random), 0, 0xFFFF));
+			const uint16_t tileY = static_cast<uint16_t>(std::clamp(y + offset(random), 0, 0xFFFF));
+			const uint8_t tileZ = static_cast<uint8_t>(options.originZ);
+
+			stream.push_back(static_cast<char>(NODE_START));
+			stream.push_back(static_cast<char>(OTBM_TILE));
+			appendEscaped(stream, tileX);
+			appendEscaped(stream, tileY);
+			appendEscaped(stream, tileZ);
+			appendEscaped(stream, OTBM_ATTR_ITEM);
+			appendEscaped(stream, options.itemId);
+			stream.push_back(static_cast<char>(NODE_END));
+
+			nodes.push_back(makeNodeIndex(tileX, tileY, tileZ));
+		}
+		stream.push_back(static_cast<char>(NODE_END));
+
+		if(stream.size() > 0xFFFF) {
+			fail("change list does not fit in a single packet, lower --tiles-per-change");
+			return;
+		}
+
+		{
+			std::lock_guard<std::mutex> guard(shared.lock);
+			const auto now = Clock::now();
+			for(uint32_t node : nodes) {
+				shared.changes[node] = { now, index };
+			}
+		}
+
+		OutMessage message;
+		message.write<uint8_t>(PACKET_CHANGE_LIST);
+		message.writeString(stream);
+		send(PACKET_CHANGE_LIST, message.finish());
+	}
+
+	void Mapper::sendCursor()
+	{
+		std::uniform_int_distribution<int> offset(-8, 8);
+
+		// Every mapper uses its own color so receivers can tell who moved
+		const uint32_t color = (static_cast<uint32_t>(index & 0xFF)) |
+			(static_cast<uint32_t>((index >> 8) & 0xFF) << 8) |
+			(0xB5u << 16) | (0xFFu << 24);
+
+		OutMessage message;
+		message.write<uint8_t>(PACKET_CLIENT_UPDATE_CURSOR);
+		message.write<uint32_t>(77); // The server fixes the id for us
+		message.write<uint32_t>(color);
+		message.write<uint16_t>(static_cast<uint16_t>(std::clamp(x + offset(random), 0, 0xFFFF)));
+		message.write<uint16_t>(static_cast<uint16_t>(std::clamp(y + offset(random), 0, 0xFFFF)));
+		message.write<uint8_t>(static_cast<uint8_t>(options.originZ));
+
+		{
+			std::lock_guard<std::mutex> guard(shared.lock);
+			shared.cursors[color] = Clock::now();
+		}
+		send(PACKET_CLIENT_UPDATE_CURSOR, message.finish());
+	}
+
+	// Total user + system CPU time of another process, in seconds
+	bool getProcessCpuTime(int pid, double& seconds)
+	{
+		if(pid <= 0) {
+			return false;
+		}
+
+#if defined(_WIN32)
+		HANDLE process = OpenProcess(PROCESS_QUERY_LIMITED_INFORMATION, FALSE, static_cast<DWORD>(pid));
+		if(!process) {
+			return false;
+		}
+
+		FILETIME creation, exit, kernel, user;
+		const bool success = GetProcessTimes(process, &creation, &exit, &kernel, &user) != 0;
+		CloseHandle(process);
+		if(!success) {
+			return false;
+		}
+
+		auto toSeconds = [](const FILETIME& time) {
+			ULARGE_INTEGER value;
+			value.LowPart = time.dwLowDateTime;
+			value.HighPart = time.dwHighDateTime;
+			return static_cast<double>(value.QuadPart) / 1e7;
+		};
+		seconds = toSeconds(kernel) + toSeconds(user);
+		return true;
+#elif defined(__linux__)
+		std::ifstream file("/proc/" + std::to_string(pid) + "/stat");
+		std::string line;
+		if(!file || !std::getline(file, line)) {
+			return false;
+		}
+
+		// The command name may contain spaces, the fields we want come after it
+		const size_t end = line.rfind(')');
+		if(end == std::string::npos) {
+			return false;
+		}
+
+		std::istringstream fields(line.substr(end + 2));
+		std::string field;
+		unsigned long long utime = 0, stime = 0;
+		for(int i = 3; i <= 15 && (fields >> field); ++i) {
+			if(i == 14) {
+				utime = std::stoull(field);
+			} else if(i == 15) {
+				stime = std::stoull(field);
+			}
+		}
+
+		seconds = static_cast<double>(utime + stime) / sysconf(_SC_CLK_TCK);
+		return true;
+#else
+		return false;
+#endif
+	}
+
+	double percentile(const std::vector<double>& sorted, double p)
+	{
+		if(sorted.empty()) {
+			return 0.0;
+		}
+		const size_t rank = static_cast<size_t>(std::ceil(p / 100.0 * sorted.size()));
+		return sorted[std::min(sorted.size() - 1, rank > 0 ? rank - 1 : 0)];
+	}
+
+	void printUsage()
+	{
+		std::cout <<
+			"Usage: rme_live_bench [options]\n"
+			"\n"
+			"  --host <address>           live server address (127.0.0.1)\n"
+			"  --port <port>              live server port (31313)\n"
+			"  --password <password>      live server password\n"
+			"  --clients <n>              simulated mappers (8, the server accepts 16)\n"
+			"  --threads <n>              network threads (one per mapper, up to the core count)\n"
+			"  --duration <seconds>       length of the run (30)\n"
+			"  --node-rate <hz>           node requests per mapper per second (10)\n"
+			"  --nodes-per-request <n>    nodes in each request (16)\n"
+			"  --change-rate <hz>         change lists per mapper per second (2)\n"
+			"  --tiles-per-change <n>     tiles in each change list (4)\n"
+			"  --cursor-rate <hz>         cursor updates per mapper per second (10)\n"
+			"  --origin <x> <y> <z>       center of the mapping area (1000 1000 7)\n"
+			"  --spread <tiles>           half size of the mapping area (64)\n"
+			"  --item <id>                ground item written by change lists (4526)\n"
+			"  --client-version <id>      client version id sent in the handshake (0)\n"
+			"  --server-pid <pid>         measure the CPU time of this process\n"
+			"  --seed <n>                 random seed (24301)\n"
+			"\n"
+			"A rate of 0 disables that kind of traffic.\n";
+	}
+
+	bool parseOptions(int argc, char** argv, BenchOptions& options)
+	{
+		auto next = [&](int& i) -> const char* {
+			if(i + 1 >= argc) {
+				throw std::invalid_argument(std::string("missing value for ") + argv[i]);
+			}
+			return argv[++i];
+		};
+
+		try {
+			for(int i = 1; i < argc; ++i) {
+				const std::string arg = argv[i];
+				if(arg == "--help" || arg == "-h") {
+					printUsage();
+					return false;
+				} else if(arg == "--host") {
+					options.host = next(i);
+				} else if(arg == "--port") {
+					options.port = static_cast<uint16_t>(std::stoi(next(i)));
+				} else if(arg == "--password") {
+					options.password = next(i);
+				} else if(arg == "--clients") {
+					options.clients = std::stoi(next(i));
+				} else if(arg == "--threads") {
+					options.threads = std::stoi(next(i));
+				} else if(arg == "--duration") {
+					options.duration = std::stoi(next(i));
+				} else if(arg == "--node-rate") {
+					options.nodeRate = std::stod(next(i));
+				} else if(arg == "--nodes-per-request") {
+					options.nodesPerRequest = std::stoi(next(i));
+				} else if(arg == "--change-rate") {
+					options.changeRate = std::stod(next(i));
+				} else if(arg == "--tiles-per-change") {
+					options.tilesPerChange = std::stoi(next(i));
+				} else if(arg == "--cursor-rate") {
+					options.cursorRate = std::stod(next(i));
+				} else if(arg == "--origin") {
+					options.originX = std::stoi(next(i));
+					options.originY = std::stoi(next(i));
+					options.originZ = std::stoi(next(i));
+				} else if(arg == "--spread") {
+					options.spread = std::stoi(next(i));
+				} else if(arg == "--item") {
+					options.itemId = static_cast<uint16_t>(std::stoi(next(i)));
+				} else if(arg == "--client-version") {
+					options.clientVersion = static_cast<uint32_t>(std::stoul(next(i)));
+				} else if(arg == "--server-pid") {
+					options.serverPid = std::stoi(next(i));
+				} else if(arg == "--seed") {
+					options.seed = static_cast<uint32_t>(std::stoul(next(i)));
+				} else {
+					throw std::invalid_argument("unknown option " + arg);
+				}
+			}
+		} catch(std::exception& e) {
+			std::cerr << "rme_live_bench: " << e.what() << std::endl;
+			printUsage();
+			return false;
+		}
+
+		if(options.clients < 1 || options.duration < 1 || options.nodesPerRequest < 1 || options.tilesPerChange < 1 || options.spread < 0) {
+			std::cerr << "rme_live_bench: counts and durations must be positive" << std::endl;
+			return false;
+		}
+
+		if(options.originZ < 0 || options.originZ > 15) {
+			std::cerr << "rme_live_bench: floor must be in the range 0-15" << std::endl;
+			return false;
+		}
+		return true;
+	}
+}
+
+int main(int argc, char** argv)
+{
+	BenchOptions options;
+	if(!parseOptions(argc, argv, options)) {
+		return 1;
+	}
+
+	if(options.clients > MAX_SERVER_CLIENTS) {
+		std::cerr << "warning: the server only accepts " << MAX_SERVER_CLIENTS << " clients, the rest will be kicked" << std::endl;
+	}
+
+	int threadCount = options.threads;
+	if(threadCount <= 0) {
+		threadCount = std::max(1u, std::thread::hardware_concurrency());
+	}
+	threadCount = std::min(threadCount, options.clients);
+
+	// One io_context per thread, a mapper lives on exactly one of them so
+	// its handlers never run concurrently.
+	std::vector<std::unique_ptr<asio::io_context>> services;
+	std::vector<asio::executor_work_guard<asio::io_context::executor_type>> guards;
+	for(int i = 0; i < threadCount; ++i) {
+		services.push_back(std::make_unique<asio::io_context>(1));
+		guards.push_back(asio::make_work_guard(*services.back()));
+	}
+
+	asio::ip::tcp::resolver::results_type endpoints;
+	try {
+		asio::ip::tcp::resolver resolver(*services.front());
+		endpoints = resolver.resolve(options.host, std::to_string(options.port));
+	} catch(std::exception& e) {
+		std::cerr << "rme_live_bench: could not resolve " << options.host << ": " << e.what() << std::endl;
+		return 1;
+	}
+
+	SharedState shared;
+	std::vector<std::unique_ptr<Mapper>> mappers;
+	for(int i = 0; i < options.clients; ++i) {
+		mappers.push_back(std::make_unique<Mapper>(*services[i % threadCount], options, shared, i));
+	}
+
+	double serverCpuStart = 0.0;
+	const bool measureServer = getProcessCpuTime(options.serverPid, serverCpuStart);
+	if(options.serverPid > 0 && !measureServer) {
+		std::cerr << "warning: can't read the CPU time of process " << options.serverPid << std::endl;
+	}
+
+	const auto start = Clock::now();
+	for(auto& mapper : mappers) {
+		mapper->start(endpoints);
+	}
+
+	std::vector<std::thread> threads;
+	for(auto& service : services) {
+		threads.emplace_back([&service]() { service->run(); });
+	}
+
+	std::this_thread::sleep_for(std::chrono::seconds(options.duration));
+
+	for(int i = 0; i < options.clients; ++i) {
+		Mapper* mapper = mappers[i].get();
+		asio::post(*services[i % threadCount], [mapper]() { mapper->stop(); });
+	}
+	for(auto& guard : guards) {
+		guard.reset();
+	}
+	for(auto& thread : threads) {
+		thread.join();
+	}
+
+	const double elapsed = std::chrono::duration<double>(Clock::now() - start).count();
+
+	double serverCpuEnd = 0.0;
+	const bool serverMeasured = measureServer && getProcessCpuTime(options.serverPid, serverCpuEnd);
+
+	Counters total;
+	for(auto& mapper : mappers) {
+		total.merge(mapper->getCounters());
+	}
+
+	// Report
+	uint64_t sentPackets = 0, receivedPackets = 0;
+	for(int i = 0; i < 256; ++i) {
+		sentPackets += total.sentPackets[i];
+		receivedPackets += total.receivedPackets[i];
+	}
+
+	char line[256];
+	std::cout << "rme_live_bench: " << options.clients << " mappers against " << options.host << ":" << options.port
+		<< " for " << options.duration << "s (" << threadCount << " threads)\n";
+	std::cout << "connected at the end: " << shared.connected.load() << ", errors: " << total.errors << "\n\n";
+
+	std::cout << "packet                      sent    received\n";
+	const std::pair<LivePacketType, const char*> packetNames[] = {
+		{ PACKET_REQUEST_NODES, "request nodes" },
+		{ PACKET_CHANGE_LIST, "change list" },
+		{ PACKET_CLIENT_UPDATE_CURSOR, "cursor update (out)" },
+		{ PACKET_NODE, "node" },
+		{ PACKET_CURSOR_UPDATE, "cursor update (in)" },
+		{ PACKET_KICK, "kick" },
+	};
+	for(const auto& entry : packetNames) {
+		snprintf(line, sizeof(line), "%-22s %10llu  %10llu\n", entry.second,
+			static_cast<unsigned long long>(total.sentPackets[entry.first]),
+			static_cast<unsigned long long>(total.receivedPackets[entry.first]));
+		std::cout << line;
+	}
+
+	snprintf(line, sizeof(line), "\nthroughput: %.1f msg/s out, %.1f msg/s in, %.1f KiB/s out, %.1f KiB/s in\n\n",
+		sentPackets / elapsed, receivedPackets / elapsed,
+		total.sentBytes / 1024.0 / elapsed, total.receivedBytes / 1024.0 / elapsed);
+	std::cout << line;
+
+	std::cout << "latency (ms)           samples     mean      p50      p90      p99      max\n";
+	for(int kind = 0; kind < LATENCY_COUNT; ++kind) {
+		std::vector<double>& samples = total.latency[kind];
+		std::sort(samples.begin(), samples.end());
+
+		double sum = 0.0;
+		for(double sample : samples) {
+			sum += sample;
+		}
+
+		snprintf(line, sizeof(line), "%-20s %10zu %8.2f %8.2f %8.2f %8.2f %8.2f\n", latencyNames[kind], samples.size(),
+			samples.empty() ? 0.0 : sum / samples.size(),
+			percentile(samples, 50.0), percentile(samples, 90.0), percentile(samples, 99.0),
+			samples.empty() ? 0.0 : samples.back());
+		std::cout << line;
+	}
+
+	if(serverMeasured) {
+		const double cpu = serverCpuEnd - serverCpuStart;
+		snprintf(line, sizeof(line), "\nserver cpu: %.2fs over %.2fs (%.1f%% of one core)\n", cpu, elapsed, 100.0 * cpu / elapsed);
+		std::cout << line;
+	} else {
+		std::cout << "\nserver cpu: not measured (pass --server-pid)\n";
+	}
+
+	return total.errors > 0 && shared.connected.load() == 0 ? 1 : 0;
+}